@@ -0,0 +1,201 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "allanVariance.h"
+#include <cmath>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+AllanVariance::AllanVariance()
+{
+    reset();
+}
+//--------------------------------------------------------------------------------------------------
+void AllanVariance::reset()
+{
+    for (uint_t k = 0; k < maxLevels; k++)
+    {
+        for (uint_t p = 0; p < phases; p++)
+        {
+            Cluster& c = m_clusters[k][p];
+            for (uint_t a = 0; a < 3; a++)
+            {
+                c.thetaStart[a] = 0;
+                c.prevMean[a] = 0;
+                c.sumSq[a] = 0;
+            }
+            c.diffs = 0;
+            c.started = p == 0;
+            c.havePrev = false;
+        }
+    }
+
+    for (uint_t a = 0; a < 3; a++)
+    {
+        m_theta[a] = 0;
+        m_first[a] = 0;
+    }
+    m_count = 0;
+    m_firstUs = 0;
+    m_lastUs = 0;
+    m_timedCount = 0;
+}
+//--------------------------------------------------------------------------------------------------
+void AllanVariance::add(real_t x, real_t y, real_t z)
+{
+    if (m_count == 0)
+    {
+        m_first[0] = x;
+        m_first[1] = y;
+        m_first[2] = z;
+    }
+
+    // Removing the first sample keeps the running sum small so precision holds over long runs
+    m_theta[0] += x - m_first[0];
+    m_theta[1] += y - m_first[1];
+    m_theta[2] += z - m_first[2];
+    m_count++;
+
+    for (uint_t k = 0; k < maxLevels; k++)
+    {
+        const uint_t m = static_cast<uint_t>(1) << k;
+        const uint_t p = m < phases ? m : phases;
+        const uint_t step = m / p;
+
+        if (m_count & (step - 1))
+        {
+            break;                                  // Not a boundary at this octave so not at any higher one either
+        }
+
+        Cluster& c = m_clusters[k][(m_count & (m - 1)) / step];
+
+        if (c.started)
+        {
+            for (uint_t a = 0; a < 3; a++)
+            {
+                const real_t mean = (m_theta[a] - c.thetaStart[a]) / m;
+                if (c.havePrev)
+                {
+                    const real_t diff = mean - c.prevMean[a];
+                    c.sumSq[a] += diff * diff;
+                }
+                c.prevMean[a] = mean;
+            }
+
+            if (c.havePrev)
+            {
+                c.diffs++;
+            }
+            c.havePrev = true;
+        }
+
+        c.started = true;
+        c.thetaStart[0] = m_theta[0];
+        c.thetaStart[1] = m_theta[1];
+        c.thetaStart[2] = m_theta[2];
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void AllanVariance::callbackBlock(const ImuBlock& block)
+{
+    if (block.count == 0)
+    {
+        return;
+    }
+
+    if (m_timedCount == 0)
+    {
+        m_firstUs = block.timeUs[0];
+    }
+    m_lastUs = block.timeUs[block.count - 1];
+    m_timedCount += block.count;
+
+    for (uint_t i = 0; i < block.count; i++)
+    {
+        add(block.x[i], block.y[i], block.z[i]);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+real_t AllanVariance::samplePeriodS() const
+{
+    if (m_timedCount < 2)
+    {
+        return 0;
+    }
+    return (m_lastUs - m_firstUs) * 0.000001 / (m_timedCount - 1);
+}
+//--------------------------------------------------------------------------------------------------
+std::vector<AllanVariance::Point> AllanVariance::compute() const
+{
+    std::vector<Point> points;
+    const real_t tau0 = samplePeriodS();
+
+    for (uint_t k = 0; k < maxLevels; k++)
+    {
+        Point point;
+        real_t sumSq[3] = { 0, 0, 0 };
+
+        point.tauS = tau0 * (static_cast<uint_t>(1) << k);
+        point.clusters = 0;
+
+        for (uint_t p = 0; p < phases; p++)
+        {
+            const Cluster& c = m_clusters[k][p];
+            sumSq[0] += c.sumSq[0];
+            sumSq[1] += c.sumSq[1];
+            sumSq[2] += c.sumSq[2];
+            point.clusters += c.diffs;
+        }
+
+        // Need a few cluster differences before the estimate means anything
+        if (point.clusters < 3)
+        {
+            break;
+        }
+
+        for (uint_t a = 0; a < 3; a++)
+        {
+            point.adev[a] = std::sqrt(sumSq[a] / (2.0 * point.clusters));
+        }
+        points.push_back(point);
+    }
+
+    return points;
+}
+//--------------------------------------------------------------------------------------------------
+AllanVariance::Noise AllanVariance::noise(const std::vector<Point>& points)
+{
+    Noise noise;
+
+    for (uint_t a = 0; a < 3; a++)
+    {
+        real_t bestSlopeErr = 1e9;
+        noise.randomWalk[a] = 0;
+        noise.biasInstability[a] = 0;
+        noise.biasInstabilityTauS[a] = 0;
+
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            // Random walk is read from the -1/2 slope region, taken as the point whose local slope is closest to -1/2
+            if (i + 1 < points.size() && points[i].adev[a] > 0 && points[i + 1].adev[a] > 0)
+            {
+                const real_t slope = std::log(points[i + 1].adev[a] / points[i].adev[a]) / std::log(points[i + 1].tauS / points[i].tauS);
+                const real_t err = std::fabs(slope + 0.5);
+                if (err < bestSlopeErr)
+                {
+                    bestSlopeErr = err;
+                    noise.randomWalk[a] = points[i].adev[a] * std::sqrt(points[i].tauS);
+                }
+            }
+
+            // Bias instability is the flicker floor, the minimum of the curve scaled by sqrt(2 ln2 / pi)
+            if (noise.biasInstabilityTauS[a] == 0 || points[i].adev[a] / 0.664 < noise.biasInstability[a])
+            {
+                noise.biasInstability[a] = points[i].adev[a] / 0.664;
+                noise.biasInstabilityTauS[a] = points[i].tauS;
+            }
+        }
+    }
+    return noise;
+}
+//--------------------------------------------------------------------------------------------------
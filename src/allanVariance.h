@@ -0,0 +1,71 @@
+#ifndef ALLANVARIANCE_H_
+#define ALLANVARIANCE_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "imuManager.h"
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Streaming three axis Allan deviation. Cluster sizes are octave spaced (1, 2, 4 ... samples) and
+    // each octave runs a number of phase shifted cluster accumulators, giving a partially overlapping
+    // estimate in O(log n) memory however long the run is. Cluster sums are taken as differences of a
+    // running sum at cluster boundaries so each sample costs one boundary check per octave.
+    class AllanVariance
+    {
+    public:
+        struct Point
+        {
+            real_t tauS;
+            real_t adev[3];
+            uint_t clusters;
+        };
+
+        struct Noise
+        {
+            real_t randomWalk[3];                   // Angle or velocity random walk, units / sqrt(Hz)
+            real_t biasInstability[3];              // Flicker floor, units
+            real_t biasInstabilityTauS[3];
+        };
+
+        AllanVariance();
+        void reset();
+        void add(real_t x, real_t y, real_t z);
+        uint_t sampleCount() const { return m_count; }
+        real_t samplePeriodS() const;
+        std::vector<Point> compute() const;
+        static Noise noise(const std::vector<Point>& points);
+
+        Slot<const ImuBlock&> slotBlock{ this, &AllanVariance::callbackBlock };
+
+    private:
+        static constexpr uint_t maxLevels = 32;
+        static constexpr uint_t phases = 8;
+
+        struct Cluster
+        {
+            real_t thetaStart[3];
+            real_t prevMean[3];
+            real_t sumSq[3];
+            uint_t diffs;
+            bool_t started;
+            bool_t havePrev;
+        };
+
+        Cluster m_clusters[maxLevels][phases];
+        real_t m_theta[3];                          // Running sum of samples less the first sample
+        real_t m_first[3];
+        uint_t m_count;
+        uint64_t m_firstUs;
+        uint64_t m_lastUs;
+        uint_t m_timedCount;
+
+        void callbackBlock(const ImuBlock& block);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -2,16 +2,42 @@
 
 #include "app.h"
 #include "platform/debug.h"
+#include "metrics.h"
 
 using namespace IslSdk;
 
 //--------------------------------------------------------------------------------------------------
-App::App(const std::string& name) : name(name), m_device(nullptr)
+App::App(const std::string& name) : name(name), m_device(nullptr), m_rateController(nullptr), m_packetGauges()
 {
+    m_rates.onChange.connect(slotRatesChanged);
 }
 //--------------------------------------------------------------------------------------------------
 App::~App()
 {
+    setRateController(nullptr);
+}
+//--------------------------------------------------------------------------------------------------
+void App::setRateController(RateController* controller)
+{
+    if (m_rateController != nullptr)
+    {
+        m_rateController->remove(m_rates);
+    }
+
+    m_rateController = controller;
+
+    if (m_rateController != nullptr)
+    {
+        m_rateController->add(m_rates);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void App::run()
+{
+    if (m_device != nullptr)
+    {
+        m_link.run(*m_device);
+    }
 }
 //--------------------------------------------------------------------------------------------------
 void App::setDevice(const Device::SharedPtr& device)
@@ -32,6 +58,8 @@ void App::setDevice(const Device::SharedPtr& device)
     }
 
     m_device = device;
+    m_clockSync.reset();
+    m_rates.streams.clear();
 
     if (m_device != nullptr)
     {
@@ -43,9 +71,20 @@ void App::setDevice(const Device::SharedPtr& device)
         m_device->onPortChanged.connect(slotPortChanged);
         m_device->onPortRemoved.connect(slotPortRemoved);
         m_device->onInfoChanged.connect(slotDeviceInfo);
-        //m_device->onPacketCount.connect(slotPacketCount);
+        m_device->onPacketCount.connect(slotPacketCount);
+        m_rates.setDevice(m_device->info);
+        m_link.setName(m_device->info.pnSnAsStr());
+
+        // The SDK reports totals since the device connected, so these are gauges as they restart from zero on a reconnect
+        const std::string labels = "device=\"" + m_device->info.pnSnAsStr() + "\"";
+        Metrics& metrics = Metrics::global();
+        m_packetGauges[0] = &metrics.gauge("isl_device_packets_tx", labels, "Packets sent to the device");
+        m_packetGauges[1] = &metrics.gauge("isl_device_packets_rx", labels, "Packets received from the device");
+        m_packetGauges[2] = &metrics.gauge("isl_device_packets_resent", labels, "Packets resent to the device");
+        m_packetGauges[3] = &metrics.gauge("isl_device_packets_missed", labels, "Packets from the device that were missed");
 
         connectSignals(*m_device);
+        superviseLink();
     }
 }
 //--------------------------------------------------------------------------------------------------
@@ -66,12 +105,18 @@ void App::callbackDeleteted(Device& device)
 void App::callbackConnect(Device& device)
 {
     Debug::log(Debug::Severity::Notice, name.c_str(), "%04u.%04u connected and ready%s", device.info.pn, device.info.sn, device.bootloaderMode() ? " (bootloader mode)" : "");
+
+    if (m_link.connected(device))
+    {
+        applyRates(device);                                                     // A power cycled device has lost them
+    }
     connectEvent(device);
 }
 //--------------------------------------------------------------------------------------------------
 void App::callbackDisconnect(Device& device)
 {
     Debug::log(Debug::Severity::Notice, name.c_str(), "%04u.%04u disconnected", device.info.pn, device.info.sn);
+    m_link.linkLost("disconnected");
 }
 //--------------------------------------------------------------------------------------------------
 void App::callbackPortAdded(Device& device, SysPort& port, const ConnectionMeta& meta)
@@ -89,11 +134,13 @@ void App::callbackPortChanged(Device& device, SysPort& port, const ConnectionMet
     {
         Debug::log(Debug::Severity::Info, name.c_str(), "IP address for %04u.%04u on port %s changed to %u.%u.%u.%u", device.info.pn, device.info.sn, port.name.c_str(), meta.ipAddress & 0xff, (meta.ipAddress >> 8) & 0xff, (meta.ipAddress >> 16) & 0xff, (meta.ipAddress >> 24) & 0xff);
     }
+    m_link.setConnection(device);
 }
 //--------------------------------------------------------------------------------------------------
 void App::callbackPortRemoved(Device& device, SysPort& port)
 {
     Debug::log(Debug::Severity::Info, name.c_str(), "Port %s removed from %04u.%04u", port.name.c_str(), device.info.pn, device.info.sn);
+    m_link.linkLost("port removed");
 }
 //--------------------------------------------------------------------------------------------------
 void App::callbackDeviceInfo(Device& device, const Device::Info& info)
@@ -103,7 +150,21 @@ void App::callbackDeviceInfo(Device& device, const Device::Info& info)
 //--------------------------------------------------------------------------------------------------
 void App::callbackPacketCount(Device& device, uint_t tx, uint_t rx, uint_t resent, uint_t missed)
 {
-    Debug::log(Debug::Severity::Info, name.c_str(), "Packet stats for %04u.%04u Tx:%u, Rx:%u, Resent:%u, Missed:%u", FMT_U(device.info.pn), FMT_U(device.info.sn), tx, rx, resent, missed);
+    m_packetGauges[0]->set(tx);
+    m_packetGauges[1]->set(rx);
+    m_packetGauges[2]->set(resent);
+    m_packetGauges[3]->set(missed);
+
+    m_rates.packetCount(resent, missed);
+}
+//--------------------------------------------------------------------------------------------------
+void App::callbackRatesChanged(RateController::Policy& policy)
+{
+    if (m_device != nullptr)
+    {
+        applyRates(*m_device);
+        superviseLink();
+    }
 }
 //--------------------------------------------------------------------------------------------------
 
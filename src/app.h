@@ -4,6 +4,9 @@
 //------------------------------------------ Includes ----------------------------------------------
 
 #include "devices/device.h"
+#include "clockSync.h"
+#include "rateController.h"
+#include "linkSupervisor.h"
 
 //--------------------------------------- Class Definition -----------------------------------------
 
@@ -13,9 +16,12 @@ namespace IslSdk
     {
     public:
         App(const std::string& name);
-        ~App();
+        virtual ~App();
         void setDevice(const Device::SharedPtr& device);
         virtual void doTask(int_t key, const std::string& path);
+        void setRateController(RateController* controller);
+        void run();                                                                 // Call regularly to supervise the link
+        virtual bool_t setHeadingTarget(Slot<uint64_t, real_t>* slot) { return false; } // Sends the AHRS heading to slot, nullptr to stop, false if there's no AHRS
 
         const std::string name;
 
@@ -28,12 +34,20 @@ namespace IslSdk
         Slot<Device&, SysPort&> slotPortRemoved{ this, &App::callbackPortRemoved };
         Slot<Device&, const Device::Info&> slotDeviceInfo{ this, &App::callbackDeviceInfo };
         Slot<Device&, uint_t, uint_t, uint_t, uint_t> slotPacketCount{ this, &App::callbackPacketCount };
+        Slot<RateController::Policy&> slotRatesChanged{ this, &App::callbackRatesChanged };
 
     protected:
         Device::SharedPtr m_device;
+        ClockSync m_clockSync;                                                      // Maps the device timeUs onto Platform::getTimeUs()
+        RateController::Policy m_rates;                                             // Sensor streams and their bounds, set up in connectSignals()
+        RateController* m_rateController;
+        LinkSupervisor m_link;                                                      // Fed with the device's main data by the derived Apps
+        Metrics::Gauge* m_packetGauges[4];                                          // Tx, rx, resent and missed, looked up for each device
         virtual void connectSignals(Device& device) {};
         virtual void disconnectSignals(Device& device) {};
         virtual void connectEvent(Device& device) {};
+        virtual void applyRates(Device& device) {};                                 // Send the intervals in m_rates to the device
+        virtual void superviseLink() {};                                            // Tell m_link what data to watch for stalls and its interval
 
     private:
         void callbackError(Device& device, const std::string& msg);
@@ -45,6 +59,7 @@ namespace IslSdk
         void callbackPortRemoved(Device& device, SysPort& port);
         void callbackDeviceInfo(Device& device, const Device::Info& info);
         void callbackPacketCount(Device& device, uint_t tx, uint_t rx, uint_t resent, uint_t missed);
+        void callbackRatesChanged(RateController::Policy& policy);
     };
 }
 
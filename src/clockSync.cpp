@@ -0,0 +1,177 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "clockSync.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+ClockSync::ClockSync(uint_t bucketUs) : m_bucketUs(bucketUs)
+{
+    reset();
+}
+//--------------------------------------------------------------------------------------------------
+void ClockSync::reset()
+{
+    m_pointIdx = 0;
+    m_pointCount = 0;
+    m_started = false;
+    m_refDeviceUs = 0;
+    m_refOffsetUs = 0;
+    m_lastDeviceUs = 0;
+    m_bucketStartUs = 0;
+    m_bucketValid = false;
+    m_locked = false;
+    m_intercept = 0;
+    m_slope = 0;
+    m_errorBoundUs = 0;
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t ClockSync::toHost(uint64_t deviceUs, uint64_t hostRxUs)
+{
+    // A device clock that jumps back more than a bucket has been reset or wrapped
+    if (m_started && deviceUs + m_bucketUs < m_lastDeviceUs)
+    {
+        reset();
+    }
+
+    if (!m_started)
+    {
+        m_started = true;
+        m_refDeviceUs = deviceUs;
+        m_refOffsetUs = static_cast<int64_t>(hostRxUs - deviceUs);
+        m_bucketStartUs = deviceUs;
+        m_intercept = 0;
+    }
+    m_lastDeviceUs = deviceUs;
+
+    Point p;
+    p.x = static_cast<real_t>(static_cast<int64_t>(deviceUs - m_refDeviceUs));
+    p.y = static_cast<real_t>(static_cast<int64_t>(hostRxUs - deviceUs) - m_refOffsetUs);
+
+    if (deviceUs - m_bucketStartUs >= m_bucketUs)
+    {
+        if (m_bucketValid)
+        {
+            m_points[m_pointIdx] = m_bucketMin;
+            m_pointIdx = (m_pointIdx + 1) % maxPoints;
+            m_pointCount = m_pointCount < maxPoints ? m_pointCount + 1 : maxPoints;
+            fit();
+        }
+        m_bucketStartUs = deviceUs;
+        m_bucketValid = false;
+    }
+
+    if (!m_bucketValid || p.y < m_bucketMin.y)
+    {
+        m_bucketMin = p;
+        m_bucketValid = true;
+    }
+
+    if (!m_locked)
+    {
+        // Until two buckets have closed the best estimate is the smallest offset seen so far
+        if (p.y < m_intercept)
+        {
+            m_intercept = p.y;
+        }
+    }
+    else
+    {
+        // A packet earlier than the fitted line by more than the error bound means the line is too late
+        const real_t residual = p.y - (m_intercept + m_slope * p.x);
+        if (residual < -m_errorBoundUs)
+        {
+            m_intercept += residual + m_errorBoundUs;
+        }
+    }
+
+    return map(deviceUs);
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t ClockSync::map(uint64_t deviceUs) const
+{
+    const real_t x = static_cast<real_t>(static_cast<int64_t>(deviceUs - m_refDeviceUs));
+    const real_t offset = m_refOffsetUs + m_intercept + m_slope * x;
+    return deviceUs + static_cast<int64_t>(std::floor(offset + 0.5));
+}
+//--------------------------------------------------------------------------------------------------
+void ClockSync::fit()
+{
+    bool_t use[maxPoints];
+    real_t residual[maxPoints];
+    real_t slope = 0, intercept = 0;
+
+    if (m_pointCount < 2)
+    {
+        return;
+    }
+
+    for (uint_t i = 0; i < m_pointCount; i++)
+    {
+        use[i] = true;
+    }
+
+    for (uint_t pass = 0; pass < 2; pass++)
+    {
+        real_t sx = 0, sy = 0, sxx = 0, sxy = 0;
+        uint_t n = 0;
+
+        for (uint_t i = 0; i < m_pointCount; i++)
+        {
+            if (use[i])
+            {
+                const Point& p = m_points[i];
+                sx += p.x;
+                sy += p.y;
+                sxx += p.x * p.x;
+                sxy += p.x * p.y;
+                n++;
+            }
+        }
+
+        const real_t den = n * sxx - sx * sx;
+        if (n < 2 || den == 0)
+        {
+            return;
+        }
+
+        slope = (n * sxy - sx * sy) / den;
+        intercept = (sy - slope * sx) / n;
+
+        if (pass == 0)
+        {
+            // Reject points further than 3 sigma from the line, sigma estimated from the MAD
+            real_t sorted[maxPoints];
+            for (uint_t i = 0; i < m_pointCount; i++)
+            {
+                residual[i] = std::fabs(m_points[i].y - (intercept + slope * m_points[i].x));
+                sorted[i] = residual[i];
+            }
+
+            std::nth_element(&sorted[0], &sorted[m_pointCount / 2], &sorted[m_pointCount]);
+            const real_t limit = std::max<real_t>(3.0 * 1.4826 * sorted[m_pointCount / 2], 20.0);
+
+            for (uint_t i = 0; i < m_pointCount; i++)
+            {
+                use[i] = residual[i] <= limit;
+            }
+        }
+    }
+
+    real_t bound = 0;
+    for (uint_t i = 0; i < m_pointCount; i++)
+    {
+        if (use[i])
+        {
+            bound = std::max<real_t>(bound, std::fabs(m_points[i].y - (intercept + slope * m_points[i].x)));
+        }
+    }
+
+    m_slope = slope;
+    m_intercept = intercept;
+    m_errorBoundUs = bound;
+    m_locked = true;
+}
+//--------------------------------------------------------------------------------------------------
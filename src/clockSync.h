@@ -0,0 +1,60 @@
+#ifndef CLOCKSYNC_H_
+#define CLOCKSYNC_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Maps a device timebase onto the host monotonic clock (Platform::getTimeUs). Each observation is a
+    // device timestamp and the host time it was received. Transport and scheduling delays only ever
+    // make packets late, so the minimum host - device offset is kept per bucket of device time and an
+    // offset and drift line is fitted through those minima with outliers rejected by median absolute
+    // deviation. The fit is redone once per bucket so the per packet cost is constant.
+    class ClockSync
+    {
+    public:
+        ClockSync(uint_t bucketUs = 1000000);
+        void reset();
+        uint64_t toHost(uint64_t deviceUs, uint64_t hostRxUs);      // Adds the observation and returns the unified host time
+        uint64_t map(uint64_t deviceUs) const;
+        bool_t locked() const { return m_locked; }
+        real_t driftPpm() const { return m_slope * 1000000.0; }
+        real_t errorBoundUs() const { return m_errorBoundUs; }
+
+    private:
+        static constexpr uint_t maxPoints = 64;
+
+        struct Point
+        {
+            real_t x;                                   // Device time relative to m_refDeviceUs
+            real_t y;                                   // Minimum offset relative to m_refOffsetUs
+        };
+
+        const uint_t m_bucketUs;
+        Point m_points[maxPoints];
+        uint_t m_pointIdx;
+        uint_t m_pointCount;
+
+        bool_t m_started;
+        uint64_t m_refDeviceUs;
+        int64_t m_refOffsetUs;
+        uint64_t m_lastDeviceUs;
+        uint64_t m_bucketStartUs;
+        bool_t m_bucketValid;
+        Point m_bucketMin;
+
+        bool_t m_locked;
+        real_t m_intercept;
+        real_t m_slope;
+        real_t m_errorBoundUs;
+
+        void fit();
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
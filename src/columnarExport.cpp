@@ -0,0 +1,729 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "columnarExport.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace IslSdk;
+
+// Parquet enums and Thrift compact protocol types, see parquet.thrift in the Apache Parquet format repository
+static constexpr int32_t typeInt64 = 2;
+static constexpr int32_t typeDouble = 5;
+static constexpr int32_t typeByteArray = 6;
+static constexpr int32_t encodingPlain = 0;
+static constexpr int32_t encodingRle = 3;
+static constexpr int32_t encodingDeltaBinaryPacked = 5;
+static constexpr int32_t encodingRleDictionary = 8;
+static constexpr int32_t pageData = 0;
+static constexpr int32_t pageDictionary = 2;
+static constexpr int32_t repetitionRequired = 0;
+static constexpr int32_t convertedUtf8 = 0;
+static constexpr int32_t convertedTimestampMicros = 10;
+static constexpr uint8_t thriftI32 = 5;
+static constexpr uint8_t thriftI64 = 6;
+static constexpr uint8_t thriftBinary = 8;
+static constexpr uint8_t thriftList = 9;
+static constexpr uint8_t thriftStruct = 12;
+static constexpr uint_t deltaBlockSize = 128;
+static constexpr uint_t deltaMiniBlocks = 4;
+static constexpr uint_t deltaMiniBlockSize = deltaBlockSize / deltaMiniBlocks;
+
+//--------------------------------------------------------------------------------------------------
+static void putVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+//--------------------------------------------------------------------------------------------------
+static uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+//--------------------------------------------------------------------------------------------------
+static uint_t bitWidth(uint64_t value)
+{
+    uint_t bits = 0;
+    while (value)
+    {
+        bits++;
+        value >>= 1;
+    }
+    return bits;
+}
+//--------------------------------------------------------------------------------------------------
+// Values packed least significant bit first, as used by both the RLE hybrid and delta encodings
+static void packBits(std::vector<uint8_t>& out, const uint64_t* values, uint_t count, uint_t bits)
+{
+    const uint64_t mask = bits < 64 ? (static_cast<uint64_t>(1) << bits) - 1 : ~static_cast<uint64_t>(0);
+    uint64_t acc = 0;
+    uint_t accBits = 0;                                                     // Always less than 8 between values
+
+    for (uint_t i = 0; i < count; i++)
+    {
+        const uint64_t v = values[i] & mask;
+        uint64_t high = accBits ? v >> (64 - accBits) : 0;                  // What doesn't fit in acc when bits is near 64
+
+        acc |= v << accBits;
+        accBits += bits;
+
+        while (accBits >= 8)
+        {
+            out.push_back(static_cast<uint8_t>(acc));
+            acc = (acc >> 8) | (high << 56);
+            high >>= 8;
+            accBits -= 8;
+        }
+    }
+
+    if (accBits)
+    {
+        out.push_back(static_cast<uint8_t>(acc));
+    }
+}
+//--------------------------------------------------------------------------------------------------
+// DELTA_BINARY_PACKED: blocks of 128 deltas in 4 miniblocks, each bit packed at its own width above the block's smallest delta
+static void encodeDelta(std::vector<uint8_t>& out, const int64_t* values, uint_t count)
+{
+    putVarint(out, deltaBlockSize);
+    putVarint(out, deltaMiniBlocks);
+    putVarint(out, count);
+    putVarint(out, zigzag(count ? values[0] : 0));
+
+    uint64_t packed[deltaMiniBlockSize];
+
+    for (uint_t start = 1; start < count; start += deltaBlockSize)
+    {
+        const uint_t n = std::min(deltaBlockSize, count - start);
+        int64_t minDelta = INT64_MAX;
+
+        for (uint_t i = 0; i < n; i++)
+        {
+            minDelta = std::min(minDelta, static_cast<int64_t>(static_cast<uint64_t>(values[start + i]) - static_cast<uint64_t>(values[start + i - 1])));
+        }
+
+        putVarint(out, zigzag(minDelta));
+
+        uint_t widths[deltaMiniBlocks] = {};
+        const uint_t used = (n + deltaMiniBlockSize - 1) / deltaMiniBlockSize;
+
+        for (uint_t m = 0; m < used; m++)
+        {
+            uint64_t maxValue = 0;
+            for (uint_t i = m * deltaMiniBlockSize; i < std::min(n, (m + 1) * deltaMiniBlockSize); i++)
+            {
+                maxValue |= static_cast<uint64_t>(values[start + i]) - static_cast<uint64_t>(values[start + i - 1]) - static_cast<uint64_t>(minDelta);
+            }
+            widths[m] = bitWidth(maxValue);
+        }
+
+        for (uint_t m = 0; m < deltaMiniBlocks; m++)
+        {
+            out.push_back(static_cast<uint8_t>(widths[m]));                 // Unused miniblocks at the end have width 0 and no data
+        }
+
+        for (uint_t m = 0; m < used; m++)
+        {
+            for (uint_t i = 0; i < deltaMiniBlockSize; i++)
+            {
+                const uint_t j = m * deltaMiniBlockSize + i;
+                packed[i] = j < n ? static_cast<uint64_t>(values[start + j]) - static_cast<uint64_t>(values[start + j - 1]) - static_cast<uint64_t>(minDelta) : 0;
+            }
+            packBits(out, packed, deltaMiniBlockSize, widths[m]);
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+// RLE / bit packed hybrid for dictionary indices. Runs of 8 or more are RLE, the rest bit packed in groups of 8.
+static void encodeIndices(std::vector<uint8_t>& out, const uint32_t* values, uint_t count, uint_t bits)
+{
+    auto runLength = [values, count](uint_t i, uint_t limit)
+    {
+        uint_t run = 1;
+        while (i + run < count && run < limit && values[i + run] == values[i])
+        {
+            run++;
+        }
+        return run;
+    };
+
+    uint64_t group[8];
+    uint_t i = 0;
+
+    while (i < count)
+    {
+        const uint_t run = runLength(i, count);
+
+        if (run >= 8)
+        {
+            putVarint(out, static_cast<uint64_t>(run) << 1);
+            for (uint_t b = 0; b < (bits + 7) / 8; b++)
+            {
+                out.push_back(static_cast<uint8_t>(values[i] >> (b * 8)));
+            }
+            i += run;
+            continue;
+        }
+
+        uint_t groups = 0;
+        uint_t end = i;
+        while (end < count && (end == i || runLength(end, 8) < 8))
+        {
+            end += 8;
+            groups++;
+        }
+
+        putVarint(out, (static_cast<uint64_t>(groups) << 1) | 1);
+        for (uint_t g = 0; g < groups; g++)
+        {
+            for (uint_t k = 0; k < 8; k++)
+            {
+                const uint_t j = i + g * 8 + k;
+                group[k] = j < count ? values[j] : 0;                       // Only the last group is ever padded
+            }
+            packBits(out, group, 8, bits);
+        }
+        i = std::min(end, count);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+// Thrift compact protocol, just the parts the Parquet page headers and footer need
+class ThriftWriter
+{
+public:
+    ThriftWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    void beginStruct()
+    {
+        m_lastId.push_back(0);
+    }
+
+    void endStruct()
+    {
+        m_out.push_back(0);
+        m_lastId.pop_back();
+    }
+
+    void field(int16_t id, uint8_t type)
+    {
+        const int16_t delta = id - m_lastId.back();
+
+        if (delta > 0 && delta <= 15)
+        {
+            m_out.push_back(static_cast<uint8_t>((delta << 4) | type));
+        }
+        else
+        {
+            m_out.push_back(type);
+            putVarint(m_out, zigzag(id));
+        }
+        m_lastId.back() = id;
+    }
+
+    void i32(int16_t id, int32_t value)
+    {
+        field(id, thriftI32);
+        putVarint(m_out, zigzag(value));
+    }
+
+    void i64(int16_t id, int64_t value)
+    {
+        field(id, thriftI64);
+        putVarint(m_out, zigzag(value));
+    }
+
+    void string(int16_t id, const std::string& value)
+    {
+        field(id, thriftBinary);
+        stringElement(value);
+    }
+
+    void structField(int16_t id)
+    {
+        field(id, thriftStruct);
+        beginStruct();
+    }
+
+    void list(int16_t id, uint8_t elementType, uint_t size)
+    {
+        field(id, thriftList);
+        if (size < 15)
+        {
+            m_out.push_back(static_cast<uint8_t>((size << 4) | elementType));
+        }
+        else
+        {
+            m_out.push_back(0xf0 | elementType);
+            putVarint(m_out, size);
+        }
+    }
+
+    void i32Element(int32_t value)
+    {
+        putVarint(m_out, zigzag(value));
+    }
+
+    void stringElement(const std::string& value)
+    {
+        putVarint(m_out, value.size());
+        m_out.insert(m_out.end(), value.begin(), value.end());
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+    std::vector<int16_t> m_lastId;
+};
+//--------------------------------------------------------------------------------------------------
+ColumnarExport::Stream::Stream(const std::string& name, const std::vector<std::string>& columns) : name(name), columns(columns), m_export(nullptr), m_pending(0), m_lastDevice(0),
+                                                                                                  m_rows(0), m_dropped(0), m_file(nullptr), m_offset(0)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void ColumnarExport::Stream::append(uint64_t hostUs, const std::string& device, std::initializer_list<real_t> values)
+{
+    if (m_export == nullptr || !m_export->m_running)
+    {
+        return;
+    }
+
+    RowGroup& group = *m_filling;
+
+    if (group.timeUs.empty())
+    {
+        group.firstUs = Platform::getTimeUs();
+    }
+
+    if (m_lastDevice >= group.dictionary.size() || group.dictionary[m_lastDevice] != device)
+    {
+        m_lastDevice = std::find(group.dictionary.begin(), group.dictionary.end(), device) - group.dictionary.begin();
+        if (m_lastDevice == group.dictionary.size())
+        {
+            group.dictionary.push_back(device);
+        }
+    }
+
+    group.timeUs.push_back(static_cast<int64_t>(hostUs) + m_export->m_epochOffsetUs);
+    group.device.push_back(m_lastDevice);
+
+    std::initializer_list<real_t>::const_iterator it = values.begin();
+    for (std::vector<double>& column : group.values)
+    {
+        column.push_back(it != values.end() ? *it++ : 0.0);
+    }
+
+    if (group.timeUs.size() >= rowGroupRows)
+    {
+        m_export->submit(*this);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+ColumnarExport::ColumnarExport() : m_epochOffsetUs(0), m_running(false), m_stopping(false)
+{
+}
+//--------------------------------------------------------------------------------------------------
+ColumnarExport::~ColumnarExport()
+{
+    stop();
+}
+//--------------------------------------------------------------------------------------------------
+ColumnarExport& ColumnarExport::global()
+{
+    static ColumnarExport columnarExport;
+    return columnarExport;
+}
+//--------------------------------------------------------------------------------------------------
+ColumnarExport::Stream& ColumnarExport::stream(const std::string& name, const std::vector<std::string>& columns)
+{
+    for (std::unique_ptr<Stream>& stream : m_streams)
+    {
+        if (stream->name == name)
+        {
+            return *stream;
+        }
+    }
+
+    m_streams.push_back(std::make_unique<Stream>(name, columns));
+    Stream& stream = *m_streams.back();
+    stream.m_export = this;
+    stream.m_filling = std::make_unique<Stream::RowGroup>();
+    stream.m_filling->values.resize(columns.size());
+    return stream;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t ColumnarExport::start(const std::string& pathPrefix)
+{
+    stop();
+
+    const int64_t epochUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    m_epochOffsetUs = epochUs - static_cast<int64_t>(Platform::getTimeUs());
+    m_pathPrefix = pathPrefix;
+    m_stopping = false;
+
+    for (std::unique_ptr<Stream>& stream : m_streams)
+    {
+        stream->m_rows = 0;
+        stream->m_dropped = 0;
+
+        if (HeapMonitor::enabled)
+        {
+            reserve(*stream);
+        }
+    }
+    m_jobs.reserve(m_streams.size() * maxPendingGroups);
+
+    m_writer = std::thread(&ColumnarExport::writerTask, this);
+    m_running = true;
+
+    Debug::log(Debug::Severity::Notice, "Export", "Exporting to %s*.parquet", pathPrefix.c_str());
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+void ColumnarExport::stop()
+{
+    if (!m_running)
+    {
+        return;
+    }
+
+    for (std::unique_ptr<Stream>& stream : m_streams)
+    {
+        if (!stream->m_filling->timeUs.empty())
+        {
+            submit(*stream);
+        }
+    }
+
+    m_running = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    m_writer.join();
+
+    std::vector<uint8_t> buf;
+    for (std::unique_ptr<Stream>& stream : m_streams)
+    {
+        if (stream->m_file)
+        {
+            writeFooter(*stream, buf);
+            fclose(stream->m_file);
+            stream->m_file = nullptr;
+
+            Debug::log(Debug::Severity::Notice, "Export", "%s%s.parquet %llu rows in %u row groups, %llu rows dropped", m_pathPrefix.c_str(), stream->name.c_str(),
+                       static_cast<unsigned long long>(stream->m_rows), FMT_U(stream->m_groups.size()), static_cast<unsigned long long>(stream->m_dropped.load()));
+        }
+        stream->m_groups.clear();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void ColumnarExport::run()
+{
+    if (!m_running)
+    {
+        return;
+    }
+
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    for (std::unique_ptr<Stream>& stream : m_streams)
+    {
+        if (!stream->m_filling->timeUs.empty() && nowUs - stream->m_filling->firstUs > flushPeriodMs * static_cast<uint64_t>(1000))
+        {
+            submit(*stream);
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void ColumnarExport::reserve(Stream& stream)
+{
+    // Every row group the stream can have, the one filling and those pending or spare, at full size
+    while (stream.m_spare.size() < maxPendingGroups)
+    {
+        std::unique_ptr<Stream::RowGroup> group = std::make_unique<Stream::RowGroup>();
+        group->values.resize(stream.columns.size());
+        stream.m_spare.push_back(std::move(group));
+    }
+
+    stream.m_spare.push_back(std::move(stream.m_filling));
+    for (std::unique_ptr<Stream::RowGroup>& group : stream.m_spare)
+    {
+        group->timeUs.reserve(rowGroupRows);
+        group->device.reserve(rowGroupRows);
+        group->dictionary.reserve(maxDictionary);
+        for (std::vector<double>& column : group->values)
+        {
+            column.reserve(rowGroupRows);
+        }
+    }
+    stream.m_filling = std::move(stream.m_spare.back());
+    stream.m_spare.pop_back();
+}
+//--------------------------------------------------------------------------------------------------
+void ColumnarExport::submit(Stream& stream)
+{
+    std::unique_ptr<Stream::RowGroup>& group = stream.m_filling;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    if (stream.m_pending >= maxPendingGroups)
+    {
+        stream.m_dropped += group->timeUs.size();                           // The writer is that far behind, start the row group again
+    }
+    else
+    {
+        stream.m_pending++;
+        m_jobs.push_back({ &stream, std::move(group) });
+
+        if (stream.m_spare.empty())
+        {
+            group = std::make_unique<Stream::RowGroup>();
+            group->values.resize(stream.columns.size());
+        }
+        else
+        {
+            group = std::move(stream.m_spare.back());
+            stream.m_spare.pop_back();
+        }
+        lock.unlock();
+        m_cv.notify_one();
+    }
+
+    group->timeUs.clear();
+    group->device.clear();
+    group->dictionary.clear();
+    for (std::vector<double>& column : group->values)
+    {
+        column.clear();
+    }
+    stream.m_lastDevice = 0;
+}
+//--------------------------------------------------------------------------------------------------
+void ColumnarExport::writerTask()
+{
+    Platform::setBackgroundThread();
+
+    std::vector<uint8_t> buf;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_cv.wait(lock, [this] { return !m_jobs.empty() || m_stopping; });
+
+        if (m_jobs.empty())
+        {
+            break;
+        }
+
+        Job job = std::move(m_jobs.front());
+        m_jobs.erase(m_jobs.begin());
+        lock.unlock();
+
+        writeRowGroup(*job.stream, *job.group, buf);
+
+        lock.lock();
+        job.stream->m_spare.push_back(std::move(job.group));
+        job.stream->m_pending--;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void ColumnarExport::writeRowGroup(Stream& stream, Stream::RowGroup& group, std::vector<uint8_t>& buf)
+{
+    if (stream.m_file == nullptr)
+    {
+        const std::string fileName = m_pathPrefix + stream.name + ".parquet";
+
+        stream.m_file = fopen(fileName.c_str(), "wb");
+        if (stream.m_file == nullptr)
+        {
+            Debug::log(Debug::Severity::Warning, "Export", "Can't create %s", fileName.c_str());
+            stream.m_dropped += group.timeUs.size();
+            return;
+        }
+        fwrite("PAR1", 1, 4, stream.m_file);
+        stream.m_offset = 4;
+    }
+
+    const uint_t rows = group.timeUs.size();
+    std::vector<uint8_t> page;
+    Stream::GroupMeta meta = { rows, 0, {} };
+
+    // Writes one page, its header first, and returns where it starts
+    auto writePage = [&](int32_t type, int32_t encoding, uint_t values)
+    {
+        buf.clear();
+        ThriftWriter thrift(buf);
+
+        thrift.beginStruct();
+        thrift.i32(1, type);
+        thrift.i32(2, static_cast<int32_t>(page.size()));
+        thrift.i32(3, static_cast<int32_t>(page.size()));              // Uncompressed
+        if (type == pageDictionary)
+        {
+            thrift.structField(7);
+            thrift.i32(1, values);
+            thrift.i32(2, encodingPlain);
+            thrift.endStruct();
+        }
+        else
+        {
+            thrift.structField(5);
+            thrift.i32(1, values);
+            thrift.i32(2, encoding);
+            thrift.i32(3, encodingRle);                                 // Levels, though required columns have none
+            thrift.i32(4, encodingRle);
+            thrift.endStruct();
+        }
+        thrift.endStruct();
+
+        const uint64_t offset = stream.m_offset;
+        fwrite(buf.data(), 1, buf.size(), stream.m_file);
+        fwrite(page.data(), 1, page.size(), stream.m_file);
+        stream.m_offset += buf.size() + page.size();
+        return offset;
+    };
+
+    // Time
+    page.clear();
+    encodeDelta(page, group.timeUs.data(), rows);
+    Stream::ChunkMeta chunk = { stream.m_offset, -1, 0, 0 };
+    chunk.dataOffset = writePage(pageData, encodingDeltaBinaryPacked, rows);
+    chunk.size = stream.m_offset - chunk.offset;
+    meta.chunks.push_back(chunk);
+
+    // Device, a dictionary page of the names then the indices
+    page.clear();
+    for (const std::string& name : group.dictionary)
+    {
+        const uint32_t len = static_cast<uint32_t>(name.size());
+        page.insert(page.end(), reinterpret_cast<const uint8_t*>(&len), reinterpret_cast<const uint8_t*>(&len) + 4);
+        page.insert(page.end(), name.begin(), name.end());
+    }
+    chunk = { stream.m_offset, 0, 0, 0 };
+    chunk.dictionaryOffset = writePage(pageDictionary, encodingPlain, group.dictionary.size());
+
+    const uint_t bits = std::max<uint_t>(1, bitWidth(group.dictionary.size() - 1));
+    page.clear();
+    page.push_back(static_cast<uint8_t>(bits));
+    encodeIndices(page, group.device.data(), rows, bits);
+    chunk.dataOffset = writePage(pageData, encodingRleDictionary, rows);
+    chunk.size = stream.m_offset - chunk.offset;
+    meta.chunks.push_back(chunk);
+
+    // Values, plain little endian doubles
+    for (const std::vector<double>& column : group.values)
+    {
+        page.resize(rows * sizeof(double));
+        memcpy(page.data(), column.data(), page.size());
+        chunk = { stream.m_offset, -1, 0, 0 };
+        chunk.dataOffset = writePage(pageData, encodingPlain, rows);
+        chunk.size = stream.m_offset - chunk.offset;
+        meta.chunks.push_back(chunk);
+    }
+
+    fflush(stream.m_file);
+    meta.size = stream.m_offset - meta.chunks.front().offset;
+    stream.m_rows += rows;
+    stream.m_groups.push_back(std::move(meta));
+}
+//--------------------------------------------------------------------------------------------------
+void ColumnarExport::writeFooter(Stream& stream, std::vector<uint8_t>& buf)
+{
+    const uint_t columnCount = 2 + stream.columns.size();
+    buf.clear();
+    ThriftWriter thrift(buf);
+
+    thrift.beginStruct();
+    thrift.i32(1, 1);                                                       // Format version
+
+    thrift.list(2, thriftStruct, 1 + columnCount);                          // Schema, a root with the columns as children
+    thrift.beginStruct();
+    thrift.string(4, "schema");
+    thrift.i32(5, columnCount);
+    thrift.endStruct();
+
+    auto column = [&thrift](const std::string& name, int32_t type, int32_t convertedType)
+    {
+        thrift.beginStruct();
+        thrift.i32(1, type);
+        thrift.i32(3, repetitionRequired);
+        thrift.string(4, name);
+        if (convertedType >= 0)
+        {
+            thrift.i32(6, convertedType);
+        }
+        thrift.endStruct();
+    };
+
+    column("time", typeInt64, convertedTimestampMicros);
+    column("device", typeByteArray, convertedUtf8);
+    for (const std::string& name : stream.columns)
+    {
+        column(name, typeDouble, -1);
+    }
+
+    thrift.i64(3, stream.m_rows);
+
+    thrift.list(4, thriftStruct, stream.m_groups.size());
+    for (const Stream::GroupMeta& group : stream.m_groups)
+    {
+        thrift.beginStruct();
+        thrift.list(1, thriftStruct, columnCount);
+
+        for (uint_t i = 0; i < columnCount; i++)
+        {
+            const Stream::ChunkMeta& chunk = group.chunks[i];
+            const bool_t dictionary = chunk.dictionaryOffset >= 0;
+
+            thrift.beginStruct();
+            thrift.i64(2, chunk.offset);
+            thrift.structField(3);
+            thrift.i32(1, i == 0 ? typeInt64 : i == 1 ? typeByteArray : typeDouble);
+            thrift.list(2, thriftI32, dictionary ? 3 : 2);
+            thrift.i32Element(i == 0 ? encodingDeltaBinaryPacked : encodingPlain);
+            thrift.i32Element(encodingRle);
+            if (dictionary)
+            {
+                thrift.i32Element(encodingRleDictionary);
+            }
+            thrift.list(3, thriftBinary, 1);
+            thrift.stringElement(i == 0 ? "time" : i == 1 ? "device" : stream.columns[i - 2]);
+            thrift.i32(4, 0);                                               // Uncompressed
+            thrift.i64(5, group.rows);
+            thrift.i64(6, chunk.size);
+            thrift.i64(7, chunk.size);
+            thrift.i64(9, chunk.dataOffset);
+            if (dictionary)
+            {
+                thrift.i64(11, chunk.dictionaryOffset);
+            }
+            thrift.endStruct();
+            thrift.endStruct();
+        }
+
+        thrift.i64(2, group.size);
+        thrift.i64(3, group.rows);
+        thrift.endStruct();
+    }
+
+    // Lets the time column be matched back to the T: host times in the log
+    thrift.list(5, thriftStruct, 1);
+    thrift.beginStruct();
+    thrift.string(1, "isl.epochOffsetUs");
+    thrift.string(2, std::to_string(m_epochOffsetUs));
+    thrift.endStruct();
+
+    thrift.string(6, "islSdk sdkExample");
+    thrift.endStruct();
+
+    const uint32_t size = static_cast<uint32_t>(buf.size());
+    fwrite(buf.data(), 1, buf.size(), stream.m_file);
+    fwrite(&size, 1, 4, stream.m_file);
+    fwrite("PAR1", 1, 4, stream.m_file);
+}
+//--------------------------------------------------------------------------------------------------
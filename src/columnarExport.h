@@ -0,0 +1,121 @@
+#ifndef COLUMNAREXPORT_H_
+#define COLUMNAREXPORT_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include "heapMonitor.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Exports sensor data as Parquet files for offline analysis, one file per stream named after it, eg.
+    // depth.parquet, that pandas.read_parquet() or polars.read_parquet() load directly. Every stream has
+    // a time column (UTC microseconds), a dictionary encoded device column and its own double columns.
+    // Rows are appended on the SDK thread into a row group and a background thread encodes and writes
+    // each full row group as one column chunk per column: timestamps delta encoded, devices as a
+    // dictionary and values plain. A stream holds at most maxPendingGroups full row groups waiting to be
+    // written, if the disk falls that far behind rows are dropped and counted. The footer is written by
+    // stop() so a file is only readable once the export has stopped. Static memory builds allocate every
+    // stream's row groups in start() and use smaller ones so appending never allocates.
+    class ColumnarExport
+    {
+    public:
+        static constexpr uint_t rowGroupRows = HeapMonitor::enabled ? 8192 : 65536;
+        static constexpr uint_t maxPendingGroups = 2;                       // Per stream, bounds memory to (2 + 1) row groups
+        static constexpr uint_t flushPeriodMs = 60000;                      // Slow streams still get a row group this often
+        static constexpr uint_t maxDictionary = 16;                         // Devices per stream reserved for in static memory builds
+
+        class Stream
+        {
+        public:
+            Stream(const std::string& name, const std::vector<std::string>& columns);
+            void append(uint64_t hostUs, const std::string& device, std::initializer_list<real_t> values);
+            const std::string name;
+            const std::vector<std::string> columns;
+
+        private:
+            friend class ColumnarExport;
+
+            struct RowGroup
+            {
+                std::vector<int64_t> timeUs;
+                std::vector<uint32_t> device;                               // Index into dictionary
+                std::vector<std::string> dictionary;
+                std::vector<std::vector<double>> values;                    // One vector per column
+                uint64_t firstUs;
+            };
+
+            struct ChunkMeta
+            {
+                uint64_t offset;
+                int64_t dictionaryOffset;                                   // -1 for no dictionary page
+                uint64_t dataOffset;
+                uint64_t size;
+            };
+
+            struct GroupMeta
+            {
+                uint64_t rows;
+                uint64_t size;
+                std::vector<ChunkMeta> chunks;
+            };
+
+            ColumnarExport* m_export;
+            std::unique_ptr<RowGroup> m_filling;
+            std::vector<std::unique_ptr<RowGroup>> m_spare;                 // Written row groups kept for reuse
+            uint_t m_pending;
+            uint_t m_lastDevice;
+            uint64_t m_rows;
+            std::atomic<uint64_t> m_dropped;                                // Added to by both threads
+            FILE* m_file;                                                   // The rest is only used by the writer thread
+            uint64_t m_offset;
+            std::vector<GroupMeta> m_groups;
+        };
+
+        ColumnarExport();
+        ~ColumnarExport();
+        static ColumnarExport& global();
+        Stream& stream(const std::string& name, const std::vector<std::string>& columns);
+        bool_t start(const std::string& pathPrefix);                        // Files are pathPrefix + stream name + ".parquet"
+        void stop();
+        bool_t running() const { return m_running; }
+        void run();                                                         // Call regularly to flush slow streams
+
+    private:
+        struct Job
+        {
+            Stream* stream;
+            std::unique_ptr<Stream::RowGroup> group;
+        };
+
+        std::vector<std::unique_ptr<Stream>> m_streams;
+        std::string m_pathPrefix;
+        int64_t m_epochOffsetUs;                                            // Added to Platform::getTimeUs() to give UTC
+        bool_t m_running;
+        bool_t m_stopping;
+        std::vector<Job> m_jobs;                                            // At most maxPendingGroups for each stream
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::thread m_writer;
+
+        void reserve(Stream& stream);
+        void submit(Stream& stream);
+        void writerTask();
+        void writeRowGroup(Stream& stream, Stream::RowGroup& group, std::vector<uint8_t>& buf);
+        void writeFooter(Stream& stream, std::vector<uint8_t>& buf);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
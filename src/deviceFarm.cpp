@@ -0,0 +1,657 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "deviceFarm.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include "slotProfiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(OS_UNIX)
+    #include <arpa/inet.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
+using namespace IslSdk;
+
+// The farm's own datagrams, not the ISL protocol
+static constexpr uint32_t farmMagic = 0x4d524146;                       // "FARM"
+
+struct FarmHeader
+{
+    uint32_t magic;
+    uint16_t index;                                                     // Simulated device number
+    uint8_t type;
+    uint8_t reserved;
+    uint32_t seq;
+    uint32_t reserved2;
+    uint64_t timeUs;                                                    // Device clock, microseconds since it started
+    uint64_t sendNs;                                                    // Platform::getTimeNs() when sent
+};
+
+struct FarmAnnounce
+{
+    uint16_t pid;
+    uint16_t pn;
+    uint16_t sn;
+    uint16_t reserved;
+};
+
+struct FarmAhrs
+{
+    float w;
+    float x;
+    float y;
+    float z;
+    float magHeadingRad;
+    float turns;
+};
+
+struct FarmEcho
+{
+    float altitudeM;
+    float correlation;
+    float signalEnergy;
+};
+
+struct FarmPressure
+{
+    float pressureBar;
+    float depthM;
+};
+
+struct FarmPing
+{
+    uint16_t angle;
+    int16_t stepSize;
+    uint32_t minRangeMm;
+    uint32_t maxRangeMm;
+    uint32_t count;                                                     // Followed by count uint16_t samples
+};
+
+static_assert(sizeof(FarmHeader) == 32, "Header layout is shared by both ends");
+
+static constexpr uint_t maxPacketSize = sizeof(FarmHeader) + sizeof(FarmPing) + DeviceFarm::maxPingSamples * sizeof(uint16_t);
+static constexpr uint16_t simPartNumber = 9900;                         // Simulated devices are part 9900 + PID, serial number their device number
+static const uint16_t simPids[] = { Device::Pid::Isa500, Device::Pid::Isd4000, Device::Pid::Ism3d, Device::Pid::Sonar };
+
+//--------------------------------------------------------------------------------------------------
+DeviceFarm::DeviceFarm() : m_rates{ 50, 10, 20, 20, 500 }, m_socket(-1), m_simCount(0), m_stopping(false), m_farmCpuNs(0), m_sendFailures(0), m_lastDiscoveryUs(0), m_packets(0),
+                           m_dropped(0), m_latency(Metrics::global().histogram("isl_farm_latency_seconds", "", "Time from a simulated device sending to its callbacks returning")),
+                           m_testStep(0), m_testSeconds(0), m_testAddedUs(0), m_testStartUs(0), m_testThreadCpuNs(0), m_testProcessCpuNs(0), m_testFarmCpuNs(0), m_testPackets(0), m_testDropped(0)
+{
+    m_echoes.resize(1);
+}
+//--------------------------------------------------------------------------------------------------
+DeviceFarm::~DeviceFarm()
+{
+    stop();
+}
+//--------------------------------------------------------------------------------------------------
+#ifdef OS_UNIX
+bool_t DeviceFarm::start(const Rates& rates)
+{
+    const int bufSize = 8 * 1024 * 1024;
+    struct sockaddr_in addr = {};
+
+    stop();
+
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (m_socket < 0 || bind(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        Debug::log(Debug::Severity::Error, "Farm", "Can't open a loopback UDP socket");
+        stop();
+        return false;
+    }
+
+    setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));     // Limited by net.core.rmem_max, overflow shows as dropped packets
+    fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+
+    m_rates = rates;
+    m_rates.pingSamples = std::min(m_rates.pingSamples, maxPingSamples);
+    m_buf.resize(maxPacketSize);
+    m_stopping = false;
+    m_farm = std::thread(&DeviceFarm::farmTask, this);
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::stop()
+{
+    if (m_farm.joinable())
+    {
+        m_stopping = true;
+        m_farm.join();
+    }
+
+    if (m_socket >= 0)
+    {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+
+    for (Sim& sim : m_newSims)
+    {
+        ::close(sim.socket);
+    }
+    m_newSims.clear();
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::add(uint_t count)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (uint_t i = 0; i < count && m_simCount < maxDevices; i++)
+    {
+        const uint16_t index = static_cast<uint16_t>(m_simCount.load());
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(basePort + index);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        Sim sim = {};
+        sim.socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sim.socket < 0 || bind(sim.socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            Debug::log(Debug::Severity::Warning, "Farm", "Can't bind UDP port %u for simulated device %u", FMT_U(basePort + index), FMT_U(index));
+            if (sim.socket >= 0)
+            {
+                ::close(sim.socket);
+            }
+            break;
+        }
+
+        sim.index = index;
+        sim.pid = simPids[index % (sizeof(simPids) / sizeof(simPids[0]))];
+        sim.startUs = Platform::getTimeUs() - index * static_cast<uint64_t>(1000000);     // Each device powered up at a different time
+        m_newSims.push_back(sim);
+        m_simCount++;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::farmTask()
+{
+    std::vector<Sim> sims;
+    std::vector<struct pollfd> fds;
+    FarmHeader header;
+    struct sockaddr_in from;
+
+    Platform::setBackgroundThread();                                        // Stays at normal priority if the main thread is real time
+
+    while (!m_stopping)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (Sim& sim : m_newSims)
+            {
+                sims.push_back(sim);
+                fds.push_back({ sim.socket, POLLIN, 0 });
+            }
+            m_newSims.clear();
+        }
+
+        // Sleep until the next sample is due or a discovery arrives
+        uint64_t nowUs = Platform::getTimeUs();
+        uint64_t nextUs = nowUs + 10000;
+        for (const Sim& sim : sims)
+        {
+            if (sim.found)
+            {
+                nextUs = std::min(nextUs, std::min(sim.nextAhrsUs, sim.nextDataUs));
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), nextUs > nowUs ? static_cast<int>((nextUs - nowUs + 999) / 1000) : 0) > 0)
+        {
+            for (uint_t i = 0; i < sims.size(); i++)
+            {
+                socklen_t fromLen = sizeof(from);
+
+                while ((fds[i].revents & POLLIN) && recvfrom(sims[i].socket, &header, sizeof(header), MSG_DONTWAIT, reinterpret_cast<struct sockaddr*>(&from), &fromLen) == sizeof(header))
+                {
+                    if (header.magic == farmMagic && header.type == static_cast<uint8_t>(Type::Discover))
+                    {
+                        Sim& sim = sims[i];
+                        const FarmAnnounce announce = { sim.pid, static_cast<uint16_t>(simPartNumber + sim.pid), static_cast<uint16_t>(sim.index + 1), 0 };
+
+                        memcpy(sim.host, &from, sizeof(from));
+                        sim.found = true;
+                        sim.nextAhrsUs = m_rates.ahrsHz > 0 ? Platform::getTimeUs() : UINT64_MAX;
+                        sim.nextDataUs = dataHz(sim.pid) > 0 ? Platform::getTimeUs() : UINT64_MAX;
+                        send(sim, Type::Announce, &announce, sizeof(announce));
+                    }
+                    fromLen = sizeof(from);
+                }
+            }
+        }
+
+        nowUs = Platform::getTimeUs();
+        for (Sim& sim : sims)
+        {
+            if (sim.found)
+            {
+                simulate(sim, nowUs);
+            }
+        }
+
+        m_farmCpuNs.store(Platform::getThreadCpuNs(), std::memory_order_relaxed);
+    }
+
+    for (Sim& sim : sims)
+    {
+        ::close(sim.socket);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::simulate(Sim& sim, uint64_t nowUs)
+{
+    const real_t pi = 3.14159265358979;
+    const uint64_t ahrsPeriodUs = m_rates.ahrsHz > 0 ? static_cast<uint64_t>(1000000 / m_rates.ahrsHz) : 0;
+    const uint64_t dataPeriodUs = dataHz(sim.pid) > 0 ? static_cast<uint64_t>(1000000 / dataHz(sim.pid)) : 0;
+
+    // A device more than a second behind skips ahead rather than sending a burst
+    if (m_rates.ahrsHz > 0 && nowUs > sim.nextAhrsUs + 1000000)
+    {
+        sim.nextAhrsUs = nowUs;
+    }
+
+    if (dataPeriodUs && nowUs > sim.nextDataUs + 1000000)
+    {
+        sim.nextDataUs = nowUs;
+    }
+
+    while (m_rates.ahrsHz > 0 && nowUs >= sim.nextAhrsUs)
+    {
+        // Turning slowly about the vertical
+        const real_t t = (sim.nextAhrsUs - sim.startUs) * 0.000001;
+        const real_t heading = std::fmod(0.2 * t + sim.index, 2 * pi);
+        const FarmAhrs ahrs = { static_cast<float>(std::cos(heading * 0.5)), 0, 0, static_cast<float>(std::sin(heading * 0.5)), static_cast<float>(heading), static_cast<float>(std::floor(0.2 * t / (2 * pi))) };
+
+        send(sim, Type::Ahrs, &ahrs, sizeof(ahrs));
+        sim.nextAhrsUs += ahrsPeriodUs;
+    }
+
+    while (dataPeriodUs && nowUs >= sim.nextDataUs)
+    {
+        const real_t t = (sim.nextDataUs - sim.startUs) * 0.000001;
+
+        if (sim.pid == Device::Pid::Isa500)
+        {
+            const FarmEcho echo = { static_cast<float>(10 + 2 * std::sin(0.1 * t)), 0.9f, 0.5f };
+            send(sim, Type::Echo, &echo, sizeof(echo));
+        }
+        else if (sim.pid == Device::Pid::Isd4000)
+        {
+            // 8 second swell on a 20m dive
+            const real_t depthM = 20 + 0.5 * std::sin(2 * pi * t / 8);
+            const FarmPressure pressure = { static_cast<float>(1.01325 + depthM * 0.1005), static_cast<float>(depthM) };
+            send(sim, Type::Pressure, &pressure, sizeof(pressure));
+        }
+        else if (sim.pid == Device::Pid::Sonar)
+        {
+            // A seabed return that moves in and out with the head angle
+            uint16_t samples[maxPingSamples];
+            const uint_t count = m_rates.pingSamples;
+            const real_t bed = count * (0.6 + 0.2 * std::sin(sim.angle * 2 * pi / Sonar::maxAngle));
+
+            for (uint_t i = 0; i < count; i++)
+            {
+                const real_t d = (i - bed) / (count * 0.02 + 1);
+                samples[i] = static_cast<uint16_t>(500 + 40000 * std::exp(-d * d) + (i * 7919 % 256));
+            }
+
+            const FarmPing ping = { sim.angle, 32, 500, 30000, static_cast<uint32_t>(count) };
+            send(sim, Type::Ping, &ping, sizeof(ping), samples, count * sizeof(uint16_t));
+            sim.angle = (sim.angle + 32) % Sonar::maxAngle;
+        }
+        sim.nextDataUs += dataPeriodUs;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::send(Sim& sim, Type type, const void* payload, uint_t size, const void* data, uint_t dataSize)
+{
+    uint8_t packet[maxPacketSize];
+    FarmHeader header = { farmMagic, sim.index, static_cast<uint8_t>(type), 0, sim.seq++, 0, Platform::getTimeUs() - sim.startUs, Platform::getTimeNs() };
+
+    memcpy(packet, &header, sizeof(header));
+    memcpy(packet + sizeof(header), payload, size);
+    if (dataSize)
+    {
+        memcpy(packet + sizeof(header) + size, data, dataSize);
+    }
+
+    if (sendto(sim.socket, packet, sizeof(header) + size + dataSize, 0, reinterpret_cast<const struct sockaddr*>(sim.host), sizeof(struct sockaddr_in)) < 0)
+    {
+        m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::discover()
+{
+    const FarmHeader header = { farmMagic, 0, static_cast<uint8_t>(Type::Discover), 0, 0, 0, 0, Platform::getTimeNs() };
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // Like a discovery sweep, asks every address that hasn't answered yet
+    for (uint_t i = 0; i < m_simCount; i++)
+    {
+        if (i >= m_hosts.size() || m_hosts[i].device == nullptr)
+        {
+            addr.sin_port = htons(basePort + i);
+            sendto(m_socket, &header, sizeof(header), 0, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::receive()
+{
+    ssize_t size;
+
+    while ((size = recv(m_socket, m_buf.data(), m_buf.size(), 0)) >= static_cast<ssize_t>(sizeof(FarmHeader)))
+    {
+        dispatch(m_buf.data(), static_cast<uint_t>(size));
+    }
+}
+//--------------------------------------------------------------------------------------------------
+#else
+bool_t DeviceFarm::start(const Rates& rates)
+{
+    Debug::log(Debug::Severity::Error, "Farm", "The device farm needs POSIX sockets");
+    return false;
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::stop()
+{
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::add(uint_t count)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::farmTask()
+{
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::simulate(Sim& sim, uint64_t nowUs)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::send(Sim& sim, Type type, const void* payload, uint_t size, const void* data, uint_t dataSize)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::discover()
+{
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::receive()
+{
+}
+#endif
+//--------------------------------------------------------------------------------------------------
+real_t DeviceFarm::dataHz(uint16_t pid) const
+{
+    switch (pid)
+    {
+    case Device::Pid::Isa500:  return m_rates.echoHz;
+    case Device::Pid::Isd4000: return m_rates.pressureHz;
+    case Device::Pid::Sonar:   return m_rates.pingHz;
+    default:                   return 0;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::run()
+{
+    if (!running())
+    {
+        return;
+    }
+
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    if (m_devices.size() < m_simCount && nowUs - m_lastDiscoveryUs >= discoveryPeriodMs * static_cast<uint64_t>(1000))
+    {
+        m_lastDiscoveryUs = nowUs;
+        discover();
+    }
+
+    receive();
+
+    if (!m_testSteps.empty())
+    {
+        runLoadTest();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::dispatch(const uint8_t* packet, uint_t size)
+{
+    FarmHeader header;
+    memcpy(&header, packet, sizeof(header));
+    const uint8_t* payload = packet + sizeof(header);
+    size -= sizeof(header);
+
+    if (header.magic != farmMagic || header.index >= maxDevices)
+    {
+        return;
+    }
+
+    if (header.index >= m_hosts.size())
+    {
+        m_hosts.resize(header.index + 1);
+    }
+
+    Host& host = m_hosts[header.index];
+
+    if (header.type == static_cast<uint8_t>(Type::Announce))
+    {
+        FarmAnnounce announce;
+        if (host.device != nullptr || size < sizeof(announce))
+        {
+            return;
+        }
+        memcpy(&announce, payload, sizeof(announce));
+
+        const Device::Info info = { announce.pid, announce.pn, announce.sn };
+        switch (announce.pid)
+        {
+        case Device::Pid::Isa500:  host.device = std::make_shared<Isa500>(info); break;
+        case Device::Pid::Isd4000: host.device = std::make_shared<Isd4000>(info); break;
+        case Device::Pid::Ism3d:   host.device = std::make_shared<Ism3d>(info); break;
+        case Device::Pid::Sonar:   host.device = std::make_shared<Sonar>(info); break;
+        default: return;
+        }
+
+        host.nextSeq = header.seq + 1;
+        m_devices.push_back(host.device);
+        onNew(host.device);
+        host.device->onConnect(*host.device);
+        return;
+    }
+
+    if (host.device == nullptr)
+    {
+        return;                                                             // Data from a device that was found before a restart
+    }
+
+    m_packets++;
+    if (header.seq != host.nextSeq)
+    {
+        m_dropped += header.seq - host.nextSeq;
+    }
+    host.nextSeq = header.seq + 1;
+
+    Device& device = *host.device;
+
+    switch (static_cast<Type>(header.type))
+    {
+    case Type::Ahrs:
+    {
+        FarmAhrs msg;
+        if (size < sizeof(msg))
+        {
+            return;
+        }
+        memcpy(&msg, payload, sizeof(msg));
+
+        const Math::Quaternion q{ msg.w, msg.x, msg.y, msg.z };
+        Ahrs& ahrs = device.info.pid == Device::Pid::Isa500 ? reinterpret_cast<Isa500&>(device).ahrs : device.info.pid == Device::Pid::Isd4000 ? reinterpret_cast<Isd4000&>(device).ahrs :
+                     device.info.pid == Device::Pid::Ism3d ? reinterpret_cast<Ism3d&>(device).ahrs : reinterpret_cast<Sonar&>(device).ahrs;
+        ahrs.onData(ahrs, header.timeUs, q, msg.magHeadingRad, msg.turns);
+        break;
+    }
+    case Type::Echo:
+    {
+        FarmEcho msg;
+        if (size < sizeof(msg))
+        {
+            return;
+        }
+        memcpy(&msg, payload, sizeof(msg));
+
+        Isa500& isa500 = reinterpret_cast<Isa500&>(device);
+        m_echoes[0].totalTof = msg.altitudeM * 2 / 1500.0;
+        m_echoes[0].correlation = msg.correlation;
+        m_echoes[0].signalEnergy = msg.signalEnergy;
+        isa500.onEcho(isa500, header.timeUs, 0, 1, m_echoes);
+        break;
+    }
+    case Type::Pressure:
+    {
+        FarmPressure msg;
+        if (size < sizeof(msg))
+        {
+            return;
+        }
+        memcpy(&msg, payload, sizeof(msg));
+
+        Isd4000& isd4000 = reinterpret_cast<Isd4000&>(device);
+        isd4000.onPressure(isd4000, header.timeUs, msg.pressureBar, msg.depthM, msg.pressureBar);
+        break;
+    }
+    case Type::Ping:
+    {
+        FarmPing msg;
+        if (size < sizeof(msg))
+        {
+            return;
+        }
+        memcpy(&msg, payload, sizeof(msg));
+
+        const uint_t count = std::min<uint_t>(msg.count, (size - sizeof(msg)) / sizeof(uint16_t));
+        Sonar& sonar = reinterpret_cast<Sonar&>(device);
+
+        m_ping.angle = msg.angle;
+        m_ping.stepSize = msg.stepSize;
+        m_ping.minRangeMm = msg.minRangeMm;
+        m_ping.maxRangeMm = msg.maxRangeMm;
+        m_ping.data.resize(count);
+        memcpy(m_ping.data.data(), payload + sizeof(msg), count * sizeof(uint16_t));
+        sonar.onPingData(sonar, m_ping);
+        break;
+    }
+    default:
+        return;
+    }
+
+    const uint64_t latencyNs = Platform::getTimeNs() - header.sendNs;
+    m_latency.record(latencyNs);
+    if (m_testLatency)
+    {
+        m_testLatency->record(latencyNs);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::startLoadTest(uint_t maxCount, uint_t stepSeconds)
+{
+    const uint_t steps[] = { 1, 2, 5, 10, 20, 50, 100, 200 };
+
+    m_testSteps.clear();
+    for (uint_t count : steps)
+    {
+        if (count < maxCount)
+        {
+            m_testSteps.push_back(count);
+        }
+    }
+    m_testSteps.push_back(std::min(maxCount, maxDevices));
+
+    m_testStep = 0;
+    m_testSeconds = stepSeconds;
+    m_testStartUs = 0;
+    m_testAddedUs = Platform::getTimeUs();
+    add(m_testSteps[0]);
+
+    Debug::log(Debug::Severity::Notice, "Farm", "App dispatch load test up to %u devices, %u s a step. AHRS %.0f Hz, echoes %.0f Hz, pressure %.0f Hz, pings %.0f Hz of %u samples",
+               FMT_U(m_testSteps.back()), FMT_U(stepSeconds), m_rates.ahrsHz, m_rates.echoHz, m_rates.pressureHz, m_rates.pingHz, FMT_U(m_rates.pingSamples));
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceFarm::runLoadTest()
+{
+    if (loadTestFinished())
+    {
+        return;
+    }
+
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    // Measure once every device in the step has been found, or given up on
+    if (m_testStartUs == 0)
+    {
+        if (m_devices.size() >= m_simCount || nowUs - m_testAddedUs > 5 * discoveryPeriodMs * static_cast<uint64_t>(1000))
+        {
+            m_testStartUs = nowUs;
+            m_testThreadCpuNs = Platform::getThreadCpuNs();
+            m_testProcessCpuNs = Platform::getProcessCpuNs();
+            m_testFarmCpuNs = m_farmCpuNs.load(std::memory_order_relaxed);
+            m_testPackets = m_packets;
+            m_testDropped = m_dropped + m_sendFailures.load(std::memory_order_relaxed);
+            m_testLatency = std::make_unique<Metrics::Histogram>();
+        }
+        return;
+    }
+
+    if (nowUs - m_testStartUs < m_testSeconds * static_cast<uint64_t>(1000000))
+    {
+        return;
+    }
+
+    const real_t wallNs = (nowUs - m_testStartUs) * 1000.0;
+    const uint_t devices = std::max<uint_t>(1, m_devices.size());
+    const uint64_t threadNs = Platform::getThreadCpuNs() - m_testThreadCpuNs;
+    const uint64_t farmNs = m_farmCpuNs.load(std::memory_order_relaxed) - m_testFarmCpuNs;
+    const uint64_t processNs = Platform::getProcessCpuNs() - m_testProcessCpuNs;
+    const uint64_t otherNs = processNs > threadNs + farmNs ? processNs - threadNs - farmNs : 0;
+    const uint64_t packets = m_packets - m_testPackets;
+    const uint64_t dropped = m_dropped + m_sendFailures.load(std::memory_order_relaxed) - m_testDropped;
+    const Metrics::Histogram& latency = *m_testLatency;
+
+    Debug::log(Debug::Severity::Notice, "Farm", "%3u devices  CPU per device: main thread %6.3f%%, other threads %6.3f%% (farm %5.1f%% total)  latency ms p50:%7.2f p99:%7.2f p99.9:%7.2f  packets %8llu  dropped %llu (%.3f%%)",
+               FMT_U(m_devices.size()), threadNs * 100.0 / wallNs / devices, otherNs * 100.0 / wallNs / devices, farmNs * 100.0 / wallNs,
+               latency.quantile(0.5) * 0.000001, latency.quantile(0.99) * 0.000001, latency.quantile(0.999) * 0.000001,
+               static_cast<unsigned long long>(packets), static_cast<unsigned long long>(dropped), packets + dropped ? dropped * 100.0 / (packets + dropped) : 0.0);
+
+    if (SlotProfiler::global().running())
+    {
+        SlotProfiler::global().report();                                    // Per callback, from the previous step's report so including discovery
+    }
+
+    m_testLatency.reset();
+    m_testStep++;
+    m_testStartUs = 0;
+
+    if (!loadTestFinished())
+    {
+        m_testAddedUs = nowUs;
+        add(m_testSteps[m_testStep] - m_simCount);
+    }
+}
+//--------------------------------------------------------------------------------------------------
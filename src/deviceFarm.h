@@ -0,0 +1,129 @@
+#ifndef DEVICEFARM_H_
+#define DEVICEFARM_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "devices/isa500.h"
+#include "devices/isd4000.h"
+#include "devices/ism3d.h"
+#include "devices/sonar.h"
+#include "metrics.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Simulated ISA500, ISD4000, ISM3D and sonar devices for load testing App dispatch without owning
+    // the devices. This is not a test of the SDK: discovery, framing, parsing and the ports are never
+    // used, as the farm speaks its own datagrams rather than the ISL protocol. Each simulated device is
+    // a UDP socket on 127.0.0.1, basePort + its number, run by the farm thread. It answers a discovery
+    // datagram with its PID, part and serial number and then streams AHRS and its own data, echoes,
+    // pressure or pings, at the set rates with a sequence number and send time. run() sends the
+    // discovery, makes a device object for each answer and raises onNew so it gets an App like any
+    // other device. It then raises that device's data signals directly with the received data, so
+    // the Apps and everything downstream of them see the load real devices would give. The devices
+    // have no connection so commands go nowhere. Sequence gaps are dropped packets and the time from
+    // send to the end of the callbacks goes to the isl_farm_latency_seconds histogram.
+    class DeviceFarm
+    {
+    public:
+        static constexpr uint16_t basePort = 33200;                          // Simulated device n listens on basePort + n
+        static constexpr uint_t maxDevices = 200;
+        static constexpr uint_t maxPingSamples = 4000;
+        static constexpr uint_t discoveryPeriodMs = 1000;
+
+        struct Rates
+        {
+            real_t ahrsHz;                                                  // Every device
+            real_t echoHz;                                                  // ISA500
+            real_t pressureHz;                                              // ISD4000
+            real_t pingHz;                                                  // Sonar
+            uint_t pingSamples;
+        };
+
+        DeviceFarm();
+        ~DeviceFarm();
+        bool_t start(const Rates& rates);
+        void stop();
+        bool_t running() const { return m_socket >= 0; }
+        void add(uint_t count);                                             // Devices are an ISA500, ISD4000, ISM3D and sonar in turn
+        uint_t size() const { return m_simCount; }
+        uint_t discovered() const { return m_devices.size(); }
+        void run();                                                         // Call regularly on the main thread to discover and dispatch
+        void startLoadTest(uint_t maxDevices, uint_t stepSeconds);          // Steps up the device count, logging a report for each step
+        bool_t loadTestFinished() const { return m_testStep >= m_testSteps.size(); }
+
+        Signal<const Device::SharedPtr&> onNew;                             // A simulated device answered discovery
+
+    private:
+        enum class Type : uint8_t { Discover, Announce, Ahrs, Echo, Pressure, Ping };
+
+        struct Sim                                                          // Owned by the farm thread once started
+        {
+            int socket;
+            uint16_t index;
+            uint16_t pid;
+            uint32_t seq;
+            bool_t found;
+            uint8_t host[16];                                               // sockaddr_in the discovery came from
+            uint64_t startUs;
+            uint64_t nextAhrsUs;
+            uint64_t nextDataUs;
+            uint16_t angle;
+        };
+
+        struct Host                                                         // Owned by the main thread
+        {
+            Device::SharedPtr device;
+            uint32_t nextSeq;
+        };
+
+        Rates m_rates;
+        int m_socket;                                                       // The App side, discovery goes out and data comes in here
+        std::atomic<uint_t> m_simCount;
+        std::vector<Sim> m_newSims;                                         // Handed to the farm thread under m_mutex
+        std::mutex m_mutex;
+        std::thread m_farm;
+        std::atomic<bool_t> m_stopping;
+        std::atomic<uint64_t> m_farmCpuNs;
+        std::atomic<uint64_t> m_sendFailures;
+        std::vector<Host> m_hosts;                                          // By simulated device number
+        std::vector<Device::SharedPtr> m_devices;
+        std::vector<uint8_t> m_buf;
+        uint64_t m_lastDiscoveryUs;
+        uint64_t m_packets;
+        uint64_t m_dropped;
+        Metrics::Histogram& m_latency;
+        std::vector<Isa500::Echo> m_echoes;
+        Sonar::Ping m_ping;
+
+        std::vector<uint_t> m_testSteps;
+        uint_t m_testStep;
+        uint_t m_testSeconds;
+        uint64_t m_testAddedUs;
+        uint64_t m_testStartUs;                                             // 0 while waiting for the step's devices to be discovered
+        uint64_t m_testThreadCpuNs;
+        uint64_t m_testProcessCpuNs;
+        uint64_t m_testFarmCpuNs;
+        uint64_t m_testPackets;
+        uint64_t m_testDropped;
+        std::unique_ptr<Metrics::Histogram> m_testLatency;
+
+        real_t dataHz(uint16_t pid) const;
+        void farmTask();
+        void simulate(Sim& sim, uint64_t nowUs);
+        void send(Sim& sim, Type type, const void* payload, uint_t size, const void* data = nullptr, uint_t dataSize = 0);
+        void discover();
+        void receive();
+        void dispatch(const uint8_t* packet, uint_t size);
+        void runLoadTest();
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,210 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "deviceRegistry.h"
+#include "platform/debug.h"
+#include "platform.h"
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+DeviceRegistry::DeviceRegistry() : m_selected(0), m_haveSelected(false)
+{
+}
+//--------------------------------------------------------------------------------------------------
+DeviceRegistry::~DeviceRegistry()
+{
+    while (!m_order.empty())
+    {
+        remove(m_order.back());
+    }
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t DeviceRegistry::key(const Device::Info& info)
+{
+    return (static_cast<uint64_t>(info.pid) << 32) | (static_cast<uint64_t>(info.pn) << 16) | info.sn;
+}
+//--------------------------------------------------------------------------------------------------
+App* DeviceRegistry::find(const Device::Info& info) const
+{
+    auto it = m_entries.find(key(info));
+    return it != m_entries.end() ? it->second.app.get() : nullptr;
+}
+//--------------------------------------------------------------------------------------------------
+App* DeviceRegistry::attach(const Device::SharedPtr& device)
+{
+    auto it = m_entries.find(key(device->info));
+
+    if (it == m_entries.end())
+    {
+        return nullptr;
+    }
+
+    Entry& entry = it->second;
+
+    if (entry.device != device)
+    {
+        if (entry.device)
+        {
+            entry.device->onDelete.disconnect(slotDelete);
+        }
+
+        entry.device = device;
+        entry.app->setDevice(device);
+        device->onDelete.connect(slotDelete);
+        Debug::log(Debug::Severity::Notice, "Registry", "%04u.%04u reattached to existing %s", FMT_U(device->info.pn), FMT_U(device->info.sn), entry.app->name.c_str());
+    }
+
+    entry.deletePending = false;
+    return entry.app.get();
+}
+//--------------------------------------------------------------------------------------------------
+App* DeviceRegistry::add(const Device::SharedPtr& device, std::unique_ptr<App> app)
+{
+    const uint64_t k = key(device->info);
+
+    if (m_entries.count(k))
+    {
+        remove(k);
+    }
+
+    Entry& entry = m_entries[k];
+    entry.app = std::move(app);
+    entry.device = device;
+    entry.info = device->info;
+    entry.deletePending = false;
+    entry.detachedUs = 0;
+    m_order.push_back(k);
+
+    entry.app->setDevice(device);
+    device->onDelete.connect(slotDelete);
+
+    if (!m_haveSelected)
+    {
+        select(m_order.size());
+    }
+    return entry.app.get();
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceRegistry::run()
+{
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    for (uint_t i = 0; i < m_order.size();)
+    {
+        Entry& entry = m_entries[m_order[i]];
+
+        // Detaching is deferred to here as it disconnects slots from the signal being emitted
+        if (entry.deletePending)
+        {
+            entry.deletePending = false;
+            entry.device->onDelete.disconnect(slotDelete);
+            entry.app->setDevice(nullptr);
+            entry.device.reset();
+            entry.detachedUs = nowUs;
+        }
+
+        if (entry.device)
+        {
+            entry.app->run();
+        }
+
+        if (!entry.device && nowUs - entry.detachedUs > holdTimeMs * static_cast<uint64_t>(1000))
+        {
+            Debug::log(Debug::Severity::Info, "Registry", "Releasing %s for %04u.%04u", entry.app->name.c_str(), FMT_U(entry.info.pn), FMT_U(entry.info.sn));
+            remove(m_order[i]);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceRegistry::doTask(int_t key, const std::string& path)
+{
+    if (key >= '0' && key <= '9')
+    {
+        select(key - '0');
+    }
+    else if (key == 'l')
+    {
+        list();
+    }
+    else if (m_haveSelected)
+    {
+        m_entries[m_selected].app->doTask(key, path);
+    }
+    else
+    {
+        for (uint64_t k : m_order)
+        {
+            m_entries[k].app->doTask(key, path);
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceRegistry::select(uint_t index)
+{
+    if (index == 0)
+    {
+        m_haveSelected = false;
+        Debug::log(Debug::Severity::Notice, "Registry", "Keys go to all devices");
+    }
+    else if (index <= m_order.size())
+    {
+        const Entry& entry = m_entries[m_order[index - 1]];
+        m_selected = m_order[index - 1];
+        m_haveSelected = true;
+        Debug::log(Debug::Severity::Notice, "Registry", "Keys go to %s %04u.%04u", entry.app->name.c_str(), FMT_U(entry.info.pn), FMT_U(entry.info.sn));
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceRegistry::list() const
+{
+    for (uint_t i = 0; i < m_order.size(); i++)
+    {
+        const Entry& entry = m_entries.at(m_order[i]);
+        Debug::log(Debug::Severity::Info, "Registry", "%u -> %s %04u.%04u%s%s", FMT_U(i + 1), entry.app->name.c_str(), FMT_U(entry.info.pn), FMT_U(entry.info.sn), entry.device ? "" : " (detached)", m_haveSelected && m_selected == m_order[i] ? " *" : "");
+    }
+    Debug::log(Debug::Severity::Info, "Registry", "0 -> All devices%s", m_haveSelected ? "" : " *");
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceRegistry::remove(uint64_t k)
+{
+    auto it = m_entries.find(k);
+
+    if (it != m_entries.end())
+    {
+        if (it->second.device)
+        {
+            it->second.device->onDelete.disconnect(slotDelete);
+        }
+        it->second.app->setDevice(nullptr);
+        m_entries.erase(it);
+    }
+
+    for (uint_t i = 0; i < m_order.size(); i++)
+    {
+        if (m_order[i] == k)
+        {
+            m_order.erase(m_order.begin() + i);
+            break;
+        }
+    }
+
+    if (m_haveSelected && m_selected == k)
+    {
+        m_haveSelected = false;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DeviceRegistry::callbackDeleted(Device& device)
+{
+    auto it = m_entries.find(key(device.info));
+
+    if (it != m_entries.end() && it->second.device.get() == &device)
+    {
+        it->second.deletePending = true;
+    }
+}
+//--------------------------------------------------------------------------------------------------
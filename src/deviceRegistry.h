@@ -0,0 +1,59 @@
+#ifndef DEVICEREGISTRY_H_
+#define DEVICEREGISTRY_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "app.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Owns one App per physical device, keyed by PID, part number and serial number. A rediscovered
+    // device is reattached to its existing App so none are duplicated. When the SDK deletes a device
+    // its App is detached and kept for holdTimeMs in case the device comes back, then destroyed.
+    // Key presses go to the selected device only, or to every device when none is selected.
+    class DeviceRegistry
+    {
+    public:
+        static constexpr uint_t holdTimeMs = 60000;
+
+        DeviceRegistry();
+        ~DeviceRegistry();
+        static uint64_t key(const Device::Info& info);
+        App* find(const Device::Info& info) const;
+        App* attach(const Device::SharedPtr& device);                       // Returns the existing App now using this device, or nullptr if there isn't one
+        App* add(const Device::SharedPtr& device, std::unique_ptr<App> app);
+        void run();                                                         // Call regularly to release deleted devices
+        void doTask(int_t key, const std::string& path);                    // 0 to 9 select a device, l lists them, other keys are routed
+        uint_t size() const { return m_entries.size(); }
+
+        Slot<Device&> slotDelete{ this, &DeviceRegistry::callbackDeleted };
+
+    private:
+        struct Entry
+        {
+            std::unique_ptr<App> app;
+            Device::SharedPtr device;                                       // nullptr while detached
+            Device::Info info;
+            bool_t deletePending;
+            uint64_t detachedUs;
+        };
+
+        std::unordered_map<uint64_t, Entry> m_entries;
+        std::vector<uint64_t> m_order;                                      // Registration order, used for selection by number
+        uint64_t m_selected;
+        bool_t m_haveSelected;
+
+        void select(uint_t index);
+        void list() const;
+        void remove(uint64_t key);
+        void callbackDeleted(Device& device);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,197 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "discoveryCache.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <cstdio>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+DiscoveryCache::DiscoveryCache() : m_startUs(0), m_firstConnected(false), m_probeHits(0)
+{
+}
+//--------------------------------------------------------------------------------------------------
+DiscoveryCache::~DiscoveryCache()
+{
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t DiscoveryCache::key(uint16_t pid, uint16_t pn, uint16_t sn)
+{
+    return (static_cast<uint64_t>(pid) << 32) | (static_cast<uint64_t>(pn) << 16) | sn;
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryCache::start(const std::string& fileName)
+{
+    m_fileName = fileName;
+    m_startUs = Platform::getTimeUs();
+    m_firstConnected = false;
+    m_probeHits = 0;
+    load();
+
+    Debug::log(Debug::Severity::Info, "Discovery", "%u devices in cache", FMT_U(m_entries.size()));
+}
+//--------------------------------------------------------------------------------------------------
+bool_t DiscoveryCache::discover(SysPort& sysPort)
+{
+    bool_t probing = false;
+
+    for (auto& it : m_entries)
+    {
+        Entry& entry = it.second;
+
+        if (entry.portName == sysPort.name)
+        {
+            if (sysPort.type == SysPort::Type::Net)
+            {
+                NetPort& port = reinterpret_cast<NetPort&>(sysPort);
+                port.discoverIslDevices(entry.pid, entry.pn, entry.sn, entry.meta.ipAddress, entry.meta.port, netProbeTimeoutMs);
+            }
+            else
+            {
+                UartPort& port = reinterpret_cast<UartPort&>(sysPort);
+                port.discoverIslDevices(entry.pid, entry.pn, entry.sn, entry.meta.baudrate, serialProbeTimeoutMs);
+            }
+
+            entry.probing = true;
+            probing = true;
+        }
+    }
+    return probing;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t DiscoveryCache::discoveryFinished(SysPort& sysPort)
+{
+    bool_t missed = false;
+
+    if (sysPort.isDiscovering())
+    {
+        return false;                                   // More cached probes queued on this port
+    }
+
+    for (auto& it : m_entries)
+    {
+        Entry& entry = it.second;
+
+        if (entry.probing && entry.portName == sysPort.name)
+        {
+            Debug::log(Debug::Severity::Warning, "Discovery", "Cached device %04u.%04u not found on %s", FMT_U(entry.pn), FMT_U(entry.sn), sysPort.name.c_str());
+            entry.probing = false;
+            missed = true;
+        }
+    }
+    return missed;
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryCache::deviceFound(Device& device, SysPort& sysPort, const ConnectionMeta& meta)
+{
+    auto it = m_entries.find(key(device.info.pid, device.info.pn, device.info.sn));
+
+    if (it != m_entries.end() && it->second.probing)
+    {
+        it->second.probing = false;
+        m_probeHits++;
+    }
+
+    update(device, sysPort, meta);
+
+    device.onPortChanged.connect(slotPortChanged);
+    if (!m_firstConnected)
+    {
+        device.onConnect.connect(slotConnect);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+uint_t DiscoveryCache::cachedCount(const std::string& portName) const
+{
+    uint_t count = 0;
+
+    for (const auto& it : m_entries)
+    {
+        count += it.second.portName == portName;
+    }
+    return count;
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryCache::update(Device& device, SysPort& sysPort, const ConnectionMeta& meta)
+{
+    Entry& entry = m_entries[key(device.info.pid, device.info.pn, device.info.sn)];
+
+    if (entry.portName != sysPort.name || entry.meta.baudrate != meta.baudrate || entry.meta.ipAddress != meta.ipAddress || entry.meta.port != meta.port)
+    {
+        entry.portName = sysPort.name;
+        entry.pid = device.info.pid;
+        entry.pn = device.info.pn;
+        entry.sn = device.info.sn;
+        entry.meta = meta;
+        entry.probing = false;
+        save();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryCache::callbackConnect(Device& device)
+{
+    if (!m_firstConnected)
+    {
+        m_firstConnected = true;
+        Debug::log(Debug::Severity::Notice, "Discovery", "First device connected %.0f ms after start, %u found from the cache", (Platform::getTimeUs() - m_startUs) * 0.001, FMT_U(m_probeHits));
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryCache::callbackPortChanged(Device& device, SysPort& sysPort, const ConnectionMeta& meta)
+{
+    update(device, sysPort, meta);
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryCache::load()
+{
+    FILE* file = fopen(m_fileName.c_str(), "r");
+    char line[256];
+
+    m_entries.clear();
+
+    if (file == nullptr)
+    {
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file))
+    {
+        char portName[128];
+        unsigned int pid, pn, sn, baudrate, ipAddress, port;
+
+        if (line[0] != '#' && sscanf(line, "%127[^,],%u,%u,%u,%u,%u,%u", portName, &pid, &pn, &sn, &baudrate, &ipAddress, &port) == 7)
+        {
+            Entry& entry = m_entries[key(pid, pn, sn)];
+            entry.portName = portName;
+            entry.pid = static_cast<uint16_t>(pid);
+            entry.pn = static_cast<uint16_t>(pn);
+            entry.sn = static_cast<uint16_t>(sn);
+            entry.meta.baudrate = baudrate;
+            entry.meta.ipAddress = ipAddress;
+            entry.meta.port = static_cast<uint16_t>(port);
+            entry.probing = false;
+        }
+    }
+    fclose(file);
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryCache::save() const
+{
+    FILE* file = fopen(m_fileName.c_str(), "w");
+
+    if (file == nullptr)
+    {
+        Debug::log(Debug::Severity::Warning, "Discovery", "Can't write %s", m_fileName.c_str());
+        return;
+    }
+
+    fprintf(file, "# port,pid,pn,sn,baudrate,ipAddress,ipPort\n");
+    for (const auto& it : m_entries)
+    {
+        const Entry& e = it.second;
+        fprintf(file, "%s,%u,%u,%u,%u,%u,%u\n", e.portName.c_str(), e.pid, e.pn, e.sn, static_cast<unsigned int>(e.meta.baudrate), static_cast<unsigned int>(e.meta.ipAddress), e.meta.port);
+    }
+    fclose(file);
+}
+//--------------------------------------------------------------------------------------------------
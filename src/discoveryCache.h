@@ -0,0 +1,61 @@
+#ifndef DISCOVERYCACHE_H_
+#define DISCOVERYCACHE_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "devices/device.h"
+#include <string>
+#include <unordered_map>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Remembers the port, baudrate or IP address and PN/SN of each device found, in a small text file.
+    // On the next start a port with cached devices is probed for just those devices at their last known
+    // settings, and only if one of them doesn't answer is the full baudrate or broadcast sweep run.
+    class DiscoveryCache
+    {
+    public:
+        DiscoveryCache();
+        ~DiscoveryCache();
+        void start(const std::string& fileName);                            // Loads the cache and starts the startup timer
+        bool_t discover(SysPort& sysPort);                                  // Returns false if nothing is cached for this port
+        bool_t discoveryFinished(SysPort& sysPort);                         // Returns true if a cached device was missed and a full sweep is needed
+        void deviceFound(Device& device, SysPort& sysPort, const ConnectionMeta& meta);
+        uint_t cachedCount(const std::string& portName) const;
+
+        Slot<Device&> slotConnect{ this, &DiscoveryCache::callbackConnect };
+        Slot<Device&, SysPort&, const ConnectionMeta&> slotPortChanged{ this, &DiscoveryCache::callbackPortChanged };
+
+    private:
+        static constexpr uint_t serialProbeTimeoutMs = 250;
+        static constexpr uint_t netProbeTimeoutMs = 1000;
+
+        struct Entry
+        {
+            std::string portName;
+            uint16_t pid;
+            uint16_t pn;
+            uint16_t sn;
+            ConnectionMeta meta;
+            bool_t probing;
+        };
+
+        std::string m_fileName;
+        std::unordered_map<uint64_t, Entry> m_entries;
+        uint64_t m_startUs;
+        bool_t m_firstConnected;
+        uint_t m_probeHits;
+
+        static uint64_t key(uint16_t pid, uint16_t pn, uint16_t sn);
+        void load();
+        void save() const;
+        void update(Device& device, SysPort& sysPort, const ConnectionMeta& meta);
+        void callbackConnect(Device& device);
+        void callbackPortChanged(Device& device, SysPort& sysPort, const ConnectionMeta& meta);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,239 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "discoveryScheduler.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace IslSdk;
+
+// Baudrates ISL devices support, in the order tried on a port with no history
+const uint32_t DiscoveryScheduler::baudrates[] = { 115200, 9600, 57600, 38400, 19200, 230400, 460800, 921600 };
+
+//--------------------------------------------------------------------------------------------------
+DiscoveryScheduler::DiscoveryScheduler() : m_startUs(0), m_reported(false)
+{
+}
+//--------------------------------------------------------------------------------------------------
+DiscoveryScheduler::~DiscoveryScheduler()
+{
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::start(const std::string& historyFileName)
+{
+    m_fileName = historyFileName;
+    m_startUs = Platform::getTimeUs();
+    m_reported = false;
+    load();
+}
+//--------------------------------------------------------------------------------------------------
+DiscoveryScheduler::Port& DiscoveryScheduler::getPort(const SysPort& sysPort)
+{
+    auto it = m_ports.find(sysPort.name);
+
+    if (it == m_ports.end())
+    {
+        Port& p = m_ports[sysPort.name];
+        p.timing.portName = sysPort.name;
+        p.timing.startUs = 0;
+        p.timing.readyUs = 0;
+        p.timing.finishUs = 0;
+        p.timing.devices = 0;
+        p.expected = 0;
+        p.next = 0;
+        p.sweeping = false;
+        p.done = false;
+        return p;
+    }
+    return it->second;
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::setExpectedCount(const SysPort& sysPort, uint_t count)
+{
+    getPort(sysPort).expected = count;
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::sweep(UartPort& port)
+{
+    Port& p = getPort(port);
+    const std::unordered_map<uint32_t, uint_t>& history = m_history[port.name];
+
+    p.order.assign(std::begin(baudrates), std::end(baudrates));
+    std::stable_sort(p.order.begin(), p.order.end(), [&history](uint32_t a, uint32_t b)
+    {
+        auto ia = history.find(a);
+        auto ib = history.find(b);
+        return (ia != history.end() ? ia->second : 0) > (ib != history.end() ? ib->second : 0);
+    });
+
+    // Counted again from here, so devices found by an earlier probe don't end the sweep before it starts
+    p.found.clear();
+    p.timing.devices = 0;
+    p.timing.readyUs = 0;
+    p.next = 0;
+    p.sweeping = true;
+    p.done = false;
+    probeNext(port, p);
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::probeNext(UartPort& port, Port& p)
+{
+    const bool_t full = p.expected && p.timing.devices >= p.expected;
+
+    if (p.sweeping && !full && p.next < p.order.size())
+    {
+        port.discoverIslDevices(0xffff, 0xffff, 0xffff, p.order[p.next++], probeTimeoutMs);
+    }
+    else
+    {
+        p.sweeping = false;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::discoveryStarted(SysPort& sysPort)
+{
+    Port& p = getPort(sysPort);
+
+    if (p.timing.startUs == 0)
+    {
+        p.timing.startUs = Platform::getTimeUs();
+    }
+    p.done = false;
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::discoveryFinished(SysPort& sysPort)
+{
+    Port& p = getPort(sysPort);
+
+    p.timing.finishUs = Platform::getTimeUs();
+
+    if (p.sweeping && !sysPort.isDiscovering())
+    {
+        probeNext(reinterpret_cast<UartPort&>(sysPort), p);
+    }
+
+    if (!p.sweeping && !sysPort.isDiscovering())
+    {
+        p.done = true;
+        checkAllDone();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::deviceFound(const Device& device, SysPort& sysPort, const ConnectionMeta& meta)
+{
+    Port& p = getPort(sysPort);
+
+    if (!p.found.insert(static_cast<uint32_t>(device.info.pn) << 16 | device.info.sn).second)
+    {
+        return;                                                             // Found again, at another baudrate or by the cache probe
+    }
+    p.timing.devices = static_cast<uint_t>(p.found.size());
+
+    if (sysPort.type == SysPort::Type::Serial)
+    {
+        m_history[sysPort.name][meta.baudrate]++;
+        save();
+    }
+
+    if (p.expected && p.timing.devices >= p.expected && p.timing.readyUs == 0)
+    {
+        // Everything expected is here, don't wait for the rest of the sweep to time out
+        p.timing.readyUs = Platform::getTimeUs();
+        p.sweeping = false;
+
+        if (sysPort.isDiscovering())
+        {
+            sysPort.stopDiscovery();
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+std::vector<DiscoveryScheduler::Timing> DiscoveryScheduler::timings() const
+{
+    std::vector<Timing> result;
+
+    for (const auto& it : m_ports)
+    {
+        result.push_back(it.second.timing);
+    }
+    return result;
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::checkAllDone()
+{
+    uint64_t lastUs = m_startUs;
+    uint_t devices = 0;
+
+    for (const auto& it : m_ports)
+    {
+        if (!it.second.done)
+        {
+            return;
+        }
+    }
+
+    if (m_reported)
+    {
+        return;
+    }
+    m_reported = true;
+
+    for (const auto& it : m_ports)
+    {
+        const Timing& t = it.second.timing;
+        const uint64_t readyUs = t.readyUs ? t.readyUs : t.finishUs;
+
+        Debug::log(Debug::Severity::Info, "Discovery", "%s: %u devices, ready %.0f ms after start (discovery %.0f ms)", t.portName.c_str(), FMT_U(t.devices), (readyUs - m_startUs) * 0.001, (t.finishUs - t.startUs) * 0.001);
+        lastUs = std::max(lastUs, readyUs);
+        devices += t.devices;
+    }
+
+    Debug::log(Debug::Severity::Notice, "Discovery", "%u ports, %u devices ready in %.0f ms", FMT_U(m_ports.size()), FMT_U(devices), (lastUs - m_startUs) * 0.001);
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::load()
+{
+    FILE* file = fopen(m_fileName.c_str(), "r");
+    char line[256];
+
+    m_history.clear();
+
+    if (file == nullptr)
+    {
+        return;
+    }
+
+    while (fgets(line, sizeof(line), file))
+    {
+        char portName[128];
+        unsigned int baudrate, count;
+
+        if (line[0] != '#' && sscanf(line, "%127[^,],%u,%u", portName, &baudrate, &count) == 3)
+        {
+            m_history[portName][baudrate] = count;
+        }
+    }
+    fclose(file);
+}
+//--------------------------------------------------------------------------------------------------
+void DiscoveryScheduler::save() const
+{
+    FILE* file = fopen(m_fileName.c_str(), "w");
+
+    if (file == nullptr)
+    {
+        return;
+    }
+
+    fprintf(file, "# port,baudrate,devicesFound\n");
+    for (const auto& port : m_history)
+    {
+        for (const auto& baud : port.second)
+        {
+            fprintf(file, "%s,%u,%u\n", port.first.c_str(), static_cast<unsigned int>(baud.first), static_cast<unsigned int>(baud.second));
+        }
+    }
+    fclose(file);
+}
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,74 @@
+#ifndef DISCOVERYSCHEDULER_H_
+#define DISCOVERYSCHEDULER_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "comms/ports/sysPort.h"
+#include "devices/device.h"
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Schedules ISL discovery on every port and times it. Serial ports are swept one baudrate at a time,
+    // most often successful first according to a history file, and the sweep stops once the port has
+    // as many different devices as expected. A port that reaches its expected count has any remaining
+    // probes cancelled. With no expected count every baudrate is tried. The SDK runs each port's
+    // discovery independently so all ports proceed concurrently.
+    class DiscoveryScheduler
+    {
+    public:
+        struct Timing
+        {
+            std::string portName;
+            uint64_t startUs;                           // First discovery started
+            uint64_t readyUs;                           // Expected device count reached, 0 if never
+            uint64_t finishUs;                          // Last discovery finished
+            uint_t devices;                             // Different devices found by the latest sweep
+        };
+
+        DiscoveryScheduler();
+        ~DiscoveryScheduler();
+        void start(const std::string& historyFileName);
+        void setExpectedCount(const SysPort& sysPort, uint_t count);       // 0 means unknown, sweep every baudrate
+        void sweep(UartPort& port);
+        void discoveryStarted(SysPort& sysPort);
+        void discoveryFinished(SysPort& sysPort);
+        void deviceFound(const Device& device, SysPort& sysPort, const ConnectionMeta& meta);
+        std::vector<Timing> timings() const;
+
+    private:
+        static constexpr uint_t probeTimeoutMs = 200;
+        static const uint32_t baudrates[];
+
+        struct Port
+        {
+            Timing timing;
+            uint_t expected;
+            std::vector<uint32_t> order;
+            std::unordered_set<uint32_t> found;         // Part number << 16 | serial number
+            uint_t next;
+            bool_t sweeping;
+            bool_t done;
+        };
+
+        std::string m_fileName;
+        uint64_t m_startUs;
+        bool_t m_reported;
+        std::unordered_map<std::string, Port> m_ports;
+        std::unordered_map<std::string, std::unordered_map<uint32_t, uint_t>> m_history;   // Devices found per port per baudrate
+
+        Port& getPort(const SysPort& sysPort);
+        void probeNext(UartPort& port, Port& p);
+        void checkAllDone();
+        void load();
+        void save() const;
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,122 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "dispatchBenchmark.h"
+#include "typedApp.h"
+#include "maths/maths.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace IslSdk;
+
+namespace
+{
+    struct Sample
+    {
+        uint64_t timeUs;
+        Math::Quaternion q;
+        real_t magHeadingRad;
+        real_t turns;
+    };
+
+    // Stands in for the device's Ahrs, the signal has the same arguments
+    struct Replay
+    {
+        Signal<Replay&, uint64_t, const Math::Quaternion&, real_t, real_t> onData;
+    };
+
+    // What an AHRS handler does with every sample at the least, checks the interval and keeps the heading
+    struct Track
+    {
+        uint64_t lastUs = 0;
+        uint64_t late = 0;
+        real_t sum = 0;
+
+        void add(uint64_t timeUs, const Math::Quaternion& q, real_t magHeadingRad)
+        {
+            late += timeUs - lastUs > 1500;
+            lastUs = timeUs;
+            sum += q.w * q.z + magHeadingRad;
+        }
+    };
+
+    class SlotReceiver
+    {
+    public:
+        Track track;
+        Slot<Replay&, uint64_t, const Math::Quaternion&, real_t, real_t> slotData{ this, &SlotReceiver::callbackData };
+
+        void callbackData(Replay& replay, uint64_t timeUs, const Math::Quaternion& q, real_t magHeadingRad, real_t turns) { track.add(timeUs, q, magHeadingRad); }
+    };
+
+    class TypedReceiver
+    {
+    public:
+        Track track;
+
+        void callbackData(Replay& replay, uint64_t timeUs, const Math::Quaternion& q, real_t magHeadingRad, real_t turns) { track.add(timeUs, q, magHeadingRad); }
+
+        Handlers<On<&Replay::onData, &TypedReceiver::callbackData>> m_handlers{ this };          // After the handlers it names
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+template<typename F> static uint64_t replayNs(const std::vector<Sample>& stream, uint_t events, F deliver)
+{
+    const uint64_t startNs = Platform::getTimeNs();
+
+    for (uint_t i = 0; i < events; i++)
+    {
+        deliver(stream[i & (stream.size() - 1)]);
+    }
+    return Platform::getTimeNs() - startNs;
+}
+//--------------------------------------------------------------------------------------------------
+void DispatchBenchmark::run(uint_t events)
+{
+    const uint_t rounds = 5;
+    std::vector<Sample> stream(65536);
+
+    // A slow turn with some roll, one sample per ms
+    for (uint_t i = 0; i < stream.size(); i++)
+    {
+        const real_t half = static_cast<real_t>(i * 0.0001);
+        stream[i] = { 1000 + i * static_cast<uint64_t>(1000), { std::cos(half), static_cast<real_t>(0.01 * std::sin(i * 0.01)), 0, std::sin(half) }, half * 2, 0 };
+    }
+
+    Replay slotReplay;
+    Replay typedReplay;
+    SlotReceiver slotReceiver;
+    TypedReceiver typedReceiver;
+    Track direct;
+    uint64_t slotNs = UINT64_MAX;
+    uint64_t typedNs = UINT64_MAX;
+    uint64_t directNs = UINT64_MAX;
+
+    slotReplay.onData.connect(slotReceiver.slotData);
+    typedReceiver.m_handlers.connect(typedReplay);
+
+    Debug::log(Debug::Severity::Notice, "Dispatch", "Replaying %u synthetic AHRS samples %u times each way", FMT_U(events), FMT_U(rounds));
+
+    // Interleaved so frequency scaling and the caches treat each the same, the best round of each counts
+    for (uint_t round = 0; round < rounds; round++)
+    {
+        slotNs = std::min(slotNs, replayNs(stream, events, [&](const Sample& s) { slotReplay.onData(slotReplay, s.timeUs, s.q, s.magHeadingRad, s.turns); }));
+        typedNs = std::min(typedNs, replayNs(stream, events, [&](const Sample& s) { typedReplay.onData(typedReplay, s.timeUs, s.q, s.magHeadingRad, s.turns); }));
+        directNs = std::min(directNs, replayNs(stream, events, [&](const Sample& s) { direct.add(s.timeUs, s.q, s.magHeadingRad); }));
+    }
+
+    typedReceiver.m_handlers.disconnect(typedReplay);
+    slotReplay.onData.disconnect(slotReceiver.slotData);
+
+    const real_t perEvent = 1.0 / (events ? events : 1);
+    Debug::log(Debug::Severity::Notice, "Dispatch", "Slot member %.2f ns, TypedApp On<> %.2f ns, direct call %.2f ns per event", slotNs * perEvent, typedNs * perEvent, directNs * perEvent);
+
+    if (slotReceiver.track.sum != typedReceiver.track.sum || slotReceiver.track.sum != direct.sum || slotReceiver.track.late != direct.late)
+    {
+        Debug::log(Debug::Severity::Warning, "Dispatch", "The handlers saw different streams");
+    }
+}
+//--------------------------------------------------------------------------------------------------
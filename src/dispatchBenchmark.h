@@ -0,0 +1,25 @@
+#ifndef DISPATCHBENCHMARK_H_
+#define DISPATCHBENCHMARK_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Measures what it costs to deliver one event to an App's handler. A synthetic 1kHz AHRS stream,
+    // a slow turn with some roll, is replayed through a Signal to the same handler bound two ways, by
+    // a Slot member naming the callback as the Apps did, and by a TypedApp On<> binding. The handler is
+    // also called directly, which is the floor, so the difference from it is the cost of the Signal and
+    // Slot. The figures are for whichever Signal the build links, so measure against the real SDK.
+    class DispatchBenchmark
+    {
+    public:
+        static void run(uint_t events);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,332 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "ellipsoidFit.h"
+#include <cmath>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+// Cyclic Jacobi eigen decomposition of a symmetric 3x3 matrix, a is destroyed, eigenvectors are the columns of v
+static void eigenSymmetric3(real_t a[3][3], real_t v[3][3], real_t d[3])
+{
+    for (uint_t i = 0; i < 3; i++)
+    {
+        for (uint_t j = 0; j < 3; j++)
+        {
+            v[i][j] = i == j ? 1.0 : 0.0;
+        }
+    }
+
+    for (uint_t sweep = 0; sweep < 32; sweep++)
+    {
+        const real_t off = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+        if (off < 1e-30)
+        {
+            break;
+        }
+
+        for (uint_t p = 0; p < 2; p++)
+        {
+            for (uint_t q = p + 1; q < 3; q++)
+            {
+                if (a[p][q] == 0)
+                {
+                    continue;
+                }
+
+                const real_t theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+                const real_t t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1.0));
+                const real_t c = 1.0 / std::sqrt(t * t + 1.0);
+                const real_t s = t * c;
+
+                for (uint_t k = 0; k < 3; k++)
+                {
+                    const real_t akp = a[k][p], akq = a[k][q];
+                    a[k][p] = c * akp - s * akq;
+                    a[k][q] = s * akp + c * akq;
+                }
+                for (uint_t k = 0; k < 3; k++)
+                {
+                    const real_t apk = a[p][k], aqk = a[q][k];
+                    a[p][k] = c * apk - s * aqk;
+                    a[q][k] = s * apk + c * aqk;
+                }
+                for (uint_t k = 0; k < 3; k++)
+                {
+                    const real_t vkp = v[k][p], vkq = v[k][q];
+                    v[k][p] = c * vkp - s * vkq;
+                    v[k][q] = s * vkp + c * vkq;
+                }
+            }
+        }
+    }
+
+    d[0] = a[0][0];
+    d[1] = a[1][1];
+    d[2] = a[2][2];
+}
+//--------------------------------------------------------------------------------------------------
+EllipsoidFit::EllipsoidFit() : expectedRadius(0), initialCentre(0, 0, 0), minSamples(100), minCoverage(0.5), maxResidual(0.1)
+{
+    reset();
+}
+//--------------------------------------------------------------------------------------------------
+void EllipsoidFit::reset()
+{
+    for (uint_t i = 0; i < 9; i++)
+    {
+        for (uint_t j = 0; j < 9; j++)
+        {
+            m_ata[i][j] = 0;
+        }
+        m_atb[i] = 0;
+    }
+
+    for (uint_t i = 0; i < binCount; i++)
+    {
+        m_bins[i] = 0;
+    }
+
+    m_scale = 0;
+    m_count = 0;
+    m_binsUsed = 0;
+    m_result.valid = false;
+    m_result.radius = 0;
+    m_result.residual = 0;
+    m_result.coverage = 0;
+}
+//--------------------------------------------------------------------------------------------------
+uint_t EllipsoidFit::binIndex(real_t x, real_t y, real_t z) const
+{
+    // Cube map, the dominant axis and its sign pick the face and the other two axes the cell on it
+    const real_t ax = std::fabs(x), ay = std::fabs(y), az = std::fabs(z);
+    uint_t face;
+    real_t u, v, major;
+
+    if (ax >= ay && ax >= az)
+    {
+        face = x >= 0 ? 0 : 1;
+        major = ax;
+        u = y;
+        v = z;
+    }
+    else if (ay >= az)
+    {
+        face = y >= 0 ? 2 : 3;
+        major = ay;
+        u = x;
+        v = z;
+    }
+    else
+    {
+        face = z >= 0 ? 4 : 5;
+        major = az;
+        u = x;
+        v = y;
+    }
+
+    if (major <= 0)
+    {
+        return 0;
+    }
+
+    uint_t iu = static_cast<uint_t>((u / major + 1.0) * 0.5 * binsPerAxis);
+    uint_t iv = static_cast<uint_t>((v / major + 1.0) * 0.5 * binsPerAxis);
+    iu = iu >= binsPerAxis ? binsPerAxis - 1 : iu;
+    iv = iv >= binsPerAxis ? binsPerAxis - 1 : iv;
+
+    return (face * binsPerAxis + iu) * binsPerAxis + iv;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t EllipsoidFit::add(const Math::Vector3& sample)
+{
+    if (m_scale == 0)
+    {
+        // Work in units of the first sample's magnitude to keep the normal equations well conditioned
+        m_scale = std::sqrt(sample.x * sample.x + sample.y * sample.y + sample.z * sample.z);
+        if (m_scale == 0)
+        {
+            return false;
+        }
+    }
+
+    const real_t x = sample.x / m_scale, y = sample.y / m_scale, z = sample.z / m_scale;
+    const Math::Vector3& centre = m_result.valid ? m_result.bias : initialCentre;
+    const real_t cx = centre.x / m_scale, cy = centre.y / m_scale, cz = centre.z / m_scale;
+
+    const uint_t bin = binIndex(x - cx, y - cy, z - cz);
+    if (m_bins[bin] >= maxPerBin)
+    {
+        return false;
+    }
+
+    if (m_bins[bin]++ == 0)
+    {
+        m_binsUsed++;
+    }
+
+    const real_t d[9] = { x * x, y * y, z * z, 2 * x * y, 2 * x * z, 2 * y * z, 2 * x, 2 * y, 2 * z };
+
+    for (uint_t i = 0; i < 9; i++)
+    {
+        for (uint_t j = i; j < 9; j++)
+        {
+            m_ata[i][j] += d[i] * d[j];
+        }
+        m_atb[i] += d[i];
+    }
+
+    m_count++;
+
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t EllipsoidFit::solve()
+{
+    real_t l[9][9];
+    real_t p[9];
+
+    m_result.coverage = static_cast<real_t>(m_binsUsed) / binCount;
+
+    if (m_count < 12)
+    {
+        return false;
+    }
+
+    // Cholesky factorisation of the normal matrix, only the upper triangle is accumulated
+    for (uint_t i = 0; i < 9; i++)
+    {
+        for (uint_t j = 0; j <= i; j++)
+        {
+            real_t sum = m_ata[j][i];
+            for (uint_t k = 0; k < j; k++)
+            {
+                sum -= l[i][k] * l[j][k];
+            }
+
+            if (i == j)
+            {
+                if (sum <= 0)
+                {
+                    return false;
+                }
+                l[i][i] = std::sqrt(sum);
+            }
+            else
+            {
+                l[i][j] = sum / l[j][j];
+            }
+        }
+    }
+
+    for (uint_t i = 0; i < 9; i++)
+    {
+        real_t sum = m_atb[i];
+        for (uint_t k = 0; k < i; k++)
+        {
+            sum -= l[i][k] * p[k];
+        }
+        p[i] = sum / l[i][i];
+    }
+
+    for (uint_t i = 9; i-- > 0;)
+    {
+        real_t sum = p[i];
+        for (uint_t k = i + 1; k < 9; k++)
+        {
+            sum -= l[k][i] * p[k];
+        }
+        p[i] = sum / l[i][i];
+    }
+
+    // Centre c = -M^-1 g where M is the quadric matrix and g the linear terms
+    const real_t m[3][3] = { { p[0], p[3], p[4] }, { p[3], p[1], p[5] }, { p[4], p[5], p[2] } };
+    const real_t det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+
+    if (std::fabs(det) < 1e-12)
+    {
+        return false;
+    }
+
+    const real_t inv[3][3] =
+    {
+        { (m[1][1] * m[2][2] - m[1][2] * m[2][1]) / det, (m[0][2] * m[2][1] - m[0][1] * m[2][2]) / det, (m[0][1] * m[1][2] - m[0][2] * m[1][1]) / det },
+        { (m[1][2] * m[2][0] - m[1][0] * m[2][2]) / det, (m[0][0] * m[2][2] - m[0][2] * m[2][0]) / det, (m[0][2] * m[1][0] - m[0][0] * m[1][2]) / det },
+        { (m[1][0] * m[2][1] - m[1][1] * m[2][0]) / det, (m[0][1] * m[2][0] - m[0][0] * m[2][1]) / det, (m[0][0] * m[1][1] - m[0][1] * m[1][0]) / det },
+    };
+
+    real_t c[3];
+    for (uint_t i = 0; i < 3; i++)
+    {
+        c[i] = -(inv[i][0] * p[6] + inv[i][1] * p[7] + inv[i][2] * p[8]);
+    }
+
+    // (x - c)' M (x - c) = 1 + c' M c
+    real_t k = 1.0;
+    for (uint_t i = 0; i < 3; i++)
+    {
+        for (uint_t j = 0; j < 3; j++)
+        {
+            k += c[i] * m[i][j] * c[j];
+        }
+    }
+
+    if (k <= 0)
+    {
+        return false;
+    }
+
+    real_t a[3][3], v[3][3], eig[3];
+    for (uint_t i = 0; i < 3; i++)
+    {
+        for (uint_t j = 0; j < 3; j++)
+        {
+            a[i][j] = m[i][j] / k;
+        }
+    }
+
+    eigenSymmetric3(a, v, eig);
+
+    if (eig[0] <= 0 || eig[1] <= 0 || eig[2] <= 0)
+    {
+        return false;                           // Not an ellipsoid yet, more coverage needed
+    }
+
+    // Semi axes are 1 / sqrt(eig), the geometric mean of them is the field strength estimate
+    const real_t radius = std::pow(eig[0] * eig[1] * eig[2], -1.0 / 6.0);
+    const real_t r = expectedRadius > 0 ? expectedRadius : radius * m_scale;
+    const real_t sq[3] = { std::sqrt(eig[0]), std::sqrt(eig[1]), std::sqrt(eig[2]) };
+
+    for (uint_t i = 0; i < 3; i++)
+    {
+        for (uint_t j = 0; j < 3; j++)
+        {
+            real_t w = 0;
+            for (uint_t e = 0; e < 3; e++)
+            {
+                w += v[i][e] * sq[e] * v[j][e];
+            }
+            m_result.transform[i][j] = w * r / m_scale;
+        }
+    }
+
+    m_result.bias = Math::Vector3(c[0] * m_scale, c[1] * m_scale, c[2] * m_scale);
+    m_result.radius = radius * m_scale;
+
+    // Residual from the accumulators, |Dp - 1|^2 = p'(D'D)p - 2p'D'1 + n
+    real_t r2 = static_cast<real_t>(m_count);
+    for (uint_t i = 0; i < 9; i++)
+    {
+        real_t row = 0;
+        for (uint_t j = 0; j < 9; j++)
+        {
+            row += (i <= j ? m_ata[i][j] : m_ata[j][i]) * p[j];
+        }
+        r2 += p[i] * row - 2.0 * p[i] * m_atb[i];
+    }
+    m_result.residual = std::sqrt(r2 > 0 ? r2 / m_count : 0);
+    m_result.valid = m_count >= minSamples && m_result.coverage >= minCoverage && m_result.residual <= maxResidual;
+
+    return m_result.valid;
+}
+//--------------------------------------------------------------------------------------------------
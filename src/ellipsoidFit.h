@@ -0,0 +1,63 @@
+#ifndef ELLIPSOIDFIT_H_
+#define ELLIPSOIDFIT_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "maths/vector.h"
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Incremental least squares fit of a general ellipsoid Ax² + By² + Cz² + 2Dxy + 2Exz + 2Fyz + 2Gx + 2Hy + 2Iz = 1
+    // to magnetometer or accelerometer samples. Only the 9x9 normal equations are kept so memory is
+    // constant. Samples are binned by direction from the fitted centre, or from initialCentre until
+    // there is a fit, and each bin accepts a limited number of samples, stopping a sensor left in one
+    // orientation from dominating the fit. A fixed centre matters before the first fit, binning about
+    // the samples' own mean would spread a stationary sensor's noise over every bin. A solved fit is
+    // only valid once it has minSamples, minCoverage of the bins and a residual within maxResidual,
+    // a fit to a few orientations solves but extrapolates the rest of the ellipsoid.
+    class EllipsoidFit
+    {
+    public:
+        struct Result
+        {
+            Math::Vector3 bias;                 // Ellipsoid centre, sensor units
+            real_t transform[3][3];             // Maps (v - bias) onto a sphere of the given radius
+            real_t radius;
+            real_t residual;                    // RMS algebraic residual of the accepted samples
+            real_t coverage;                    // Fraction of direction bins holding at least one sample
+            bool_t valid;                       // Solved and within the limits below
+        };
+
+        EllipsoidFit();
+        void reset();
+        bool_t add(const Math::Vector3& v);     // Returns true if the sample was accepted into the fit
+        bool_t solve();                         // Returns true if the result is valid
+        const Result& result() const { return m_result; }
+        uint_t accepted() const { return m_count; }
+        real_t expectedRadius;                  // If > 0 the transform scales to this radius, eg 1g for accelerometers
+        Math::Vector3 initialCentre;            // Bins directions about this until there's a fit, eg the device's stored bias
+        uint_t minSamples;                      // Accepted samples needed for a valid fit
+        real_t minCoverage;                     // Fraction of direction bins needed for a valid fit
+        real_t maxResidual;                     // Largest RMS algebraic residual of a valid fit, roughly twice the noise over the radius
+
+    private:
+        static constexpr uint_t binsPerAxis = 4;
+        static constexpr uint_t binCount = 6 * binsPerAxis * binsPerAxis;
+        static constexpr uint_t maxPerBin = 16;
+
+        real_t m_ata[9][9];
+        real_t m_atb[9];
+        real_t m_scale;
+        uint_t m_count;
+        uint_t m_binsUsed;
+        uint16_t m_bins[binCount];
+        Result m_result;
+
+        uint_t binIndex(real_t x, real_t y, real_t z) const;
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
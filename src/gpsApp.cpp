@@ -2,11 +2,13 @@
 
 #include "gpsApp.h"
 #include "platform/debug.h"
+#include "platform.h"
+#include "slotProfiler.h"
 
 using namespace IslSdk;
 
 //--------------------------------------------------------------------------------------------------
-GpsApp::GpsApp(const std::string& name) : name(name), m_device(nullptr)
+GpsApp::GpsApp(const std::string& name) : name(name), m_device(nullptr), m_export(ColumnarExport::global().stream("gps", { "latitudeDeg", "longitudeDeg" }))
 {
 }
 //--------------------------------------------------------------------------------------------------
@@ -26,6 +28,7 @@ void GpsApp::setDevice(const NmeaDevice::SharedPtr& device)
     }
 
     m_device = device;
+    m_clockSync.reset();
 
     if (m_device != nullptr)
     {
@@ -49,68 +52,99 @@ void GpsApp::callbackDeleteted(NmeaDevice& device)
 //--------------------------------------------------------------------------------------------------
 void GpsApp::callbackData(GpsDevice& device, const std::string& str)
 {
-    GpsDevice::GpsDevice::SentenceType sentenceType = GpsDevice::getSentenceType(str);
+    PROFILE_SLOT("GpsApp::callbackData");
 
-    switch (sentenceType)
+    NmeaParser::Fields fields;
+
+    if (!NmeaParser::tokenize(str, fields))
+    {
+        Debug::log(Debug::Severity::Warning, name.c_str(), "Bad NMEA sentence or checksum");
+        return;
+    }
+
+    const int talkerLen = static_cast<int>(fields.talker.size());
+    const char* talker = fields.talker.data();
+
+    switch (fields.type)
     {
-    case GpsDevice::SentenceType::Gll:
+    case NmeaParser::Sentence::Gll:
     {
-        GpsDevice::Gpgll gpgll;
-        if (device.parseStringGPGLL(str, gpgll))
+        NmeaParser::Gll gll;
+        if (NmeaParser::parse(fields, gll))
         {
-            Debug::log(Debug::Severity::Info, name.c_str(), "GPGLL: latitude:%f, longitude:%f", gpgll.latitudeDeg, gpgll.longitudeDeg);
+            Debug::log(Debug::Severity::Info, name.c_str(), "%.*sGLL: latitude:%f, longitude:%f", talkerLen, talker, gll.latitudeDeg, gll.longitudeDeg);
         }
         break;
     }
-    case GpsDevice::SentenceType::Gga:
+    case NmeaParser::Sentence::Gga:
     {
-        GpsDevice::Gpgga gpgga;
-        if (device.parseStringGPGGA(str, gpgga))
+        NmeaParser::Gga gga;
+        if (NmeaParser::parse(fields, gga))
         {
-            Debug::log(Debug::Severity::Info, name.c_str(), "GPGGA: latitude:%f, longitude:%f", gpgga.latitudeDeg, gpgga.longitudeDeg);
+            const uint64_t hostUs = fixHostUs(gga.utcTime);
+            Debug::log(Debug::Severity::Info, name.c_str(), "T:%.3f %.*sGGA: latitude:%f, longitude:%f", hostUs * 0.000001, talkerLen, talker, gga.latitudeDeg, gga.longitudeDeg);
+
+            if (gga.quality != 0)
+            {
+                onPosition(hostUs, gga.latitudeDeg, gga.longitudeDeg);
+                m_export.append(hostUs, name, { gga.latitudeDeg, gga.longitudeDeg });
+            }
         }
         break;
     }
-    case GpsDevice::SentenceType::Gsv:
+    case NmeaParser::Sentence::Gsv:
     {
-        GpsDevice::Gpgsv gpgsv;
-        if (device.parseStringGPGSV(str, gpgsv))
+        NmeaParser::Gsv gsv;
+        if (NmeaParser::parse(fields, gsv))
         {
-            Debug::log(Debug::Severity::Info, name.c_str(), "GPGSV: satellites in view:%u", gpgsv.satellitesInView);
+            Debug::log(Debug::Severity::Info, name.c_str(), "%.*sGSV: satellites in view:%u", talkerLen, talker, FMT_U(gsv.satellitesInView));
         }
         break;
     }
-    case GpsDevice::SentenceType::Gsa:
+    case NmeaParser::Sentence::Gsa:
     {
-        GpsDevice::Gpgsa gpgsa;
-        if (device.parseStringGPGSA(str, gpgsa))
+        NmeaParser::Gsa gsa;
+        if (NmeaParser::parse(fields, gsa))
         {
-            Debug::log(Debug::Severity::Info, name.c_str(), "GPGSA: fix type %s", gpgsa.fixType == 1 ? "NONE" : gpgsa.fixType == 2 ? "2D" : "3D");
+            Debug::log(Debug::Severity::Info, name.c_str(), "%.*sGSA: fix type %s", talkerLen, talker, gsa.fixType == 1 ? "NONE" : gsa.fixType == 2 ? "2D" : "3D");
         }
         break;
     }
-    case GpsDevice::SentenceType::Vtg:
+    case NmeaParser::Sentence::Vtg:
     {
-        GpsDevice::Gpvtg gpvtg;
-        if (device.parseStringGPVTG(str, gpvtg))
+        NmeaParser::Vtg vtg;
+        if (NmeaParser::parse(fields, vtg))
         {
-            Debug::log(Debug::Severity::Info, name.c_str(), "GPVTG: speed:%.3f Km/h", gpvtg.speedKm);
+            Debug::log(Debug::Severity::Info, name.c_str(), "%.*sVTG: speed:%.3f Km/h", talkerLen, talker, vtg.speedKm);
         }
         break;
     }
-    case GpsDevice::SentenceType::Rmc:
+    case NmeaParser::Sentence::Rmc:
     {
-        GpsDevice::Gprmc gprmc;
-        if (device.parseStringGPRMC(str, gprmc))
+        NmeaParser::Rmc rmc;
+        if (NmeaParser::parse(fields, rmc))
         {
-            Debug::log(Debug::Severity::Info, name.c_str(), "GPRMC: latitude:%f, longitude:%f", gprmc.latitudeDeg, gprmc.longitudeDeg);
+            const uint64_t hostUs = fixHostUs(rmc.utcTime);
+            Debug::log(Debug::Severity::Info, name.c_str(), "T:%.3f %.*sRMC: latitude:%f, longitude:%f", hostUs * 0.000001, talkerLen, talker, rmc.latitudeDeg, rmc.longitudeDeg);
+
+            if (rmc.valid)
+            {
+                onPosition(hostUs, rmc.latitudeDeg, rmc.longitudeDeg);
+                m_export.append(hostUs, name, { rmc.latitudeDeg, rmc.longitudeDeg });
+            }
         }
         break;
     }
     default:
         break;
     }
-
-    Debug::log(Debug::Severity::Info, name.c_str(), "data: %s", str.c_str());
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t GpsApp::fixHostUs(real_t utcTime)
+{
+    // hhmmss.ss to microseconds of the UTC day, the clock sync resets itself at midnight when this wraps
+    const uint_t hhmmss = static_cast<uint_t>(utcTime);
+    const real_t seconds = (hhmmss / 10000) * 3600.0 + ((hhmmss / 100) % 100) * 60.0 + (utcTime - (hhmmss - hhmmss % 100));
+    return m_clockSync.toHost(static_cast<uint64_t>(seconds * 1000000.0 + 0.5), Platform::getTimeUs());
 }
 //--------------------------------------------------------------------------------------------------
@@ -4,6 +4,9 @@
 //------------------------------------------ Includes ----------------------------------------------
 
 #include "nmeaDevices/gpsDevice.h"
+#include "nmeaParser.h"
+#include "clockSync.h"
+#include "columnarExport.h"
 
 //--------------------------------------- Class Definition -----------------------------------------
 
@@ -16,6 +19,7 @@ namespace IslSdk
         ~GpsApp();
         void setDevice(const NmeaDevice::SharedPtr& device);
         const std::string name;
+        Signal<uint64_t, real_t, real_t> onPosition;                // Host time of the fix, latitude and longitude in degrees
 
         Slot<NmeaDevice&, const std::string&> slotError{ this, & GpsApp::callbackError };
         Slot<NmeaDevice&> slotDelete{ this, & GpsApp::callbackDeleteted };
@@ -23,6 +27,9 @@ namespace IslSdk
 
     private:
         NmeaDevice::SharedPtr m_device;
+        ClockSync m_clockSync;                                  // Maps NMEA UTC time of day onto Platform::getTimeUs()
+        ColumnarExport::Stream& m_export;
+        uint64_t fixHostUs(real_t utcTime);
         void callbackError(NmeaDevice& device, const std::string& msg);
         void callbackDeleteted(NmeaDevice& device);
         void callbackData(GpsDevice& device, const std::string& data);
@@ -0,0 +1,316 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "heapMonitor.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(OS_WINDOWS)
+    #include <malloc.h>
+#elif defined(__APPLE__)
+    #include <malloc/malloc.h>
+#else
+    #include <malloc.h>
+#endif
+
+using namespace IslSdk;
+
+// Updated from operator new before main() runs so these are constant initialised, not members
+static std::atomic<uint64_t> allocs(0);
+static std::atomic<uint64_t> steadyAllocs(0);                                   // Since the seal
+static std::atomic<uint64_t> callbackAllocs(0);
+static std::atomic<uint64_t> liveBytes(0);
+static std::atomic<uint64_t> peakBytes(0);
+static std::atomic<bool_t> isSealed(false);
+static std::atomic<bool_t> isStrict(false);
+static std::atomic<const char*> lastCallback(nullptr);
+static std::atomic<uint64_t> lastCallbackSize(0);
+
+#ifdef APP_STATIC_MEMORY
+thread_local const char* HeapMonitor::t_callback = nullptr;
+
+//--------------------------------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+    void* ptr = std::malloc(size ? size : 1);
+
+    if (ptr == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    HeapMonitor::allocated(ptr, size);
+    return ptr;
+}
+//--------------------------------------------------------------------------------------------------
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete(void* ptr) noexcept
+{
+    HeapMonitor::freed(ptr);
+    std::free(ptr);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void* ptr) noexcept
+{
+    operator delete(ptr);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete(void* ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void* ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+//--------------------------------------------------------------------------------------------------
+// Over aligned types. Taken from the plain operator new with room to align, and the start of the block
+// kept just before the aligned address, so they're counted the same way and freed with std::free
+void* operator new(size_t size, std::align_val_t align)
+{
+    const size_t alignment = static_cast<size_t>(align) < sizeof(void*) ? sizeof(void*) : static_cast<size_t>(align);
+    char* block = static_cast<char*>(operator new(size + alignment + sizeof(void*)));
+    char* ptr = block + sizeof(void*);
+
+    ptr += (alignment - reinterpret_cast<uintptr_t>(ptr) % alignment) % alignment;
+    reinterpret_cast<void**>(ptr)[-1] = block;
+    return ptr;
+}
+//--------------------------------------------------------------------------------------------------
+void* operator new[](size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    if (ptr)
+    {
+        operator delete(reinterpret_cast<void**>(ptr)[-1]);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void* ptr, std::align_val_t align) noexcept
+{
+    operator delete(ptr, align);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete(void* ptr, size_t, std::align_val_t align) noexcept
+{
+    operator delete(ptr, align);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void* ptr, size_t, std::align_val_t align) noexcept
+{
+    operator delete(ptr, align);
+}
+//--------------------------------------------------------------------------------------------------
+// The nothrow forms, replaced as well so none of them can reach an allocator that isn't counted
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+//--------------------------------------------------------------------------------------------------
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size, align);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    return operator new(size, align, std::nothrow);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete(void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr, align);
+}
+//--------------------------------------------------------------------------------------------------
+void operator delete[](void* ptr, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+    operator delete(ptr, align);
+}
+#endif
+
+//--------------------------------------------------------------------------------------------------
+static uint64_t usableSize(void* ptr)
+{
+#if defined(OS_WINDOWS)
+    return _msize(ptr);
+#elif defined(__APPLE__)
+    return malloc_size(ptr);
+#else
+    return malloc_usable_size(ptr);
+#endif
+}
+//--------------------------------------------------------------------------------------------------
+HeapMonitor::HeapMonitor() : m_sealUs(0), m_lastReportUs(0), m_reportedCallbackAllocs(0), m_reportedAllocs(0),
+                             m_callbackAllocs(Metrics::global().counter("isl_heap_callback_allocations_total", "", "Heap allocations in slot callbacks after startup")),
+                             m_steadyAllocs(Metrics::global().counter("isl_heap_steady_allocations_total", "", "Heap allocations by anything after startup")),
+                             m_liveBytes(Metrics::global().gauge("isl_heap_live_bytes", "", "Bytes allocated with new and not yet deleted")),
+                             m_peakBytes(Metrics::global().gauge("isl_heap_peak_bytes", "", "Most bytes allocated with new at once"))
+{
+}
+//--------------------------------------------------------------------------------------------------
+HeapMonitor& HeapMonitor::global()
+{
+    static HeapMonitor monitor;
+    return monitor;
+}
+//--------------------------------------------------------------------------------------------------
+void HeapMonitor::allocated(void* ptr, size_t size)
+{
+    // Runs inside operator new so it must not allocate, or log until the allocation is known to be bad
+    const uint64_t bytes = usableSize(ptr);
+    const uint64_t live = liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    uint64_t peak = peakBytes.load(std::memory_order_relaxed);
+
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+    allocs.fetch_add(1, std::memory_order_relaxed);
+
+    if (isSealed.load(std::memory_order_relaxed))
+    {
+        steadyAllocs.fetch_add(1, std::memory_order_relaxed);
+
+#ifdef APP_STATIC_MEMORY
+        if (t_callback)
+        {
+            callbackAllocs.fetch_add(1, std::memory_order_relaxed);
+            lastCallback.store(t_callback, std::memory_order_relaxed);
+            lastCallbackSize.store(size, std::memory_order_relaxed);
+
+            if (isStrict.load(std::memory_order_relaxed))
+            {
+                std::fprintf(stderr, "Heap allocation of %zu bytes in %s after startup\n", size, t_callback);
+                std::abort();
+            }
+        }
+#endif
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void HeapMonitor::freed(void* ptr)
+{
+    if (ptr)
+    {
+        liveBytes.fetch_sub(usableSize(ptr), std::memory_order_relaxed);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void HeapMonitor::start(uint_t sealDelayMs, bool_t strict)
+{
+    m_sealUs = Platform::getTimeUs() + static_cast<uint64_t>(sealDelayMs) * 1000;
+    isStrict = strict;
+
+    if (enabled)
+    {
+        Debug::log(Debug::Severity::Notice, "Heap", "Steady state in %.1f s%s, %llu allocations and %.1f MB live so far", sealDelayMs * 0.001, strict ? ", callback allocations then abort" : "",
+                   static_cast<unsigned long long>(allocs.load()), liveBytes.load() / 1048576.0);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void HeapMonitor::seal()
+{
+    if (enabled && !isSealed)
+    {
+        m_liveBytes.set(static_cast<real_t>(liveBytes.load()));
+        m_peakBytes.set(static_cast<real_t>(peakBytes.load()));
+        m_reportedAllocs = steadyAllocs.load();
+        m_reportedCallbackAllocs = callbackAllocs.load();
+        m_lastReportUs = Platform::getTimeUs();
+        Debug::log(Debug::Severity::Notice, "Heap", "Sealed after %llu allocations, %.1f MB live and %.1f MB at peak", static_cast<unsigned long long>(allocs.load()), liveBytes.load() / 1048576.0, peakBytes.load() / 1048576.0);
+        isSealed = true;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+bool_t HeapMonitor::sealed() const
+{
+    return isSealed;
+}
+//--------------------------------------------------------------------------------------------------
+void HeapMonitor::run()
+{
+    if (!enabled || m_sealUs == 0)
+    {
+        return;
+    }
+
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    if (!isSealed)
+    {
+        if (nowUs >= m_sealUs)
+        {
+            seal();
+        }
+        return;
+    }
+
+    if (nowUs - m_lastReportUs < reportPeriodMs * 1000)
+    {
+        return;
+    }
+    m_lastReportUs = nowUs;
+
+    const uint64_t steady = steadyAllocs.load(std::memory_order_relaxed);
+    const uint64_t callback = callbackAllocs.load(std::memory_order_relaxed);
+
+    m_steadyAllocs.add(steady - m_reportedAllocs);
+    m_callbackAllocs.add(callback - m_reportedCallbackAllocs);
+    m_liveBytes.set(static_cast<real_t>(liveBytes.load(std::memory_order_relaxed)));
+    m_peakBytes.set(static_cast<real_t>(peakBytes.load(std::memory_order_relaxed)));
+
+    if (callback != m_reportedCallbackAllocs)
+    {
+        Debug::log(Debug::Severity::Warning, "Heap", "%llu allocations in callbacks in the last %.0f s, the last %llu bytes in %s", static_cast<unsigned long long>(callback - m_reportedCallbackAllocs), reportPeriodMs * 0.001,
+                   static_cast<unsigned long long>(lastCallbackSize.load()), lastCallback.load());
+    }
+
+    if (steady - callback != m_reportedAllocs - m_reportedCallbackAllocs)
+    {
+        Debug::log(Debug::Severity::Info, "Heap", "%llu allocations outside callbacks in the last %.0f s, %.1f MB live", static_cast<unsigned long long>((steady - callback) - (m_reportedAllocs - m_reportedCallbackAllocs)), reportPeriodMs * 0.001,
+                   liveBytes.load() / 1048576.0);
+    }
+
+    m_reportedAllocs = steady;
+    m_reportedCallbackAllocs = callback;
+}
+//--------------------------------------------------------------------------------------------------
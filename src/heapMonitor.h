@@ -0,0 +1,73 @@
+#ifndef HEAPMONITOR_H_
+#define HEAPMONITOR_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include "metrics.h"
+#include <cstddef>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Catches heap allocations once the app is running, for the static memory build of small 32 bit
+    // hosts. With STATIC_MEMORY set in CMake every form of the global operator new and delete, aligned
+    // and nothrow included, is replaced to count each allocation and the bytes live on the heap. malloc
+    // called directly isn't seen. Startup allocates freely, the Apps size their
+    // buffers then, and when the seal delay has passed everything after is steady state: an allocation
+    // made inside a slot callback (PROFILE_SLOT) is an App-side allocation and is logged with the name of
+    // the callback, or aborts if strict so it's found in testing. Others, by the SDK or logging or other
+    // threads, are only counted. Without STATIC_MEMORY the operators aren't replaced and nothing is seen.
+    class HeapMonitor
+    {
+    public:
+#ifdef APP_STATIC_MEMORY
+        static constexpr bool_t enabled = true;
+#else
+        static constexpr bool_t enabled = false;
+#endif
+        static constexpr uint_t reportPeriodMs = 10000;
+
+        // Marks the current thread as running the named callback, PROFILE_SLOT opens one
+        class Scope
+        {
+        public:
+#ifdef APP_STATIC_MEMORY
+            Scope(const char* name) : m_outer(t_callback) { t_callback = name; }
+            ~Scope() { t_callback = m_outer; }
+
+        private:
+            const char* const m_outer;
+#else
+            Scope(const char* name) {}
+#endif
+        };
+
+        static HeapMonitor& global();
+        static void allocated(void* ptr, size_t size);                      // Called by the replaced operators
+        static void freed(void* ptr);
+        void start(uint_t sealDelayMs, bool_t strict);                      // Steady state begins sealDelayMs from now
+        void seal();
+        bool_t sealed() const;
+        void run();                                                         // Call regularly to seal when due and report
+
+    private:
+#ifdef APP_STATIC_MEMORY
+        static thread_local const char* t_callback;
+#endif
+        uint64_t m_sealUs;
+        uint64_t m_lastReportUs;
+        uint64_t m_reportedCallbackAllocs;
+        uint64_t m_reportedAllocs;
+        Metrics::Counter& m_callbackAllocs;
+        Metrics::Counter& m_steadyAllocs;
+        Metrics::Gauge& m_liveBytes;
+        Metrics::Gauge& m_peakBytes;
+
+        HeapMonitor();
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -2,15 +2,138 @@
 
 #include "imuManager.h"
 #include "platform/debug.h"
+#include "platform.h"
+#include "slotProfiler.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define IMU_USE_SSE2
+    #include <emmintrin.h>
+#endif
 
 using namespace IslSdk;
 
 //--------------------------------------------------------------------------------------------------
-void AhrsManager::connectSignals(Ahrs& sensor, const std::string& deviceName)
+// Sums, sums of squares, min and max of count samples, a multiple of 4, in four independent lanes.
+// Nothing is carried from one sample to the next within a lane so the compiler can keep the lanes
+// in vector registers. The min and max keep the lane's value if the sample is a NaN.
+template<typename T>
+static void axisLanes(const T* data, uint_t count, T* sum, T* sumSq, T* lo, T* hi)
+{
+    for (uint_t i = 0; i < count; i += 4)
+    {
+        for (uint_t j = 0; j < 4; j++)
+        {
+            const T v = data[i + j];
+            sum[j] += v;
+            sumSq[j] += v * v;
+            lo[j] = v < lo[j] ? v : lo[j];
+            hi[j] = v > hi[j] ? v : hi[j];
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+#ifdef IMU_USE_SSE2
+// The same four lanes as two pairs of doubles, minpd and maxpd return the second operand for a NaN
+static void axisLanes(const double* data, uint_t count, double* sum, double* sumSq, double* lo, double* hi)
+{
+    __m128d sum0 = _mm_loadu_pd(&sum[0]), sum1 = _mm_loadu_pd(&sum[2]);
+    __m128d sq0 = _mm_loadu_pd(&sumSq[0]), sq1 = _mm_loadu_pd(&sumSq[2]);
+    __m128d lo0 = _mm_loadu_pd(&lo[0]), lo1 = _mm_loadu_pd(&lo[2]);
+    __m128d hi0 = _mm_loadu_pd(&hi[0]), hi1 = _mm_loadu_pd(&hi[2]);
+
+    for (uint_t i = 0; i < count; i += 4)
+    {
+        const __m128d a = _mm_loadu_pd(&data[i]);
+        const __m128d b = _mm_loadu_pd(&data[i + 2]);
+
+        sum0 = _mm_add_pd(sum0, a);
+        sum1 = _mm_add_pd(sum1, b);
+        sq0 = _mm_add_pd(sq0, _mm_mul_pd(a, a));
+        sq1 = _mm_add_pd(sq1, _mm_mul_pd(b, b));
+        lo0 = _mm_min_pd(a, lo0);
+        lo1 = _mm_min_pd(b, lo1);
+        hi0 = _mm_max_pd(a, hi0);
+        hi1 = _mm_max_pd(b, hi1);
+    }
+
+    _mm_storeu_pd(&sum[0], sum0);
+    _mm_storeu_pd(&sum[2], sum1);
+    _mm_storeu_pd(&sumSq[0], sq0);
+    _mm_storeu_pd(&sumSq[2], sq1);
+    _mm_storeu_pd(&lo[0], lo0);
+    _mm_storeu_pd(&lo[2], lo1);
+    _mm_storeu_pd(&hi[0], hi0);
+    _mm_storeu_pd(&hi[2], hi1);
+}
+#endif
+//--------------------------------------------------------------------------------------------------
+// Mean, RMS, min and max of one axis of a block
+static void axisStats(const real_t* data, uint_t count, real_t& mean, real_t& rms, real_t& min, real_t& max)
+{
+    real_t sum[4] = { 0, 0, 0, 0 };
+    real_t sumSq[4] = { 0, 0, 0, 0 };
+    real_t lo[4] = { data[0], data[0], data[0], data[0] };
+    real_t hi[4] = { data[0], data[0], data[0], data[0] };
+    const uint_t lanes = count & ~static_cast<uint_t>(3);
+
+    axisLanes(data, lanes, sum, sumSq, lo, hi);
+
+    for (uint_t i = lanes; i < count; i++)
+    {
+        sum[0] += data[i];
+        sumSq[0] += data[i] * data[i];
+        lo[0] = data[i] < lo[0] ? data[i] : lo[0];
+        hi[0] = data[i] > hi[0] ? data[i] : hi[0];
+    }
+
+    mean = ((sum[0] + sum[1]) + (sum[2] + sum[3])) / count;
+    rms = std::sqrt(((sumSq[0] + sumSq[1]) + (sumSq[2] + sumSq[3])) / count);
+    min = std::min(std::min(lo[0], lo[1]), std::min(lo[2], lo[3]));
+    max = std::max(std::max(hi[0], hi[1]), std::max(hi[2], hi[3]));
+}
+//--------------------------------------------------------------------------------------------------
+bool_t ImuBlock::add(uint64_t time, const Math::Vector3& v)
+{
+    if (count >= size)
+    {
+        count = 0;
+    }
+
+    timeUs[count] = time;
+    x[count] = v.x;
+    y[count] = v.y;
+    z[count] = v.z;
+    count++;
+
+    return count >= size;
+}
+//--------------------------------------------------------------------------------------------------
+ImuBlock::Stats ImuBlock::stats() const
+{
+    Stats s;
+
+    if (count)
+    {
+        axisStats(&x[0], count, s.mean.x, s.rms.x, s.min.x, s.max.x);
+        axisStats(&y[0], count, s.mean.y, s.rms.y, s.min.y, s.max.y);
+        axisStats(&z[0], count, s.mean.z, s.rms.z, s.min.z, s.max.z);
+    }
+    return s;
+}
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+void AhrsManager::connectSignals(Ahrs& sensor, const std::string& deviceName, ClockSync* clockSync, const Device::Info* info)
 {
 	disconnectSignals();
 	ahrs = &sensor;
+	clock = clockSync;
+	sourceId = info ? TelemetryServer::sourceId(*info) : 0;
+	device = info ? info->pnSnAsStr() : deviceName;
 	name = deviceName;
+	headingSeries = &TimeSeriesStore::global().series("heading", device);
 	ahrs->onData.connect(slotAhrsData);
 }
 //--------------------------------------------------------------------------------------------------
@@ -22,12 +145,54 @@ void AhrsManager::disconnectSignals()
 	}
 }
 //--------------------------------------------------------------------------------------------------
+void AhrsManager::setHeadingTarget(Slot<uint64_t, real_t>* slot)
+{
+    if (headingTarget)
+    {
+        onHeading.disconnect(*headingTarget);
+    }
+
+    headingTarget = slot;
+
+    if (headingTarget)
+    {
+        onHeading.connect(*headingTarget);
+    }
+}
+//--------------------------------------------------------------------------------------------------
 void AhrsManager::callbackAhrs(Ahrs& ahrs, uint64_t timeUs, const Math::Quaternion& q, real_t magHeadingRad, real_t turnsCount)
 {
+    PROFILE_SLOT("AhrsManager::callbackAhrs");
+
+    lastHostUs = clock ? clock->toHost(timeUs, Platform::getTimeUs()) : Platform::getTimeUs();
+
     Math::EulerAngles euler = q.toEulerAngles(0);
+    onHeading(lastHostUs, euler.heading);
+
+    const TelemetryServer::Ahrs msg = { static_cast<float>(q.w), static_cast<float>(q.x), static_cast<float>(q.y), static_cast<float>(q.z),
+                                        static_cast<float>(euler.heading), static_cast<float>(magHeadingRad), static_cast<float>(turnsCount), 0 };
+    TelemetryServer::global().publish(TelemetryServer::Topic::Ahrs, sourceId, lastHostUs, &msg, sizeof(msg));
     euler.radToDeg();
+    exportStream.append(lastHostUs, device, { euler.heading, euler.pitch, euler.roll });
+    pipelineSource.push(lastHostUs, sourceId, { euler.heading, euler.pitch, euler.roll });
 
-    Debug::log(Debug::Severity::Info, name.c_str(), "H:%.1f    P:%.2f    R%.2f", euler.heading, euler.pitch, euler.roll);
+    // Stored unwrapped so a bucket spanning north has a true min, max and mean, plots take it modulo 360
+    if (headingStarted)
+    {
+        if (euler.heading - lastHeadingDeg > 180)
+        {
+            headingTurns--;
+        }
+        else if (lastHeadingDeg - euler.heading > 180)
+        {
+            headingTurns++;
+        }
+    }
+    lastHeadingDeg = euler.heading;
+    headingStarted = true;
+    headingSeries->add(lastHostUs, euler.heading + 360.0 * headingTurns);
+
+    Debug::log(Debug::Severity::Info, name.c_str(), "T:%.3f    H:%.1f    P:%.2f    R%.2f", lastHostUs * 0.000001, euler.heading, euler.pitch, euler.roll);
 }
 //--------------------------------------------------------------------------------------------------
 
@@ -37,10 +202,17 @@ void GyroManager::connectSignals(GyroSensor& sensor, const std::string& deviceNa
 	disconnectSignals();
 	gyro = &sensor;
 	name = deviceName;
+	block.count = 0;
 	gyro->onData.connect(slotData);
 	gyro->onCalChange.connect(slotCalChange);
 }
 //--------------------------------------------------------------------------------------------------
+void GyroManager::setBlockSize(uint_t size)
+{
+	block.size = size > ImuBlock::capacity ? ImuBlock::capacity : (size ? size : 1);
+	block.count = 0;
+}
+//--------------------------------------------------------------------------------------------------
 void GyroManager::disconnectSignals()
 {
 	if (gyro)
@@ -52,7 +224,17 @@ void GyroManager::disconnectSignals()
 //--------------------------------------------------------------------------------------------------
 void GyroManager::callbackData(GyroSensor& gyro, const Math::Vector3& v)
 {
-	Debug::log(Debug::Severity::Info, name.c_str(), "Gyro(%u) x:%.2f, y:%.2f, z:%.2f", gyro.sensorNumber, v.x, v.y, v.z);
+	PROFILE_SLOT("GyroManager::callbackData");
+
+	block.sensorNumber = gyro.sensorNumber;
+
+	if (block.add(Platform::getTimeUs(), v))
+	{
+		onBlock(block);
+
+		ImuBlock::Stats st = block.stats();
+		Debug::log(Debug::Severity::Info, name.c_str(), "Gyro(%u) block of %u, mean x:%.2f, y:%.2f, z:%.2f, rms x:%.2f, y:%.2f, z:%.2f", FMT_U(gyro.sensorNumber), FMT_U(block.count), st.mean.x, st.mean.y, st.mean.z, st.rms.x, st.rms.y, st.rms.z);
+	}
 }
 //--------------------------------------------------------------------------------------------------
 void GyroManager::callbackCalChange(GyroSensor& gyro, const Math::Vector3& v)
@@ -67,11 +249,18 @@ void AccelManager::connectSignals(AccelSensor& sensor, const std::string& device
 	disconnectSignals();
 	accel = &sensor;
 	name = deviceName;
+	block.count = 0;
 	accel->onData.connect(slotData);
 	accel->onCalChange.connect(slotCalChange);
 	accel->onCalProgress.connect(slotCal);
 }
 //--------------------------------------------------------------------------------------------------
+void AccelManager::setBlockSize(uint_t size)
+{
+	block.size = size > ImuBlock::capacity ? ImuBlock::capacity : (size ? size : 1);
+	block.count = 0;
+}
+//--------------------------------------------------------------------------------------------------
 void AccelManager::disconnectSignals()
 {
 	if (accel)
@@ -84,12 +273,40 @@ void AccelManager::disconnectSignals()
 //--------------------------------------------------------------------------------------------------
 void AccelManager::callbackData(AccelSensor& accel, const Math::Vector3& v)
 {
-	Debug::log(Debug::Severity::Info, name.c_str(), "Accel(%u) x:%.2f, y:%.2f, z:%.2f", accel.sensorNumber, v.x, v.y, v.z);
+	PROFILE_SLOT("AccelManager::callbackData");
+
+	block.sensorNumber = accel.sensorNumber;
+
+	if (hostCal.add(v))
+	{
+		hostCal.solve();
+	}
+
+	if (block.add(Platform::getTimeUs(), v))
+	{
+		onBlock(block);
+
+		ImuBlock::Stats st = block.stats();
+		Debug::log(Debug::Severity::Info, name.c_str(), "Accel(%u) block of %u, mean x:%.2f, y:%.2f, z:%.2f, rms x:%.2f, y:%.2f, z:%.2f", FMT_U(accel.sensorNumber), FMT_U(block.count), st.mean.x, st.mean.y, st.mean.z, st.rms.x, st.rms.y, st.rms.z);
+
+		const EllipsoidFit::Result& cal = hostCal.result();
+		if (cal.valid)
+		{
+			Debug::log(Debug::Severity::Info, name.c_str(), "Accel(%u) host cal bias: %.3f, %.3f, %.3f, radius %.3f, residual %.4f, coverage %.0f%%", FMT_U(accel.sensorNumber), cal.bias.x, cal.bias.y, cal.bias.z, cal.radius, cal.residual, cal.coverage * 100.0);
+		}
+	}
 }
 //--------------------------------------------------------------------------------------------------
 void AccelManager::callbackCalChange(AccelSensor& accel, const Math::Vector3& v, const Math::Matrix3x3& transform)
 {
 	Debug::log(Debug::Severity::Info, name.c_str(), "Accel(%u) cal change bias: %.2f, %.2f, %.2f", accel.sensorNumber, v.x, v.y, v.z);
+	hostCal.initialCentre = v;                                  // Until the host has its own fit
+
+	const EllipsoidFit::Result& cal = hostCal.result();
+	if (cal.valid)
+	{
+		Debug::log(Debug::Severity::Info, name.c_str(), "Accel(%u) host cal bias: %.2f, %.2f, %.2f, difference %.2f, %.2f, %.2f", FMT_U(accel.sensorNumber), cal.bias.x, cal.bias.y, cal.bias.z, cal.bias.x - v.x, cal.bias.y - v.y, cal.bias.z - v.z);
+	}
 }
 //--------------------------------------------------------------------------------------------------
 void AccelManager::callbackCal(AccelSensor& accel, const Math::Vector3& v, uint_t count)
@@ -104,11 +321,18 @@ void MagManager::connectSignals(MagSensor& sensor, const std::string& deviceName
 	disconnectSignals();
 	mag = &sensor;
 	name = deviceName;
+	block.count = 0;
 	mag->onData.connect(slotData);
 	mag->onCalChange.connect(slotCalChange);
 	mag->onCalProgress.connect(slotCal);
 }
 //--------------------------------------------------------------------------------------------------
+void MagManager::setBlockSize(uint_t size)
+{
+	block.size = size > ImuBlock::capacity ? ImuBlock::capacity : (size ? size : 1);
+	block.count = 0;
+}
+//--------------------------------------------------------------------------------------------------
 void MagManager::disconnectSignals()
 {
 	if (mag)
@@ -121,12 +345,40 @@ void MagManager::disconnectSignals()
 //--------------------------------------------------------------------------------------------------
 void MagManager::callbackData(MagSensor& mag, const Math::Vector3& v)
 {
-	Debug::log(Debug::Severity::Info, name.c_str(), "Mag(%u) x:%.2f, y:%.2f, z:%.2f", mag.sensorNumber, v.x, v.y, v.z);
+	PROFILE_SLOT("MagManager::callbackData");
+
+	block.sensorNumber = mag.sensorNumber;
+
+	if (hostCal.add(v))
+	{
+		hostCal.solve();
+	}
+
+	if (block.add(Platform::getTimeUs(), v))
+	{
+		onBlock(block);
+
+		ImuBlock::Stats st = block.stats();
+		Debug::log(Debug::Severity::Info, name.c_str(), "Mag(%u) block of %u, mean x:%.2f, y:%.2f, z:%.2f, rms x:%.2f, y:%.2f, z:%.2f", FMT_U(mag.sensorNumber), FMT_U(block.count), st.mean.x, st.mean.y, st.mean.z, st.rms.x, st.rms.y, st.rms.z);
+
+		const EllipsoidFit::Result& cal = hostCal.result();
+		if (cal.valid)
+		{
+			Debug::log(Debug::Severity::Info, name.c_str(), "Mag(%u) host cal bias: %.3f, %.3f, %.3f, radius %.3f, residual %.4f, coverage %.0f%%", FMT_U(mag.sensorNumber), cal.bias.x, cal.bias.y, cal.bias.z, cal.radius, cal.residual, cal.coverage * 100.0);
+		}
+	}
 }
 //--------------------------------------------------------------------------------------------------
 void MagManager::callbackCalChange(MagSensor& mag, const Math::Vector3& v, const Math::Matrix3x3& transform)
 {
 	Debug::log(Debug::Severity::Info, name.c_str(), "Mag(%u) cal change bias: %.2f, %.2f, %.2f", mag.sensorNumber, v.x, v.y, v.z);
+	hostCal.initialCentre = v;                                  // Until the host has its own fit
+
+	const EllipsoidFit::Result& cal = hostCal.result();
+	if (cal.valid)
+	{
+		Debug::log(Debug::Severity::Info, name.c_str(), "Mag(%u) host cal bias: %.2f, %.2f, %.2f, difference %.2f, %.2f, %.2f", FMT_U(mag.sensorNumber), cal.bias.x, cal.bias.y, cal.bias.z, cal.bias.x - v.x, cal.bias.y - v.y, cal.bias.z - v.z);
+	}
 }
 //--------------------------------------------------------------------------------------------------
 void MagManager::callbackCal(MagSensor& mag, const Math::Vector3& v, uint_t count)
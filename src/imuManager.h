@@ -4,21 +4,69 @@
 //------------------------------------------ Includes ----------------------------------------------
 
 #include "devices/ahrs.h"
+#include "ellipsoidFit.h"
+#include "clockSync.h"
+#include "telemetryServer.h"
+#include "columnarExport.h"
+#include "pipeline.h"
+#include "timeSeriesStore.h"
 
 //--------------------------------------- Class Definition -----------------------------------------
 
 namespace IslSdk
 {
+    // Structure of arrays buffer of raw IMU samples. Samples are added one at a time by the managers
+    // below and the full block is handed to consumers through the manager's onBlock signal.
+    class ImuBlock
+    {
+    public:
+        static constexpr uint_t capacity = 256;
+
+        struct Stats
+        {
+            Math::Vector3 mean;
+            Math::Vector3 rms;
+            Math::Vector3 min;
+            Math::Vector3 max;
+        };
+
+        ImuBlock() : count(0), size(capacity), sensorNumber(0) {}
+        bool_t add(uint64_t timeUs, const Math::Vector3& v);        // Returns true when the block is full
+        Stats stats() const;
+
+        uint_t count;
+        uint_t size;                                                // Number of samples that make a full block, <= capacity
+        uint_t sensorNumber;
+        uint64_t timeUs[capacity];
+        real_t x[capacity];
+        real_t y[capacity];
+        real_t z[capacity];
+    };
+
     class AhrsManager
     {
     public:
-        AhrsManager() : ahrs(nullptr) {};
-        void connectSignals(Ahrs& sensor, const std::string& name);
+        AhrsManager() : ahrs(nullptr), clock(nullptr), lastHostUs(0), sourceId(0), exportStream(ColumnarExport::global().stream("ahrs", { "headingDeg", "pitchDeg", "rollDeg" })), pipelineSource(Pipeline::global().source("ahrs")), headingSeries(nullptr), headingTurns(0), lastHeadingDeg(0), headingStarted(false), headingTarget(nullptr) {};
+        ~AhrsManager() { setHeadingTarget(nullptr); };
+        void connectSignals(Ahrs& sensor, const std::string& name, ClockSync* clockSync = nullptr, const Device::Info* info = nullptr);
         void disconnectSignals();
+        void setHeadingTarget(Slot<uint64_t, real_t>* slot);        // Connects onHeading to slot until replaced, nullptr to stop
+        Signal<uint64_t, real_t> onHeading;                         // Host time and heading in radians
         
     private:
         std::string name;
         Ahrs* ahrs;
+        ClockSync* clock;
+        uint64_t lastHostUs;
+        uint32_t sourceId;
+        std::string device;                                         // Part and serial number for the export
+        ColumnarExport::Stream& exportStream;
+        Pipeline::Source& pipelineSource;
+        TimeSeriesStore::Series* headingSeries;                     // Made in connectSignals() when the device is known
+        int_t headingTurns;                                         // Crossings of north, clockwise positive, to unwrap the stored heading
+        real_t lastHeadingDeg;
+        bool_t headingStarted;
+        Slot<uint64_t, real_t>* headingTarget;
         Slot<Ahrs&, uint64_t, const Math::Quaternion&, real_t, real_t> slotAhrsData{ this, &AhrsManager::callbackAhrs };
 
         void callbackAhrs(Ahrs& ahrs, uint64_t timeUs, const Math::Quaternion& q, real_t magHeadingRad, real_t turnsCount);
@@ -30,10 +78,13 @@ namespace IslSdk
         GyroManager() : gyro(nullptr) {};
         void connectSignals(GyroSensor& sensor, const std::string& name);
         void disconnectSignals();
+        void setBlockSize(uint_t size);
+        Signal<const ImuBlock&> onBlock;
        
     private:
         std::string name;
         GyroSensor* gyro;
+        ImuBlock block;
         Slot<GyroSensor&, const Math::Vector3&> slotData{ this, & GyroManager::callbackData };
         Slot<GyroSensor&, const Math::Vector3&> slotCalChange { this, & GyroManager::callbackCalChange };
 
@@ -44,13 +95,17 @@ namespace IslSdk
     class AccelManager
     {
     public:
-        AccelManager() : accel(nullptr) {};
+        AccelManager() : accel(nullptr) { hostCal.expectedRadius = 1.0; };
 		void connectSignals(AccelSensor& sensor, const std::string& name);
 		void disconnectSignals();
+        void setBlockSize(uint_t size);
+        Signal<const ImuBlock&> onBlock;
+        EllipsoidFit hostCal;
 		
     private:
         std::string name;
         AccelSensor* accel;
+        ImuBlock block;
         Slot<AccelSensor&, const Math::Vector3&> slotData{ this, & AccelManager::callbackData };
         Slot<AccelSensor&, const Math::Vector3&, const Math::Matrix3x3&> slotCalChange { this, & AccelManager::callbackCalChange };
         Slot<AccelSensor&, const Math::Vector3&, uint_t> slotCal{ this, & AccelManager::callbackCal };
@@ -66,10 +121,14 @@ namespace IslSdk
         MagManager() : mag(nullptr) {};
         void connectSignals(MagSensor& sensor, const std::string& name);
         void disconnectSignals();
+        void setBlockSize(uint_t size);
+        Signal<const ImuBlock&> onBlock;
+        EllipsoidFit hostCal;
 
     private:
         std::string name;
         MagSensor* mag;
+        ImuBlock block;
         Slot<MagSensor&, const Math::Vector3&> slotData{ this, & MagManager::callbackData };
         Slot<MagSensor&, const Math::Vector3&, const Math::Matrix3x3&> slotCalChange { this, & MagManager::callbackCalChange };
         Slot<MagSensor&, const Math::Vector3&, uint_t> slotCal{ this, & MagManager::callbackCal };
@@ -3,12 +3,19 @@
 #include "isa500App.h"
 #include "maths/maths.h"
 #include "platform/debug.h"
+#include "platform.h"
+#include "slotProfiler.h"
 
 using namespace IslSdk;
 
 //--------------------------------------------------------------------------------------------------
-Isa500App::Isa500App(void) : App("Isa500App")
+Isa500App::Isa500App(void) : TypedApp("Isa500App"), m_altitudeExport(ColumnarExport::global().stream("altitude", { "altitudeM", "correlation", "signalEnergy" })),
+                             m_temperatureExport(ColumnarExport::global().stream("temperature", { "temperatureC" })),
+                             m_altitudeSource(Pipeline::global().source("altitude")), m_temperatureSource(Pipeline::global().source("temperature")),
+                             m_altitudeSeries(nullptr), m_temperatureSeries(nullptr)
 {
+    ahrs.onHeading.connect(m_link.slotAhrs);                                    // Watched while the device isn't pinging on its own
+
     Debug::log(Debug::Severity::Notice, name.c_str(), "created" NEW_LINE
                                                       "d -> Set settings to defualt" NEW_LINE
                                                       "s -> Save settings to file" NEW_LINE
@@ -19,57 +26,64 @@ Isa500App::~Isa500App(void)
 {
 }
 //--------------------------------------------------------------------------------------------------
-void Isa500App::connectSignals(Device& device)
+void Isa500App::connectDevice(Isa500& isa500)
 {
-    Isa500& isa500 = reinterpret_cast<Isa500&>(device);
-
-    ahrs.connectSignals(isa500.ahrs, name);
+    ahrs.connectSignals(isa500.ahrs, name, &m_clockSync, &isa500.info);
+    m_altitudeSeries = &TimeSeriesStore::global().series("altitude", isa500.info.pnSnAsStr());
+    m_temperatureSeries = &TimeSeriesStore::global().series("temperature", isa500.info.pnSnAsStr());
     gyro.connectSignals(isa500.gyro, name);
     accel.connectSignals(isa500.accel, name);
     mag.connectSignals(isa500.mag, name);
 
-    isa500.onEcho.connect(slotEchoData);                      // Subscribing to this event causes data to be sent from the device at the rate defined by setSensorRates()
-    isa500.onEchogramData.connect(slotPingData);
-    isa500.onTemperature.connect(slotTemperatureData);        // Subscribing to this event causes data to be sent from the device at the rate defined by setSensorRates()
-    isa500.onVoltage.connect(slotVoltageData);                // Subscribing to this event causes data to be sent from the device at the rate defined by setSensorRates()
-    isa500.onTrigger.connect(slotTriggerData);
-    isa500.onScriptDataReceived.connect(slotScriptDataReceived);
-    isa500.onSettingsUpdated.connect(slotSettingsUpdated);
-
+    // Name, priority, fastest and slowest interval in ms, estimated bytes per sample and the starting interval.
+    // Pings start off, so echoes only come from 'p', set an interval to ping continuously.
+    // The raw IMU streams feed the block statistics and are the first to slow on a busy link.
+    m_rates.streams = { { "ping", 0, 100, 5000, 48, 0 },
+                        { "ahrs", 1, 100, 5000, 52, 1000 },
+                        { "gyro", 2, 100, 1000, 32, 100 },
+                        { "accel", 2, 100, 1000, 32, 100 },
+                        { "mag", 2, 100, 1000, 32, 100 } };
+    sendRates(isa500);
+}
+//--------------------------------------------------------------------------------------------------
+void Isa500App::sendRates(Isa500& isa500)
+{
     Isa500::SensorRates rates;
-    rates.ping = 0;
-    rates.ahrs = 1000;
-    rates.gyro = 0;
-    rates.accel = 0;
-    rates.mag = 0;
+    rates.ping = m_rates.intervalMs("ping");
+    rates.ahrs = m_rates.intervalMs("ahrs");
+    rates.gyro = m_rates.intervalMs("gyro");
+    rates.accel = m_rates.intervalMs("accel");
+    rates.mag = m_rates.intervalMs("mag");
     rates.temperature = 0;
     rates.voltage = 0;
     isa500.setSensorRates(rates);
 }
 //--------------------------------------------------------------------------------------------------
-void Isa500App::disconnectSignals(Device& device)
+void Isa500App::watchLink()
+{
+    const uint32_t pingMs = m_rates.intervalMs("ping");
+    m_link.setExpectedIntervalMs(pingMs ? pingMs : m_rates.intervalMs("ahrs"), pingMs == 0);
+}
+//--------------------------------------------------------------------------------------------------
+void Isa500App::disconnectDevice(Isa500& isa500)
 {
-    Isa500& isa500 = reinterpret_cast<Isa500&>(device);
-
     ahrs.disconnectSignals();
     gyro.disconnectSignals();
     accel.disconnectSignals();
     mag.disconnectSignals();
-
-    isa500.onEcho.disconnect(slotEchoData);
-    isa500.onEchogramData.disconnect(slotPingData);
-    isa500.onTemperature.disconnect(slotTemperatureData);
-    isa500.onVoltage.disconnect(slotVoltageData);
-    isa500.onTrigger.disconnect(slotTriggerData);
-    isa500.onScriptDataReceived.disconnect(slotScriptDataReceived);
-    isa500.onSettingsUpdated.disconnect(slotSettingsUpdated);
+}
+//--------------------------------------------------------------------------------------------------
+bool_t Isa500App::setHeadingTarget(Slot<uint64_t, real_t>* slot)
+{
+    ahrs.setHeadingTarget(slot);
+    return true;
 }
 //--------------------------------------------------------------------------------------------------
 void Isa500App::doTask(int_t key, const std::string& path)
 {
     if (m_device)
     {
-        Isa500& isa500 = reinterpret_cast<Isa500&>(*m_device);
+        Isa500& isa500 = device();
 
         switch (key)
         {
@@ -93,22 +107,31 @@ void Isa500App::doTask(int_t key, const std::string& path)
     }
 }
 //--------------------------------------------------------------------------------------------------
-void Isa500App::connectEvent(Device& device)
-{
-    Isa500& isa500 = reinterpret_cast<Isa500&>(device);
-}
-//--------------------------------------------------------------------------------------------------
 void Isa500App::callbackEchoData(Isa500& isa500, uint64_t timeUs, uint_t selectedIdx, uint_t totalEchoCount, const std::vector<Isa500::Echo>& echoes)
 {
+    PROFILE_SLOT("Isa500App::callbackEchoData");
+
+    m_link.dataReceived();
+
+    const uint64_t hostUs = m_clockSync.toHost(timeUs, Platform::getTimeUs());
+
     if (echoes.size())
     {
         // echoes.size() is limited to isa500.settings.multiEchoLimit
         // totalEchoCount is the number of received echoes and has nothing to do with the length of echoes array
-        Debug::log(Debug::Severity::Info, name.c_str(), "Echo received, range %.3f meters. Total Echoes: %u", echoes[selectedIdx].totalTof * isa500.settings.speedOfSound * 0.5, totalEchoCount);
+        const Isa500::Echo& echo = echoes[selectedIdx];
+        const TelemetryServer::Altitude msg = { static_cast<float>(echo.totalTof * isa500.settings.speedOfSound * 0.5), static_cast<float>(echo.correlation), static_cast<float>(echo.signalEnergy),
+                                                static_cast<uint32_t>(totalEchoCount) };
+        TelemetryServer::global().publish(TelemetryServer::Topic::Altitude, TelemetryServer::sourceId(isa500.info), hostUs, &msg, sizeof(msg));
+        m_altitudeExport.append(hostUs, isa500.info.pnSnAsStr(), { msg.altitudeM, echo.correlation, echo.signalEnergy });
+        m_altitudeSource.push(hostUs, TelemetryServer::sourceId(isa500.info), { msg.altitudeM, echo.correlation, echo.signalEnergy });
+        m_altitudeSeries->add(hostUs, msg.altitudeM);
+
+        Debug::log(Debug::Severity::Info, name.c_str(), "T:%.3f Echo received, range %.3f meters. Total Echoes: %u", hostUs * 0.000001, msg.altitudeM, totalEchoCount);
     }
     else
     {
-        Debug::log(Debug::Severity::Info, name.c_str(), "No echoes received");
+        Debug::log(Debug::Severity::Info, name.c_str(), "T:%.3f No echoes received", hostUs * 0.000001);
     }
 }
 //--------------------------------------------------------------------------------------------------
@@ -125,6 +148,9 @@ void Isa500App::callbackEchogramData(Isa500& isa500, const std::vector<uint8_t>&
 void Isa500App::callbackTemperatureData(Isa500& isa500, real_t temperatureC)
 {
     Debug::log(Debug::Severity::Info, name.c_str(), "Temperature %.2f", temperatureC);
+    m_temperatureExport.append(Platform::getTimeUs(), isa500.info.pnSnAsStr(), { temperatureC });
+    m_temperatureSource.push(Platform::getTimeUs(), TelemetryServer::sourceId(isa500.info), { temperatureC });
+    m_temperatureSeries->add(Platform::getTimeUs(), temperatureC);
 }
 //--------------------------------------------------------------------------------------------------
 void Isa500App::callbackVoltageData(Isa500& isa500, real_t voltage12)
@@ -3,38 +3,40 @@
 
 //------------------------------------------ Includes ----------------------------------------------
 
-#include "app.h"
+#include "typedApp.h"
 #include "devices/isa500.h"
 #include "imuManager.h"
+#include "columnarExport.h"
 
 //--------------------------------------- Class Definition -----------------------------------------
 
 namespace IslSdk
 {
-    class Isa500App : public App
+    class Isa500App : public TypedApp<Isa500App, Isa500>
     {
     public:
         Isa500App(void);
         ~Isa500App(void);
-        void connectSignals(Device& device) override;
-        void disconnectSignals(Device& device) override;
         void doTask(int_t key, const std::string& path) override;
-
-        Slot<Isa500&, uint64_t, uint_t, uint_t, const std::vector<Isa500::Echo>&> slotEchoData{ this, &Isa500App::callbackEchoData };
-        Slot<Isa500&, const std::vector<uint8_t>&> slotPingData{ this, &Isa500App::callbackEchogramData };
-        Slot<Isa500&, real_t> slotTemperatureData{ this, &Isa500App::callbackTemperatureData };
-        Slot<Isa500&, real_t> slotVoltageData{ this, &Isa500App::callbackVoltageData };
-        Slot<Isa500&, bool_t> slotTriggerData{ this, &Isa500App::callbackTriggerData };
-        Slot<Isa500&> slotScriptDataReceived{ this, &Isa500App::callbackScriptDataReceived };
-        Slot<Isa500&, bool_t> slotSettingsUpdated{ this, &Isa500App::callbackSettingsUpdated };
+        bool_t setHeadingTarget(Slot<uint64_t, real_t>* slot) override;
 
     private:
+        friend TypedApp;
         AhrsManager ahrs;
         GyroManager gyro;
         AccelManager accel;
         MagManager mag;
-
-        void connectEvent(Device& device);
+        ColumnarExport::Stream& m_altitudeExport;
+        ColumnarExport::Stream& m_temperatureExport;
+        Pipeline::Source& m_altitudeSource;
+        Pipeline::Source& m_temperatureSource;
+        TimeSeriesStore::Series* m_altitudeSeries;
+        TimeSeriesStore::Series* m_temperatureSeries;
+
+        void connectDevice(Isa500& isa500);
+        void disconnectDevice(Isa500& isa500);
+        void sendRates(Isa500& isa500);
+        void watchLink();
         void callbackEchoData(Isa500& isa500, uint64_t timeUs, uint_t selectedIdx, uint_t totalEchoCount, const std::vector<Isa500::Echo>& echoes);
         void callbackEchogramData(Isa500& isa500, const std::vector<uint8_t>& data);
         void callbackTemperatureData(Isa500& isa500, real_t temperatureC);
@@ -42,6 +44,14 @@ namespace IslSdk
         void callbackTriggerData(Isa500& isa500, bool_t risingEdge);
         void callbackScriptDataReceived(Isa500& isa500);
         void callbackSettingsUpdated(Isa500& isa500, bool_t ok);
+
+        Handlers<On<&Isa500::onEcho, &Isa500App::callbackEchoData>,                              // Subscribing to echoes, temperature and voltage causes data to be
+                 On<&Isa500::onEchogramData, &Isa500App::callbackEchogramData>,                  // sent from the device at the rate defined by setSensorRates()
+                 On<&Isa500::onTemperature, &Isa500App::callbackTemperatureData>,
+                 On<&Isa500::onVoltage, &Isa500App::callbackVoltageData>,
+                 On<&Isa500::onTrigger, &Isa500App::callbackTriggerData>,
+                 On<&Isa500::onScriptDataReceived, &Isa500App::callbackScriptDataReceived>,
+                 On<&Isa500::onSettingsUpdated, &Isa500App::callbackSettingsUpdated>> m_handlers{ this };
     };
 }
 
@@ -3,69 +3,93 @@
 #include "isd4000App.h"
 #include "maths/maths.h"
 #include "platform/debug.h"
+#include "platform.h"
+#include "slotProfiler.h"
 
 using namespace IslSdk;
 
 //--------------------------------------------------------------------------------------------------
-Isd4000App::Isd4000App(void) : App("Isd4000App")
+Isd4000App::Isd4000App(void) : TypedApp("Isd4000App"), m_depthExport(ColumnarExport::global().stream("depth", { "pressureBar", "depthM" })),
+                               m_temperatureExport(ColumnarExport::global().stream("temperature", { "temperatureC" })),
+                               m_depthSource(Pipeline::global().source("depth")), m_temperatureSource(Pipeline::global().source("temperature")),
+                               m_depthSeries(nullptr), m_temperatureSeries(nullptr)
 {
     Debug::log(Debug::Severity::Notice, name.c_str(), "created" NEW_LINE
                                                       "d -> Set settings to defualt" NEW_LINE
-                                                      "s -> Save settings to file" NEW_LINE);
+                                                      "s -> Save settings to file" NEW_LINE
+                                                      "w -> Save last water column profile" NEW_LINE);
 }
 //--------------------------------------------------------------------------------------------------
 Isd4000App::~Isd4000App(void)
 {
 }
 //--------------------------------------------------------------------------------------------------
-void Isd4000App::connectSignals(Device & device)
+void Isd4000App::connectDevice(Isd4000& isd4000)
 {
-    Isd4000& isd4000 = reinterpret_cast<Isd4000&>(device);
-
-    ahrs.connectSignals(isd4000.ahrs, name);
+    ahrs.connectSignals(isd4000.ahrs, name, &m_clockSync, &isd4000.info);
+    m_depthSeries = &TimeSeriesStore::global().series("depth", isd4000.info.pnSnAsStr());
+    m_temperatureSeries = &TimeSeriesStore::global().series("temperature", isd4000.info.pnSnAsStr());
     gyro.connectSignals(isd4000.gyro, name);
     accel.connectSignals(isd4000.accel, name);
     mag.connectSignals(isd4000.mag, name);
 
-    isd4000.onPressure.connect(slotPressure);                   // Subscribing to this event causes data to be sent from the device at the rate defined by setSensorRates()
-    isd4000.onTemperature.connect(slotTemperature);             // Subscribing to this event causes data to be sent from the device at the rate defined by setSensorRates()
-    isd4000.onScriptDataReceived.connect(slotScriptDataReceived);
-    isd4000.onSettingsUpdated.connect(slotSettingsUpdated);
-    isd4000.onPressureCalCert.connect(slotPressureCalCert);
-    isd4000.onTemperatureCalCert.connect(slotTemperatureCalCert);
+    // Name, priority, fastest and slowest interval in ms, estimated bytes per sample and the starting interval.
+    // Pressure is pinned as the wave spectrum needs a fixed sample rate. The raw IMU streams feed
+    // the block statistics and are the first to slow on a busy link.
+    m_rates.streams = { { "pressure", 0, 100, 100, 40, 100 },
+                        { "ahrs", 1, 50, 2000, 52, 100 },
+                        { "temperature", 2, 200, 10000, 24, 200 },
+                        { "gyro", 3, 100, 1000, 32, 100 },
+                        { "accel", 3, 100, 1000, 32, 100 },
+                        { "mag", 3, 100, 1000, 32, 100 } };
+    sendRates(isd4000);
+
+    // Queue enough pressure samples to pair them all at the slowest temperature rate
+    WaterProfile::Settings profileSettings;
+    profileSettings.pressureIntervalMs = m_rates.intervalMs("pressure");
+    profileSettings.temperatureIntervalMs = m_rates.streams[2].slowestMs;
+    waterProfile.setup(profileSettings);
 
+    // 512 samples at 10Hz gives a 51.2 second segment, long enough to resolve swell periods
+    waveSpectrum.setup(1000.0 / m_rates.intervalMs("pressure"), 512, 60);
+}
+//--------------------------------------------------------------------------------------------------
+void Isd4000App::sendRates(Isd4000& isd4000)
+{
     Isd4000::SensorRates rates;
-    rates.pressure = 100;
-    rates.ahrs = 100;
-    rates.gyro = 0;
-    rates.accel = 0;
-    rates.mag = 0;
-    rates.temperature = 200;
+    rates.pressure = m_rates.intervalMs("pressure");
+    rates.ahrs = m_rates.intervalMs("ahrs");
+    rates.gyro = m_rates.intervalMs("gyro");
+    rates.accel = m_rates.intervalMs("accel");
+    rates.mag = m_rates.intervalMs("mag");
+    rates.temperature = m_rates.intervalMs("temperature");
     isd4000.setSensorRates(rates);
 }
 //--------------------------------------------------------------------------------------------------
-void Isd4000App::disconnectSignals(Device& device)
+void Isd4000App::watchLink()
+{
+    m_link.setExpectedIntervalMs(m_rates.intervalMs("pressure"), false);
+}
+//--------------------------------------------------------------------------------------------------
+void Isd4000App::disconnectDevice(Isd4000& isd4000)
 {
-    Isd4000& isd4000 = reinterpret_cast<Isd4000&>(device);
-
     ahrs.disconnectSignals();
     gyro.disconnectSignals();
     accel.disconnectSignals();
     mag.disconnectSignals();
-
-    isd4000.onPressure.disconnect(slotPressure);
-    isd4000.onTemperature.disconnect(slotTemperature);
-    isd4000.onScriptDataReceived.disconnect(slotScriptDataReceived);
-    isd4000.onSettingsUpdated.disconnect(slotSettingsUpdated);
-    isd4000.onPressureCalCert.disconnect(slotPressureCalCert);
-    isd4000.onTemperatureCalCert.disconnect(slotTemperatureCalCert);
+}
+//--------------------------------------------------------------------------------------------------
+bool_t Isd4000App::setHeadingTarget(Slot<uint64_t, real_t>* slot)
+{
+    ahrs.setHeadingTarget(slot);
+    return true;
 }
 //--------------------------------------------------------------------------------------------------
 void Isd4000App::doTask(int_t key, const std::string& path)
 {
     if (m_device)
     {
-        Isd4000& isd4000 = reinterpret_cast<Isd4000&>(*m_device);
+        Isd4000& isd4000 = device();
         switch (key)
         {
         case 'd':
@@ -76,6 +100,13 @@ void Isd4000App::doTask(int_t key, const std::string& path)
             isd4000.saveConfig(path + m_device->info.pnSnAsStr() + " settings.xml");
             break;
 
+        case 'w':
+            if (!waterProfile.exportCsv(path + m_device->info.pnSnAsStr() + " profile.csv"))
+            {
+                Debug::log(Debug::Severity::Warning, name.c_str(), "Failed to save profile");
+            }
+            break;
+
         default:
             break;
         }
@@ -85,12 +116,40 @@ void Isd4000App::doTask(int_t key, const std::string& path)
 //--------------------------------------------------------------------------------------------------
 void Isd4000App::callbackPressureData(Isd4000& isd4000, uint64_t timeUs, real_t pressureBar, real_t depthM, real_t pressureBarRaw)
 {
-    Debug::log(Debug::Severity::Info, name.c_str(), "Pressure %.5f Bar, Depth %.3f Meters", pressureBar, depthM);
+    PROFILE_SLOT("Isd4000App::callbackPressureData");
+
+    m_link.dataReceived();
+
+    const uint64_t hostUs = m_clockSync.toHost(timeUs, Platform::getTimeUs());
+
+    Debug::log(Debug::Severity::Info, name.c_str(), "T:%.3f Pressure %.5f Bar, Depth %.3f Meters", hostUs * 0.000001, pressureBar, depthM);
+
+    const TelemetryServer::Depth msg = { static_cast<float>(pressureBar), static_cast<float>(depthM) };
+    TelemetryServer::global().publish(TelemetryServer::Topic::Depth, TelemetryServer::sourceId(isd4000.info), hostUs, &msg, sizeof(msg));
+    m_depthExport.append(hostUs, isd4000.info.pnSnAsStr(), { pressureBar, depthM });
+    m_depthSource.push(hostUs, TelemetryServer::sourceId(isd4000.info), { pressureBar, depthM });
+    m_depthSeries->add(hostUs, depthM);
+
+    if (waveSpectrum.add(depthM))
+    {
+        const WaveSpectrum::Result& waves = waveSpectrum.result();
+        Debug::log(Debug::Severity::Info, name.c_str(), "Sea state Hs %.2f Meters, Tp %.1f Seconds", waves.hsM, waves.tpS);
+    }
+
+    if (waterProfile.addPressure(timeUs, pressureBar, depthM))
+    {
+        const WaterProfile::Profile& profile = waterProfile.lastProfile();
+        Debug::log(Debug::Severity::Notice, name.c_str(), "%s cast %u complete, %.1f to %.1f Meters", profile.cast == WaterProfile::Cast::Descent ? "Descent" : "Ascent", FMT_U(profile.number), profile.minDepthM, profile.maxDepthM);
+    }
 }
 //--------------------------------------------------------------------------------------------------
 void Isd4000App::callbackTemperatureData(Isd4000& isd4000, real_t temperatureC, real_t temperatureRawC)
 {
     Debug::log(Debug::Severity::Info, name.c_str(), "Temperature %.2fC", temperatureRawC);
+    m_temperatureExport.append(Platform::getTimeUs(), isd4000.info.pnSnAsStr(), { temperatureC });
+    m_temperatureSource.push(Platform::getTimeUs(), TelemetryServer::sourceId(isd4000.info), { temperatureC });
+    m_temperatureSeries->add(Platform::getTimeUs(), temperatureC);
+    waterProfile.addTemperature(temperatureC);
 }
 //--------------------------------------------------------------------------------------------------
 void Isd4000App::callbackScriptDataReceived(Isd4000& isd4000)
@@ -3,42 +3,57 @@
 
 //------------------------------------------ Includes ----------------------------------------------
 
-#include "app.h"
+#include "typedApp.h"
 #include "devices/isd4000.h"
 #include "imuManager.h"
+#include "waveSpectrum.h"
+#include "waterProfile.h"
+#include "columnarExport.h"
 
 //--------------------------------------- Class Definition -----------------------------------------
 
 namespace IslSdk
 {
-    class Isd4000App : public App
+    class Isd4000App : public TypedApp<Isd4000App, Isd4000>
     {
     public:
         Isd4000App(void);
         ~Isd4000App(void);
-        void connectSignals(Device& device) override;
-        void disconnectSignals(Device& device) override;
         void doTask(int_t key, const std::string& path) override;
-
-        Slot<Isd4000&, uint64_t, real_t, real_t, real_t> slotPressure{ this, & Isd4000App::callbackPressureData };
-        Slot<Isd4000&, real_t, real_t> slotTemperature{ this, & Isd4000App::callbackTemperatureData };
-        Slot<Isd4000&> slotScriptDataReceived{ this, & Isd4000App::callbackScriptDataReceived };
-        Slot<Isd4000&, bool_t> slotSettingsUpdated{ this, & Isd4000App::callbackSettingsUpdated };
-        Slot<Isd4000&, const Isd4000::PressureCal&> slotPressureCalCert{ this, & Isd4000App::callbackPressureCal };
-        Slot<Isd4000&, const Isd4000::TemperatureCal&> slotTemperatureCalCert{ this, & Isd4000App::callbackTemperatureCal };
+        bool_t setHeadingTarget(Slot<uint64_t, real_t>* slot) override;
 
     private:
+        friend TypedApp;
         AhrsManager ahrs;
         GyroManager gyro;
         AccelManager accel;
         MagManager mag;
-
+        WaveSpectrum waveSpectrum;
+        WaterProfile waterProfile;
+        ColumnarExport::Stream& m_depthExport;
+        ColumnarExport::Stream& m_temperatureExport;
+        Pipeline::Source& m_depthSource;
+        Pipeline::Source& m_temperatureSource;
+        TimeSeriesStore::Series* m_depthSeries;
+        TimeSeriesStore::Series* m_temperatureSeries;
+
+        void connectDevice(Isd4000& isd4000);
+        void disconnectDevice(Isd4000& isd4000);
+        void sendRates(Isd4000& isd4000);
+        void watchLink();
         void callbackPressureData(Isd4000& isd4000, uint64_t timeUs, real_t pressureBar, real_t depthM, real_t pressureBarRaw);
         void callbackTemperatureData(Isd4000& isd4000, real_t temperatureC, real_t temperatureRawC);
         void callbackScriptDataReceived(Isd4000& isd4000);
         void callbackSettingsUpdated(Isd4000& isd4000, bool_t ok);
         void callbackPressureCal(Isd4000& isd4000, const Isd4000::PressureCal& cal);
         void callbackTemperatureCal(Isd4000& isd4000, const Isd4000::TemperatureCal& cal);
+
+        Handlers<On<&Isd4000::onPressure, &Isd4000App::callbackPressureData>,                    // Subscribing to pressure and temperature causes data to be sent
+                 On<&Isd4000::onTemperature, &Isd4000App::callbackTemperatureData>,              // from the device at the rate defined by setSensorRates()
+                 On<&Isd4000::onScriptDataReceived, &Isd4000App::callbackScriptDataReceived>,
+                 On<&Isd4000::onSettingsUpdated, &Isd4000App::callbackSettingsUpdated>,
+                 On<&Isd4000::onPressureCalCert, &Isd4000App::callbackPressureCal>,
+                 On<&Isd4000::onTemperatureCalCert, &Isd4000App::callbackTemperatureCal>> m_handlers{ this };
     };
 }
 
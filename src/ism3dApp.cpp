@@ -7,43 +7,56 @@
 using namespace IslSdk;
 
 //--------------------------------------------------------------------------------------------------
-Ism3dApp::Ism3dApp(void) : App("Ism3dApp")
+Ism3dApp::Ism3dApp(void) : TypedApp("Ism3dApp")
 {
+    ahrs.onHeading.connect(m_link.slotAhrs);                                    // AHRS data is expected from every device at its set rate
+
     Debug::log(Debug::Severity::Notice, name.c_str(), "created" NEW_LINE
                                                       "d -> Set settings to defualt" NEW_LINE
-                                                      "s -> Save settings to file" NEW_LINE);
+                                                      "s -> Save settings to file" NEW_LINE
+                                                      "a -> Start Allan variance run" NEW_LINE
+                                                      "A -> Stop Allan variance run and report" NEW_LINE);
 }
 //--------------------------------------------------------------------------------------------------
 Ism3dApp::~Ism3dApp(void)
 {
 }
 //--------------------------------------------------------------------------------------------------
-void Ism3dApp::connectSignals(Device& device)
+void Ism3dApp::connectDevice(Ism3d& ism3d)
 {
-    Ism3d& ism3d = reinterpret_cast<Ism3d&>(device);
-
-    ahrs.connectSignals(ism3d.ahrs, name);
+    ahrs.connectSignals(ism3d.ahrs, name, &m_clockSync, &ism3d.info);
     gyro.connectSignals(ism3d.gyro, name);
     accel.connectSignals(ism3d.accel, name);
     mag.connectSignals(ism3d.mag, name);
     gyro2.connectSignals(ism3d.gyroSec, name);
     accel2.connectSignals(ism3d.accelSec, name);
 
-    ism3d.onScriptDataReceived.connect(slotScriptDataReceived);
-    ism3d.onSettingsUpdated.connect(slotSettingsUpdated);
+    gyro.onBlock.connect(gyroAdev.slotBlock);
+    gyro2.onBlock.connect(gyro2Adev.slotBlock);
+    accel.onBlock.connect(accelAdev.slotBlock);
+    accel2.onBlock.connect(accel2Adev.slotBlock);
 
+    // Name, priority, fastest and slowest interval in ms, estimated bytes per sample and the starting interval.
+    // Gyro and accel are off until an Allan variance run pins them at 100Hz, mag feeds the block statistics.
+    m_rates.streams = { { "ahrs", 0, 20, 2000, 52, 100 },
+                        { "gyro", 0, 10, 10, 32, 0 },
+                        { "accel", 0, 10, 10, 32, 0 },
+                        { "mag", 2, 100, 1000, 32, 100 } };
+    sendRates(ism3d);
+}
+//--------------------------------------------------------------------------------------------------
+void Ism3dApp::sendRates(Ism3d& ism3d)
+{
     Ism3d::SensorRates rates;
-    rates.ahrs = 100;
-    rates.gyro = 0;
-    rates.accel = 0;
-    rates.mag = 0;
+    rates.ahrs = m_rates.intervalMs("ahrs");
+    rates.gyro = m_rates.intervalMs("gyro");
+    rates.accel = m_rates.intervalMs("accel");
+    rates.mag = m_rates.intervalMs("mag");
     ism3d.setSensorRates(rates);
 }
 //--------------------------------------------------------------------------------------------------
-void Ism3dApp::disconnectSignals(Device& device)
+void Ism3dApp::disconnectDevice(Ism3d& ism3d)
 {
-    Ism3d& ism3d = reinterpret_cast<Ism3d&>(device);
-
     ahrs.disconnectSignals();
     gyro.disconnectSignals();
     accel.disconnectSignals();
@@ -51,15 +64,23 @@ void Ism3dApp::disconnectSignals(Device& device)
     gyro2.disconnectSignals();
     accel2.disconnectSignals();
 
-    ism3d.onScriptDataReceived.disconnect(slotScriptDataReceived);
-    ism3d.onSettingsUpdated.disconnect(slotSettingsUpdated);
+    gyro.onBlock.disconnect(gyroAdev.slotBlock);
+    gyro2.onBlock.disconnect(gyro2Adev.slotBlock);
+    accel.onBlock.disconnect(accelAdev.slotBlock);
+    accel2.onBlock.disconnect(accel2Adev.slotBlock);
+}
+//--------------------------------------------------------------------------------------------------
+bool_t Ism3dApp::setHeadingTarget(Slot<uint64_t, real_t>* slot)
+{
+    ahrs.setHeadingTarget(slot);
+    return true;
 }
 //--------------------------------------------------------------------------------------------------
 void Ism3dApp::doTask(int_t key, const std::string& path)
 {
     if (m_device)
     {
-        Ism3d& ism3d = reinterpret_cast<Ism3d&>(*m_device);
+        Ism3d& ism3d = device();
 
         switch (key)
         {
@@ -71,6 +92,18 @@ void Ism3dApp::doTask(int_t key, const std::string& path)
             ism3d.saveConfig(path + m_device->info.pnSnAsStr() + " settings.xml");
             break;
 
+        case 'a':
+            setAllanRun(ism3d, true);
+            break;
+
+        case 'A':
+            setAllanRun(ism3d, false);
+            logAllan("Gyro", gyroAdev, 60.0, 3600.0, "deg/sqrt(h)", "deg/h");
+            logAllan("Gyro2", gyro2Adev, 60.0, 3600.0, "deg/sqrt(h)", "deg/h");
+            logAllan("Accel", accelAdev, 60.0, 1000.0, "g/sqrt(h)", "mg");
+            logAllan("Accel2", accel2Adev, 60.0, 1000.0, "g/sqrt(h)", "mg");
+            break;
+
         default:
             break;
         }
@@ -96,3 +129,39 @@ void Ism3dApp::callbackSettingsUpdated(Ism3d& ism3d, bool_t ok)
     }
 }
 //--------------------------------------------------------------------------------------------------
+void Ism3dApp::setAllanRun(Ism3d& ism3d, bool_t run)
+{
+    for (RateController::Stream& stream : m_rates.streams)
+    {
+        if (stream.name == "gyro" || stream.name == "accel")
+        {
+            stream.intervalMs = run ? 10 : 0;
+        }
+    }
+    sendRates(ism3d);
+
+    if (run)
+    {
+        gyroAdev.reset();
+        gyro2Adev.reset();
+        accelAdev.reset();
+        accel2Adev.reset();
+        Debug::log(Debug::Severity::Notice, name.c_str(), "Allan variance run started");
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Ism3dApp::logAllan(const char* sensor, const AllanVariance& adev, real_t rwScale, real_t biScale, const char* rwUnits, const char* biUnits)
+{
+    const std::vector<AllanVariance::Point> points = adev.compute();
+    const AllanVariance::Noise noise = AllanVariance::noise(points);
+    const char axis[] = { 'x', 'y', 'z' };
+
+    Debug::log(Debug::Severity::Notice, name.c_str(), "%s Allan deviation, %u samples at %.4f seconds", sensor, FMT_U(adev.sampleCount()), adev.samplePeriodS());
+
+    for (uint_t a = 0; a < 3; a++)
+    {
+        Debug::log(Debug::Severity::Notice, name.c_str(), "%s %c random walk %.4f %s, bias instability %.4f %s at %.1f seconds", sensor, axis[a], noise.randomWalk[a] * rwScale, rwUnits,
+                   noise.biasInstability[a] * biScale, biUnits, noise.biasInstabilityTauS[a]);
+    }
+}
+//--------------------------------------------------------------------------------------------------
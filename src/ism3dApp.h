@@ -3,36 +3,47 @@
 
 //------------------------------------------ Includes ----------------------------------------------
 
-#include "app.h"
+#include "typedApp.h"
 #include "devices/ism3d.h"
 #include "imuManager.h"
+#include "allanVariance.h"
 
 //--------------------------------------- Class Definition -----------------------------------------
 
 namespace IslSdk
 {
-    class Ism3dApp : public App
+    class Ism3dApp : public TypedApp<Ism3dApp, Ism3d>
     {
     public:
         Ism3dApp(void);
         ~Ism3dApp(void);
-        void connectSignals(Device& device) override;
-        void disconnectSignals(Device& device) override;
         void doTask(int_t key, const std::string& path) override;
-
-        Slot<Ism3d&> slotScriptDataReceived{ this, & Ism3dApp::callbackScriptDataReceived };
-        Slot<Ism3d&, bool_t> slotSettingsUpdated{ this, & Ism3dApp::callbackSettingsUpdated };
+        bool_t setHeadingTarget(Slot<uint64_t, real_t>* slot) override;
 
     private:
+        friend TypedApp;
         AhrsManager ahrs;
         GyroManager gyro;
         AccelManager accel;
         MagManager mag;
         GyroManager gyro2;
         AccelManager accel2;
+        AllanVariance gyroAdev;
+        AllanVariance gyro2Adev;
+        AllanVariance accelAdev;
+        AllanVariance accel2Adev;
+
+        void connectDevice(Ism3d& ism3d);
+        void disconnectDevice(Ism3d& ism3d);
+        void sendRates(Ism3d& ism3d);
+        void setAllanRun(Ism3d& ism3d, bool_t run);
+        void logAllan(const char* sensor, const AllanVariance& adev, real_t rwScale, real_t biScale, const char* rwUnits, const char* biUnits);
 
         void callbackScriptDataReceived(Ism3d& ism3d);
         void callbackSettingsUpdated(Ism3d& ism3d, bool_t ok);
+
+        Handlers<On<&Ism3d::onScriptDataReceived, &Ism3dApp::callbackScriptDataReceived>,
+                 On<&Ism3d::onSettingsUpdated, &Ism3dApp::callbackSettingsUpdated>> m_handlers{ this };
     };
 }
 
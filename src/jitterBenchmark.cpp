@@ -0,0 +1,82 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "jitterBenchmark.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+void JitterBenchmark::measure(Result& result, uint_t periodUs, uint_t durationMs, uint_t loadThreads)
+{
+    std::atomic<bool_t> loaded(true);
+    std::vector<std::thread> load;
+
+    // Busy threads at normal priority stand in for the other processes on a shared computer. New
+    // threads inherit the real time policy so they drop back to normal or they'd starve this one.
+    for (uint_t i = 0; i < loadThreads; i++)
+    {
+        load.emplace_back([&loaded]()
+        {
+            Platform::setThreadRealTime(0);
+            volatile uint64_t n = 0;
+            while (loaded.load(std::memory_order_relaxed))
+            {
+                n = n + 1;
+            }
+        });
+    }
+
+    result.loops = 0;
+    result.maxLatencyNs = 0;
+    result.maxPeriodNs = 0;
+
+    const uint64_t endUs = Platform::getTimeUs() + durationMs * static_cast<uint64_t>(1000);
+    uint64_t wakeUs = Platform::getTimeUs() + periodUs;
+    uint64_t lastNs = 0;
+
+    while (wakeUs < endUs)
+    {
+        Platform::sleepUntilUs(wakeUs);
+        const uint64_t nowNs = Platform::getTimeNs();
+        const uint64_t latencyNs = nowNs > wakeUs * 1000 ? nowNs - wakeUs * 1000 : 0;
+
+        result.latencyNs.record(latencyNs);
+        result.maxLatencyNs = latencyNs > result.maxLatencyNs ? latencyNs : result.maxLatencyNs;
+
+        if (lastNs)
+        {
+            result.periodNs.record(nowNs - lastNs);
+            result.maxPeriodNs = nowNs - lastNs > result.maxPeriodNs ? nowNs - lastNs : result.maxPeriodNs;
+        }
+
+        lastNs = nowNs;
+        result.loops++;
+        wakeUs += periodUs;
+    }
+
+    loaded = false;
+    for (std::thread& thread : load)
+    {
+        thread.join();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void JitterBenchmark::log(const char* label, const Result& result, uint_t periodUs)
+{
+    const Metrics::Histogram& l = result.latencyNs;
+    const Metrics::Histogram& p = result.periodNs;
+
+    // Quantiles are bucket upper bounds so are limited to the largest value actually seen
+    auto us = [](uint64_t quantileNs, uint64_t maxNs) { return (quantileNs < maxNs ? quantileNs : maxNs) * 0.001; };
+
+    Debug::log(Debug::Severity::Notice, "Jitter", "%-10s %llu loops at %u us" NEW_LINE
+               "  wake latency us  p50:%8.1f  p99:%8.1f  p99.9:%8.1f  max:%8.1f" NEW_LINE
+               "  loop period us   p50:%8.1f  p99:%8.1f  p99.9:%8.1f  max:%8.1f", label, static_cast<unsigned long long>(result.loops), FMT_U(periodUs),
+               us(l.quantile(0.5), result.maxLatencyNs), us(l.quantile(0.99), result.maxLatencyNs), us(l.quantile(0.999), result.maxLatencyNs), result.maxLatencyNs * 0.001,
+               us(p.quantile(0.5), result.maxPeriodNs), us(p.quantile(0.99), result.maxPeriodNs), us(p.quantile(0.999), result.maxPeriodNs), result.maxPeriodNs * 0.001);
+}
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,34 @@
+#ifndef JITTERBENCHMARK_H_
+#define JITTERBENCHMARK_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include "metrics.h"
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Measures scheduling jitter the way cyclictest does. The calling thread sleeps to an absolute
+    // wake time every period and records how late it woke and the time between wakes. Run it with and
+    // without the real time settings, with the usual load on the machine, to see what they buy.
+    class JitterBenchmark
+    {
+    public:
+        struct Result
+        {
+            uint64_t loops;
+            uint64_t maxLatencyNs;
+            uint64_t maxPeriodNs;
+            Metrics::Histogram latencyNs;                                   // Wake time after the requested time
+            Metrics::Histogram periodNs;                                    // Time between consecutive wakes
+        };
+
+        static void measure(Result& result, uint_t periodUs, uint_t durationMs, uint_t loadThreads);
+        static void log(const char* label, const Result& result, uint_t periodUs);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,190 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "linkSupervisor.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <algorithm>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+LinkSupervisor::LinkSupervisor() : m_expectedMs(0), m_fromAhrs(true), m_measured(false), m_lastDataUs(0), m_recovering(false), m_lostUs(0), m_nextRetryUs(0),
+                                   m_retryMs(firstRetryMs), m_attempts(0), m_portClosed(false), m_recoveryTime(nullptr), m_losses(nullptr)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void LinkSupervisor::setName(const std::string& deviceName)
+{
+    const std::string labels = "device=\"" + deviceName + "\"";
+
+    m_name = deviceName;
+    m_recoveryTime = &Metrics::global().histogram("isl_link_recovery_seconds", labels, "Time from losing the link to a device to it reconnecting");
+    m_losses = &Metrics::global().counter("isl_link_losses_total", labels, "Disconnects, removed ports and data stalls");
+}
+//--------------------------------------------------------------------------------------------------
+void LinkSupervisor::setExpectedIntervalMs(uint_t intervalMs, bool_t fromAhrs)
+{
+    if (fromAhrs != m_fromAhrs || m_measured)
+    {
+        m_lastDataUs = 0;                               // The old source's last sample says nothing about the new one
+    }
+
+    m_expectedMs = intervalMs;
+    m_fromAhrs = fromAhrs;
+    m_measured = false;
+}
+//--------------------------------------------------------------------------------------------------
+void LinkSupervisor::setMeasuredInterval()
+{
+    if (!m_measured)
+    {
+        m_expectedMs = 0;                               // Stalls aren't reported until an interval has been measured
+        m_lastDataUs = 0;
+    }
+
+    m_fromAhrs = false;
+    m_measured = true;
+}
+//--------------------------------------------------------------------------------------------------
+void LinkSupervisor::setConnection(Device& device)
+{
+    if (device.connection)
+    {
+        m_sysPort = device.connection->sysPort;
+        m_meta = device.connection->meta;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void LinkSupervisor::dataReceived()
+{
+    if (m_fromAhrs)
+    {
+        return;
+    }
+
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    if (m_measured && m_lastDataUs && !m_recovering)
+    {
+        // Smoothed over about 8 samples, rounded up so it never reaches 0
+        const uint_t intervalMs = static_cast<uint_t>((nowUs - m_lastDataUs + 999) / 1000);
+        m_expectedMs = m_expectedMs ? (m_expectedMs * 7 + intervalMs + 7) / 8 : intervalMs;
+    }
+    m_lastDataUs = nowUs;
+}
+//--------------------------------------------------------------------------------------------------
+void LinkSupervisor::linkLost(const char* reason)
+{
+    if (m_recovering)
+    {
+        return;
+    }
+
+    m_recovering = true;
+    m_lostUs = Platform::getTimeUs();
+    m_nextRetryUs = m_lostUs;                           // First attempt on the next run()
+    m_retryMs = firstRetryMs;
+    m_attempts = 0;
+    m_portClosed = false;
+
+    if (m_losses)
+    {
+        m_losses->add();
+    }
+
+    Debug::log(Debug::Severity::Warning, "Link", "%s lost, %s", m_name.c_str(), reason);
+}
+//--------------------------------------------------------------------------------------------------
+bool_t LinkSupervisor::connected(Device& device)
+{
+    setConnection(device);
+    m_lastDataUs = 0;
+
+    if (!m_recovering)
+    {
+        return false;
+    }
+
+    const uint64_t recoveryUs = Platform::getTimeUs() - m_lostUs;
+    m_recovering = false;
+
+    if (m_recoveryTime)
+    {
+        m_recoveryTime->record(recoveryUs * 1000);
+    }
+
+    Debug::log(Debug::Severity::Notice, "Link", "%s recovered in %.0f ms after %u attempts", m_name.c_str(), recoveryUs * 0.001, FMT_U(m_attempts));
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+void LinkSupervisor::run(Device& device)
+{
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    if (!m_recovering)
+    {
+        const uint64_t stallUs = std::max<uint64_t>(m_expectedMs * stallIntervals, minStallMs) * 1000;
+
+        if (m_expectedMs && m_lastDataUs && nowUs - m_lastDataUs > stallUs)
+        {
+            linkLost("no data");
+        }
+        return;
+    }
+
+    if (nowUs - m_lostUs > giveUpMs * static_cast<uint64_t>(1000))
+    {
+        Debug::log(Debug::Severity::Warning, "Link", "%s not back after %u attempts, leaving it to discovery", m_name.c_str(), FMT_U(m_attempts));
+        m_recovering = false;
+        m_lastDataUs = 0;
+    }
+    else if (nowUs >= m_nextRetryUs)
+    {
+        reconnect(device);
+        m_nextRetryUs = nowUs + m_retryMs * static_cast<uint64_t>(1000);
+        m_retryMs = std::min(m_retryMs * 2, maxRetryMs);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void LinkSupervisor::reconnect(Device& device)
+{
+    if (m_sysPort == nullptr)
+    {
+        return;
+    }
+
+    m_attempts++;
+
+    if (device.isConnected() && !m_portClosed)
+    {
+        // Stalled but the SDK still has the connection, so connecting again would do nothing. A serial
+        // port is closed to drop it and reopened on the next attempt, other devices on the port recover
+        // the same way. A network port is shared by every networked device so the SDK's own timeout is
+        // left to drop it.
+        if (m_sysPort->type == SysPort::Type::Serial)
+        {
+            m_sysPort->close();
+            m_portClosed = true;
+        }
+        return;
+    }
+
+    if (!m_sysPort->isOpen)
+    {
+        m_sysPort->open();                              // A USB serial adapter that was unplugged comes back closed
+    }
+
+    if (!device.isConnected())
+    {
+        device.connect(m_sysPort, m_meta);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void LinkSupervisor::callbackAhrs(uint64_t timeUs, real_t headingRad)
+{
+    if (m_fromAhrs)
+    {
+        m_lastDataUs = Platform::getTimeUs();
+    }
+}
+//--------------------------------------------------------------------------------------------------
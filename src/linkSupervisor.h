@@ -0,0 +1,67 @@
+#ifndef LINKSUPERVISOR_H_
+#define LINKSUPERVISOR_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "devices/device.h"
+#include "metrics.h"
+#include <string>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Watches the link to one device and gets it back quickly without waiting for a full rediscovery.
+    // The link is lost when the device disconnects, its port is removed or the watched data stops for
+    // stallIntervals sample intervals. The App watches its device's main data, fed to dataReceived(), at
+    // its set interval or one measured from the data, or the AHRS from slotAhrs. The port is then
+    // reopened if needed and the device reconnected at the last baudrate or IP address and port,
+    // retrying with backoff until it answers or giveUpMs passes. A stalled device the SDK still has
+    // connected is dropped first, see reconnect(). Time from loss to reconnect goes to the
+    // isl_link_recovery_seconds histogram.
+    class LinkSupervisor
+    {
+    public:
+        static constexpr uint_t stallIntervals = 4;
+        static constexpr uint_t minStallMs = 250;
+        static constexpr uint_t firstRetryMs = 100;
+        static constexpr uint_t maxRetryMs = 2000;
+        static constexpr uint_t giveUpMs = 15000;                           // Left to rediscovery after this
+
+        LinkSupervisor();
+        void setName(const std::string& deviceName);
+        void setExpectedIntervalMs(uint_t intervalMs, bool_t fromAhrs);    // Samples from slotAhrs or dataReceived(), 0 turns stall detection off
+        void setMeasuredInterval();                                         // Samples from dataReceived() at an interval measured from them
+        void setConnection(Device& device);                                 // Remember the port and settings the device is connected with
+        void dataReceived();                                                // A sample of the device's main data
+        void linkLost(const char* reason);
+        bool_t connected(Device& device);                                   // Returns true if this ends an outage
+        bool_t recovering() const { return m_recovering; }
+        void run(Device& device);
+
+        Slot<uint64_t, real_t> slotAhrs{ this, &LinkSupervisor::callbackAhrs };
+
+    private:
+        std::string m_name;
+        SysPort::SharedPtr m_sysPort;
+        ConnectionMeta m_meta;
+        uint_t m_expectedMs;
+        bool_t m_fromAhrs;
+        bool_t m_measured;
+        uint64_t m_lastDataUs;                                              // 0 until data arrives, so stalls aren't reported before the first sample
+        bool_t m_recovering;
+        uint64_t m_lostUs;
+        uint64_t m_nextRetryUs;
+        uint_t m_retryMs;
+        uint_t m_attempts;
+        bool_t m_portClosed;                                                // Closed this outage to drop a stalled connection
+        Metrics::Histogram* m_recoveryTime;
+        Metrics::Counter* m_losses;
+
+        void reconnect(Device& device);
+        void callbackAhrs(uint64_t timeUs, real_t headingRad);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -12,17 +12,85 @@
 #include "ism3dApp.h"
 #include "sonarApp.h"
 #include "gpsApp.h"
+#include "sonarMosaic.h"
+#include "sonarFusion.h"
+#include "deviceRegistry.h"
+#include "discoveryCache.h"
+#include "discoveryScheduler.h"
+#include "metrics.h"
+#include "slotProfiler.h"
+#include "portCapture.h"
+#include "rateController.h"
+#include "jitterBenchmark.h"
+#include "dispatchBenchmark.h"
+#include "nmeaBenchmark.h"
+#include "telemetryServer.h"
+#include "columnarExport.h"
+#include "deviceFarm.h"
+#include "heapMonitor.h"
+#include "pipeline.h"
+#include "timeSeriesStore.h"
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
 
 using namespace IslSdk;
 
 //------------------------------------------- Globals ----------------------------------------------
 
-std::vector<App*> apps;
 std::shared_ptr<GpsApp> gpsApp;
+SonarMosaic mosaic;                                                             // Fed with positions from the GPS, heading from one AHRS and pings from any sonar
+SonarFusion fusion;                                                             // All sonars composited in the vehicle frame
+
+// Mounting pose of each sonar, and of the heading source if it's turned, by part and serial number. x forward
+// and y starboard in meters and the rotation of the device's zero angle from vehicle forward. Devices not in
+// the table are placed at the origin facing forward.
+struct DeviceMount
+{
+    uint16_t pn;
+    uint16_t sn;
+    SonarFusion::Mount mount;
+};
+const DeviceMount deviceMounts[] = { { 1193, 1, { 0.5, 0.0, 0.0 } }, { 1193, 2, { -0.5, 0.0, 3.14159265358979323846 } } };
+uint_t headingPn = 0;                                                           // Device whose AHRS heads the mosaic, set with --heading or the first found with one
+uint_t headingSn = 0;
+uint_t nmeaCompareSentences = 0;                                                // Set by --nmea-compare, timed through the first GPS found
+uint_t serialDevices = 0;                                                       // Expected on a serial port not in the cache, 0 sweeps every baudrate
+const uint_t sonarTextureSize[] = { 500, 400 };                                // Static memory builds fix each sonar's texture at this, data points by angles
+DiscoveryCache discoveryCache;                                                  // Last known port settings of each device for a fast start
+DiscoveryScheduler discoveryScheduler;                                          // Orders serial sweeps by past success and times discovery per port
+PortCapture portCapture;                                                        // Raw port bytes to a pcapng file for debugging the bus
+
+// Each port's traffic counters, looked up once in newPort() so portStats() neither allocates nor locks
+struct PortCounters
+{
+    Metrics::Counter* txBytes;
+    Metrics::Counter* rxBytes;
+    Metrics::Counter* badPackets;
+};
+std::unordered_map<const SysPort*, PortCounters> portCounters;
+RateController rateController;                                                  // Shares each serial link between the sensor streams of the devices on it
+DeviceFarm deviceFarm;                                                          // Simulated devices over loopback for App dispatch load tests
+DeviceRegistry registry;                                                        // Owns an App for each device, keyed by PID, PN and SN, declared after what the Apps use
+
+// Run with --realtime [cpu] to pin the SDK thread to a CPU with SCHED_FIFO priority and locked memory,
+// or --jitter [seconds] [load threads] to measure the loop timing with and without those settings,
+// or --telemetry [subscribers] [seconds] to measure telemetry throughput and latency to local subscribers,
+// or --nmea [sentences] [fuzz cases] to measure the NMEA parser's sentences per second and fuzz it,
+// or --nmea-compare [sentences] to time it against the SDK's GpsDevice parsing once a GPS is found,
+// or --app-load [devices] [seconds per step] [rate scale] to load test App dispatch with simulated devices.
+// Static memory builds treat everything after heapSealMs as steady state, --strict-heap [seconds] sets
+// that time and aborts on an allocation in a callback after it.
+void enterRealTime(int_t cpu);
+int_t runJitterBenchmark(uint_t seconds, uint_t loadThreads, int_t cpu);
 
 // These functions are the callbacks.
 void newPort(const SysPort::SharedPtr& sysPort);
+void discoverAll(SysPort& sysPort);
 void newDevice(const Device::SharedPtr& device, const SysPort::SharedPtr& sysPort, const ConnectionMeta& meta);
+void newFarmDevice(const Device::SharedPtr& device);
+std::unique_ptr<App> createApp(const Device::SharedPtr& device, const std::string& portName);
+SonarFusion::Mount deviceMount(const Device::Info& info);
 void newNmeaDevice(const NmeaDevice::SharedPtr& device, const SysPort::SharedPtr& sysPort, const ConnectionMeta& meta);
 void portOpen(SysPort& sysPort, bool_t failed);
 void portClosed(SysPort& sysPort);
@@ -37,6 +105,7 @@ void portDeleted(SysPort& sysPort);
 Slot<const SysPort::SharedPtr&> slotNewPort(&newPort);
 Slot<const Device::SharedPtr&, const SysPort::SharedPtr&, const ConnectionMeta&> slotNewDevice(&newDevice);
 Slot<const NmeaDevice::SharedPtr&, const SysPort::SharedPtr&, const ConnectionMeta&> slotNewNmeaDevice(&newNmeaDevice);
+Slot<const Device::SharedPtr&> slotNewFarmDevice(&newFarmDevice);
 Slot<SysPort&, bool_t> slotPortOpen(&portOpen);
 Slot<SysPort&> slotPortClosed(&portClosed);
 Slot<SysPort&, uint_t, uint_t, uint_t> slotPortStats(&portStats);
@@ -49,25 +118,143 @@ Slot<SysPort&> slotPortDeleted(&portDeleted);
 //--------------------------------------------------------------------------------------------------
 int main(int argc, char** argv)
 {
-    Platform::setTerminalMode();
     const std::string appPath = Platform::getExePath(argv[0]);
+    bool_t realTime = false;
+    int_t cpu = 0;
+    uint_t heapSealMs = 30000;
+    bool_t strictHeap = false;
+    uint_t farmDevices = 0;
+    uint_t farmStepSeconds = 0;
+    real_t farmRateScale = 1.0;
+
+    for (int_t i = 1; i < argc; i++)
+    {
+        const bool_t hasValue = i + 1 < argc && argv[i + 1][0] != '-';
+
+        if (strcmp(argv[i], "--realtime") == 0)
+        {
+            realTime = true;
+            cpu = hasValue ? atoi(argv[++i]) : cpu;
+        }
+        else if (strcmp(argv[i], "--jitter") == 0)
+        {
+            const uint_t seconds = hasValue ? atoi(argv[++i]) : 10;
+            const uint_t loadThreads = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 0;
+            return runJitterBenchmark(seconds, loadThreads, cpu);
+        }
+        else if (strcmp(argv[i], "--telemetry") == 0)
+        {
+            const uint_t subscribers = hasValue ? atoi(argv[++i]) : 4;
+            const uint_t seconds = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 5;
+            TelemetryServer::benchmark(subscribers, seconds);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--dispatch") == 0)
+        {
+            DispatchBenchmark::run(hasValue ? atoi(argv[++i]) : 10000000);
+            return 0;
+        }
+        else if (strcmp(argv[i], "--nmea") == 0)
+        {
+            const uint_t sentences = hasValue ? atoi(argv[++i]) : 1000000;
+            const uint_t fuzzCases = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 1000000;
+            return NmeaBenchmark::run(sentences, fuzzCases) ? 0 : 1;
+        }
+        else if (strcmp(argv[i], "--nmea-compare") == 0)
+        {
+            nmeaCompareSentences = hasValue ? atoi(argv[++i]) : 1000000;
+        }
+        else if (strcmp(argv[i], "--heading") == 0)                          // Part and serial number of the AHRS that heads the mosaic, eg. 1193.1
+        {
+            char* end = nullptr;
+            headingPn = hasValue ? strtoul(argv[++i], &end, 10) : 0;
+            headingSn = end && *end == '.' ? strtoul(end + 1, nullptr, 10) : 0;
+        }
+        else if (strcmp(argv[i], "--expect") == 0)                           // Devices on each new serial port, eg. 1 for point to point links
+        {
+            serialDevices = hasValue ? atoi(argv[++i]) : serialDevices;
+        }
+        else if (strcmp(argv[i], "--strict-heap") == 0)
+        {
+            strictHeap = true;
+            heapSealMs = hasValue ? atoi(argv[++i]) * 1000 : heapSealMs;
+        }
+        else if (strcmp(argv[i], "--app-load") == 0)
+        {
+            farmDevices = hasValue ? atoi(argv[++i]) : 50;
+            farmStepSeconds = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[++i]) : 10;
+            farmRateScale = i + 1 < argc && argv[i + 1][0] != '-' ? atof(argv[++i]) : farmRateScale;
+        }
+    }
+
+    if (realTime)
+    {
+        enterRealTime(cpu);                                                     // Before the SDK is created so its memory is locked and prefaulted
+    }
+
+    Platform::setTerminalMode();
+    HeapMonitor::global().start(heapSealMs, strictHeap);                        // Devices found and App buffers sized before then
+    discoveryCache.start(appPath + "discoveryCache.txt");                       // Before the SDK is created so startup time includes finding the ports
+    discoveryScheduler.start(appPath + "discoveryHistory.txt");
+    Metrics::global().setup(appPath + "sdkExample.prom", appPath + "metrics.sock", 10000);  // Prometheus textfile every 10s, or read the socket at any time
+    TelemetryServer::global().setup(33010, appPath + "telemetry.sock");        // Subscribe on UDP 127.0.0.1:33010 or the Unix socket
+    Pipeline::global().start(appPath + "pipeline.txt", 2);                      // Processing graph on 2 threads, if there's a file
+    TimeSeriesStore::global().setup(appPath, TimeSeriesStore::defaultConfig);   // Mission history of depth, altitude, heading and temperature, carried on from the last run
     Sdk sdk;                                                                    // Create the SDK instance
+    mosaic.setup(appPath, 0.1, HeapMonitor::enabled ? 4 : 16);                  // 10cm pixels, at most 16 tiles (64MB) held in memory, 4 allocated up front if static
+    fusion.setup(1000, 1000, 0.1, SonarFusion::Blend::Max, 2);                  // 100m square about the vehicle, rendered on 2 threads and this one
+    portCapture.select({});                                                     // Capture every port, or list names eg. { "COM3", "NETWORK" }
 
-    Debug::log(Debug::Severity::Notice, "Main", "Impact Subsea SDK version %s    press\033[31m x\033[36m to exit", sdk.version.c_str());
+    Debug::log(Debug::Severity::Notice, "Main", "Impact Subsea SDK version %s    press\033[31m x\033[36m to exit,\033[31m P\033[36m to profile,\033[31m C\033[36m to capture,\033[31m E\033[36m to export,\033[31m L\033[36m to reload the pipeline,\033[31m T\033[36m to plot", sdk.version.c_str());
     Platform::sleepMs(1000);
 
     sdk.ports.onNew.connect(slotNewPort);                                       // Connect to the new port signal
     sdk.devices.onNew.connect(slotNewDevice);                                   // Connect to the new device signal
     sdk.nmeaDevices.onNew.connect(slotNewNmeaDevice);                           // Connect to the new NMEA device signal
 
+    if (farmDevices)                                                            // App dispatch load test, the report for each step is logged and profiled
+    {
+        deviceFarm.onNew.connect(slotNewFarmDevice);
+        deviceFarm.start({ 50 * farmRateScale, 10 * farmRateScale, 20 * farmRateScale, 20 * farmRateScale, 500 });
+        SlotProfiler::global().start(3600000, 8);
+        deviceFarm.startLoadTest(farmDevices, farmStepSeconds);
+    }
+
     // Serial over Lan ports can be created using the following function, change the IP address and port to suit your needs
     // sdk.ports.createSol("SOL1", false, true, Utils::ipToUint(192, 168, 1, 215), 1001);
 
 
+    const uint_t loopPeriodUs = 40000;
+    uint64_t wakeUs = Platform::getTimeUs();
+
     while (1)
     {
-        Platform::sleepMs(40);                                                  // Sleep for 40ms to limit CPU usage
+        // Run every 40ms to limit CPU usage. Sleeping to an absolute time keeps the period steady however
+        // long the loop body takes, and starts again from now if the loop ever overruns.
+        wakeUs += loopPeriodUs;
+        if (wakeUs < Platform::getTimeUs())
+        {
+            wakeUs = Platform::getTimeUs() + loopPeriodUs;
+        }
+        Platform::sleepUntilUs(wakeUs);
+
         sdk.run();                                                              // Run the SDK. This should be called regularly to process data
+        registry.run();                                                         // Release Apps whose device was deleted and hasn't come back
+        rateController.run();
+        Metrics::global().run();
+        TelemetryServer::global().run();
+        ColumnarExport::global().run();
+        Pipeline::global().run();
+        TimeSeriesStore::global().run();
+        SlotProfiler::global().run();
+        deviceFarm.run();
+        fusion.run();                                                           // After everything that adds pings
+        HeapMonitor::global().run();
+
+        if (farmDevices && deviceFarm.loadTestFinished())
+        {
+            break;
+        }
 
         if (Platform::keyboardPressed())                                        // Check if a key has been pressed and do some example tasks
         {
@@ -77,18 +264,88 @@ int main(int argc, char** argv)
             {
                 break;
             }
-            else
+            else if (key == 'P')                                                // Start or stop slot profiling, stopping writes a Chrome trace
+            {
+                if (SlotProfiler::global().running())
+                {
+                    SlotProfiler::global().stop();
+                    SlotProfiler::global().writeTrace(appPath + "slotTrace.json");
+                }
+                else
+                {
+                    SlotProfiler::global().start(5000, 8);
+                }
+            }
+            else if (key == 'C')                                                // Start or stop capturing the selected ports to a pcapng file
             {
-                for (App* app : apps)
+                if (portCapture.running())
                 {
-                    app->doTask(key, appPath);
+                    portCapture.stop();
+                }
+                else
+                {
+                    portCapture.start(appPath + "ports.pcapng");
                 }
             }
+            else if (key == 'E')                                                // Start or stop exporting sensor data to Parquet files, stopping finishes the files
+            {
+                if (ColumnarExport::global().running())
+                {
+                    ColumnarExport::global().stop();
+                }
+                else
+                {
+                    ColumnarExport::global().start(appPath);
+                }
+            }
+            else if (key == 'L')                                                // Read pipeline.txt again, the queued batches are finished first
+            {
+                Pipeline::global().start(appPath + "pipeline.txt", 2);
+            }
+            else if (key == 'T')                                                // Every series over its whole time at 1000 points, as a plot would ask for it
+            {
+                TimeSeriesStore::global().writeCsv(appPath + "timeSeries.csv", 1000);
+            }
+            else
+            {
+                registry.doTask(key, appPath);                                  // Keys 0 to 9 select the device the other keys go to
+            }
         }
     }
     return 0;
 }
 //--------------------------------------------------------------------------------------------------
+void enterRealTime(int_t cpu)
+{
+    // Lock memory first so the prefaulted pages stay resident
+    const bool_t locked = Platform::lockMemory();
+    Platform::prefaultStack(512 * 1024);
+    Platform::prefaultHeap(64 * 1024 * 1024);
+    const bool_t pinned = Platform::setThreadAffinity(cpu);
+    const bool_t fifo = Platform::setThreadRealTime(80);
+
+    Debug::log(Debug::Severity::Notice, "Main", "Real time mode: CPU %d %s, SCHED_FIFO %s, memory lock %s", cpu, pinned ? "pinned" : "not pinned",
+               fifo ? "priority 80" : "refused", locked ? "ok" : "refused");
+}
+//--------------------------------------------------------------------------------------------------
+int_t runJitterBenchmark(uint_t seconds, uint_t loadThreads, int_t cpu)
+{
+    const uint_t periodUs = 1000;
+    std::unique_ptr<JitterBenchmark::Result> normal = std::make_unique<JitterBenchmark::Result>();
+    std::unique_ptr<JitterBenchmark::Result> realTime = std::make_unique<JitterBenchmark::Result>();
+
+    Debug::log(Debug::Severity::Notice, "Main", "Jitter benchmark, %u s each way with %u load threads", FMT_U(seconds), FMT_U(loadThreads));
+
+    // Normal first as the real time settings can't be undone
+    JitterBenchmark::measure(*normal, periodUs, seconds * 1000, loadThreads);
+    enterRealTime(cpu);
+    JitterBenchmark::measure(*realTime, periodUs, seconds * 1000, loadThreads);
+
+    JitterBenchmark::log("Normal", *normal, periodUs);
+    JitterBenchmark::log("Real time", *realTime, periodUs);
+    return 0;
+}
+//--------------------------------------------------------------------------------------------------
 // This function is called when a new port is found. It's address has been initialised inside the slot class defined above.
 void newPort(const SysPort::SharedPtr& sysPort)
 {
@@ -101,6 +358,17 @@ void newPort(const SysPort::SharedPtr& sysPort)
     sysPort->onDiscoveryFinished.connect(slotPortDiscoveryFinished);
     sysPort->onDelete.connect(slotPortDeleted);
 
+    const std::string labels = "port=\"" + sysPort->name + "\"";
+    Metrics& metrics = Metrics::global();
+    portCounters[sysPort.get()] = { &metrics.counter("isl_port_tx_bytes_total", labels, "Bytes sent on the port"),
+                                    &metrics.counter("isl_port_rx_bytes_total", labels, "Bytes received on the port"),
+                                    &metrics.counter("isl_port_bad_packets_total", labels, "Packets received with a bad CRC or framing") };
+
+    if (portCapture.isSelected(sysPort->name))
+    {
+        sysPort->onData.connect(slotPortData);                                  // Only written to the file while a capture is running
+    }
+
     Debug::log(Debug::Severity::Info, "Main", "Found new SysPort %s", sysPort->name.c_str());
 
     /*
@@ -114,24 +382,41 @@ void newPort(const SysPort::SharedPtr& sysPort)
         sysPort->discoverIslDevices(0, 1336, 135);        // a value of 0 means any PID, part number or serial number
      */
 
+    // Devices found on this port last time are probed for first at their cached settings. Only if there
+    // are none, or one of them doesn't answer, is the full sweep in discoverAll() run.
+    if (sysPort->type == SysPort::Type::Serial)
+    {
+        const uint_t cached = discoveryCache.cachedCount(sysPort->name);
+        discoveryScheduler.setExpectedCount(*sysPort, cached ? cached : serialDevices);   // A full sweep unless told otherwise, so RS485 multi-drop buses are found
+    }
+
+    if (!discoveryCache.discover(*sysPort))
+    {
+        discoverAll(*sysPort);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void discoverAll(SysPort& sysPort)
+{
     // The following code will start discovery on the port depending on the port type.
     // It casts the SysPort to the derived type and call the discover function for that type.
 
-    if (sysPort->type == SysPort::Type::Net)
+    if (sysPort.type == SysPort::Type::Net)
     {
-        NetPort& port = reinterpret_cast<NetPort&>(*sysPort);
+        NetPort& port = reinterpret_cast<NetPort&>(sysPort);
 
-        if (sysPort->name == "NETWORK")
+        if (sysPort.name == "NETWORK")
         {
             uint32_t ipAddress = Utils::ipToUint(192, 168, 1, 255);
             port.discoverIslDevices(0xffff, 0xffff, 0xffff, ipAddress, 33005, 2000);    // These are the default parameters, same as port.discoverIslDevices()
         }
     }
-    else if (sysPort->type == SysPort::Type::Serial)
+    else if (sysPort.type == SysPort::Type::Serial)
     {
-        UartPort& port = reinterpret_cast<UartPort&>(*sysPort);
-        // This call is the same as calling port.discoverIslDevices(pid, pn, sn, baudrate, timeout) multiple times with different baudrates
-        port.discoverIslDevices();
+        UartPort& port = reinterpret_cast<UartPort&>(sysPort);
+        // port.discoverIslDevices() is the same as calling port.discoverIslDevices(pid, pn, sn, baudrate, timeout) multiple times with
+        // different baudrates. The scheduler makes those calls itself, most likely baudrate first, and stops when the port is full.
+        discoveryScheduler.sweep(port);
 
         // To discover NMEA devices, call port.discoverNmeaDevices() or port.discoverNmeaDevices(baudrate, timeout)
         // calling this function will stop discovery of ISL devices
@@ -141,44 +426,102 @@ void newPort(const SysPort::SharedPtr& sysPort)
 // This function is called when a new Device is found. It's address has been initialised inside the slot class defined above.
 void newDevice(const Device::SharedPtr& device, const SysPort::SharedPtr& sysPort, const ConnectionMeta& meta)
 {
-    App* app = nullptr;
+    discoveryCache.deviceFound(*device, *sysPort, meta);
+    discoveryScheduler.deviceFound(*device, *sysPort, meta);
+    rateController.deviceFound(*device, *sysPort, meta);
+
+    if (registry.attach(device))                                                // Rediscovered, the existing App has been given the new device
+    {
+        device->connect();
+        return;
+    }
+
+    std::unique_ptr<App> app = createApp(device, sysPort->name);
+
+    if (app)
+    {
+        app->setRateController(&rateController);
+        registry.add(device, std::move(app));
+        device->connect();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+// This function is called when the device farm finds a simulated device. It has no port to connect.
+void newFarmDevice(const Device::SharedPtr& device)
+{
+    std::unique_ptr<App> app = createApp(device, "FARM");
+
+    app->setRateController(&rateController);
+    registry.add(device, std::move(app));
+}
+//--------------------------------------------------------------------------------------------------
+std::unique_ptr<App> createApp(const Device::SharedPtr& device, const std::string& portName)
+{
+    std::unique_ptr<App> app;
 
     switch (device->info.pid)
     {
     case Device::Pid::Isa500:
-        Debug::log(Debug::Severity::Notice, "Main", "Found ISA500 altimeter %04u.%04u on port %s", FMT_U(device->info.pn), FMT_U(device->info.sn), sysPort->name.c_str());
-        app = new Isa500App();
+        Debug::log(Debug::Severity::Notice, "Main", "Found ISA500 altimeter %04u.%04u on port %s", FMT_U(device->info.pn), FMT_U(device->info.sn), portName.c_str());
+        app = std::make_unique<Isa500App>();
         break;
 
     case Device::Pid::Isd4000:
-        Debug::log(Debug::Severity::Notice, "Main", "Found ISD4000 depth sensor %04u.%04u on port %s", FMT_U(device->info.pn), FMT_U(device->info.sn), sysPort->name.c_str());
-        app = new Isd4000App();
+        Debug::log(Debug::Severity::Notice, "Main", "Found ISD4000 depth sensor %04u.%04u on port %s", FMT_U(device->info.pn), FMT_U(device->info.sn), portName.c_str());
+        app = std::make_unique<Isd4000App>();
         break;
 
     case Device::Pid::Ism3d:
-        Debug::log(Debug::Severity::Notice, "Main", "Found ISM3D ahrs sensor %04u.%04u on port %s", FMT_U(device->info.pn), FMT_U(device->info.sn), sysPort->name.c_str());
-        app = new Ism3dApp();
+        Debug::log(Debug::Severity::Notice, "Main", "Found ISM3D ahrs sensor %04u.%04u on port %s", FMT_U(device->info.pn), FMT_U(device->info.sn), portName.c_str());
+        app = std::make_unique<Ism3dApp>();
         break;
 
     case Device::Pid::Sonar:
-        Debug::log(Debug::Severity::Notice, "Main", "Found Sonar %04u.%04u on port %s", FMT_U(device->info.pn), FMT_U(device->info.sn), sysPort->name.c_str());
-        app = new SonarApp();
+    {
+        Debug::log(Debug::Severity::Notice, "Main", "Found Sonar %04u.%04u on port %s", FMT_U(device->info.pn), FMT_U(device->info.sn), portName.c_str());
+        std::unique_ptr<SonarApp> sonarApp = std::make_unique<SonarApp>();
+        const SonarFusion::Mount mount = deviceMount(device->info);
+        sonarApp->setMosaic(&mosaic, mount.rotationRad);
+        sonarApp->setFusion(&fusion, mount);
+
+        if (HeapMonitor::enabled)
+        {
+            sonarApp->fixTextureSize(sonarTextureSize[0], sonarTextureSize[1]);
+        }
+        app = std::move(sonarApp);
         break;
+    }
 
     default:
-        Debug::log(Debug::Severity::Notice, "Main", "Found device %04u.%04u on port %s", device->info.pn, device->info.sn, sysPort->name.c_str());
-        app = new App("Device");
+        Debug::log(Debug::Severity::Notice, "Main", "Found device %04u.%04u on port %s", device->info.pn, device->info.sn, portName.c_str());
+        app = std::make_unique<App>("Device");
         break;
     }
 
-    if (app)
-    {
-        app->setDevice(device);
-        apps.push_back(app);
+    // Every device with an AHRS has a heading, only one is given to the mosaic so they aren't interleaved
+    const bool_t isHeadingSource = (headingPn == 0 && headingSn == 0) || (device->info.pn == headingPn && device->info.sn == headingSn);
 
-        device->connect();
+    if (app && isHeadingSource && app->setHeadingTarget(&mosaic.slotHeading))
+    {
+        headingPn = device->info.pn;
+        headingSn = device->info.sn;
+        mosaic.setHeadingMount(deviceMount(device->info).rotationRad);
+        Debug::log(Debug::Severity::Notice, "Main", "Mosaic heading from %04u.%04u", FMT_U(device->info.pn), FMT_U(device->info.sn));
     }
 
+    return app;
+}
+//--------------------------------------------------------------------------------------------------
+SonarFusion::Mount deviceMount(const Device::Info& info)
+{
+    for (const DeviceMount& m : deviceMounts)
+    {
+        if (m.pn == info.pn && m.sn == info.sn)
+        {
+            return m.mount;
+        }
+    }
+    return SonarFusion::Mount{ 0, 0, 0 };
 }
 //--------------------------------------------------------------------------------------------------
 // This function is called when a new Nmea device is found. It's address has been initialised inside the slot class defined above.
@@ -187,7 +530,16 @@ void newNmeaDevice(const NmeaDevice::SharedPtr& device, const SysPort::SharedPtr
     if (device->type == NmeaDevice::Type::Gps)
     {
         Debug::log(Debug::Severity::Notice, "Main", "Found GPS device on port %s", sysPort->name.c_str());
-        gpsApp = std::make_shared<GpsApp>("GPS");
+        if (nmeaCompareSentences)
+        {
+            NmeaBenchmark::compare(reinterpret_cast<GpsDevice&>(*device), nmeaCompareSentences);
+            nmeaCompareSentences = 0;
+        }
+        if (gpsApp == nullptr)
+        {
+            gpsApp = std::make_shared<GpsApp>("GPS");
+            gpsApp->onPosition.connect(mosaic.slotPosition);
+        }
         gpsApp->setDevice(device);
     }
 }
@@ -212,11 +564,23 @@ void portClosed(SysPort& sysPort)
 void portStats(SysPort& sysPort, uint_t txBytes, uint_t rxBytes, uint_t badPackets)
 {
     //Debug::log(Debug::Severity::Info, "Main", "%s TX:%u, RX:%u, Bad packets:%u", sysPort.name.c_str(), FMT_U(txBytes), FMT_U(rxBytes), FMT_U(badPackets));
+
+    // Counts are since the last portStats event
+    auto it = portCounters.find(&sysPort);
+    if (it != portCounters.end())
+    {
+        it->second.txBytes->add(txBytes);
+        it->second.rxBytes->add(rxBytes);
+        it->second.badPackets->add(badPackets);
+    }
+
+    rateController.portStats(sysPort, txBytes, rxBytes);
 }
 //--------------------------------------------------------------------------------------------------
 void portDiscoveryStarted(SysPort& sysPort, AutoDiscovery::Type type)
 {
     Debug::log(Debug::Severity::Info, "Main", "%s discovery started", sysPort.name.c_str());
+    discoveryScheduler.discoveryStarted(sysPort);
 }
 //--------------------------------------------------------------------------------------------------
 void portDiscoveryEvent(SysPort& sysPort, const ConnectionMeta& meta, AutoDiscovery::Type type, uint_t discoveryCount)
@@ -235,15 +599,25 @@ void portDiscoveryEvent(SysPort& sysPort, const ConnectionMeta& meta, AutoDiscov
 void portDiscoveryFinished(SysPort& sysPort, AutoDiscovery::Type type, uint_t discoveryCount, bool_t wasCancelled)
 {
     Debug::log(Debug::Severity::Info, "Main", "%s Discovery Finished", sysPort.name.c_str());
+
+    if (type == AutoDiscovery::Type::Isl)
+    {
+        if (discoveryCache.discoveryFinished(sysPort))
+        {
+            discoverAll(sysPort);
+        }
+        discoveryScheduler.discoveryFinished(sysPort);
+    }
 }
 //--------------------------------------------------------------------------------------------------
 void portData(SysPort& sysPort, const uint8_t* data, uint_t size)
 {
-    Debug::log(Debug::Severity::Info, "Main", "Port data, size: %u", size);
+    portCapture.write(sysPort, data, size);
 }
 //--------------------------------------------------------------------------------------------------
 void portDeleted(SysPort& sysPort)
 {
     Debug::log(Debug::Severity::Warning, "Main", "Port %s deleted", sysPort.name.c_str());
+    portCounters.erase(&sysPort);                                               // The counters stay registered for a port of the same name
 }
 //--------------------------------------------------------------------------------------------------
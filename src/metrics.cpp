@@ -0,0 +1,373 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "metrics.h"
+#include "platform/debug.h"
+#include <algorithm>
+#include <cstdio>
+
+#if defined(OS_UNIX)
+    #include <cerrno>
+    #include <fcntl.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#elif defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+static inline uint_t highestBit(uint64_t v)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return idx;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+//--------------------------------------------------------------------------------------------------
+Metrics::Histogram::Histogram() : m_sum(0)
+{
+    for (std::atomic<uint64_t>& bucket : m_buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+uint_t Metrics::Histogram::index(uint64_t value)
+{
+    if (value < subBuckets)
+    {
+        return static_cast<uint_t>(value);
+    }
+
+    // The top subBucketBits + 1 bits of the value, the leading one selects the power of two
+    const uint_t shift = highestBit(value) - subBucketBits;
+    return (shift + 1) * subBuckets + static_cast<uint_t>((value >> shift) & (subBuckets - 1));
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Metrics::Histogram::upperBound(uint_t idx)
+{
+    if (idx < subBuckets)
+    {
+        return idx;
+    }
+
+    const uint_t shift = idx / subBuckets - 1;
+    const uint64_t lower = static_cast<uint64_t>(subBuckets + idx % subBuckets) << shift;
+    return lower + ((static_cast<uint64_t>(1) << shift) - 1);
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Metrics::Histogram::count() const
+{
+    uint64_t n = 0;
+
+    for (const std::atomic<uint64_t>& bucket : m_buckets)
+    {
+        n += bucket.load(std::memory_order_relaxed);
+    }
+    return n;
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Metrics::Histogram::countBelow(uint64_t value) const
+{
+    uint64_t n = 0;
+
+    for (uint_t i = 0; i < bucketCount && upperBound(i) <= value; i++)
+    {
+        n += m_buckets[i].load(std::memory_order_relaxed);
+    }
+    return n;
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Metrics::Histogram::quantile(real_t q) const
+{
+    const uint64_t total = count();
+    const uint64_t target = static_cast<uint64_t>(q * total + 0.5);
+    uint64_t n = 0;
+
+    for (uint_t i = 0; i < bucketCount; i++)
+    {
+        n += m_buckets[i].load(std::memory_order_relaxed);
+        if (n >= target && n)
+        {
+            return upperBound(i);
+        }
+    }
+    return 0;
+}
+//--------------------------------------------------------------------------------------------------
+Metrics::Metrics() : m_periodMs(0), m_lastWriteUs(0), m_socket(-1)
+{
+}
+//--------------------------------------------------------------------------------------------------
+Metrics::~Metrics()
+{
+    closeSocket();
+}
+//--------------------------------------------------------------------------------------------------
+Metrics& Metrics::global()
+{
+    static Metrics metrics;
+    return metrics;
+}
+//--------------------------------------------------------------------------------------------------
+Metrics::Metric& Metrics::find(Type type, const std::string& name, const std::string& labels, const std::string& help)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (std::unique_ptr<Metric>& metric : m_metrics)
+    {
+        if (metric->type == type && metric->name == name && metric->labels == labels)
+        {
+            return *metric;
+        }
+    }
+
+    std::unique_ptr<Metric> metric = std::make_unique<Metric>();
+    metric->type = type;
+    metric->name = name;
+    metric->labels = labels;
+    metric->help = help;
+
+    switch (type)
+    {
+    case Type::Counter:
+        metric->counter = std::make_unique<Counter>();
+        break;
+    case Type::Gauge:
+        metric->gauge = std::make_unique<Gauge>();
+        break;
+    case Type::Histogram:
+        metric->histogram = std::make_unique<Histogram>();
+        break;
+    }
+
+    // Kept ordered by name, in registration order within a name, so the export needs no sorting
+    auto it = std::upper_bound(m_metrics.begin(), m_metrics.end(), name, [](const std::string& n, const std::unique_ptr<Metric>& m) { return n < m->name; });
+    return **m_metrics.insert(it, std::move(metric));
+}
+//--------------------------------------------------------------------------------------------------
+Metrics::Counter& Metrics::counter(const std::string& name, const std::string& labels, const std::string& help)
+{
+    return *find(Type::Counter, name, labels, help).counter;
+}
+//--------------------------------------------------------------------------------------------------
+Metrics::Gauge& Metrics::gauge(const std::string& name, const std::string& labels, const std::string& help)
+{
+    return *find(Type::Gauge, name, labels, help).gauge;
+}
+//--------------------------------------------------------------------------------------------------
+Metrics::Histogram& Metrics::histogram(const std::string& name, const std::string& labels, const std::string& help)
+{
+    return *find(Type::Histogram, name, labels, help).histogram;
+}
+//--------------------------------------------------------------------------------------------------
+void Metrics::setup(const std::string& textFileName, const std::string& socketPath, uint_t periodMs)
+{
+    closeSocket();
+    m_textFileName = textFileName;
+    m_tmpFileName = textFileName + ".tmp";
+    m_socketPath = socketPath;
+    m_periodMs = periodMs;
+    openSocket();
+}
+//--------------------------------------------------------------------------------------------------
+void Metrics::run()
+{
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    if (!m_textFileName.empty() && nowUs - m_lastWriteUs >= m_periodMs * static_cast<uint64_t>(1000))
+    {
+        m_lastWriteUs = nowUs;
+        writeTextFile();
+    }
+    serveSocket();
+}
+//--------------------------------------------------------------------------------------------------
+std::string Metrics::exposition() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    expose();
+    return m_text;
+}
+//--------------------------------------------------------------------------------------------------
+void Metrics::expose() const
+{
+    // Formatted into m_text which keeps its capacity, so after the first export this doesn't allocate
+    char line[512];
+
+    m_text.clear();
+
+    for (uint_t i = 0; i < m_metrics.size(); i++)
+    {
+        const Metric& m = *m_metrics[i];
+        const char* open = m.labels.empty() ? "" : "{";
+        const char* close = m.labels.empty() ? "" : "}";
+
+        if (i == 0 || m_metrics[i - 1]->name != m.name)
+        {
+            const char* typeStr[] = { "counter", "gauge", "histogram" };
+            if (!m.help.empty())
+            {
+                snprintf(line, sizeof(line), "# HELP %s %s\n", m.name.c_str(), m.help.c_str());
+                m_text += line;
+            }
+            snprintf(line, sizeof(line), "# TYPE %s %s\n", m.name.c_str(), typeStr[static_cast<uint_t>(m.type)]);
+            m_text += line;
+        }
+
+        switch (m.type)
+        {
+        case Type::Counter:
+            snprintf(line, sizeof(line), "%s%s%s%s %llu\n", m.name.c_str(), open, m.labels.c_str(), close, static_cast<unsigned long long>(m.counter->value()));
+            m_text += line;
+            break;
+
+        case Type::Gauge:
+            snprintf(line, sizeof(line), "%s%s%s%s %.9g\n", m.name.c_str(), open, m.labels.c_str(), close, static_cast<double>(m.gauge->value()));
+            m_text += line;
+            break;
+
+        case Type::Histogram:
+        {
+            // Powers of two from 1us to 17s give a fixed set of le labels across scrapes
+            const char* comma = m.labels.empty() ? "" : ",";
+            for (uint_t k = 10; k <= 34; k++)
+            {
+                const uint64_t le = static_cast<uint64_t>(1) << k;
+                snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"%.9g\"} %llu\n", m.name.c_str(), m.labels.c_str(), comma, le * 1e-9, static_cast<unsigned long long>(m.histogram->countBelow(le - 1)));
+                m_text += line;
+            }
+
+            const uint64_t count = m.histogram->count();
+            snprintf(line, sizeof(line), "%s_bucket{%s%sle=\"+Inf\"} %llu\n%s_sum%s%s%s %.9g\n%s_count%s%s%s %llu\n", m.name.c_str(), m.labels.c_str(), comma, static_cast<unsigned long long>(count),
+                     m.name.c_str(), open, m.labels.c_str(), close, m.histogram->sum() * 1e-9, m.name.c_str(), open, m.labels.c_str(), close, static_cast<unsigned long long>(count));
+            m_text += line;
+            break;
+        }
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+bool_t Metrics::writeTextFile() const
+{
+    // Written to a temporary file and renamed so the collector never reads a partial file
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FILE* file = fopen(m_tmpFileName.c_str(), "w");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    expose();
+    const bool_t ok = fwrite(m_text.data(), 1, m_text.size(), file) == m_text.size();
+    fclose(file);
+
+    if (ok && std::rename(m_tmpFileName.c_str(), m_textFileName.c_str()) != 0)
+    {
+        std::remove(m_textFileName.c_str());
+        return std::rename(m_tmpFileName.c_str(), m_textFileName.c_str()) == 0;
+    }
+    return ok;
+}
+//--------------------------------------------------------------------------------------------------
+#ifdef OS_UNIX
+void Metrics::openSocket()
+{
+    struct sockaddr_un addr = {};
+
+    if (m_socketPath.empty() || m_socketPath.size() >= sizeof(addr.sun_path))
+    {
+        return;
+    }
+
+    addr.sun_family = AF_UNIX;
+    m_socketPath.copy(addr.sun_path, m_socketPath.size());
+    unlink(m_socketPath.c_str());
+
+    m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_socket >= 0)
+    {
+        if (bind(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 || listen(m_socket, 4) != 0)
+        {
+            Debug::log(Debug::Severity::Warning, "Metrics", "Can't listen on %s", m_socketPath.c_str());
+            close(m_socket);
+            m_socket = -1;
+        }
+        else
+        {
+            fcntl(m_socket, F_SETFL, fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK);
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Metrics::closeSocket()
+{
+    if (m_socket >= 0)
+    {
+        close(m_socket);
+        unlink(m_socketPath.c_str());
+        m_socket = -1;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Metrics::serveSocket()
+{
+    int client;
+
+    while (m_socket >= 0 && (client = accept(m_socket, nullptr, nullptr)) >= 0)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        expose();
+        const char* data = m_text.data();
+        size_t size = m_text.size();
+
+        // Never waits on the client, this is the main loop. The send buffer is sized to take the whole
+        // export so only a client that has stopped reading is dropped
+        int bufSize = static_cast<int>(size);
+        setsockopt(client, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+        fcntl(client, F_SETFL, fcntl(client, F_GETFL, 0) | O_NONBLOCK);
+
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+
+        while (size)
+        {
+            const ssize_t sent = send(client, data, size, flags);
+            if (sent <= 0)
+            {
+                if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                {
+                    Debug::log(Debug::Severity::Warning, "Metrics", "Dropped a client that wasn't reading, %u bytes unsent", FMT_U(size));
+                }
+                break;
+            }
+            data += sent;
+            size -= sent;
+        }
+        close(client);
+    }
+}
+#else
+//--------------------------------------------------------------------------------------------------
+void Metrics::openSocket()
+{
+}
+//--------------------------------------------------------------------------------------------------
+void Metrics::closeSocket()
+{
+}
+//--------------------------------------------------------------------------------------------------
+void Metrics::serveSocket()
+{
+}
+#endif
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,129 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include "platform.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Counters, gauges and latency histograms exported in the Prometheus text format. Metrics are looked
+    // up by name and labels once and the returned reference updated from then on, which is a relaxed
+    // atomic add so any thread can update without locking. Histograms are log linear, 16 sub buckets
+    // per power of two, so any value is recorded to within 6%. run() rewrites the textfile for the node
+    // exporter and answers connections on a local Unix socket.
+    class Metrics
+    {
+    public:
+        class Counter
+        {
+        public:
+            Counter() : m_value(0) {}
+            void add(uint64_t n = 1) { m_value.fetch_add(n, std::memory_order_relaxed); }
+            uint64_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+        private:
+            std::atomic<uint64_t> m_value;
+        };
+
+        class Gauge
+        {
+        public:
+            Gauge() : m_value(0) {}
+            void set(real_t v) { m_value.store(v, std::memory_order_relaxed); }
+            real_t value() const { return m_value.load(std::memory_order_relaxed); }
+
+        private:
+            std::atomic<real_t> m_value;
+        };
+
+        class Histogram
+        {
+        public:
+            static constexpr uint_t subBucketBits = 4;
+            static constexpr uint_t subBuckets = 1 << subBucketBits;
+            static constexpr uint_t bucketCount = (64 - subBucketBits + 1) * subBuckets;
+
+            Histogram();
+            void record(uint64_t value)
+            {
+                m_buckets[index(value)].fetch_add(1, std::memory_order_relaxed);
+                m_sum.fetch_add(value, std::memory_order_relaxed);
+            }
+            uint64_t count() const;
+            uint64_t sum() const { return m_sum.load(std::memory_order_relaxed); }
+            uint64_t quantile(real_t q) const;                              // Upper bound of the bucket holding the quantile
+            uint64_t countBelow(uint64_t value) const;                      // Samples less than or equal to value, exact at powers of two
+            static uint_t index(uint64_t value);
+            static uint64_t upperBound(uint_t idx);
+
+        private:
+            std::atomic<uint64_t> m_buckets[bucketCount];
+            std::atomic<uint64_t> m_sum;
+        };
+
+        // Records the time from construction to destruction in nanoseconds
+        class Timer
+        {
+        public:
+            Timer(Histogram& histogram) : m_histogram(histogram), m_startNs(Platform::getTimeNs()) {}
+            ~Timer() { m_histogram.record(Platform::getTimeNs() - m_startNs); }
+
+        private:
+            Histogram& m_histogram;
+            const uint64_t m_startNs;
+        };
+
+        Metrics();
+        ~Metrics();
+        static Metrics& global();
+        Counter& counter(const std::string& name, const std::string& labels = "", const std::string& help = "");
+        Gauge& gauge(const std::string& name, const std::string& labels = "", const std::string& help = "");
+        Histogram& histogram(const std::string& name, const std::string& labels = "", const std::string& help = "");   // Values in ns, exported in seconds
+        void setup(const std::string& textFileName, const std::string& socketPath, uint_t periodMs);
+        void run();
+        std::string exposition() const;
+        bool_t writeTextFile() const;
+
+    private:
+        enum class Type { Counter, Gauge, Histogram };
+
+        struct Metric
+        {
+            Type type;
+            std::string name;
+            std::string labels;
+            std::string help;
+            std::unique_ptr<Counter> counter;
+            std::unique_ptr<Gauge> gauge;
+            std::unique_ptr<Histogram> histogram;
+        };
+
+        mutable std::mutex m_mutex;                         // Guards registration and export, never updates
+        std::vector<std::unique_ptr<Metric>> m_metrics;
+        std::string m_textFileName;
+        std::string m_tmpFileName;
+        mutable std::string m_text;                         // The last export, reused
+        std::string m_socketPath;
+        uint_t m_periodMs;
+        uint64_t m_lastWriteUs;
+        int m_socket;
+
+        Metric& find(Type type, const std::string& name, const std::string& labels, const std::string& help);
+        void expose() const;
+        void openSocket();
+        void closeSocket();
+        void serveSocket();
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
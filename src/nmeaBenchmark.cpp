@@ -0,0 +1,379 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "nmeaBenchmark.h"
+#include "nmeaParser.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace IslSdk;
+
+namespace
+{
+    // Sentence bodies without the '$' or checksum, which are added when the corpus is made
+    const char* const corpusBodies[] =
+    {
+        "GNGGA,123519.00,4807.03812,N,01131.00045,E,1,12,0.9,545.4,M,46.9,M,,",
+        "GNRMC,123519.00,A,4807.03812,N,01131.00045,E,022.4,084.4,230394,003.1,W,A",
+        "GNGLL,4807.03812,N,01131.00045,E,123519.00,A,A",
+        "GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00",
+        "GPGSV,3,2,11,14,25,170,00,16,57,208,39,18,67,296,40,19,40,246,00",
+        "GPGSV,3,3,11,22,42,067,42,24,14,311,43,27,05,244,00,,,,",
+        "GLGSV,2,1,07,65,32,040,41,66,68,121,45,72,20,326,38,73,12,180,29,1",
+        "GAGSV,1,1,04,02,45,090,40,11,30,200,35,12,60,300,44,19,10,030,22,7",
+        "GNGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1",
+        "GNGSA,A,3,65,66,72,73,,,,,,,,,2.5,1.3,2.1",
+        "GNVTG,084.4,T,087.5,M,022.4,N,041.5,K,A",
+        "GNZDA,123519.00,23,03,1994,00,00",
+        "PISLX,1,2,3",
+    };
+
+    constexpr uint_t rounds = 5;
+
+    struct FuzzCounts
+    {
+        uint_t cases = 0;
+        uint_t tokenized = 0;
+        uint_t parsed = 0;
+        uint_t failed = 0;
+    };
+
+    std::string withChecksum(std::string_view body, char start)
+    {
+        static const char hex[] = "0123456789ABCDEF";
+        uint8_t checksum = 0;
+
+        for (char c : body)
+        {
+            checksum ^= static_cast<uint8_t>(c);
+        }
+
+        std::string sentence(1, start);
+        sentence.append(body);
+        sentence.push_back('*');
+        sentence.push_back(hex[checksum >> 4]);
+        sentence.push_back(hex[checksum & 15]);
+        return sentence;
+    }
+
+    size_t makeCorpus(std::vector<std::string>& corpus)
+    {
+        size_t bytes = 0;
+
+        for (const char* body : corpusBodies)
+        {
+            corpus.push_back(withChecksum(body, '$'));
+            bytes += corpus.back().size();
+        }
+        corpus.push_back(withChecksum("AIVDM,1,1,,A,13u?etPv2;0n:dDPwUM1U1Cb069D,0", '!'));
+        bytes += corpus.back().size();
+
+        return bytes;
+    }
+
+    // Times parse over the corpus, the best of the rounds counts
+    template <typename Parse>
+    void timeParser(const char* what, const std::vector<std::string>& corpus, size_t corpusBytes, uint_t sentences, Parse parse)
+    {
+        uint64_t bestNs = UINT64_MAX;
+        uint_t parsed = 0;
+
+        for (uint_t round = 0; round < rounds; round++)
+        {
+            const uint64_t startNs = Platform::getTimeNs();
+            parsed = 0;
+
+            for (uint_t i = 0; i < sentences; i++)
+            {
+                parsed += parse(corpus[i % corpus.size()]);
+            }
+            bestNs = std::min(bestNs, Platform::getTimeNs() - startNs);
+        }
+
+        const real_t seconds = (bestNs ? bestNs : 1) * 0.000000001;
+        const real_t bytes = static_cast<real_t>(corpusBytes) * sentences / corpus.size();
+        Debug::log(Debug::Severity::Notice, "Nmea", "%s: %.0f sentences/s, %.1f MB/s, %.1f ns a sentence, %u gave a result", what, sentences / seconds, bytes / seconds / 1048576.0,
+                   bestNs / (sentences ? static_cast<real_t>(sentences) : 1), FMT_U(parsed));
+    }
+
+    // Tokenizes and parses as GpsApp does, returns true if the sentence gave a result
+    bool_t parseSentence(std::string_view sentence, NmeaParser::Fields& fields, FuzzCounts* counts)
+    {
+        if (!NmeaParser::tokenize(sentence, fields))
+        {
+            return false;
+        }
+
+        switch (fields.type)
+        {
+        case NmeaParser::Sentence::Gga:
+        {
+            NmeaParser::Gga gga;
+            return NmeaParser::parse(fields, gga);
+        }
+        case NmeaParser::Sentence::Rmc:
+        {
+            NmeaParser::Rmc rmc;
+            return NmeaParser::parse(fields, rmc);
+        }
+        case NmeaParser::Sentence::Gll:
+        {
+            NmeaParser::Gll gll;
+            return NmeaParser::parse(fields, gll);
+        }
+        case NmeaParser::Sentence::Gsv:
+        {
+            NmeaParser::Gsv gsv;
+            const bool_t ok = NmeaParser::parse(fields, gsv);
+            if (counts && ok && gsv.satelliteCount > 4)
+            {
+                counts->failed++;
+                Debug::log(Debug::Severity::Warning, "Nmea", "GSV gave %u satellites: %.*s", FMT_U(gsv.satelliteCount), static_cast<int>(sentence.size()), sentence.data());
+            }
+            return ok;
+        }
+        case NmeaParser::Sentence::Gsa:
+        {
+            NmeaParser::Gsa gsa;
+            const bool_t ok = NmeaParser::parse(fields, gsa);
+            if (counts && ok && gsa.prnCount > 12)
+            {
+                counts->failed++;
+                Debug::log(Debug::Severity::Warning, "Nmea", "GSA gave %u PRNs: %.*s", FMT_U(gsa.prnCount), static_cast<int>(sentence.size()), sentence.data());
+            }
+            return ok;
+        }
+        case NmeaParser::Sentence::Vtg:
+        {
+            NmeaParser::Vtg vtg;
+            return NmeaParser::parse(fields, vtg);
+        }
+        default:
+            return false;
+        }
+    }
+
+    // GpsApp's handling before NmeaParser, the SDK's sentence type and then its parse for that type
+    bool_t sdkParseSentence(GpsDevice& device, const std::string& str)
+    {
+        switch (GpsDevice::getSentenceType(str))
+        {
+        case GpsDevice::SentenceType::Gll:
+        {
+            GpsDevice::Gpgll gpgll;
+            return device.parseStringGPGLL(str, gpgll);
+        }
+        case GpsDevice::SentenceType::Gga:
+        {
+            GpsDevice::Gpgga gpgga;
+            return device.parseStringGPGGA(str, gpgga);
+        }
+        case GpsDevice::SentenceType::Gsv:
+        {
+            GpsDevice::Gpgsv gpgsv;
+            return device.parseStringGPGSV(str, gpgsv);
+        }
+        case GpsDevice::SentenceType::Gsa:
+        {
+            GpsDevice::Gpgsa gpgsa;
+            return device.parseStringGPGSA(str, gpgsa);
+        }
+        case GpsDevice::SentenceType::Vtg:
+        {
+            GpsDevice::Gpvtg gpvtg;
+            return device.parseStringGPVTG(str, gpvtg);
+        }
+        case GpsDevice::SentenceType::Rmc:
+        {
+            GpsDevice::Gprmc gprmc;
+            return device.parseStringGPRMC(str, gprmc);
+        }
+        default:
+            return false;
+        }
+    }
+
+    // What tokenize() should give, written plainly, fields is left empty if the sentence is rejected
+    void referenceTokenize(std::string_view sentence, std::vector<std::string_view>& fields)
+    {
+        fields.clear();
+
+        const size_t star = sentence.find('*', 1);
+        if (sentence.size() < 7 || (sentence[0] != '$' && sentence[0] != '!') || star == std::string_view::npos || star + 2 >= sentence.size())
+        {
+            return;
+        }
+
+        const std::string_view digits = sentence.substr(star + 1, 2);
+        uint_t expected = 0;
+        for (char c : digits)
+        {
+            const bool_t isHex = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') || (c >= 'a' && c <= 'f');
+            if (!isHex)
+            {
+                return;
+            }
+            expected = expected * 16 + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+
+        uint8_t checksum = 0;
+        for (size_t i = 1; i < star; i++)
+        {
+            checksum ^= static_cast<uint8_t>(sentence[i]);
+        }
+
+        if (checksum != expected)
+        {
+            return;
+        }
+
+        size_t start = 1;
+        for (size_t i = 1; i <= star; i++)
+        {
+            if (i == star || sentence[i] == ',')
+            {
+                fields.push_back(sentence.substr(start, i - start));
+                start = i + 1;
+            }
+        }
+
+        if (fields.size() > NmeaParser::maxFields)
+        {
+            fields.clear();
+        }
+    }
+
+    void fuzzOne(const std::string& input, FuzzCounts& counts, std::vector<std::string_view>& expected)
+    {
+        // Copied to a buffer of exactly its size, a std::string has a terminator past the end
+        const std::vector<char> buf(input.begin(), input.end());
+        const std::string_view sentence(buf.data(), buf.size());
+        NmeaParser::Fields fields;
+
+        counts.cases++;
+        referenceTokenize(sentence, expected);
+
+        const bool_t parsed = parseSentence(sentence, fields, &counts);
+        const bool_t tokenized = NmeaParser::tokenize(sentence, fields);
+        bool_t same = tokenized == !expected.empty();
+
+        if (tokenized)
+        {
+            counts.tokenized++;
+            counts.parsed += parsed;
+            same = same && fields.count == expected.size();
+
+            for (uint_t i = 0; same && i < fields.count; i++)
+            {
+                same = fields.field[i].data() == expected[i].data() && fields.field[i].size() == expected[i].size();
+            }
+
+            const char* talker = fields.talker.data();
+            same = same && (fields.talker.empty() || (talker >= buf.data() && talker + fields.talker.size() <= buf.data() + buf.size()));
+        }
+
+        if (!same)
+        {
+            counts.failed++;
+            Debug::log(Debug::Severity::Warning, "Nmea", "tokenize() differs from the reference, %u fields against %u: %.*s", FMT_U(tokenized ? fields.count : 0),
+                       FMT_U(expected.size()), static_cast<int>(sentence.size()), sentence.data());
+        }
+    }
+
+    void mutate(std::string& s, std::mt19937& rng)
+    {
+        static const char interesting[] = ",*.-0123456789ANSEW$!\r\n";
+        const uint_t edits = 1 + rng() % 4;
+
+        for (uint_t e = 0; e < edits && !s.empty(); e++)
+        {
+            const size_t pos = rng() % s.size();
+
+            switch (rng() % 6)
+            {
+            case 0:
+                s.resize(pos);
+                break;
+            case 1:
+                s[pos] = static_cast<char>(rng());
+                break;
+            case 2:
+                s[pos] = interesting[rng() % (sizeof(interesting) - 1)];
+                break;
+            case 3:
+                s.erase(pos, 1 + rng() % 4);
+                break;
+            case 4:
+                s.insert(pos, 1 + rng() % 40, ',');                             // Past maxFields
+                break;
+            default:
+                s.insert(pos, s.substr(pos, rng() % 20));                       // A run of digits or fields repeated
+                break;
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaBenchmark::run(uint_t sentences, uint_t fuzzCases)
+{
+    std::vector<std::string> corpus;
+    const size_t corpusBytes = makeCorpus(corpus);
+    NmeaParser::Fields fields;
+
+    Debug::log(Debug::Severity::Notice, "Nmea", "Parsing %u sentences from a corpus of %u, %u times", FMT_U(sentences), FMT_U(corpus.size()), FMT_U(rounds));
+    timeParser("NmeaParser", corpus, corpusBytes, sentences, [&fields](const std::string& sentence) { return parseSentence(sentence, fields, nullptr); });
+
+    // Fuzz, every truncation first and then random mutations
+    FuzzCounts counts;
+    std::vector<std::string_view> expected;
+    std::mt19937 rng(1);
+    std::string input;
+
+    expected.reserve(NmeaParser::maxFields + 64);
+
+    for (const std::string& sentence : corpus)
+    {
+        for (size_t size = 0; size <= sentence.size(); size++)
+        {
+            fuzzOne(sentence.substr(0, size), counts, expected);
+        }
+    }
+
+    for (uint_t i = 0; i < fuzzCases; i++)
+    {
+        input = corpus[rng() % corpus.size()];
+        mutate(input, rng);
+
+        // Half get a correct checksum so they reach parse()
+        const size_t star = input.rfind('*');
+        if (rng() & 1 && input.size() > 1 && star != std::string::npos && star > 0)
+        {
+            input = withChecksum(std::string_view(input).substr(1, star - 1), input[0]);
+        }
+
+        fuzzOne(input, counts, expected);
+    }
+
+    Debug::log(counts.failed ? Debug::Severity::Warning : Debug::Severity::Notice, "Nmea", "Fuzzed %u sentences, %u tokenized, %u parsed, %u failed checks",
+               FMT_U(counts.cases), FMT_U(counts.tokenized), FMT_U(counts.parsed), FMT_U(counts.failed));
+
+    return counts.failed == 0;
+}
+//--------------------------------------------------------------------------------------------------
+void NmeaBenchmark::compare(GpsDevice& device, uint_t sentences)
+{
+    std::vector<std::string> corpus;
+    const size_t corpusBytes = makeCorpus(corpus);
+    NmeaParser::Fields fields;
+
+    Debug::log(Debug::Severity::Notice, "Nmea", "Parsing %u sentences from a corpus of %u, %u times, with NmeaParser and then the SDK's GpsDevice", FMT_U(sentences),
+               FMT_U(corpus.size()), FMT_U(rounds));
+    timeParser("NmeaParser", corpus, corpusBytes, sentences, [&fields](const std::string& sentence) { return parseSentence(sentence, fields, nullptr); });
+    timeParser("GpsDevice", corpus, corpusBytes, sentences, [&device](const std::string& sentence) { return sdkParseSentence(device, sentence); });
+}
+//--------------------------------------------------------------------------------------------------
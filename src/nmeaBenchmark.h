@@ -0,0 +1,30 @@
+#ifndef NMEABENCHMARK_H_
+#define NMEABENCHMARK_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "nmeaDevices/gpsDevice.h"
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Measures and fuzzes NmeaParser. A canned corpus of the sentences a multi constellation receiver
+    // sends is tokenized and parsed as GpsApp does and the rate reported in sentences per second. The
+    // fuzz run feeds every truncation of each corpus sentence and then randomly mutated ones, half with
+    // the checksum corrected so they get through to the parse() overloads. Each input is in a buffer
+    // of exactly its size so a build with -fsanitize=address catches any read past the end. tokenize()
+    // is checked against a plain scalar split, which covers the SSE2 path, and the parsed counts against
+    // their array sizes. Returns false if any check failed. compare() times NmeaParser and then the
+    // SDK's GpsDevice parsing, which GpsApp used before, over the same corpus. The SDK only parses
+    // through a device it has made, so it's given the first GPS found.
+    class NmeaBenchmark
+    {
+    public:
+        static bool_t run(uint_t sentences, uint_t fuzzCases);
+        static void compare(GpsDevice& device, uint_t sentences);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
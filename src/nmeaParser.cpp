@@ -0,0 +1,392 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "nmeaParser.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define NMEA_USE_SSE2
+    #include <emmintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+static const real_t pow10Table[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+//--------------------------------------------------------------------------------------------------
+static inline uint_t hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return 16;
+}
+//--------------------------------------------------------------------------------------------------
+#ifdef NMEA_USE_SSE2
+static inline uint32_t lowestBit(uint32_t mask)
+{
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return idx;
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+#endif
+//--------------------------------------------------------------------------------------------------
+static inline bool_t addField(NmeaParser::Fields& fields, const char* data, uint_t start, uint_t end)
+{
+    if (fields.count >= NmeaParser::maxFields)
+    {
+        return false;
+    }
+    fields.field[fields.count++] = std::string_view(data + start, end - start);
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::tokenize(std::string_view sentence, Fields& fields)
+{
+    const char* data = sentence.data();
+    const uint_t size = sentence.size();
+    uint_t i = 1;
+    uint_t fieldStart = 1;
+    uint_t star = size;
+
+    fields.type = Sentence::Unknown;
+    fields.count = 0;
+
+    if (size < 7 || (data[0] != '$' && data[0] != '!'))
+    {
+        return false;
+    }
+
+#ifdef NMEA_USE_SSE2
+    // Sixteen bytes at a time, the ',' and '*' compare masks give every delimiter position in the chunk
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i asterisk = _mm_set1_epi8('*');
+
+    while (star == size && i + 16 <= size)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, asterisk))));
+
+        while (mask)
+        {
+            const uint_t pos = i + lowestBit(mask);
+            if (!addField(fields, data, fieldStart, pos))
+            {
+                return false;
+            }
+
+            if (data[pos] == '*')
+            {
+                star = pos;
+                break;
+            }
+            fieldStart = pos + 1;
+            mask &= mask - 1;
+        }
+        i += 16;
+    }
+#endif
+
+    for (; star == size && i < size; i++)
+    {
+        if (data[i] == ',' || data[i] == '*')
+        {
+            if (!addField(fields, data, fieldStart, i))
+            {
+                return false;
+            }
+
+            if (data[i] == '*')
+            {
+                star = i;
+            }
+            fieldStart = i + 1;
+        }
+    }
+
+    if (star + 2 >= size)
+    {
+        return false;                                   // No checksum
+    }
+
+    const uint_t hi = hexValue(data[star + 1]);
+    const uint_t lo = hexValue(data[star + 2]);
+    if (hi > 15 || lo > 15)
+    {
+        return false;
+    }
+
+    uint8_t checksum = 0;
+    i = 1;
+
+#ifdef NMEA_USE_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 16 <= star; i += 16)
+    {
+        acc = _mm_xor_si128(acc, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    }
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 4));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 2));
+    acc = _mm_xor_si128(acc, _mm_srli_si128(acc, 1));
+    checksum = static_cast<uint8_t>(_mm_cvtsi128_si32(acc));
+#endif
+
+    for (; i < star; i++)
+    {
+        checksum ^= static_cast<uint8_t>(data[i]);
+    }
+
+    if (checksum != ((hi << 4) | lo))
+    {
+        return false;
+    }
+
+    // Address field is a two character talker ID followed by the three character sentence formatter
+    const std::string_view address = fields.field[0];
+    if (address.size() == 5 && address[0] != 'P')
+    {
+        const std::string_view formatter = address.substr(2);
+        fields.talker = address.substr(0, 2);
+
+        if (formatter == "GGA") fields.type = Sentence::Gga;
+        else if (formatter == "RMC") fields.type = Sentence::Rmc;
+        else if (formatter == "GLL") fields.type = Sentence::Gll;
+        else if (formatter == "GSV") fields.type = Sentence::Gsv;
+        else if (formatter == "GSA") fields.type = Sentence::Gsa;
+        else if (formatter == "VTG") fields.type = Sentence::Vtg;
+    }
+    else
+    {
+        fields.talker = std::string_view();
+    }
+
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::toReal(std::string_view str, real_t& value)
+{
+    uint_t i = 0;
+    uint64_t mantissa = 0;
+    uint_t digits = 0;
+    uint_t fracDigits = 0;
+    bool_t negative = false;
+    bool_t point = false;
+
+    if (str.empty())
+    {
+        return false;
+    }
+
+    if (str[0] == '-' || str[0] == '+')
+    {
+        negative = str[0] == '-';
+        i++;
+    }
+
+    for (; i < str.size(); i++)
+    {
+        const char c = str[i];
+        if (c >= '0' && c <= '9')
+        {
+            if (digits < 18)
+            {
+                mantissa = mantissa * 10 + (c - '0');
+                digits++;
+                fracDigits += point;
+            }
+            else if (!point)
+            {
+                return false;                           // Too large for a NMEA field
+            }
+        }
+        else if (c == '.' && !point)
+        {
+            point = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    if (digits == 0)
+    {
+        return false;
+    }
+
+    value = static_cast<real_t>(mantissa) / pow10Table[fracDigits];
+    value = negative ? -value : value;
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::toUint(std::string_view str, uint_t& value)
+{
+    if (str.empty() || str.size() > 9)
+    {
+        return false;
+    }
+
+    uint_t v = 0;
+    for (char c : str)
+    {
+        if (c < '0' || c > '9')
+        {
+            return false;
+        }
+        v = v * 10 + (c - '0');
+    }
+    value = v;
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::toLatLong(std::string_view str, std::string_view hemisphere, real_t& deg)
+{
+    real_t v;
+
+    if (!toReal(str, v) || hemisphere.size() != 1)
+    {
+        return false;
+    }
+
+    // ddmm.mmmm or dddmm.mmmm
+    const real_t wholeDeg = static_cast<real_t>(static_cast<int_t>(v / 100));
+    deg = wholeDeg + (v - wholeDeg * 100) / 60.0;
+
+    if (hemisphere[0] == 'S' || hemisphere[0] == 'W')
+    {
+        deg = -deg;
+    }
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::parse(const Fields& f, Gga& gga)
+{
+    if (f.type != Sentence::Gga || f.count < 12)
+    {
+        return false;
+    }
+
+    gga = Gga();
+    toReal(f.field[1], gga.utcTime);
+    toUint(f.field[6], gga.quality);
+    toUint(f.field[7], gga.satellites);
+    toReal(f.field[8], gga.hdop);
+    toReal(f.field[9], gga.altitudeM);
+    toReal(f.field[11], gga.geoidSeparationM);
+
+    return toLatLong(f.field[2], f.field[3], gga.latitudeDeg) && toLatLong(f.field[4], f.field[5], gga.longitudeDeg);
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::parse(const Fields& f, Rmc& rmc)
+{
+    if (f.type != Sentence::Rmc || f.count < 10)
+    {
+        return false;
+    }
+
+    rmc = Rmc();
+    toReal(f.field[1], rmc.utcTime);
+    rmc.valid = f.field[2] == "A";
+    toReal(f.field[7], rmc.speedKnots);
+    toReal(f.field[8], rmc.courseDeg);
+    toUint(f.field[9], rmc.date);
+
+    if (f.count > 11 && toReal(f.field[10], rmc.magneticVariationDeg) && f.field[11] == "W")
+    {
+        rmc.magneticVariationDeg = -rmc.magneticVariationDeg;
+    }
+
+    return toLatLong(f.field[3], f.field[4], rmc.latitudeDeg) && toLatLong(f.field[5], f.field[6], rmc.longitudeDeg);
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::parse(const Fields& f, Gll& gll)
+{
+    if (f.type != Sentence::Gll || f.count < 5)
+    {
+        return false;
+    }
+
+    gll = Gll();
+    if (f.count > 5)
+    {
+        toReal(f.field[5], gll.utcTime);
+    }
+    gll.valid = f.count > 6 && f.field[6] == "A";
+
+    return toLatLong(f.field[1], f.field[2], gll.latitudeDeg) && toLatLong(f.field[3], f.field[4], gll.longitudeDeg);
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::parse(const Fields& f, Gsv& gsv)
+{
+    if (f.type != Sentence::Gsv || f.count < 4)
+    {
+        return false;
+    }
+
+    gsv = Gsv();
+    if (!toUint(f.field[1], gsv.messageCount) || !toUint(f.field[2], gsv.messageNumber) || !toUint(f.field[3], gsv.satellitesInView))
+    {
+        return false;
+    }
+
+    // Groups of four fields per satellite, NMEA 4.10 adds a trailing signal ID which is ignored
+    for (uint_t i = 4; i + 3 < f.count && gsv.satelliteCount < 4; i += 4)
+    {
+        Gsv::Satellite& sat = gsv.satellites[gsv.satelliteCount++];
+        toUint(f.field[i], sat.prn);
+        toUint(f.field[i + 1], sat.elevationDeg);
+        toUint(f.field[i + 2], sat.azimuthDeg);
+        toUint(f.field[i + 3], sat.snr);
+    }
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::parse(const Fields& f, Gsa& gsa)
+{
+    if (f.type != Sentence::Gsa || f.count < 18)
+    {
+        return false;
+    }
+
+    gsa = Gsa();
+    gsa.mode = f.field[1].empty() ? 0 : f.field[1][0];
+    if (!toUint(f.field[2], gsa.fixType))
+    {
+        return false;
+    }
+
+    for (uint_t i = 3; i < 15; i++)
+    {
+        if (toUint(f.field[i], gsa.prn[gsa.prnCount]))
+        {
+            gsa.prnCount++;
+        }
+    }
+
+    toReal(f.field[15], gsa.pdop);
+    toReal(f.field[16], gsa.hdop);
+    toReal(f.field[17], gsa.vdop);
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t NmeaParser::parse(const Fields& f, Vtg& vtg)
+{
+    if (f.type != Sentence::Vtg || f.count < 9)
+    {
+        return false;
+    }
+
+    vtg = Vtg();
+    toReal(f.field[1], vtg.trueCourseDeg);
+    toReal(f.field[3], vtg.magneticCourseDeg);
+    toReal(f.field[5], vtg.speedKnots);
+    return toReal(f.field[7], vtg.speedKm);
+}
+//--------------------------------------------------------------------------------------------------
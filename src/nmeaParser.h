@@ -0,0 +1,113 @@
+#ifndef NMEAPARSER_H_
+#define NMEAPARSER_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include <string_view>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Allocation free NMEA 0183 parser. tokenize() splits a sentence into field views in one pass and
+    // verifies the checksum, the parse() overloads then convert the fields without touching the locale.
+    // Any talker ID is accepted (GP, GN, GL, GA, GB ...) so multi constellation receivers work.
+    class NmeaParser
+    {
+    public:
+        enum class Sentence { Unknown, Gga, Rmc, Gll, Gsv, Gsa, Vtg };
+        static constexpr uint_t maxFields = 32;
+
+        struct Fields
+        {
+            Sentence type;
+            std::string_view talker;
+            uint_t count;
+            std::string_view field[maxFields];              // field[0] is the address, eg "GNGGA"
+        };
+
+        struct Gga
+        {
+            real_t utcTime;                                 // hhmmss.ss
+            real_t latitudeDeg;
+            real_t longitudeDeg;
+            uint_t quality;
+            uint_t satellites;
+            real_t hdop;
+            real_t altitudeM;
+            real_t geoidSeparationM;
+        };
+
+        struct Rmc
+        {
+            real_t utcTime;
+            bool_t valid;
+            real_t latitudeDeg;
+            real_t longitudeDeg;
+            real_t speedKnots;
+            real_t courseDeg;
+            uint_t date;                                    // ddmmyy
+            real_t magneticVariationDeg;
+        };
+
+        struct Gll
+        {
+            real_t latitudeDeg;
+            real_t longitudeDeg;
+            real_t utcTime;
+            bool_t valid;
+        };
+
+        struct Gsv
+        {
+            struct Satellite
+            {
+                uint_t prn;
+                uint_t elevationDeg;
+                uint_t azimuthDeg;
+                uint_t snr;
+            };
+
+            uint_t messageCount;
+            uint_t messageNumber;
+            uint_t satellitesInView;
+            uint_t satelliteCount;                          // Number of entries used in satellites
+            Satellite satellites[4];
+        };
+
+        struct Gsa
+        {
+            char mode;
+            uint_t fixType;
+            uint_t prnCount;
+            uint_t prn[12];
+            real_t pdop;
+            real_t hdop;
+            real_t vdop;
+        };
+
+        struct Vtg
+        {
+            real_t trueCourseDeg;
+            real_t magneticCourseDeg;
+            real_t speedKnots;
+            real_t speedKm;
+        };
+
+        static bool_t tokenize(std::string_view sentence, Fields& fields);
+        static bool_t parse(const Fields& fields, Gga& gga);
+        static bool_t parse(const Fields& fields, Rmc& rmc);
+        static bool_t parse(const Fields& fields, Gll& gll);
+        static bool_t parse(const Fields& fields, Gsv& gsv);
+        static bool_t parse(const Fields& fields, Gsa& gsa);
+        static bool_t parse(const Fields& fields, Vtg& vtg);
+
+        static bool_t toReal(std::string_view str, real_t& value);          // Returns false for an empty or malformed field
+        static bool_t toUint(std::string_view str, uint_t& value);
+        static bool_t toLatLong(std::string_view str, std::string_view hemisphere, real_t& deg);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,564 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "pipeline.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+// Splits a line of the graph file at commas, without the spaces around each field
+static std::vector<std::string> splitFields(const char* line)
+{
+    std::vector<std::string> fields;
+    const char* start = line;
+
+    while (true)
+    {
+        const char* end = start;
+        while (*end && *end != ',' && *end != '\r' && *end != '\n')
+        {
+            end++;
+        }
+
+        const char* first = start;
+        const char* last = end;
+        while (first < last && (*first == ' ' || *first == '\t'))
+        {
+            first++;
+        }
+        while (last > first && (last[-1] == ' ' || last[-1] == '\t'))
+        {
+            last--;
+        }
+        fields.emplace_back(first, last);
+
+        if (*end != ',')
+        {
+            break;
+        }
+        start = end + 1;
+    }
+    return fields;
+}
+//--------------------------------------------------------------------------------------------------
+Pipeline::Batch* Pipeline::Node::newBatch(uint_t channels)
+{
+    Batch* batch = m_pipeline->allocate(channels);
+
+    if (batch == nullptr)
+    {
+        m_vertex->dropped->add();
+    }
+    return batch;
+}
+//--------------------------------------------------------------------------------------------------
+void Pipeline::Node::emit(Batch* batch)
+{
+    m_pipeline->emit(*m_vertex, batch);
+}
+//--------------------------------------------------------------------------------------------------
+real_t Pipeline::Node::param(const Params& params, const char* key, real_t value)
+{
+    Params::const_iterator it = params.find(key);
+    return it == params.end() ? value : static_cast<real_t>(atof(it->second.c_str()));
+}
+//--------------------------------------------------------------------------------------------------
+std::string Pipeline::Node::text(const Params& params, const char* key, const char* value)
+{
+    Params::const_iterator it = params.find(key);
+    return it == params.end() ? value : it->second;
+}
+//--------------------------------------------------------------------------------------------------
+void Pipeline::Source::push(uint64_t hostUs, uint32_t device, std::initializer_list<real_t> values, const uint16_t* data, uint_t dataSize)
+{
+    if (!m_wanted)
+    {
+        return;
+    }
+
+    const uint_t channels = std::min<uint_t>(static_cast<uint_t>(values.size()) + dataSize, batchValues);
+
+    if (m_filling && m_filling->channels != channels)
+    {
+        flush();
+    }
+
+    if (m_filling == nullptr)
+    {
+        m_filling = m_pipeline.allocate(channels);
+        if (m_filling == nullptr)
+        {
+            m_vertex.dropped->add();
+            return;
+        }
+        m_startUs = Platform::getTimeUs();
+    }
+
+    real_t* row = m_filling->row(m_filling->rows);
+    uint_t n = 0;
+
+    for (real_t v : values)
+    {
+        if (n < channels)
+        {
+            row[n++] = v;
+        }
+    }
+
+    for (uint_t i = 0; n < channels; i++)
+    {
+        row[n++] = data[i];
+    }
+
+    m_filling->timeUs[m_filling->rows] = hostUs;
+    m_filling->device[m_filling->rows] = device;
+    m_filling->rows++;
+
+    if (m_filling->rows >= m_filling->capacity())
+    {
+        flush();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Pipeline::Source::flush()
+{
+    if (m_filling)
+    {
+        Batch* batch = m_filling;
+        m_filling = nullptr;
+        m_vertex.rows->add(batch->rows);
+        m_vertex.batches->add();
+        m_pipeline.emit(m_vertex, batch);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+Pipeline::Pipeline() : m_readyHead(0), m_readyCount(0), m_stopping(false), m_lastReportUs(0)
+{
+    Metrics::global();                                                      // Made first so it outlives the counters used by stop() at exit
+}
+//--------------------------------------------------------------------------------------------------
+Pipeline::~Pipeline()
+{
+    stop();
+}
+//--------------------------------------------------------------------------------------------------
+Pipeline& Pipeline::global()
+{
+    static Pipeline pipeline;
+    return pipeline;
+}
+//--------------------------------------------------------------------------------------------------
+Pipeline::Vertex* Pipeline::find(const std::string& name, bool_t node)
+{
+    for (std::unique_ptr<Vertex>& v : m_vertices)
+    {
+        if (v->name == name && (v->node != nullptr) == node)
+        {
+            return v.get();
+        }
+    }
+    return nullptr;
+}
+//--------------------------------------------------------------------------------------------------
+Pipeline::Vertex& Pipeline::add(const std::string& name, bool_t node)
+{
+    const std::string labels = (node ? "node=\"" : "source=\"") + name + "\"";       // Node and source names can be the same
+    Metrics& metrics = Metrics::global();
+
+    m_vertices.push_back(std::make_unique<Vertex>());
+    Vertex& v = *m_vertices.back();
+    v.name = name;
+    v.head = 0;
+    v.count = 0;
+    v.scheduled = false;
+    v.rows = &metrics.counter("isl_pipeline_rows_total", labels, "Rows pushed by a source or processed by a node");
+    v.batches = &metrics.counter("isl_pipeline_batches_total", labels, "Batches pushed by a source or processed by a node");
+    v.dropped = &metrics.counter("isl_pipeline_dropped_batches_total", labels, "Batches lost to a full queue or an empty pool");
+    v.depth = &metrics.gauge("isl_pipeline_queue_depth", labels, "Batches waiting at a node");
+    v.processNs = node ? &metrics.histogram("isl_pipeline_process_seconds", labels, "Time a node takes over a batch") : nullptr;
+    v.reportedRows = v.rows->value();
+    v.reportedDropped = v.dropped->value();
+    v.maxDepth = 0;
+
+    if (!node)
+    {
+        v.source = std::make_unique<Source>(*this, v);
+    }
+    return v;
+}
+//--------------------------------------------------------------------------------------------------
+Pipeline::Source& Pipeline::source(const std::string& name)
+{
+    Vertex* v = find(name, false);
+    return *(v ? v : &add(name, false))->source;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t Pipeline::load(const std::string& fileName)
+{
+    FILE* file = fopen(fileName.c_str(), "r");
+    char line[512];
+    uint_t lineNumber = 0;
+    const char* error = nullptr;
+
+    if (file == nullptr)
+    {
+        Debug::log(Debug::Severity::Info, "Pipeline", "No %s, nothing to run", fileName.c_str());
+        return false;
+    }
+
+    while (error == nullptr && fgets(line, sizeof(line), file))
+    {
+        const std::vector<std::string> fields = splitFields(line);
+        lineNumber++;
+
+        if (fields[0].empty() || fields[0][0] == '#')
+        {
+            continue;
+        }
+
+        if (fields.size() < 3 || fields[1].empty() || fields[2].empty())
+        {
+            error = "needs a name, type and input";
+            break;
+        }
+
+        if (find(fields[0], true))
+        {
+            error = "has the name of a node above";
+            break;
+        }
+
+        Params params;
+        for (uint_t i = 3; i < fields.size(); i++)
+        {
+            const size_t eq = fields[i].find('=');
+            if (eq == std::string::npos || eq == 0)
+            {
+                error = "has a parameter that isn't key=value";
+                break;
+            }
+            params[fields[i].substr(0, eq)] = fields[i].substr(eq + 1);
+        }
+
+        std::unique_ptr<Node> node = error ? nullptr : create(fields[1]);
+        if (error == nullptr && node == nullptr)
+        {
+            error = "has an unknown type";
+        }
+        else if (error == nullptr && !node->setup(fields[0], params))
+        {
+            error = "has a bad parameter";
+        }
+
+        if (error == nullptr)
+        {
+            // Any input that isn't a node above is a source, made now if no App has pushed to it yet
+            Vertex* input = find(fields[2], true);
+            input = input ? input : find(fields[2], false);
+            input = input ? input : &add(fields[2], false);
+
+            Vertex& v = add(fields[0], true);
+            v.node = std::move(node);
+            v.node->m_pipeline = this;
+            v.node->m_vertex = &v;
+            input->outputs.push_back(&v);
+        }
+    }
+    fclose(file);
+
+    if (error)
+    {
+        Debug::log(Debug::Severity::Error, "Pipeline", "%s line %u %s", fileName.c_str(), FMT_U(lineNumber), error);
+    }
+    return error == nullptr;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t Pipeline::start(const std::string& fileName, uint_t threads)
+{
+    stop();
+
+    if (!load(fileName))
+    {
+        stop();                                                             // Drops what was loaded before the error
+        return false;
+    }
+
+    // Every batch is either free, filling at a source, queued or being processed, which bounds how many there can be
+    const size_t maxBatches = poolBatches + m_vertices.size() * (queueDepth + 2);
+    m_batches.reserve(maxBatches);
+    m_free.reserve(maxBatches);
+    while (m_batches.size() < poolBatches)
+    {
+        m_batches.push_back(std::make_unique<Batch>());
+        m_free.push_back(m_batches.back().get());
+    }
+
+    m_ready.assign(m_vertices.size(), nullptr);
+    m_readyHead = 0;
+    m_readyCount = 0;
+    m_stopping = false;
+    m_lastReportUs = Platform::getTimeUs();
+
+    uint_t nodes = 0;
+    for (std::unique_ptr<Vertex>& v : m_vertices)
+    {
+        nodes += v->node != nullptr;
+        if (v->source)
+        {
+            v->source->m_wanted = !v->outputs.empty();
+        }
+    }
+
+    threads = threads ? threads : 1;
+    for (uint_t i = 0; i < threads; i++)
+    {
+        m_threads.emplace_back(&Pipeline::workerTask, this);
+    }
+
+    Debug::log(Debug::Severity::Notice, "Pipeline", "%u nodes from %s running on %u threads", FMT_U(nodes), fileName.c_str(), FMT_U(threads));
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+void Pipeline::stop()
+{
+    for (std::unique_ptr<Vertex>& v : m_vertices)
+    {
+        if (v->source)
+        {
+            v->source->flush();
+            v->source->m_wanted = false;
+        }
+    }
+
+    if (!m_threads.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_cv.notify_all();
+
+        for (std::thread& thread : m_threads)
+        {
+            thread.join();
+        }
+        m_threads.clear();
+    }
+
+    for (std::unique_ptr<Vertex>& v : m_vertices)
+    {
+        if (v->node)
+        {
+            v->node->stop();
+        }
+    }
+
+    // The sources stay as the Apps hold them, the nodes are read from the file again by start()
+    m_vertices.erase(std::remove_if(m_vertices.begin(), m_vertices.end(), [](const std::unique_ptr<Vertex>& v) { return v->node != nullptr; }), m_vertices.end());
+    for (std::unique_ptr<Vertex>& v : m_vertices)
+    {
+        v->outputs.clear();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Pipeline::run()
+{
+    if (!running())
+    {
+        return;
+    }
+
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    for (std::unique_ptr<Vertex>& v : m_vertices)
+    {
+        if (v->source && v->source->m_filling && nowUs - v->source->m_startUs >= flushPeriodMs * static_cast<uint64_t>(1000))
+        {
+            v->source->flush();
+        }
+    }
+
+    if (nowUs - m_lastReportUs >= reportPeriodMs * static_cast<uint64_t>(1000))
+    {
+        report(nowUs);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+Pipeline::Batch* Pipeline::allocate(uint_t channels)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Batch* batch = nullptr;
+
+    if (!m_free.empty())
+    {
+        batch = m_free.back();
+        m_free.pop_back();
+    }
+    else if (!HeapMonitor::enabled && m_batches.size() < m_batches.capacity())
+    {
+        m_batches.push_back(std::make_unique<Batch>());
+        batch = m_batches.back().get();
+    }
+
+    if (batch)
+    {
+        batch->channels = std::min(channels, batchValues);
+        batch->rows = 0;
+        batch->refs = 0;
+    }
+    return batch;
+}
+//--------------------------------------------------------------------------------------------------
+void Pipeline::release(Batch* batch)
+{
+    if (batch->refs <= 1)
+    {
+        m_free.push_back(batch);
+    }
+    else
+    {
+        batch->refs--;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Pipeline::emit(Vertex& from, Batch* batch)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint_t woken = 0;
+
+    if (batch == nullptr)                                                   // newBatch() found the pool empty
+    {
+        return;
+    }
+
+    batch->refs = static_cast<uint_t>(from.outputs.size());
+
+    if (batch->refs == 0 || batch->rows == 0)
+    {
+        batch->refs = 1;
+        release(batch);
+        return;
+    }
+
+    for (Vertex* to : from.outputs)
+    {
+        if (to->count == queueDepth)
+        {
+            to->dropped->add();
+            release(batch);
+            continue;
+        }
+
+        to->queue[(to->head + to->count) % queueDepth] = batch;
+        to->count++;
+        to->maxDepth = std::max(to->maxDepth, to->count);
+        to->depth->set(to->count);
+
+        if (!to->scheduled)
+        {
+            to->scheduled = true;
+            m_ready[(m_readyHead + m_readyCount) % m_ready.size()] = to;
+            m_readyCount++;
+            woken++;
+        }
+    }
+
+    if (woken > 1)
+    {
+        m_cv.notify_all();
+    }
+    else if (woken)
+    {
+        m_cv.notify_one();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Pipeline::workerTask()
+{
+    Platform::setBackgroundThread();                                        // If the SDK thread is real time a slow node mustn't starve it
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_cv.wait(lock, [this]() { return m_readyCount || m_stopping; });
+
+        if (m_readyCount == 0)                                              // Stopping and everything queued is done
+        {
+            break;
+        }
+
+        Vertex& v = *m_ready[m_readyHead];
+        m_readyHead = (m_readyHead + 1) % m_ready.size();
+        m_readyCount--;
+
+        Batch* batch = v.queue[v.head];
+        v.head = (v.head + 1) % queueDepth;
+        v.count--;
+        v.depth->set(v.count);
+        lock.unlock();
+
+        {
+            Metrics::Timer timer(*v.processNs);
+            v.node->process(*batch);
+        }
+        v.rows->add(batch->rows);
+        v.batches->add();
+
+        lock.lock();
+        release(batch);
+
+        // One batch at a time so a busy node doesn't hold a thread the others are waiting for
+        if (v.count)
+        {
+            m_ready[(m_readyHead + m_readyCount) % m_ready.size()] = &v;
+            m_readyCount++;
+        }
+        else
+        {
+            v.scheduled = false;
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Pipeline::report(uint64_t nowUs)
+{
+    const real_t seconds = (nowUs - m_lastReportUs) * 0.000001;
+    m_lastReportUs = nowUs;
+
+    for (std::unique_ptr<Vertex>& v : m_vertices)
+    {
+        if (v->node == nullptr && v->outputs.empty())
+        {
+            continue;
+        }
+
+        uint_t maxDepth;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            maxDepth = v->maxDepth;
+            v->maxDepth = 0;
+        }
+
+        const uint64_t rows = v->rows->value();
+        const uint64_t dropped = v->dropped->value();
+
+        if (v->node)
+        {
+            Debug::log(Debug::Severity::Info, "Pipeline", "%-16s %8.1f rows/s  queue max %2u of %u  p99 %.3f ms  dropped %llu", v->name.c_str(), (rows - v->reportedRows) / seconds, FMT_U(maxDepth), FMT_U(queueDepth),
+                       v->processNs->quantile(0.99) * 0.000001, static_cast<unsigned long long>(dropped - v->reportedDropped));
+        }
+        else
+        {
+            Debug::log(Debug::Severity::Info, "Pipeline", "%-16s %8.1f rows/s  source  dropped %llu", v->name.c_str(), (rows - v->reportedRows) / seconds, static_cast<unsigned long long>(dropped - v->reportedDropped));
+        }
+
+        v->reportedRows = rows;
+        v->reportedDropped = dropped;
+    }
+}
+//--------------------------------------------------------------------------------------------------
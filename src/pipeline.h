@@ -0,0 +1,163 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include "heapMonitor.h"
+#include "metrics.h"
+#include <algorithm>
+#include <condition_variable>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // A dataflow graph for processing device data, read from a text file so processing can be rewired
+    // for a mission without rebuilding. Each line is a node, name,type,input and then key=value
+    // parameters, eg.
+    //     smooth,average,depth,window=20
+    //     shallow,threshold,smooth,channel=1,below=2.5
+    //     log,csv,shallow,file=shallow.csv
+    // An input is a node above it or a source, so there are no cycles, and a node can feed any number of
+    // others. Sources are the device data the Apps push: depth, temperature, altitude, ahrs and ping.
+    // Rows are pushed on the SDK thread into batches of up to batchRows and passed on when full or
+    // flushPeriodMs old. Every node has a queue of queueDepth batches, one arriving at a full queue is
+    // dropped and counted so a slow node never holds up the SDK thread or the rest of the graph. Nodes
+    // with batches waiting run on a pool of threads, each node on one thread at a time and in order so
+    // they can keep state. Batches are shared by reference count between the nodes reading them and come
+    // from a pool that static memory builds allocate in start(). Each node's rows, batches, drops, queue
+    // depth and processing time are metrics labelled with its name, and a summary is logged regularly.
+    class Pipeline
+    {
+    private:
+        struct Vertex;
+
+    public:
+        static constexpr uint_t batchRows = 64;
+        static constexpr uint_t batchValues = 8192;                         // A sonar ping is one row, longer rows are cut
+        static constexpr uint_t queueDepth = 16;                            // Batches waiting at each node
+        static constexpr uint_t poolBatches = HeapMonitor::enabled ? 64 : 16;   // Allocated in start(), static builds never add more
+        static constexpr uint_t flushPeriodMs = 200;
+        static constexpr uint_t reportPeriodMs = 10000;
+
+        typedef std::map<std::string, std::string> Params;
+
+        struct Batch
+        {
+            uint_t channels;                                                // Values in each row
+            uint_t rows;
+            uint64_t timeUs[batchRows];                                     // Platform::getTimeUs() clock
+            uint32_t device[batchRows];                                     // TelemetryServer::sourceId()
+            real_t values[batchValues];                                     // Row after row
+            uint_t refs;                                                    // Nodes yet to process it, guarded by m_mutex
+
+            uint_t capacity() const { return channels ? std::min(batchRows, batchValues / channels) : batchRows; }
+            const real_t* row(uint_t i) const { return &values[i * channels]; }
+            real_t* row(uint_t i) { return &values[i * channels]; }
+        };
+
+        // A filter, detector, renderer or sink. The types are made by create() in pipelineNodes.cpp
+        class Node
+        {
+        public:
+            Node() : m_pipeline(nullptr), m_vertex(nullptr) {}
+            virtual ~Node() {}
+            virtual bool_t setup(const std::string& name, const Params& params) = 0;    // False if a parameter is bad
+            virtual void process(const Batch& batch) = 0;                   // On a pool thread, never two at once
+            virtual void stop() {}                                          // No batches after this, finish files
+
+        protected:
+            Batch* newBatch(uint_t channels);                               // nullptr and counted as a drop when the pool is empty
+            void emit(Batch* batch);                                        // To the nodes reading this one
+            static real_t param(const Params& params, const char* key, real_t value);   // value if the key isn't given
+            static std::string text(const Params& params, const char* key, const char* value);
+
+        private:
+            friend class Pipeline;
+            Pipeline* m_pipeline;
+            Vertex* m_vertex;
+        };
+
+        // Device data going into the graph. push() costs a test of wanted() when nothing reads the source.
+        class Source
+        {
+        public:
+            Source(Pipeline& pipeline, Vertex& vertex) : m_pipeline(pipeline), m_vertex(vertex), m_wanted(false), m_filling(nullptr), m_startUs(0) {}
+            bool_t wanted() const { return m_wanted; }
+            void push(uint64_t hostUs, uint32_t device, std::initializer_list<real_t> values, const uint16_t* data = nullptr, uint_t dataSize = 0);   // Values then data make the row
+
+        private:
+            friend class Pipeline;
+            Pipeline& m_pipeline;
+            Vertex& m_vertex;
+            bool_t m_wanted;                                                // Only changed on the SDK thread
+            Batch* m_filling;
+            uint64_t m_startUs;
+
+            void flush();
+        };
+
+        Pipeline();
+        ~Pipeline();
+        static Pipeline& global();
+        Source& source(const std::string& name);                            // The Apps get theirs when made, before or after start()
+        bool_t start(const std::string& fileName, uint_t threads);          // False, with nothing running, if the file is missing or wrong
+        void stop();                                                        // Flushes the sources and processes everything queued
+        bool_t running() const { return !m_threads.empty(); }
+        void run();                                                         // Call regularly on the SDK thread to flush sources and report
+
+    private:
+        struct Vertex
+        {
+            std::string name;
+            std::unique_ptr<Node> node;                                     // Null for a source
+            std::unique_ptr<Source> source;
+            std::vector<Vertex*> outputs;
+            Batch* queue[queueDepth];                                       // Ring buffer, guarded by m_mutex with the rest
+            uint_t head;
+            uint_t count;
+            bool_t scheduled;                                               // Waiting in m_ready or being processed
+            Metrics::Counter* rows;
+            Metrics::Counter* batches;
+            Metrics::Counter* dropped;
+            Metrics::Gauge* depth;
+            Metrics::Histogram* processNs;
+            uint64_t reportedRows;                                          // The rest are used by run() for the report
+            uint64_t reportedDropped;
+            uint_t maxDepth;
+        };
+
+        std::vector<std::unique_ptr<Vertex>> m_vertices;                    // Sources stay when the graph is reloaded
+        std::vector<std::unique_ptr<Batch>> m_batches;
+        std::vector<Batch*> m_free;
+        std::vector<Vertex*> m_ready;                                       // Ring buffer, a vertex is in it at most once
+        uint_t m_readyHead;
+        uint_t m_readyCount;
+        bool_t m_stopping;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::vector<std::thread> m_threads;
+        uint64_t m_lastReportUs;
+
+        static std::unique_ptr<Node> create(const std::string& type);      // nullptr for an unknown type
+        Vertex* find(const std::string& name, bool_t node);
+        Vertex& add(const std::string& name, bool_t node);
+        bool_t load(const std::string& fileName);
+        Batch* allocate(uint_t channels);
+        void release(Batch* batch);                                         // With m_mutex held
+        void emit(Vertex& from, Batch* batch);
+        void workerTask();
+        void report(uint64_t nowUs);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,670 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "pipeline.h"
+#include "platform/debug.h"
+#include "files/bmpFile.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#if defined(OS_UNIX)
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <sys/mman.h>
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
+using namespace IslSdk;
+
+// The node types of a pipeline file and their parameters, defaults in brackets
+//     average     window (10)                 Mean of the last window rows of each device, every channel
+//     decimate    every (10)                  Every nth row of each device
+//     threshold   channel (0) above or below, hysteresis (0)
+//                                             Logs each device crossing the level and back and outputs
+//                                             the value and 1 on crossing, 0 on coming back
+//     peak        first (0), keep (0)         Largest value from channel first on, eg. the strongest return
+//                                             of a ping. Outputs the first keep channels, where the peak is
+//                                             as a fraction of the channels searched, and its value
+//     waterfall   file, lines (256), first (0), max (0)
+//                                             Renders each row as a line of a greyscale BMP from channel
+//                                             first on, white at max or the image's largest value if 0.
+//                                             The file is rewritten every lines rows
+//     csv         file                        Rows as time in seconds, part.serial number and the values
+//     udp         port, host (127.0.0.1)      Datagrams of an UdpHeader then rows of a uint64_t time in
+//                                             microseconds, uint32_t device and float values, little endian
+//     shm         name, slots (256), values (1024)
+//                                             The latest rows in a POSIX shared memory ring, see SharedMemory
+// A ping row is its angle, minimum and maximum range in mm and the pulse length in mm, then the samples.
+
+namespace
+{
+    typedef Pipeline::Batch Batch;
+    typedef Pipeline::Params Params;
+
+    //----------------------------------------------------------------------------------------------
+    // Appends the time and device of row r of in to out and returns where its values go
+    real_t* addRow(Batch& out, const Batch& in, uint_t r)
+    {
+        out.timeUs[out.rows] = in.timeUs[r];
+        out.device[out.rows] = in.device[r];
+        return out.row(out.rows++);
+    }
+
+    //----------------------------------------------------------------------------------------------
+    class Average : public Pipeline::Node
+    {
+    public:
+        bool_t setup(const std::string& name, const Params& params) override
+        {
+            m_window = static_cast<uint_t>(param(params, "window", 10));
+            if (m_window == 0 || m_window > 4096)
+            {
+                Debug::log(Debug::Severity::Error, "Pipeline", "%s window must be 1 to 4096", name.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        void process(const Batch& in) override
+        {
+            Batch* out = newBatch(in.channels);
+            if (out == nullptr)
+            {
+                return;
+            }
+
+            for (uint_t r = 0; r < in.rows; r++)
+            {
+                State& s = m_devices[in.device[r]];
+                const real_t* x = in.row(r);
+
+                if (s.sum.size() != in.channels)
+                {
+                    s.sum.assign(in.channels, 0);
+                    s.ring.assign(m_window * in.channels, 0);
+                    s.count = 0;
+                    s.next = 0;
+                }
+
+                real_t* oldest = &s.ring[s.next * in.channels];
+                for (uint_t c = 0; c < in.channels; c++)
+                {
+                    s.sum[c] += x[c] - (s.count == m_window ? oldest[c] : 0);
+                    oldest[c] = x[c];
+                }
+                s.count = std::min(s.count + 1, m_window);
+                s.next = (s.next + 1) % m_window;
+
+                if (s.next == 0)                                            // Summed again each time round so rounding doesn't build up
+                {
+                    std::fill(s.sum.begin(), s.sum.end(), 0);
+                    for (uint_t i = 0; i < s.ring.size(); i++)
+                    {
+                        s.sum[i % in.channels] += s.ring[i];
+                    }
+                }
+
+                real_t* y = addRow(*out, in, r);
+                for (uint_t c = 0; c < in.channels; c++)
+                {
+                    y[c] = s.sum[c] / s.count;
+                }
+            }
+            emit(out);
+        }
+
+    private:
+        struct State
+        {
+            std::vector<real_t> sum;
+            std::vector<real_t> ring;
+            uint_t count;
+            uint_t next;
+        };
+
+        uint_t m_window;
+        std::map<uint32_t, State> m_devices;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    class Decimate : public Pipeline::Node
+    {
+    public:
+        bool_t setup(const std::string& name, const Params& params) override
+        {
+            m_every = static_cast<uint_t>(param(params, "every", 10));
+            if (m_every == 0)
+            {
+                Debug::log(Debug::Severity::Error, "Pipeline", "%s every must be 1 or more", name.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        void process(const Batch& in) override
+        {
+            Batch* out = newBatch(in.channels);
+            if (out == nullptr)
+            {
+                return;
+            }
+
+            for (uint_t r = 0; r < in.rows; r++)
+            {
+                uint_t& count = m_devices[in.device[r]];
+                if (count++ % m_every == 0)
+                {
+                    memcpy(addRow(*out, in, r), in.row(r), in.channels * sizeof(real_t));
+                }
+            }
+            emit(out);
+        }
+
+    private:
+        uint_t m_every;
+        std::map<uint32_t, uint_t> m_devices;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    class Threshold : public Pipeline::Node
+    {
+    public:
+        bool_t setup(const std::string& name, const Params& params) override
+        {
+            m_name = name;
+            m_channel = static_cast<uint_t>(param(params, "channel", 0));
+            m_above = params.count("above") != 0;
+            m_level = param(params, m_above ? "above" : "below", 0);
+            m_hysteresis = param(params, "hysteresis", 0);
+
+            if (params.count("above") + params.count("below") != 1 || m_hysteresis < 0)
+            {
+                Debug::log(Debug::Severity::Error, "Pipeline", "%s needs either above or below and a positive hysteresis", name.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        void process(const Batch& in) override
+        {
+            Batch* out = newBatch(2);
+            if (out == nullptr)
+            {
+                return;
+            }
+
+            if (m_channel >= in.channels)
+            {
+                emit(out);
+                return;
+            }
+
+            for (uint_t r = 0; r < in.rows; r++)
+            {
+                bool_t& alarm = m_devices[in.device[r]];
+                const real_t v = in.row(r)[m_channel];
+                const bool_t crossed = m_above ? v > m_level : v < m_level;
+                const bool_t back = m_above ? v < m_level - m_hysteresis : v > m_level + m_hysteresis;
+
+                if (alarm ? back : crossed)
+                {
+                    alarm = !alarm;
+                    real_t* y = addRow(*out, in, r);
+                    y[0] = v;
+                    y[1] = alarm;
+                    Debug::log(alarm ? Debug::Severity::Notice : Debug::Severity::Info, "Pipeline", "%s %04u.%04u %.3f %s %s %.3f", m_name.c_str(), in.device[r] >> 16, in.device[r] & 0xffff, v, alarm ? "crossed" : "back",
+                               m_above ? "above" : "below", m_level);
+                }
+            }
+            emit(out);
+        }
+
+    private:
+        std::string m_name;
+        uint_t m_channel;
+        bool_t m_above;
+        real_t m_level;
+        real_t m_hysteresis;
+        std::map<uint32_t, bool_t> m_devices;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    class Peak : public Pipeline::Node
+    {
+    public:
+        bool_t setup(const std::string& name, const Params& params) override
+        {
+            m_first = static_cast<uint_t>(param(params, "first", 0));
+            m_keep = static_cast<uint_t>(param(params, "keep", 0));
+            if (m_keep > m_first)
+            {
+                Debug::log(Debug::Severity::Error, "Pipeline", "%s can only keep channels before first", name.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        void process(const Batch& in) override
+        {
+            Batch* out = newBatch(m_keep + 2);
+            if (out == nullptr)
+            {
+                return;
+            }
+
+            if (in.channels <= m_first)
+            {
+                emit(out);
+                return;
+            }
+
+            for (uint_t r = 0; r < in.rows; r++)
+            {
+                const real_t* x = in.row(r);
+                uint_t peak = m_first;
+
+                for (uint_t c = m_first + 1; c < in.channels; c++)
+                {
+                    peak = x[c] > x[peak] ? c : peak;
+                }
+
+                real_t* y = addRow(*out, in, r);
+                memcpy(y, x, m_keep * sizeof(real_t));
+                y[m_keep] = static_cast<real_t>(peak - m_first) / (in.channels - m_first);
+                y[m_keep + 1] = x[peak];
+            }
+            emit(out);
+        }
+
+    private:
+        uint_t m_first;
+        uint_t m_keep;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    class Waterfall : public Pipeline::Node
+    {
+    public:
+        static constexpr uint_t maxWidth = 4096;
+
+        bool_t setup(const std::string& name, const Params& params) override
+        {
+            m_name = name;
+            m_fileName = text(params, "file", "");
+            m_lines = static_cast<uint_t>(param(params, "lines", 256));
+            m_first = static_cast<uint_t>(param(params, "first", 0));
+            m_max = param(params, "max", 0);
+            m_width = 0;
+            m_line = 0;
+
+            if (m_fileName.empty() || m_lines == 0 || m_lines > 4096)
+            {
+                Debug::log(Debug::Severity::Error, "Pipeline", "%s needs a file and 1 to 4096 lines", name.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        void process(const Batch& in) override
+        {
+            const uint_t width = in.channels > m_first ? std::min(in.channels - m_first, maxWidth) : 0;
+
+            if (width != m_width)
+            {
+                save();
+                m_width = width;
+                m_values.assign(m_width * m_lines, 0);
+                m_pixels.assign(m_width * m_lines, 0);
+            }
+
+            for (uint_t r = 0; r < in.rows && m_width; r++)
+            {
+                memcpy(&m_values[m_line * m_width], in.row(r) + m_first, m_width * sizeof(real_t));
+                if (++m_line == m_lines)
+                {
+                    save();
+                }
+            }
+        }
+
+        void stop() override
+        {
+            save();
+        }
+
+    private:
+        std::string m_name;
+        std::string m_fileName;
+        uint_t m_lines;
+        uint_t m_first;
+        real_t m_max;
+        uint_t m_width;
+        uint_t m_line;
+        std::vector<real_t> m_values;
+        std::vector<uint32_t> m_pixels;
+
+        void save()
+        {
+            if (m_line == 0)
+            {
+                return;
+            }
+
+            const uint_t count = m_line * m_width;
+            real_t max = m_max;
+
+            for (uint_t i = 0; i < count && m_max <= 0; i++)
+            {
+                max = std::max(max, m_values[i]);
+            }
+
+            const real_t scale = max > 0 ? 255 / max : 0;
+            for (uint_t i = 0; i < count; i++)
+            {
+                const uint32_t g = static_cast<uint32_t>(std::min<real_t>(std::max<real_t>(m_values[i] * scale, 0), 255));
+                m_pixels[i] = 0xff000000 | (g << 16) | (g << 8) | g;
+            }
+
+            if (!BmpFile::save(m_fileName, &m_pixels[0], 32, m_width, m_line))
+            {
+                Debug::log(Debug::Severity::Warning, "Pipeline", "%s can't write %s", m_name.c_str(), m_fileName.c_str());
+            }
+            m_line = 0;
+        }
+    };
+
+    //----------------------------------------------------------------------------------------------
+    class CsvFile : public Pipeline::Node
+    {
+    public:
+        CsvFile() : m_file(nullptr), m_channels(0) {}
+
+        bool_t setup(const std::string& name, const Params& params) override
+        {
+            const std::string fileName = text(params, "file", "");
+
+            m_file = fileName.empty() ? nullptr : fopen(fileName.c_str(), "w");
+            if (m_file == nullptr)
+            {
+                Debug::log(Debug::Severity::Error, "Pipeline", "%s can't write the file '%s'", name.c_str(), fileName.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        void process(const Batch& in) override
+        {
+            if (in.channels != m_channels)                                  // A heading for the first rows and if they change
+            {
+                m_channels = in.channels;
+                fprintf(m_file, "timeS,device");
+                for (uint_t c = 0; c < m_channels; c++)
+                {
+                    fprintf(m_file, ",v%u", FMT_U(c));
+                }
+                fprintf(m_file, "\n");
+            }
+
+            for (uint_t r = 0; r < in.rows; r++)
+            {
+                const real_t* x = in.row(r);
+
+                fprintf(m_file, "%.6f,%04u.%04u", in.timeUs[r] * 0.000001, in.device[r] >> 16, in.device[r] & 0xffff);
+                for (uint_t c = 0; c < in.channels; c++)
+                {
+                    fprintf(m_file, ",%g", x[c]);
+                }
+                fprintf(m_file, "\n");
+            }
+        }
+
+        void stop() override
+        {
+            if (m_file)
+            {
+                fclose(m_file);
+                m_file = nullptr;
+            }
+        }
+
+    private:
+        FILE* m_file;
+        uint_t m_channels;
+    };
+
+#ifdef OS_UNIX
+    //----------------------------------------------------------------------------------------------
+    class UdpSocket : public Pipeline::Node
+    {
+    public:
+        static constexpr uint32_t magic = 0x504c5349;                       // "ISLP"
+        static constexpr uint_t maxDatagram = 65000;
+
+        struct UdpHeader
+        {
+            uint32_t magic;
+            uint16_t channels;
+            uint16_t rows;
+            uint32_t seq;                                                   // Gaps are lost datagrams
+            uint32_t reserved;
+        };
+
+        UdpSocket() : m_socket(-1), m_seq(0) {}
+        ~UdpSocket() { stop(); }
+
+        bool_t setup(const std::string& name, const Params& params) override
+        {
+            const std::string host = text(params, "host", "127.0.0.1");
+            const uint_t port = static_cast<uint_t>(param(params, "port", 0));
+
+            memset(&m_address, 0, sizeof(m_address));
+            m_address.sin_family = AF_INET;
+            m_address.sin_port = htons(static_cast<uint16_t>(port));
+
+            if (port == 0 || port > 65535 || inet_pton(AF_INET, host.c_str(), &m_address.sin_addr) != 1 || (m_socket = socket(AF_INET, SOCK_DGRAM, 0)) < 0)
+            {
+                Debug::log(Debug::Severity::Error, "Pipeline", "%s needs a port and an IPv4 host", name.c_str());
+                return false;
+            }
+            m_buf.resize(maxDatagram);
+            return true;
+        }
+
+        void process(const Batch& in) override
+        {
+            // A row that won't fit a datagram on its own is cut short
+            const uint_t channels = std::min<uint_t>(in.channels, (maxDatagram - sizeof(UdpHeader) - 12) / sizeof(float));
+            const uint_t rowSize = 12 + channels * sizeof(float);
+            const uint_t rowsPerDatagram = (maxDatagram - sizeof(UdpHeader)) / rowSize;
+
+            for (uint_t r = 0; r < in.rows; r += rowsPerDatagram)
+            {
+                const uint_t rows = std::min(in.rows - r, rowsPerDatagram);
+                const UdpHeader header = { magic, static_cast<uint16_t>(channels), static_cast<uint16_t>(rows), m_seq++, 0 };
+                uint8_t* p = &m_buf[0];
+
+                memcpy(p, &header, sizeof(header));
+                p += sizeof(header);
+
+                for (uint_t i = r; i < r + rows; i++)
+                {
+                    const real_t* x = in.row(i);
+                    memcpy(p, &in.timeUs[i], 8);
+                    memcpy(p + 8, &in.device[i], 4);
+                    p += 12;
+                    for (uint_t c = 0; c < channels; c++, p += sizeof(float))
+                    {
+                        const float v = static_cast<float>(x[c]);
+                        memcpy(p, &v, sizeof(v));
+                    }
+                }
+                sendto(m_socket, &m_buf[0], p - &m_buf[0], MSG_DONTWAIT, reinterpret_cast<const struct sockaddr*>(&m_address), sizeof(m_address));
+            }
+        }
+
+        void stop() override
+        {
+            if (m_socket >= 0)
+            {
+                close(m_socket);
+                m_socket = -1;
+            }
+        }
+
+    private:
+        int m_socket;
+        struct sockaddr_in m_address;
+        uint32_t m_seq;
+        std::vector<uint8_t> m_buf;
+    };
+
+    //----------------------------------------------------------------------------------------------
+    // The latest rows in a ring of fixed size slots. Readers map the segment read only, wait for
+    // written to change and read the slots up to it. A slot's seq is odd while it's being written and
+    // 2 * (row number + 1) once done, so a reader copies the slot and keeps it if seq was even and the
+    // same before and after. Rows of more than values channels are cut short.
+    class SharedMemory : public Pipeline::Node
+    {
+    public:
+        static constexpr uint32_t magic = 0x534c5349;                       // "ISLS"
+
+        struct ShmHeader
+        {
+            uint32_t magic;
+            uint32_t slots;
+            uint32_t slotSize;                                              // Bytes from one slot to the next
+            uint32_t slotValues;
+            std::atomic<uint32_t> written;                                  // Rows written since the start
+            uint32_t reserved[3];
+        };
+
+        struct ShmSlot
+        {
+            std::atomic<uint32_t> seq;
+            uint32_t device;
+            uint64_t timeUs;
+            uint32_t channels;
+            uint32_t reserved;
+            float values[1];                                                // slotValues of them
+        };
+
+        SharedMemory() : m_fd(-1), m_map(nullptr), m_size(0) {}
+        ~SharedMemory() { stop(); }
+
+        bool_t setup(const std::string& name, const Params& params) override
+        {
+            const uint_t slots = static_cast<uint_t>(param(params, "slots", 256));
+            const uint_t values = static_cast<uint_t>(param(params, "values", 1024));
+            const uint_t slotSize = (offsetof(ShmSlot, values) + values * sizeof(float) + 7) & ~7u;
+
+            m_name = text(params, "name", "");
+            m_size = sizeof(ShmHeader) + slots * slotSize;
+
+            if (m_name.size() < 2 || m_name[0] != '/' || slots == 0 || values == 0 || values > Pipeline::batchValues)
+            {
+                Debug::log(Debug::Severity::Error, "Pipeline", "%s needs a name like /islPipeline and slots and values of at least 1", name.c_str());
+                return false;
+            }
+
+            m_fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644);
+            if (m_fd < 0 || ftruncate(m_fd, m_size) != 0 || (m_map = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0)) == MAP_FAILED)
+            {
+                m_map = nullptr;
+                Debug::log(Debug::Severity::Error, "Pipeline", "%s can't map shared memory %s", name.c_str(), m_name.c_str());
+                stop();
+                return false;
+            }
+
+            memset(m_map, 0, m_size);
+            ShmHeader* header = new (m_map) ShmHeader;
+            header->magic = magic;
+            header->slots = slots;
+            header->slotSize = slotSize;
+            header->slotValues = values;
+            header->written.store(0, std::memory_order_release);
+            return true;
+        }
+
+        void process(const Batch& in) override
+        {
+            ShmHeader& header = *static_cast<ShmHeader*>(m_map);
+            uint8_t* slots = static_cast<uint8_t*>(m_map) + sizeof(ShmHeader);
+            const uint_t channels = std::min<uint_t>(in.channels, header.slotValues);
+
+            for (uint_t r = 0; r < in.rows; r++)
+            {
+                const uint32_t n = header.written.load(std::memory_order_relaxed);
+                ShmSlot& slot = *reinterpret_cast<ShmSlot*>(slots + (n % header.slots) * header.slotSize);
+                const real_t* x = in.row(r);
+
+                slot.seq.store(2 * n + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                slot.device = in.device[r];
+                slot.timeUs = in.timeUs[r];
+                slot.channels = channels;
+                for (uint_t c = 0; c < channels; c++)
+                {
+                    slot.values[c] = static_cast<float>(x[c]);
+                }
+                slot.seq.store(2 * n + 2, std::memory_order_release);
+                header.written.store(n + 1, std::memory_order_release);
+            }
+        }
+
+        void stop() override
+        {
+            if (m_map)
+            {
+                munmap(m_map, m_size);
+                m_map = nullptr;
+            }
+
+            if (m_fd >= 0)
+            {
+                close(m_fd);
+                shm_unlink(m_name.c_str());
+                m_fd = -1;
+            }
+        }
+
+    private:
+        std::string m_name;
+        int m_fd;
+        void* m_map;
+        size_t m_size;
+    };
+#else
+    //----------------------------------------------------------------------------------------------
+    class Unsupported : public Pipeline::Node
+    {
+    public:
+        bool_t setup(const std::string& name, const Params& params) override
+        {
+            Debug::log(Debug::Severity::Error, "Pipeline", "%s isn't supported on this platform", name.c_str());
+            return false;
+        }
+
+        void process(const Batch& in) override {}
+    };
+
+    typedef Unsupported UdpSocket;
+    typedef Unsupported SharedMemory;
+#endif
+}
+
+//--------------------------------------------------------------------------------------------------
+std::unique_ptr<Pipeline::Node> Pipeline::create(const std::string& type)
+{
+    if (type == "average")   return std::make_unique<Average>();
+    if (type == "decimate")  return std::make_unique<Decimate>();
+    if (type == "threshold") return std::make_unique<Threshold>();
+    if (type == "peak")      return std::make_unique<Peak>();
+    if (type == "waterfall") return std::make_unique<Waterfall>();
+    if (type == "csv")       return std::make_unique<CsvFile>();
+    if (type == "udp")       return std::make_unique<UdpSocket>();
+    if (type == "shm")       return std::make_unique<SharedMemory>();
+    return nullptr;
+}
+//--------------------------------------------------------------------------------------------------
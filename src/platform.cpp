@@ -2,11 +2,23 @@
 
 #include "platform.h"
 
+#include <cerrno>
+#include <cstdlib>
+
 #if defined(OS_WINDOWS)
     #include "windows.h"
     #include <conio.h>
+    #include <malloc.h>
 #elif defined(OS_UNIX)
     #include <unistd.h>
+    #include <time.h>
+    #include <alloca.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #if defined(__GLIBC__)
+        #include <malloc.h>
+    #endif
 #else
     #error "Unsupported platform. Define OS_WINDOWS or OS_UNIX"
 #endif
@@ -41,6 +53,113 @@ int Platform::getKey()
     return _getch();
 }
 //--------------------------------------------------------------------------------------------------
+uint64_t Platform::getTimeUs()
+{
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return static_cast<uint64_t>(count.QuadPart / freq.QuadPart) * 1000000 + static_cast<uint64_t>(count.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Platform::getTimeNs()
+{
+    static LARGE_INTEGER freq = { 0 };
+    LARGE_INTEGER count;
+
+    if (freq.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&freq);
+    }
+    QueryPerformanceCounter(&count);
+    return static_cast<uint64_t>(count.QuadPart / freq.QuadPart) * 1000000000 + static_cast<uint64_t>(count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+}
+//--------------------------------------------------------------------------------------------------
+void Platform::sleepUntilUs(uint64_t timeUs)
+{
+    uint64_t nowUs = getTimeUs();
+
+    // Sleep is only good to the scheduler tick so spin for the last couple of milliseconds
+    if (timeUs > nowUs + 2000)
+    {
+        Sleep(static_cast<DWORD>((timeUs - nowUs) / 1000 - 2));
+    }
+
+    while (getTimeUs() < timeUs)
+    {
+        YieldProcessor();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+static uint64_t fileTimeNs(const FILETIME& kernel, const FILETIME& user)
+{
+    const uint64_t k = (static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+    const uint64_t u = (static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime;
+    return (k + u) * 100;                                               // 100ns units
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Platform::getThreadCpuNs()
+{
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    return fileTimeNs(kernel, user);
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Platform::getProcessCpuNs()
+{
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    return fileTimeNs(kernel, user);
+}
+//--------------------------------------------------------------------------------------------------
+bool Platform::setThreadAffinity(int cpu)
+{
+    DWORD_PTR process, system;
+
+    if (cpu < 0)
+    {
+        return GetProcessAffinityMask(GetCurrentProcess(), &process, &system) && SetThreadAffinityMask(GetCurrentThread(), process) != 0;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+}
+//--------------------------------------------------------------------------------------------------
+bool Platform::setThreadRealTime(int priority)
+{
+    if (priority == 0)
+    {
+        return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL) != 0;
+    }
+    return SetPriorityClass(GetCurrentProcess(), REALTIME_PRIORITY_CLASS) && SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+}
+//--------------------------------------------------------------------------------------------------
+bool Platform::lockMemory()
+{
+    return false;
+}
+//--------------------------------------------------------------------------------------------------
+void Platform::prefaultStack(size_t bytes)
+{
+    volatile char* stack = static_cast<volatile char*>(_alloca(bytes));
+
+    for (size_t i = 0; i < bytes; i += 4096)
+    {
+        stack[i] = 0;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Platform::prefaultHeap(size_t bytes)
+{
+    char* heap = static_cast<char*>(malloc(bytes));
+
+    if (heap)
+    {
+        for (size_t i = 0; i < bytes; i += 4096)
+        {
+            static_cast<volatile char*>(heap)[i] = 0;
+        }
+        free(heap);
+    }
+}
+//--------------------------------------------------------------------------------------------------
 #elif OS_UNIX
 void resetTerminalMode();
 //--------------------------------------------------------------------------------------------------
@@ -87,4 +206,116 @@ int Platform::getKey()
     return getchar();
 }
 //--------------------------------------------------------------------------------------------------
+uint64_t Platform::getTimeUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Platform::getTimeNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+//--------------------------------------------------------------------------------------------------
+void Platform::sleepUntilUs(uint64_t timeUs)
+{
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeUs / 1000000);
+    ts.tv_nsec = static_cast<long>(timeUs % 1000000) * 1000;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR)
+    {
+    }
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Platform::getThreadCpuNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t Platform::getProcessCpuNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+//--------------------------------------------------------------------------------------------------
+bool Platform::setThreadAffinity(int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    if (cpu < 0)
+    {
+        for (int i = 0; i < CPU_SETSIZE; i++)
+        {
+            CPU_SET(i, &set);
+        }
+    }
+    else
+    {
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
 #endif
+}
+//--------------------------------------------------------------------------------------------------
+bool Platform::setThreadRealTime(int priority)
+{
+    struct sched_param param = {};
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), priority ? SCHED_FIFO : SCHED_OTHER, &param) == 0;
+}
+//--------------------------------------------------------------------------------------------------
+bool Platform::lockMemory()
+{
+    return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+}
+//--------------------------------------------------------------------------------------------------
+void Platform::prefaultStack(size_t bytes)
+{
+    volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+
+    for (size_t i = 0; i < bytes; i += 4096)
+    {
+        stack[i] = 0;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void Platform::prefaultHeap(size_t bytes)
+{
+#if defined(__GLIBC__)
+    // Stop free() giving memory back to the OS and large blocks using their own mmap, so the pages
+    // touched here are reused by later allocations instead of faulting in new ones
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+#endif
+
+    char* heap = static_cast<char*>(malloc(bytes));
+
+    if (heap)
+    {
+        for (size_t i = 0; i < bytes; i += 4096)
+        {
+            static_cast<volatile char*>(heap)[i] = 0;
+        }
+        free(heap);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+#endif
+//--------------------------------------------------------------------------------------------------
+void Platform::setBackgroundThread()
+{
+    setThreadRealTime(0);
+    setThreadAffinity(-1);
+}
+//--------------------------------------------------------------------------------------------------
@@ -4,6 +4,8 @@
 //------------------------------------------ Includes ----------------------------------------------
 
 #include <string>
+#include <cstdint>
+#include <cstddef>
 
 //--------------------------------------- Class Definition -----------------------------------------
 
@@ -16,6 +18,20 @@ namespace IslSdk
         void setTerminalMode();
         int keyboardPressed();
         int getKey();
+        uint64_t getTimeUs();                   // Monotonic time, not related to wall clock time
+        uint64_t getTimeNs();                   // Same clock as getTimeUs() in nanoseconds
+        void sleepUntilUs(uint64_t timeUs);     // Absolute time on the getTimeUs() clock, for loops with a fixed period
+        uint64_t getThreadCpuNs();              // CPU time used by the calling thread
+        uint64_t getProcessCpuNs();             // CPU time used by all threads of the process
+
+        // Real time support for the calling thread. Each returns false if the OS refused, usually for
+        // lack of privileges (CAP_SYS_NICE and CAP_IPC_LOCK or a raised RLIMIT_RTPRIO and RLIMIT_MEMLOCK).
+        bool setThreadAffinity(int cpu);        // -1 for any CPU
+        bool setThreadRealTime(int priority);   // SCHED_FIFO at 1 to 99, time critical priority on Windows, 0 for normal scheduling
+        void setBackgroundThread();             // Normal scheduling on any CPU, first thing in a helper thread as new threads inherit both
+        bool lockMemory();                      // Lock current and future pages in RAM so nothing is paged out
+        void prefaultStack(size_t bytes);       // Touch the stack now so the first deep call doesn't page fault
+        void prefaultHeap(size_t bytes);        // Touch heap pages and keep them in the allocator for later use
     }
 }
 //--------------------------------------------------------------------------------------------------
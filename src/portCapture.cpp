@@ -0,0 +1,237 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "portCapture.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+using namespace IslSdk;
+
+// pcapng block types and options, see the pcapng specification (IETF draft-ietf-opsawg-pcapng)
+static constexpr uint32_t blockSectionHeader = 0x0a0d0d0a;
+static constexpr uint32_t blockInterface = 0x00000001;
+static constexpr uint32_t blockEnhancedPacket = 0x00000006;
+static constexpr uint16_t optEnd = 0;
+static constexpr uint16_t optIfName = 2;
+static constexpr uint16_t optIfTsResol = 9;
+static constexpr uint16_t optEpbFlags = 2;
+static constexpr uint16_t linkTypeUser0 = 147;                  // Raw bytes with no link layer
+static constexpr uint32_t snapLen = 0x40000;
+
+static inline uint_t pad4(uint_t size)
+{
+    return (size + 3) & ~3u;
+}
+
+//--------------------------------------------------------------------------------------------------
+PortCapture::PortCapture() : m_file(nullptr), m_epochUs(0), m_startUs(0), m_backFull(false), m_stopping(false), m_chunks(0), m_bytes(0), m_dropped(0)
+{
+}
+//--------------------------------------------------------------------------------------------------
+PortCapture::~PortCapture()
+{
+    stop();
+}
+//--------------------------------------------------------------------------------------------------
+void PortCapture::select(const std::vector<std::string>& portNames)
+{
+    m_selected = portNames;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t PortCapture::isSelected(const std::string& portName) const
+{
+    return m_selected.empty() || std::find(m_selected.begin(), m_selected.end(), portName) != m_selected.end();
+}
+//--------------------------------------------------------------------------------------------------
+bool_t PortCapture::start(const std::string& fileName)
+{
+    stop();
+
+    m_file = fopen(fileName.c_str(), "wb");
+    if (m_file == nullptr)
+    {
+        Debug::log(Debug::Severity::Warning, "Capture", "Can't create %s", fileName.c_str());
+        return false;
+    }
+
+    m_epochUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    m_startUs = Platform::getTimeUs();
+    m_interfaces.clear();
+    m_front.clear();
+    m_back.clear();
+    m_front.reserve(bufferSize);
+    m_back.reserve(bufferSize);
+    m_backFull = false;
+    m_stopping = false;
+    m_chunks = 0;
+    m_bytes = 0;
+    m_dropped = 0;
+
+    appendSectionHeader();
+    m_writer = std::thread(&PortCapture::writerTask, this);
+
+    Debug::log(Debug::Severity::Notice, "Capture", "Capturing to %s", fileName.c_str());
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+void PortCapture::stop()
+{
+    if (m_file == nullptr)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    m_writer.join();
+
+    fclose(m_file);
+    m_file = nullptr;
+
+    Debug::log(Debug::Severity::Notice, "Capture", "Capture stopped, %llu chunks, %llu bytes, %llu chunks dropped", static_cast<unsigned long long>(m_chunks),
+               static_cast<unsigned long long>(m_bytes), static_cast<unsigned long long>(m_dropped));
+}
+//--------------------------------------------------------------------------------------------------
+void PortCapture::write(SysPort& sysPort, const uint8_t* data, uint_t size, bool_t inbound)
+{
+    if (m_file == nullptr)
+    {
+        return;
+    }
+
+    const uint64_t timeUs = m_epochUs + (Platform::getTimeUs() - m_startUs);
+    const uint32_t capLen = std::min<uint32_t>(size, snapLen);
+    const uint32_t blockLen = 28 + pad4(capLen) + 12 + 4;
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_interfaces.find(sysPort.name);
+    const bool_t newInterface = it == m_interfaces.end();
+
+    if (!hasRoom(blockLen + (newInterface ? 64 + pad4(sysPort.name.size()) : 0)))
+    {
+        m_dropped++;
+        return;
+    }
+
+    if (newInterface)
+    {
+        it = m_interfaces.emplace(sysPort.name, static_cast<uint32_t>(m_interfaces.size())).first;
+        appendInterface(sysPort.name);
+    }
+
+    const uint32_t header[7] = { blockEnhancedPacket, blockLen, it->second, static_cast<uint32_t>(timeUs >> 32), static_cast<uint32_t>(timeUs), capLen, static_cast<uint32_t>(size) };
+    const uint32_t flags = inbound ? 1 : 2;
+    const uint32_t zero = 0;
+
+    append(header, sizeof(header));
+    append(data, capLen);
+    append(&zero, pad4(capLen) - capLen);
+    appendOption(optEpbFlags, &flags, sizeof(flags));
+    appendOption(optEnd, nullptr, 0);
+    append(&blockLen, sizeof(blockLen));
+
+    m_chunks++;
+    m_bytes += size;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t PortCapture::hasRoom(uint_t size)
+{
+    if (m_front.size() + size <= bufferSize)
+    {
+        return true;
+    }
+
+    if (m_backFull)
+    {
+        return false;                                                       // The writer is still busy with the other buffer
+    }
+
+    m_front.swap(m_back);
+    m_backFull = true;
+    m_cv.notify_one();
+    return size <= bufferSize;
+}
+//--------------------------------------------------------------------------------------------------
+void PortCapture::append(const void* data, uint_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    m_front.insert(m_front.end(), bytes, bytes + size);
+}
+//--------------------------------------------------------------------------------------------------
+void PortCapture::appendOption(uint16_t code, const void* data, uint_t size)
+{
+    const uint16_t header[2] = { code, static_cast<uint16_t>(size) };
+    const uint32_t zero = 0;
+
+    append(header, sizeof(header));
+    append(data, size);
+    append(&zero, pad4(size) - size);
+}
+//--------------------------------------------------------------------------------------------------
+void PortCapture::appendSectionHeader()
+{
+    const uint32_t blockLen = 28;
+    const uint32_t header[3] = { blockSectionHeader, blockLen, 0x1a2b3c4d };   // Byte order magic, readers swap if we're big endian
+    const uint16_t version[2] = { 1, 0 };
+    const int64_t sectionLen = -1;                                              // Unknown, the file is written as it goes
+
+    append(header, sizeof(header));
+    append(version, sizeof(version));
+    append(&sectionLen, sizeof(sectionLen));
+    append(&blockLen, sizeof(blockLen));
+}
+//--------------------------------------------------------------------------------------------------
+void PortCapture::appendInterface(const std::string& name)
+{
+    const uint32_t blockLen = 16 + 4 + pad4(name.size()) + 8 + 4 + 4;
+    const uint32_t header[2] = { blockInterface, blockLen };
+    const uint16_t linkType[2] = { linkTypeUser0, 0 };
+    const uint8_t tsResol = 6;                                                  // Microseconds
+
+    append(header, sizeof(header));
+    append(linkType, sizeof(linkType));
+    append(&snapLen, sizeof(snapLen));
+    appendOption(optIfName, name.data(), name.size());
+    appendOption(optIfTsResol, &tsResol, sizeof(tsResol));
+    appendOption(optEnd, nullptr, 0);
+    append(&blockLen, sizeof(blockLen));
+}
+//--------------------------------------------------------------------------------------------------
+void PortCapture::writerTask()
+{
+    Platform::setBackgroundThread();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_cv.wait_for(lock, std::chrono::milliseconds(flushPeriodMs), [this] { return m_backFull || m_stopping; });
+
+        // Take whatever is in the front buffer on a quiet port, or to finish
+        if (!m_backFull && !m_front.empty())
+        {
+            m_front.swap(m_back);
+            m_backFull = true;
+        }
+
+        if (m_backFull)
+        {
+            lock.unlock();
+            fwrite(m_back.data(), 1, m_back.size(), m_file);
+            fflush(m_file);
+            m_back.clear();
+            lock.lock();
+            m_backFull = false;
+        }
+        else if (m_stopping)
+        {
+            break;
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
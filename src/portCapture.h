@@ -0,0 +1,66 @@
+#ifndef PORTCAPTURE_H_
+#define PORTCAPTURE_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "comms/ports/sysPort.h"
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Captures the raw bytes of selected ports to a pcapng file, one interface per port named after it
+    // and one enhanced packet block per chunk with a microsecond timestamp and the direction. Blocks are
+    // built in the front buffer on the SDK thread and a background thread writes the back buffer, so
+    // writing never blocks sdk.run(). If the disk falls so far behind that both buffers are full,
+    // chunks are dropped and counted rather than stalling the ports. Open the file in Wireshark or tshark.
+    class PortCapture
+    {
+    public:
+        static constexpr uint_t bufferSize = 4 * 1024 * 1024;              // Per buffer, about 4s of data at 10MB/s
+        static constexpr uint_t flushPeriodMs = 500;
+
+        PortCapture();
+        ~PortCapture();
+        void select(const std::vector<std::string>& portNames);             // Ports to capture, empty for all
+        bool_t isSelected(const std::string& portName) const;
+        bool_t start(const std::string& fileName);
+        void stop();
+        bool_t running() const { return m_file != nullptr; }
+        void write(SysPort& sysPort, const uint8_t* data, uint_t size, bool_t inbound = true);
+
+    private:
+        std::vector<std::string> m_selected;
+        std::unordered_map<std::string, uint32_t> m_interfaces;             // Port name to pcapng interface id, added as each port is first seen
+        FILE* m_file;
+        uint64_t m_epochUs;                                                 // Wall clock at start, pcapng timestamps are since 1970
+        uint64_t m_startUs;
+        std::vector<uint8_t> m_front;
+        std::vector<uint8_t> m_back;
+        bool_t m_backFull;
+        bool_t m_stopping;
+        uint64_t m_chunks;
+        uint64_t m_bytes;
+        uint64_t m_dropped;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::thread m_writer;
+
+        void append(const void* data, uint_t size);
+        void appendOption(uint16_t code, const void* data, uint_t size);
+        void appendSectionHeader();
+        void appendInterface(const std::string& name);
+        bool_t hasRoom(uint_t size);
+        void writerTask();
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
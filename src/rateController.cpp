@@ -0,0 +1,226 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "rateController.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include "metrics.h"
+#include <algorithm>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+RateController::Policy::Policy() : m_deviceKey(0), m_lastLost(0), m_lost(0)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::Policy::setDevice(const Device::Info& info)
+{
+    m_deviceKey = key(info);
+    m_lastLost = 0;
+    m_lost = 0;
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::Policy::packetCount(uint_t resent, uint_t missed)
+{
+    const uint_t lost = resent + missed;
+
+    if (lost > m_lastLost)
+    {
+        m_lost += lost - m_lastLost;
+    }
+    m_lastLost = lost;                                  // Restarts from zero on a reconnect
+}
+//--------------------------------------------------------------------------------------------------
+uint32_t RateController::Policy::intervalMs(const std::string& name) const
+{
+    for (const Stream& stream : streams)
+    {
+        if (stream.name == name)
+        {
+            return stream.intervalMs;
+        }
+    }
+    return 0;
+}
+//--------------------------------------------------------------------------------------------------
+RateController::RateController() : m_lastRunUs(0)
+{
+}
+//--------------------------------------------------------------------------------------------------
+RateController::~RateController()
+{
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t RateController::key(const Device::Info& info)
+{
+    return (static_cast<uint64_t>(info.pid) << 32) | (static_cast<uint64_t>(info.pn) << 16) | info.sn;
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::add(Policy& policy)
+{
+    if (std::find(m_policies.begin(), m_policies.end(), &policy) == m_policies.end())
+    {
+        m_policies.push_back(&policy);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::remove(Policy& policy)
+{
+    m_policies.erase(std::remove(m_policies.begin(), m_policies.end(), &policy), m_policies.end());
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::deviceFound(Device& device, SysPort& sysPort, const ConnectionMeta& meta)
+{
+    device.onPortChanged.disconnect(slotPortChanged);
+    device.onPortChanged.connect(slotPortChanged);
+    setPort(device.info, sysPort, meta);
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::setPort(const Device::Info& info, SysPort& sysPort, const ConnectionMeta& meta)
+{
+    Port& port = m_ports[sysPort.name];
+
+    // 8N1 framing puts 10 bits on the wire for every byte
+    port.bytesPerSec = sysPort.type != SysPort::Type::Net ? meta.baudrate / 10 : 0;
+    if (port.utilisation == nullptr)
+    {
+        port.utilisation = &Metrics::global().gauge("isl_port_utilisation", "port=\"" + sysPort.name + "\"", "Fraction of the serial link's capacity in use");
+    }
+    m_devicePorts[key(info)] = sysPort.name;
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::portStats(SysPort& sysPort, uint_t txBytes, uint_t rxBytes)
+{
+    auto it = m_ports.find(sysPort.name);
+
+    if (it != m_ports.end())
+    {
+        it->second.bytes += txBytes + rxBytes;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::run()
+{
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    if (nowUs - m_lastRunUs < periodMs * static_cast<uint64_t>(1000))
+    {
+        return;
+    }
+
+    const real_t seconds = m_lastRunUs ? (nowUs - m_lastRunUs) * 0.000001 : 0;
+    m_lastRunUs = nowUs;
+
+    for (auto& it : m_ports)
+    {
+        Port& port = it.second;
+        uint_t lost = 0;
+
+        for (Policy* policy : m_policies)
+        {
+            auto dp = m_devicePorts.find(policy->m_deviceKey);
+            if (dp != m_devicePorts.end() && dp->second == it.first)
+            {
+                lost += policy->m_lost;
+                policy->m_lost = 0;
+            }
+        }
+
+        if (port.bytesPerSec && seconds > 0)
+        {
+            const real_t utilisation = port.bytes / (port.bytesPerSec * seconds);
+            port.utilisation->set(utilisation);
+            adjust(it.first, port, utilisation, lost);
+        }
+        port.bytes = 0;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::adjust(const std::string& portName, Port& port, real_t utilisation, uint_t lost)
+{
+    Policy* best = nullptr;
+    Stream* stream = nullptr;
+    const bool_t slowDown = utilisation > highUtilisation || lost;
+
+    if (!slowDown)
+    {
+        port.quietPeriods = utilisation < lowUtilisation ? port.quietPeriods + 1 : 0;
+        if (port.quietPeriods < 2)
+        {
+            return;
+        }
+    }
+
+    // Slow the least important stream that still has room, the busiest of those first. Speed up the most important.
+    for (Policy* policy : m_policies)
+    {
+        auto dp = m_devicePorts.find(policy->m_deviceKey);
+        if (dp == m_devicePorts.end() || dp->second != portName)
+        {
+            continue;
+        }
+
+        for (Stream& s : policy->streams)
+        {
+            if (s.intervalMs == 0 || (slowDown ? s.intervalMs >= s.slowestMs : s.intervalMs <= s.fastestMs))
+            {
+                continue;
+            }
+
+            if (stream == nullptr)
+            {
+                best = policy;
+                stream = &s;
+            }
+            else if (slowDown)
+            {
+                if (s.priority > stream->priority || (s.priority == stream->priority && s.bytes * stream->intervalMs > stream->bytes * s.intervalMs))
+                {
+                    best = policy;
+                    stream = &s;
+                }
+            }
+            else if (s.priority < stream->priority)
+            {
+                best = policy;
+                stream = &s;
+            }
+        }
+    }
+
+    if (stream == nullptr)
+    {
+        return;
+    }
+
+    const uint32_t oldMs = stream->intervalMs;
+    uint32_t newMs;
+
+    if (slowDown)
+    {
+        newMs = std::min(oldMs * 2, stream->slowestMs);
+    }
+    else
+    {
+        newMs = std::max(std::min(oldMs * 3 / 4, oldMs - 1), stream->fastestMs);
+
+        const real_t extra = stream->bytes * (1000.0 / newMs - 1000.0 / oldMs) / port.bytesPerSec;
+        if (utilisation + extra > targetUtilisation)
+        {
+            return;
+        }
+    }
+
+    stream->intervalMs = newMs;
+    port.quietPeriods = 0;
+
+    Debug::log(Debug::Severity::Info, "Rates", "%s %.0f%% used, %u lost, %s %s interval %u -> %u ms", portName.c_str(), utilisation * 100.0, FMT_U(lost),
+               slowDown ? "slowing" : "speeding up", stream->name.c_str(), FMT_U(oldMs), FMT_U(newMs));
+    best->onChange(*best);
+}
+//--------------------------------------------------------------------------------------------------
+void RateController::callbackPortChanged(Device& device, SysPort& sysPort, const ConnectionMeta& meta)
+{
+    setPort(device.info, sysPort, meta);
+}
+//--------------------------------------------------------------------------------------------------
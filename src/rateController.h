@@ -0,0 +1,91 @@
+#ifndef RATECONTROLLER_H_
+#define RATECONTROLLER_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "devices/device.h"
+#include "metrics.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Shares the bandwidth of each serial link between the sensor streams of the devices on it. Every
+    // period the measured utilisation of the port, from portStats(), and the packets the devices on it
+    // have missed or had resent decide one change per port. A busy or lossy link slows the least
+    // important stream that can go slower by doubling its interval. A quiet link speeds up the most
+    // important stream that can go faster by a quarter, if the estimated extra bytes still fit under the
+    // target. Network ports have no capacity set so aren't managed.
+    class RateController
+    {
+    public:
+        static constexpr uint_t periodMs = 2000;
+        static constexpr real_t highUtilisation = 0.85;                    // Above this streams are slowed
+        static constexpr real_t targetUtilisation = 0.7;                   // Streams are only sped up if the estimate stays below this
+        static constexpr real_t lowUtilisation = 0.6;                      // Below this for two periods streams are sped up
+
+        struct Stream
+        {
+            std::string name;
+            uint_t priority;                                                // 0 is the most important
+            uint32_t fastestMs;                                             // Bounds on the interval, equal to pin the rate
+            uint32_t slowestMs;
+            uint32_t bytes;                                                 // Estimated bytes per sample on the link including framing
+            uint32_t intervalMs;                                            // Current interval, 0 if the stream is off
+        };
+
+        // The streams of one device, owned by its App which applies them with setSensorRates() on onChange
+        class Policy
+        {
+        public:
+            Policy();
+            void setDevice(const Device::Info& info);
+            void packetCount(uint_t resent, uint_t missed);                 // Totals since the device connected
+            uint32_t intervalMs(const std::string& name) const;
+
+            std::vector<Stream> streams;
+            Signal<Policy&> onChange;
+
+        private:
+            friend class RateController;
+            uint64_t m_deviceKey;
+            uint_t m_lastLost;
+            uint_t m_lost;                                                  // Since the controller last looked
+        };
+
+        RateController();
+        ~RateController();
+        void add(Policy& policy);
+        void remove(Policy& policy);
+        void deviceFound(Device& device, SysPort& sysPort, const ConnectionMeta& meta);
+        void portStats(SysPort& sysPort, uint_t txBytes, uint_t rxBytes);
+        void run();
+
+        Slot<Device&, SysPort&, const ConnectionMeta&> slotPortChanged{ this, &RateController::callbackPortChanged };
+
+    private:
+        struct Port
+        {
+            uint_t bytesPerSec;                                             // 0 if not managed
+            uint64_t bytes;                                                 // Since the last period
+            uint_t quietPeriods;
+            Metrics::Gauge* utilisation;
+        };
+
+        std::unordered_map<std::string, Port> m_ports;
+        std::unordered_map<uint64_t, std::string> m_devicePorts;           // Device key to the name of the port it's on
+        std::vector<Policy*> m_policies;
+        uint64_t m_lastRunUs;
+
+        static uint64_t key(const Device::Info& info);
+        void setPort(const Device::Info& info, SysPort& sysPort, const ConnectionMeta& meta);
+        void adjust(const std::string& portName, Port& port, real_t utilisation, uint_t lost);
+        void callbackPortChanged(Device& device, SysPort& sysPort, const ConnectionMeta& meta);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
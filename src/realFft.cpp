@@ -0,0 +1,97 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "realFft.h"
+#include <cmath>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+RealFft::RealFft() : m_size(0)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void RealFft::setup(uint_t size)
+{
+    const real_t pi = 3.14159265358979323846;
+    const uint_t half = size / 2;
+
+    m_size = size;
+    m_work.resize(half);
+    m_twiddle.resize(half / 2);
+    m_split.resize(half);
+    m_bitReverse.resize(half);
+
+    for (uint_t i = 0; i < half / 2; i++)
+    {
+        m_twiddle[i] = std::polar<real_t>(1.0, -2.0 * pi * i / half);
+    }
+
+    for (uint_t i = 0; i < half; i++)
+    {
+        m_split[i] = std::polar<real_t>(1.0, -2.0 * pi * i / size);
+    }
+
+    uint_t bits = 0;
+    while ((static_cast<uint_t>(1) << bits) < half)
+    {
+        bits++;
+    }
+
+    for (uint_t i = 0; i < half; i++)
+    {
+        uint32_t r = 0;
+        for (uint_t b = 0; b < bits; b++)
+        {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        m_bitReverse[i] = r;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void RealFft::transform(const real_t* in, std::complex<real_t>* out)
+{
+    const uint_t half = m_size / 2;
+
+    // Pack even samples into the real part and odd samples into the imaginary part so a real FFT of
+    // size N costs one complex FFT of size N / 2 plus a linear split pass
+    for (uint_t i = 0; i < half; i++)
+    {
+        m_work[m_bitReverse[i]] = std::complex<real_t>(in[2 * i], in[2 * i + 1]);
+    }
+
+    complexFft(&m_work[0]);
+
+    out[0] = std::complex<real_t>(m_work[0].real() + m_work[0].imag(), 0.0);
+    out[half] = std::complex<real_t>(m_work[0].real() - m_work[0].imag(), 0.0);
+
+    for (uint_t k = 1; k < half; k++)
+    {
+        const std::complex<real_t> a = m_work[k];
+        const std::complex<real_t> b = std::conj(m_work[half - k]);
+        const std::complex<real_t> even = (a + b) * 0.5;
+        const std::complex<real_t> odd = (a - b) * std::complex<real_t>(0.0, -0.5);
+        out[k] = even + m_split[k] * odd;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void RealFft::complexFft(std::complex<real_t>* data)
+{
+    const uint_t n = m_size / 2;
+
+    for (uint_t len = 2; len <= n; len <<= 1)
+    {
+        const uint_t step = n / len;
+        const uint_t halfLen = len / 2;
+
+        for (uint_t i = 0; i < n; i += len)
+        {
+            for (uint_t j = 0; j < halfLen; j++)
+            {
+                const std::complex<real_t> t = m_twiddle[j * step] * data[i + j + halfLen];
+                data[i + j + halfLen] = data[i + j] - t;
+                data[i + j] += t;
+            }
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,34 @@
+#ifndef REALFFT_H_
+#define REALFFT_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include <complex>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    class RealFft
+    {
+    public:
+        RealFft();
+        void setup(uint_t size);                                                    // size must be a power of 2 and >= 4
+        void transform(const real_t* in, std::complex<real_t>* out);                // out must hold size / 2 + 1 bins
+        uint_t size() const { return m_size; }
+
+    private:
+        uint_t m_size;
+        std::vector<std::complex<real_t>> m_work;
+        std::vector<std::complex<real_t>> m_twiddle;                                // Twiddles for the size / 2 complex FFT
+        std::vector<std::complex<real_t>> m_split;                                  // Twiddles for the real spectrum split
+        std::vector<uint32_t> m_bitReverse;
+
+        void complexFft(std::complex<real_t>* data);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,201 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "slotProfiler.h"
+#include "platform/debug.h"
+#include <algorithm>
+#include <cstdio>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+SlotProfiler::Site::Site(const char* name) : name(name), histogram(Metrics::global().histogram("isl_callback_duration_seconds", std::string("callback=\"") + name + "\"", "Time spent in example app callbacks")),
+                                             calls(0), totalNs(0), worst(), reportCalls(0), reportNs(0)
+{
+    SlotProfiler::global().addSite(this);
+}
+//--------------------------------------------------------------------------------------------------
+SlotProfiler::SlotProfiler() : m_running(false), m_nsPerTick(1), m_calTicks(0), m_calNs(0), m_reportPeriodMs(10000), m_topN(5), m_lastReportUs(0), m_traceIdx(0), m_traceCount(0)
+{
+    m_calTicks = ticks();
+    m_calNs = Platform::getTimeNs();
+
+    // A first estimate of the tick rate, refined in run() as the baseline grows
+    while (Platform::getTimeNs() - m_calNs < 1000000)
+    {
+    }
+    calibrate();
+}
+//--------------------------------------------------------------------------------------------------
+SlotProfiler& SlotProfiler::global()
+{
+    static SlotProfiler profiler;
+    return profiler;
+}
+//--------------------------------------------------------------------------------------------------
+void SlotProfiler::calibrate()
+{
+#ifdef SLOT_PROFILER_TSC
+    const uint64_t t = ticks();
+    const uint64_t ns = Platform::getTimeNs();
+
+    if (t > m_calTicks)
+    {
+        m_nsPerTick = static_cast<real_t>(ns - m_calNs) / static_cast<real_t>(t - m_calTicks);
+    }
+#endif
+}
+//--------------------------------------------------------------------------------------------------
+void SlotProfiler::addSite(Site* site)
+{
+    m_sites.push_back(site);
+}
+//--------------------------------------------------------------------------------------------------
+void SlotProfiler::start(uint_t reportPeriodMs, uint_t topN)
+{
+    m_reportPeriodMs = reportPeriodMs;
+    m_topN = topN;
+    m_trace.resize(traceCapacity);
+    m_traceIdx = 0;
+    m_traceCount = 0;
+    m_lastReportUs = Platform::getTimeUs();
+
+    for (Site* site : m_sites)
+    {
+        for (Outlier& o : site->worst)
+        {
+            o = Outlier();
+        }
+        site->reportCalls = site->calls.load(std::memory_order_relaxed);
+        site->reportNs = site->totalNs.load(std::memory_order_relaxed);
+    }
+
+    m_running.store(true, std::memory_order_relaxed);
+    Debug::log(Debug::Severity::Notice, "Profiler", "Slot profiling started");
+}
+//--------------------------------------------------------------------------------------------------
+void SlotProfiler::stop()
+{
+    if (running())
+    {
+        m_running.store(false, std::memory_order_relaxed);
+        report();
+        Debug::log(Debug::Severity::Notice, "Profiler", "Slot profiling stopped");
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SlotProfiler::record(Site& site, uint64_t startTicks, uint64_t endTicks)
+{
+    const uint64_t ns = static_cast<uint64_t>((endTicks - startTicks) * m_nsPerTick);
+
+    site.histogram.record(ns);
+    site.calls.fetch_add(1, std::memory_order_relaxed);
+    site.totalNs.fetch_add(ns, std::memory_order_relaxed);
+
+    if (running())
+    {
+        const uint64_t startUs = Platform::getTimeUs() - ns / 1000;
+
+        if (ns > site.worst[worstCount - 1].durationNs)
+        {
+            uint_t i = worstCount - 1;
+            for (; i > 0 && ns > site.worst[i - 1].durationNs; i--)
+            {
+                site.worst[i] = site.worst[i - 1];
+            }
+            site.worst[i].durationNs = ns;
+            site.worst[i].timeUs = startUs;
+        }
+
+        TraceEvent& event = m_trace[m_traceIdx];
+        event.site = &site;
+        event.startUs = startUs;
+        event.durationNs = ns;
+        m_traceIdx = (m_traceIdx + 1) % traceCapacity;
+        m_traceCount = m_traceCount < traceCapacity ? m_traceCount + 1 : traceCapacity;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SlotProfiler::run()
+{
+    if (running() && Platform::getTimeUs() - m_lastReportUs >= m_reportPeriodMs * static_cast<uint64_t>(1000))
+    {
+        calibrate();
+        report();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SlotProfiler::report()
+{
+    const uint64_t nowUs = Platform::getTimeUs();
+    const real_t intervalNs = (nowUs - m_lastReportUs) * 1000.0;
+    std::vector<std::pair<uint64_t, Site*>> busiest;
+
+    for (Site* site : m_sites)
+    {
+        busiest.emplace_back(site->totalNs.load(std::memory_order_relaxed) - site->reportNs, site);
+    }
+    std::sort(busiest.begin(), busiest.end(), [](const std::pair<uint64_t, Site*>& a, const std::pair<uint64_t, Site*>& b) { return a.first > b.first; });
+
+    Debug::log(Debug::Severity::Info, "Profiler", "Top slots over the last %.1f s", intervalNs * 1e-9);
+
+    for (uint_t i = 0; i < busiest.size(); i++)
+    {
+        Site& site = *busiest[i].second;
+        const uint64_t calls = site.calls.load(std::memory_order_relaxed) - site.reportCalls;
+        const uint64_t ns = busiest[i].first;
+
+        if (i < m_topN && calls)
+        {
+            Debug::log(Debug::Severity::Info, "Profiler", "%-32s calls:%6llu  total:%8.3f ms %5.2f%%  mean:%8.2f us  p99:%8.2f us  worst:%8.2f us at T:%.3f", site.name,
+                       static_cast<unsigned long long>(calls), ns * 1e-6, intervalNs > 0 ? ns * 100.0 / intervalNs : 0.0, ns * 0.001 / calls,
+                       site.histogram.quantile(0.99) * 0.001, site.worst[0].durationNs * 0.001, site.worst[0].timeUs * 0.000001);
+        }
+
+        site.reportCalls += calls;
+        site.reportNs += ns;
+    }
+    m_lastReportUs = nowUs;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t SlotProfiler::writeTrace(const std::string& fileName) const
+{
+    FILE* file = fopen(fileName.c_str(), "w");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+    const uint_t first = (m_traceIdx + traceCapacity - m_traceCount) % traceCapacity;
+    bool_t comma = false;
+
+    for (uint_t i = 0; i < m_traceCount; i++)
+    {
+        const TraceEvent& e = m_trace[(first + i) % traceCapacity];
+        fprintf(file, "%s{\"name\":\"%s\",\"cat\":\"slot\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%llu,\"dur\":%.3f}", comma ? ",\n" : "", e.site->name,
+                static_cast<unsigned long long>(e.startUs), e.durationNs * 0.001);
+        comma = true;
+    }
+
+    // The worst calls of each site as instant events so they stand out on the timeline
+    for (const Site* site : m_sites)
+    {
+        for (const Outlier& o : site->worst)
+        {
+            if (o.durationNs)
+            {
+                fprintf(file, "%s{\"name\":\"worst %s %.1f us\",\"cat\":\"outlier\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":1,\"ts\":%llu}", comma ? ",\n" : "", site->name,
+                        o.durationNs * 0.001, static_cast<unsigned long long>(o.timeUs));
+                comma = true;
+            }
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    const bool_t ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,114 @@
+#ifndef SLOTPROFILER_H_
+#define SLOTPROFILER_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "metrics.h"
+#include "heapMonitor.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #define SLOT_PROFILER_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+    #include <intrin.h>
+    #define SLOT_PROFILER_TSC
+#endif
+
+// Put at the top of a slot callback. The time to the end of the function always goes to the
+// isl_callback_duration_seconds metric, and to the profiler's report and trace while it's running.
+// In static memory builds any heap allocation until then is reported against the callback.
+#define PROFILE_SLOT(name) static IslSdk::SlotProfiler::Site profileSite_(name); IslSdk::SlotProfiler::Scope profileScope_(profileSite_); IslSdk::HeapMonitor::Scope heapScope_(name)
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Times slot callbacks with the CPU timestamp counter. Each call site counts calls and feeds a
+    // latency histogram. While started, the profiler also keeps the worst calls for each site with
+    // when they happened, logs the sites using the most time every report period and records every call
+    // to a ring buffer that is written out as a Chrome trace event file (chrome://tracing or Perfetto).
+    class SlotProfiler
+    {
+    public:
+        static constexpr uint_t worstCount = 4;
+        static constexpr uint_t traceCapacity = 65536;
+
+        struct Outlier
+        {
+            uint64_t durationNs;
+            uint64_t timeUs;                            // Platform::getTimeUs() at the start of the call
+        };
+
+        class Site
+        {
+        public:
+            Site(const char* name);
+            const char* const name;
+            Metrics::Histogram& histogram;
+            std::atomic<uint64_t> calls;
+            std::atomic<uint64_t> totalNs;
+            Outlier worst[worstCount];                  // Longest first
+            uint64_t reportCalls;                       // Totals at the last report
+            uint64_t reportNs;
+        };
+
+        class Scope
+        {
+        public:
+            Scope(Site& site) : m_site(site), m_start(ticks()) {}
+            ~Scope() { SlotProfiler::global().record(m_site, m_start, ticks()); }
+
+        private:
+            Site& m_site;
+            const uint64_t m_start;
+        };
+
+        static SlotProfiler& global();
+        static uint64_t ticks()
+        {
+#ifdef SLOT_PROFILER_TSC
+            return __rdtsc();
+#else
+            return Platform::getTimeNs();
+#endif
+        }
+
+        void start(uint_t reportPeriodMs, uint_t topN);
+        void stop();
+        bool_t running() const { return m_running.load(std::memory_order_relaxed); }
+        void run();                                                         // Call regularly for the periodic report
+        void report();
+        bool_t writeTrace(const std::string& fileName) const;
+        void record(Site& site, uint64_t startTicks, uint64_t endTicks);
+
+    private:
+        struct TraceEvent
+        {
+            const Site* site;
+            uint64_t startUs;
+            uint64_t durationNs;
+        };
+
+        std::atomic<bool_t> m_running;
+        real_t m_nsPerTick;
+        uint64_t m_calTicks;
+        uint64_t m_calNs;
+        uint_t m_reportPeriodMs;
+        uint_t m_topN;
+        uint64_t m_lastReportUs;
+        std::vector<Site*> m_sites;
+        std::vector<TraceEvent> m_trace;
+        uint_t m_traceIdx;
+        uint_t m_traceCount;
+
+        SlotProfiler();
+        void calibrate();
+        void addSite(Site* site);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -5,11 +5,13 @@
 #include "platform/debug.h"
 #include "files/bmpFile.h"
 #include "utils/utils.h"
+#include "platform.h"
+#include "slotProfiler.h"
 
 using namespace IslSdk;
 
 //--------------------------------------------------------------------------------------------------
-SonarApp::SonarApp(void) : App("SonarApp"), m_pingCount(0)
+SonarApp::SonarApp(void) : TypedApp("SonarApp"), m_pingCount(0), m_mosaic(nullptr), m_mosaicOffsetRad(0), m_fusion(nullptr), m_fusionId(0), m_pingSource(Pipeline::global().source("ping")), m_textureWidth(0), m_textureHeight(0)
 {
     Debug::log(Debug::Severity::Notice, name.c_str(), "created" NEW_LINE
                                                       "d -> Set settings to defualt" NEW_LINE
@@ -19,71 +21,107 @@ SonarApp::SonarApp(void) : App("SonarApp"), m_pingCount(0)
                                                       "p -> Save palette" NEW_LINE
                                                       "t -> Save sonar texture" NEW_LINE
                                                       "i -> Save sonar image" NEW_LINE
-                                                      "c -> Check head is sync'ed" NEW_LINE);
+                                                      "c -> Check head is sync'ed" NEW_LINE
+                                                      "m -> Export mosaic tiles" NEW_LINE
+                                                      "f -> Save fused multi sonar image" NEW_LINE);
 }
 //--------------------------------------------------------------------------------------------------
 SonarApp::~SonarApp(void)
 {
+    setFusion(nullptr, SonarFusion::Mount{ 0, 0, 0 });                         // Its pings are cleared from the fused image
 }
 //--------------------------------------------------------------------------------------------------
-void SonarApp::renderPalette(const std::string& path)
+void SonarApp::setMosaic(SonarMosaic* mosaic, real_t mountOffsetRad)
+{
+    m_mosaic = mosaic;
+    m_mosaicOffsetRad = mountOffsetRad;
+}
+//--------------------------------------------------------------------------------------------------
+void SonarApp::setFusion(SonarFusion* fusion, const SonarFusion::Mount& mount)
 {
-    const uint_t w = 100, h = 1000;
+    if (m_fusion)
+    {
+        m_fusion->removeSource(m_fusionId);
+    }
 
-    std::unique_ptr<Palette> p = std::make_unique<Palette>();
-    std::vector<uint32_t> buf(w * h);
+    m_fusion = fusion;
 
-    p->render(&buf[0], w, h, false);
-    BmpFile::save(path + "palette.bmp", &buf[0], 32, w, h);
+    if (m_fusion)
+    {
+        m_fusionId = m_fusion->addSource(mount);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarApp::fixTextureSize(uint_t width, uint_t height)
+{
+    m_textureWidth = width;
+    m_textureHeight = height;
+
+    if (m_textureWidth)
+    {
+        m_texture.setBuffer(m_textureWidth, m_textureHeight, true);
+    }
 }
 //--------------------------------------------------------------------------------------------------
-void SonarApp::connectSignals(Device& device)
+void SonarApp::renderPalette(const std::string& path)
 {
-    Sonar& sonar = reinterpret_cast<Sonar&>(device);
+    static constexpr uint_t w = 100, h = 1000;
+    static uint32_t buf[w * h];                                                 // Shared by every sonar, only used on the SDK thread
 
-    ahrs.connectSignals(sonar.ahrs, name);
+    m_palette.render(&buf[0], w, h, false);
+    BmpFile::save(path + "palette.bmp", &buf[0], 32, w, h);
+}
+//--------------------------------------------------------------------------------------------------
+void SonarApp::connectDevice(Sonar& sonar)
+{
+    ahrs.connectSignals(sonar.ahrs, name, &m_clockSync, &sonar.info);
     gyro.connectSignals(sonar.gyro, name);
     accel.connectSignals(sonar.accel, name);
 
-    sonar.onSettingsUpdated.connect(slotSettingsUpdated);
-    sonar.onHeadIndexesAcquired.connect(slotHeadIndexesAcquired);
-    sonar.onPingData.connect(slotPingData);                 // Subscribing to this event causes ping data to be sent
-    sonar.onEchoData.connect(slotEchoData);                 // Subscribing to this event causes profiling data to be sent
-    sonar.onPwrAndTemp.connect(slotPwrAndTemp);             // Subscribing to this event causes data to be sent from the device at the rate defined by setSensorRates()
-    sonar.onMotorSlip.connect(slotMotorSlip);
-    sonar.onMotorMoveComplete.connect(slotMotorMoveComplete);
-    
+    // Name, priority, fastest and slowest interval in ms, estimated bytes per sample and the starting interval.
+    // Ping data isn't rate controlled, slowing these leaves more of the link for it. The raw gyro
+    // and accel feed the block statistics, there's no mag as nothing here takes it.
+    m_rates.streams = { { "ahrs", 0, 50, 2000, 52, 100 },
+                        { "voltageAndTemp", 1, 1000, 10000, 32, 1000 },
+                        { "gyro", 2, 100, 1000, 32, 100 },
+                        { "accel", 2, 100, 1000, 32, 100 } };
+    sendRates(sonar);
+}
+//--------------------------------------------------------------------------------------------------
+void SonarApp::sendRates(Sonar& sonar)
+{
     Sonar::SensorRates rates;
-    rates.ahrs = 100;
-    rates.gyro = 0;
-    rates.accel = 0;
-    rates.mag = 0;
-    rates.voltageAndTemp = 1000;
+    rates.ahrs = m_rates.intervalMs("ahrs");
+    rates.gyro = m_rates.intervalMs("gyro");
+    rates.accel = m_rates.intervalMs("accel");
+    rates.mag = 0;                                                      // There's no MagManager to take it
+    rates.voltageAndTemp = m_rates.intervalMs("voltageAndTemp");
     sonar.setSensorRates(rates);
 }
 //--------------------------------------------------------------------------------------------------
-void SonarApp::disconnectSignals(Device& device)
+void SonarApp::watchLink()
+{
+    m_link.setMeasuredInterval();                                               // The ping rate follows the range and step settings, so it's measured
+}
+//--------------------------------------------------------------------------------------------------
+void SonarApp::disconnectDevice(Sonar& sonar)
 {
-    Sonar& sonar = reinterpret_cast<Sonar&>(device);
-
     ahrs.disconnectSignals();
     gyro.disconnectSignals();
     accel.disconnectSignals();
-
-    sonar.onSettingsUpdated.disconnect(slotSettingsUpdated);
-    sonar.onHeadIndexesAcquired.disconnect(slotHeadIndexesAcquired);
-    sonar.onPingData.disconnect(slotPingData);
-    sonar.onEchoData.disconnect(slotEchoData);
-    sonar.onPwrAndTemp.disconnect(slotPwrAndTemp);
-    sonar.onMotorSlip.disconnect(slotMotorSlip);
-    sonar.onMotorMoveComplete.disconnect(slotMotorMoveComplete);
+}
+//--------------------------------------------------------------------------------------------------
+bool_t SonarApp::setHeadingTarget(Slot<uint64_t, real_t>* slot)
+{
+    ahrs.setHeadingTarget(slot);
+    return true;
 }
 //--------------------------------------------------------------------------------------------------
 void SonarApp::doTask(int_t key, const std::string& path)
 {
     if (m_device)
     {
-        Sonar& sonar = reinterpret_cast<Sonar&>(*m_device);
+        Sonar& sonar = device();
 
         switch (key)
         {
@@ -99,10 +137,12 @@ void SonarApp::doTask(int_t key, const std::string& path)
 
         case 'r':
             sonar.startScanning();
+            m_link.setMeasuredInterval();
             break;
 
         case 'R':
             sonar.stopScanning();
+            m_link.setExpectedIntervalMs(0, false);                             // Measured again from the pings once scanning restarts
             break;
 
         case 'p':
@@ -123,6 +163,21 @@ void SonarApp::doTask(int_t key, const std::string& path)
             sonar.acquireHeadIdx(false);
             break;
 
+        case 'm':
+            if (m_mosaic)
+            {
+                const uint_t count = m_mosaic->exportTiles(path);
+                Debug::log(Debug::Severity::Info, name.c_str(), "Exported %u mosaic tiles", FMT_U(count));
+            }
+            break;
+
+        case 'f':
+            if (m_fusion)
+            {
+                m_fusion->save(path + "fused.bmp", m_palette);
+            }
+            break;
+
         default:
             break;
         }
@@ -131,17 +186,22 @@ void SonarApp::doTask(int_t key, const std::string& path)
     }
 }
 //--------------------------------------------------------------------------------------------------
-void SonarApp::connectEvent(Device& device)
+void SonarApp::deviceConnected(Sonar& sonar)
 {
-    Sonar& sonar = reinterpret_cast<Sonar&>(device);
-
     m_circular.setBuffer(1000, 1000, true);
     m_circular.setSectorArea(0, sonar.settings.setup.maxRangeMm, sonar.settings.setup.sectorStart, sonar.settings.setup.sectorSize);
     m_circular.useBilinerInterpolation = true;
-
-    // Optimal texture size to pass to the GPU - each pixel represents a data point. The GPU can then map this texture to circle (triangle fan)
     m_texture.useBilinerInterpolation = false;
-    m_texture.setBuffer(sonar.settings.setup.imageDataPoint, Sonar::maxAngle / Math::abs(sonar.settings.setup.stepSize), true);
+    sizeTexture(sonar);
+}
+//--------------------------------------------------------------------------------------------------
+void SonarApp::sizeTexture(Sonar& sonar)
+{
+    // Optimal texture size to pass to the GPU - each pixel represents a data point. The GPU can then map this texture to circle (triangle fan)
+    if (m_textureWidth == 0)
+    {
+        m_texture.setBuffer(sonar.settings.setup.imageDataPoint, Sonar::maxAngle / Math::abs(sonar.settings.setup.stepSize), true);
+    }
     m_texture.setSectorArea(0, sonar.settings.setup.maxRangeMm, sonar.settings.setup.sectorStart, sonar.settings.setup.sectorSize);
 }
 //--------------------------------------------------------------------------------------------------
@@ -157,10 +217,7 @@ void SonarApp::callbackSettingsUpdated(Sonar& sonar, bool_t ok, Sonar::Settings:
         {
             sonar.connection->sysPort->close();
             m_circular.setSectorArea(0, sonar.settings.setup.maxRangeMm, sonar.settings.setup.sectorStart, sonar.settings.setup.sectorSize);
-
-            // Optimal texture size to pass to the GPU - each pixel represents a data point. The GPU can then map this texture to circle (triangle fan)
-            m_texture.setBuffer(sonar.settings.setup.imageDataPoint, Sonar::maxAngle / Math::abs(sonar.settings.setup.stepSize), true);
-            m_texture.setSectorArea(0, sonar.settings.setup.maxRangeMm, sonar.settings.setup.sectorStart, sonar.settings.setup.sectorSize);
+            sizeTexture(sonar);
         }
     }
     else
@@ -176,6 +233,10 @@ void SonarApp::callbackHeadIndexesAcquired(Sonar& sonar, const Sonar::HeadIndexe
 //--------------------------------------------------------------------------------------------------
 void SonarApp::callbackPingData(Sonar& sonar, const Sonar::Ping& ping)
 {
+    PROFILE_SLOT("SonarApp::callbackPingData");
+
+    m_link.dataReceived();
+
     Debug::log(Debug::Severity::Info, name.c_str(), "Ping data");
 
     uint_t txPulseLengthMm = static_cast<uint_t>(sonar.settings.system.speedOfSound * sonar.settings.acoustic.txPulseWidthUs * 0.001 * 0.5);
@@ -183,6 +244,24 @@ void SonarApp::callbackPingData(Sonar& sonar, const Sonar::Ping& ping)
 
     sonarDataStore.add(ping, txPulseLengthMm);
 
+    // The samples go to subscribers straight from the ping's own buffer
+    const TelemetryServer::SonarPing msg = { ping.minRangeMm, ping.maxRangeMm, static_cast<uint16_t>(ping.angle), static_cast<int16_t>(ping.stepSize), static_cast<uint32_t>(ping.data.size()) };
+    TelemetryServer::global().publish(TelemetryServer::Topic::SonarPing, TelemetryServer::sourceId(sonar.info), Platform::getTimeUs(), &msg, sizeof(msg), ping.data.data(), ping.data.size() * sizeof(uint16_t));
+
+    m_pingSource.push(Platform::getTimeUs(), TelemetryServer::sourceId(sonar.info), { static_cast<real_t>(ping.angle), static_cast<real_t>(ping.minRangeMm), static_cast<real_t>(ping.maxRangeMm),
+                      static_cast<real_t>(txPulseLengthMm) }, ping.data.data(), static_cast<uint_t>(ping.data.size()));
+
+    if (m_mosaic)
+    {
+        // Pings carry no device timestamp so they are placed at the time they arrive
+        m_mosaic->addPing(Platform::getTimeUs(), ping, m_mosaicOffsetRad);
+    }
+
+    if (m_fusion)
+    {
+        m_fusion->addPing(m_fusionId, ping);
+    }
+
     m_pingCount++;
 
     if (m_pingCount % (Sonar::maxAngle / sonar.settings.setup.stepSize) == 0)
@@ -3,35 +3,33 @@
 
 //------------------------------------------ Includes ----------------------------------------------
 
-#include "app.h"
+#include "typedApp.h"
 #include "devices/sonar.h"
 #include "imuManager.h"
 #include "helpers/sonarDataStore.h"
 #include "helpers/sonarImage.h"
+#include "sonarMosaic.h"
+#include "sonarFusion.h"
+#include "pipeline.h"
 
 //--------------------------------------- Class Definition -----------------------------------------
 
 namespace IslSdk
 {
-    class SonarApp : public App
+    class SonarApp : public TypedApp<SonarApp, Sonar>
     {
     public:
         SonarApp(void);
         ~SonarApp(void);
         void renderPalette(const std::string& path);
-        void connectSignals(Device& device) override;
-        void disconnectSignals(Device& device) override;
         void doTask(int_t key, const std::string& path) override;
+        bool_t setHeadingTarget(Slot<uint64_t, real_t>* slot) override;
+        void setMosaic(SonarMosaic* mosaic, real_t mountOffsetRad);        // Sonar zero angle clockwise from vehicle forward
+        void setFusion(SonarFusion* fusion, const SonarFusion::Mount& mount);
+        void fixTextureSize(uint_t width, uint_t height);                   // Allocated once instead of following the settings, zero to follow
 
-        Slot<Sonar&, bool_t, Sonar::Settings::Type> slotSettingsUpdated{ this, &SonarApp::callbackSettingsUpdated };
-        Slot<Sonar&, const Sonar::HeadIndexes&> slotHeadIndexesAcquired{ this, &SonarApp::callbackHeadIndexesAcquired };
-        Slot<Sonar&, const Sonar::Ping&> slotPingData{ this, &SonarApp::callbackPingData };
-        Slot<Sonar&, const Sonar::Echos&> slotEchoData{ this, &SonarApp::callbackEchoData };
-        Slot<Sonar&, const Sonar::CpuPowerTemp& > slotPwrAndTemp{ this, &SonarApp::callbackPwrAndTemp };
-        Slot<Sonar&> slotMotorSlip { this, &SonarApp::callbackMotorSlip };
-        Slot<Sonar&, bool_t> slotMotorMoveComplete { this, &SonarApp::callbackMotorMoveComplete };
-        
     private:
+        friend TypedApp;
         AhrsManager ahrs;
         GyroManager gyro;
         AccelManager accel;
@@ -41,7 +39,19 @@ namespace IslSdk
         SonarImage m_texture;
         uint_t m_pingCount;
         SonarDataStore sonarDataStore;
-        virtual void connectEvent(Device& device);
+        SonarMosaic* m_mosaic;
+        real_t m_mosaicOffsetRad;
+        SonarFusion* m_fusion;
+        uint_t m_fusionId;
+        Pipeline::Source& m_pingSource;
+        uint_t m_textureWidth;
+        uint_t m_textureHeight;
+        void connectDevice(Sonar& sonar);
+        void disconnectDevice(Sonar& sonar);
+        void deviceConnected(Sonar& sonar);
+        void sendRates(Sonar& sonar);
+        void watchLink();
+        void sizeTexture(Sonar& sonar);
        
         void callbackSettingsUpdated(Sonar& sonar, bool_t ok, Sonar::Settings::Type settingsType);
         void callbackHeadIndexesAcquired(Sonar& sonar, const Sonar::HeadIndexes& data);
@@ -50,6 +60,14 @@ namespace IslSdk
         void callbackPwrAndTemp(Sonar& sonar, const Sonar::CpuPowerTemp& data);
         void callbackMotorSlip(Sonar& sonar);
         void callbackMotorMoveComplete(Sonar& sonar, bool_t ok);
+
+        Handlers<On<&Sonar::onSettingsUpdated, &SonarApp::callbackSettingsUpdated>,
+                 On<&Sonar::onHeadIndexesAcquired, &SonarApp::callbackHeadIndexesAcquired>,
+                 On<&Sonar::onPingData, &SonarApp::callbackPingData>,                            // Subscribing to this causes ping data to be sent
+                 On<&Sonar::onEchoData, &SonarApp::callbackEchoData>,                            // Subscribing to this causes profiling data to be sent
+                 On<&Sonar::onPwrAndTemp, &SonarApp::callbackPwrAndTemp>,                        // Sent at the rate defined by setSensorRates() once subscribed
+                 On<&Sonar::onMotorSlip, &SonarApp::callbackMotorSlip>,
+                 On<&Sonar::onMotorMoveComplete, &SonarApp::callbackMotorMoveComplete>> m_handlers{ this };
     };
 }
 
@@ -0,0 +1,501 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "sonarFusion.h"
+#include "files/bmpFile.h"
+#include "heapMonitor.h"
+#include "platform.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace IslSdk;
+
+static const real_t pi = 3.14159265358979323846;
+
+//--------------------------------------------------------------------------------------------------
+SonarFusion::SonarFusion() : m_width(0), m_height(0), m_metersPerPixel(0.05), m_blend(Blend::Max), m_stopping(false), m_renderNext(0), m_renderLeft(0)
+{
+}
+//--------------------------------------------------------------------------------------------------
+SonarFusion::~SonarFusion()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::lock_guard<std::mutex> renderLock(m_renderMutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    m_renderCv.notify_all();
+
+    if (m_worker.joinable())
+    {
+        m_worker.join();
+    }
+
+    for (std::thread& renderer : m_renderers)
+    {
+        renderer.join();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::setup(uint_t width, uint_t height, real_t metersPerPixel, Blend blend, uint_t threads)
+{
+    m_width = width;
+    m_height = height;
+    m_metersPerPixel = metersPerPixel;
+    m_blend = blend;
+    m_image.assign(m_width * m_height, 0);
+
+    if (!m_worker.joinable())
+    {
+        m_worker = std::thread(&SonarFusion::workerTask, this);
+    }
+
+    while (m_renderers.size() < threads)
+    {
+        m_renderers.emplace_back(&SonarFusion::renderTask, this);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+uint_t SonarFusion::addSource(const Mount& mount)
+{
+    const uint_t size = m_width * m_height;
+    uint_t id = m_sources.size();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (uint_t i = 0; i < m_sources.size(); i++)
+        {
+            if (m_sources[i]->removed && !m_sources[i]->building)               // The worker has finished with it
+            {
+                id = i;
+                break;
+            }
+        }
+
+        if (id == m_sources.size())
+        {
+            m_sources.push_back(std::make_unique<Source>());
+            m_jobs.reserve(m_sources.size());
+            m_built.reserve(m_sources.size());
+
+            std::lock_guard<std::mutex> renderLock(m_renderMutex);
+            m_renderJobs.reserve(m_sources.size());
+        }
+        m_sources[id]->maxRangeMm = 0;
+    }
+
+    Source& source = *m_sources[id];
+    source.mount = mount;
+    source.polar.assign(angleBins * rangeBins, 0);
+    source.angleValid.assign(angleBins, false);
+    source.pending.resize(maxPendingPings);
+    source.pendingCount = 0;
+    source.ready = true;
+    source.swapped = false;
+    source.building = false;
+    source.removed = false;
+    buildLut(source.lut, 0, mount);                                             // Covers nothing until the first ping gives a range
+
+    if (source.layer.size() != size)                                            // A reused slot's layer is already clear, its dirty pixels are still to merge
+    {
+        source.layer.assign(size, noValue);
+        source.isDirty.assign(size, 0);
+        source.dirty.clear();
+    }
+
+    if (HeapMonitor::enabled)
+    {
+        // Both lookups at their largest so a new range never allocates
+        for (Lut* lut : { &source.lut, &source.next })
+        {
+            lut->cell.reserve(size);
+            lut->binStart.reserve(angleBins + 1);
+            lut->binPixels.reserve(size);
+        }
+        source.dirty.reserve(size);
+    }
+
+    return id;
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::removeSource(uint_t sourceId)
+{
+    if (sourceId >= m_sources.size() || m_sources[sourceId]->removed)
+    {
+        return;
+    }
+
+    // run() isn't rendering as it's called from the same thread, the layer is merged clear next run
+    Source& source = *m_sources[sourceId];
+    std::fill(source.angleValid.begin(), source.angleValid.end(), false);
+    source.pendingCount = 0;
+    source.swapped = false;
+
+    if (source.ready)
+    {
+        source.ready = false;
+        for (uint32_t i : source.lut.binPixels)
+        {
+            setLayer(source, i, noValue);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    source.removed = true;                                                      // A lookup still being built is never swapped in
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::addPing(uint_t sourceId, const Sonar::Ping& ping)
+{
+    if (sourceId >= m_sources.size() || m_sources[sourceId]->removed || ping.data.empty() || ping.maxRangeMm == 0)
+    {
+        return;
+    }
+
+    Source& source = *m_sources[sourceId];
+
+    if (source.pendingCount == maxPendingPings)                                 // run() isn't being called often enough
+    {
+        return;
+    }
+
+    PendingPing& pending = source.pending[source.pendingCount++];
+    pending.maxRangeMm = ping.maxRangeMm;
+
+    // Resample the ping onto the fixed range bins, samples inside minRangeMm are left empty. The
+    // polar grid is scaled to the ping's range, a different range clears it when rendered.
+    const real_t binMm = static_cast<real_t>(ping.maxRangeMm) / rangeBins;
+    const real_t sampleMm = (static_cast<real_t>(ping.maxRangeMm) - ping.minRangeMm) / ping.data.size();
+
+    for (uint_t i = 0; i < rangeBins; i++)
+    {
+        const real_t sample = ((i + 0.5) * binMm - ping.minRangeMm) / sampleMm;
+        pending.row[i] = sample >= 0 && sample < ping.data.size() ? ping.data[static_cast<uint_t>(sample)] : 0;
+    }
+
+    // The beam is centred on the ping angle and is one step wide
+    const int_t unitsPerBin = Sonar::maxAngle / angleBins;
+    const int_t halfStep = (ping.stepSize < 0 ? -ping.stepSize : ping.stepSize) / 2;
+    pending.firstBin = (static_cast<int_t>(ping.angle) - halfStep) / unitsPerBin;
+    pending.lastBin = (static_cast<int_t>(ping.angle) + halfStep + unitsPerBin - 1) / unitsPerBin;
+    pending.lastBin = pending.lastBin > pending.firstBin ? pending.lastBin : pending.firstBin + 1;
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::run()
+{
+    swapBuilt();
+
+    std::unique_lock<std::mutex> lock(m_renderMutex);
+
+    m_renderJobs.clear();
+    for (const std::unique_ptr<Source>& source : m_sources)
+    {
+        if (!source->removed && (source->pendingCount || source->swapped))
+        {
+            m_renderJobs.push_back(source.get());
+        }
+    }
+    m_renderNext = 0;
+    m_renderLeft = m_renderJobs.size();
+
+    if (m_renderLeft)
+    {
+        m_renderCv.notify_all();
+
+        while (m_renderNext < m_renderJobs.size())                              // This thread renders too
+        {
+            renderNext(lock);
+        }
+        m_renderDoneCv.wait(lock, [this]() { return m_renderLeft == 0; });
+    }
+    lock.unlock();
+
+    // Merge, each changed pixel is blended from every source's layer
+    for (const std::unique_ptr<Source>& source : m_sources)
+    {
+        for (uint32_t i : source->dirty)
+        {
+            updatePixel(i);
+            source->isDirty[i] = 0;
+        }
+        source->dirty.clear();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::buildLut(Lut& lut, uint32_t maxRangeMm, const Mount& mount) const
+{
+    const uint_t size = m_width * m_height;
+    const real_t maxRangeM = maxRangeMm * 0.001;
+    const real_t cosR = std::cos(mount.rotationRad);
+    const real_t sinR = std::sin(mount.rotationRad);
+    std::vector<uint32_t>& count = lut.binStart;                                // Reuses the lookup's buffers so a new range doesn't allocate
+
+    lut.maxRangeMm = maxRangeMm;
+    count.assign(angleBins + 1, 0);
+    lut.cell.assign(size, noCell);
+
+    for (uint_t r = 0; r < m_height && maxRangeM > 0; r++)
+    {
+        const real_t x = (m_height * 0.5 - r - 0.5) * m_metersPerPixel - mount.xM;
+
+        for (uint_t c = 0; c < m_width; c++)
+        {
+            const real_t y = (c + 0.5 - m_width * 0.5) * m_metersPerPixel - mount.yM;
+            const real_t range = std::sqrt(x * x + y * y);
+
+            if (range < maxRangeM)
+            {
+                // Rotate into the sonar frame, angle clockwise from the sonar's zero
+                const real_t fwd = x * cosR + y * sinR;
+                const real_t stbd = y * cosR - x * sinR;
+                real_t angle = std::atan2(stbd, fwd);
+                angle = angle < 0 ? angle + 2 * pi : angle;
+
+                uint_t bin = static_cast<uint_t>(angle * angleBins / (2 * pi));
+                bin = bin < angleBins ? bin : 0;
+
+                const uint_t rangeBin = static_cast<uint_t>(range * rangeBins / maxRangeM);
+                lut.cell[r * m_width + c] = bin * rangeBins + (rangeBin < rangeBins ? rangeBin : rangeBins - 1);
+                count[bin + 1]++;
+            }
+        }
+    }
+
+    // Counting sort of the covered pixels by angle bin
+    for (uint_t i = 0; i < angleBins; i++)
+    {
+        count[i + 1] += count[i];
+    }
+
+    lut.binPixels.resize(count[angleBins]);
+
+    for (uint_t i = 0; i < size; i++)
+    {
+        if (lut.cell[i] != noCell)
+        {
+            lut.binPixels[count[lut.cell[i] / rangeBins]++] = i;
+        }
+    }
+
+    // Each offset has been advanced to the start of the next bin, shift them back
+    for (uint_t i = angleBins; i > 0; i--)
+    {
+        count[i] = count[i - 1];
+    }
+    count[0] = 0;
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::requestLut(Source& source, uint32_t maxRangeMm)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    source.maxRangeMm = maxRangeMm;
+
+    if (!source.building)                                                       // Otherwise the worker sees the new range when it finishes
+    {
+        source.building = true;
+        m_jobs.push_back(&source);
+        m_cv.notify_one();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::swapBuilt()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (Source* source : m_built)
+    {
+        if (!source->removed && !source->building && source->next.maxRangeMm == source->maxRangeMm)   // Else removed, or the range changed again and it's being rebuilt
+        {
+            std::swap(source->lut, source->next);
+            source->ready = true;
+            source->swapped = true;                                             // The pixels it left were cleared when its range changed
+        }
+    }
+    m_built.clear();
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::workerTask()
+{
+    Platform::setBackgroundThread();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_cv.wait(lock, [this]() { return !m_jobs.empty() || m_stopping; });
+
+        if (m_stopping)
+        {
+            break;
+        }
+
+        Source& source = *m_jobs.back();
+        m_jobs.pop_back();
+
+        // Built again if the range changed while building, next is only swapped in once building is false
+        uint32_t rangeMm = source.maxRangeMm;
+        while (true)
+        {
+            lock.unlock();
+            buildLut(source.next, rangeMm, source.mount);
+            lock.lock();
+
+            if (rangeMm == source.maxRangeMm)
+            {
+                break;
+            }
+            rangeMm = source.maxRangeMm;
+        }
+
+        source.building = false;
+        m_built.push_back(&source);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::renderTask()
+{
+    Platform::setBackgroundThread();
+
+    std::unique_lock<std::mutex> lock(m_renderMutex);
+
+    while (true)
+    {
+        m_renderCv.wait(lock, [this]() { return m_renderNext < m_renderJobs.size() || m_stopping; });
+
+        if (m_stopping)
+        {
+            break;
+        }
+        renderNext(lock);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::renderNext(std::unique_lock<std::mutex>& lock)
+{
+    Source& source = *m_renderJobs[m_renderNext++];
+
+    lock.unlock();
+    renderSource(source);
+    lock.lock();
+
+    if (--m_renderLeft == 0)
+    {
+        m_renderDoneCv.notify_one();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::renderSource(Source& source)
+{
+    if (source.swapped)
+    {
+        source.swapped = false;
+
+        for (uint32_t i : source.lut.binPixels)
+        {
+            const uint32_t cell = source.lut.cell[i];
+            setLayer(source, i, source.angleValid[cell / rangeBins] ? source.polar[cell] : noValue);
+        }
+    }
+
+    for (uint_t p = 0; p < source.pendingCount; p++)
+    {
+        const PendingPing& ping = source.pending[p];
+
+        if (ping.maxRangeMm != source.maxRangeMm)
+        {
+            // History at the old range is discarded and the source is left out of the image until the
+            // worker has a lookup for the new range
+            std::fill(source.polar.begin(), source.polar.end(), 0);
+            std::fill(source.angleValid.begin(), source.angleValid.end(), false);
+
+            if (source.ready)
+            {
+                source.ready = false;
+                for (uint32_t i : source.lut.binPixels)
+                {
+                    setLayer(source, i, noValue);
+                }
+            }
+            requestLut(source, ping.maxRangeMm);
+        }
+
+        for (int_t b = ping.firstBin; b < ping.lastBin; b++)
+        {
+            const uint_t bin = static_cast<uint_t>((b % static_cast<int_t>(angleBins) + angleBins) % angleBins);
+
+            std::copy(&ping.row[0], &ping.row[rangeBins], &source.polar[bin * rangeBins]);
+            source.angleValid[bin] = true;
+
+            if (source.ready)
+            {
+                for (uint32_t i = source.lut.binStart[bin]; i < source.lut.binStart[bin + 1]; i++)
+                {
+                    const uint32_t idx = source.lut.binPixels[i];
+                    setLayer(source, idx, source.polar[source.lut.cell[idx]]);
+                }
+            }
+        }
+    }
+    source.pendingCount = 0;
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::setLayer(Source& source, uint32_t idx, uint32_t value)
+{
+    source.layer[idx] = value;
+
+    if (!source.isDirty[idx])
+    {
+        source.isDirty[idx] = 1;
+        source.dirty.push_back(idx);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::updatePixel(uint_t idx)
+{
+    uint32_t sum = 0;
+    uint32_t max = 0;
+    uint_t count = 0;
+
+    for (const std::unique_ptr<Source>& source : m_sources)
+    {
+        const uint32_t v = source->layer[idx];
+
+        if (v != noValue)
+        {
+            sum += v;
+            max = v > max ? v : max;
+            count++;
+        }
+    }
+
+    if (m_blend == Blend::Max)
+    {
+        m_image[idx] = static_cast<uint16_t>(max);
+    }
+    else
+    {
+        m_image[idx] = static_cast<uint16_t>(count ? sum / count : 0);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarFusion::render(uint32_t* buf, const Palette& palette) const
+{
+    for (uint_t i = 0; i < m_image.size(); i++)
+    {
+        buf[i] = palette.getColour(m_image[i]);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+bool_t SonarFusion::save(const std::string& fileName, const Palette& palette) const
+{
+    if (m_image.empty())
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> buf(m_image.size());
+    render(&buf[0], palette);
+    return BmpFile::save(fileName, &buf[0], 32, m_width, m_height);
+}
+//--------------------------------------------------------------------------------------------------
@@ -0,0 +1,132 @@
+#ifndef SONARFUSION_H_
+#define SONARFUSION_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "devices/sonar.h"
+#include "helpers/palette.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Composites several scanning sonars into one vehicle frame image. Each source keeps a polar grid
+    // of its latest pings, a lookup from every output pixel to a polar cell built from the source's
+    // mounting pose, and its own layer of the image. addPing() only resamples the ping and queues it.
+    // run() renders each source's queued pings into its layer on a pool of threads, a source to a
+    // thread, and then merges the changed pixels of every layer into the image. Only the pixels under
+    // a beam are rendered and merged, so the cost per ping is the size of the beam footprint rather
+    // than the image. A lookup is rebuilt when a source changes range, which is about a million atan2s
+    // for a 1000 x 1000 image, so it's done on a worker thread into a second lookup. Until it's swapped
+    // in by a later run() the source's pings are kept in its polar grid but it's left out of the image.
+    // A removed source is cleared from the image and its slot is reused by the next source added, so
+    // sonars coming and going don't grow the list.
+    class SonarFusion
+    {
+    public:
+        enum class Blend { Max, Mean };
+
+        struct Mount
+        {
+            real_t xM;                                  // Forward of the vehicle origin
+            real_t yM;                                  // Starboard of the vehicle origin
+            real_t rotationRad;                         // Sonar zero angle clockwise from vehicle forward
+        };
+
+        static constexpr uint_t angleBins = 1600;
+        static constexpr uint_t rangeBins = 500;
+        static constexpr uint_t maxPendingPings = 32;                      // A source's pings past this between runs are dropped
+
+        SonarFusion();
+        ~SonarFusion();
+        void setup(uint_t width, uint_t height, real_t metersPerPixel, Blend blend, uint_t threads);   // Renders on threads plus the caller of run()
+        uint_t addSource(const Mount& mount);                               // Returns the source id, after setup()
+        void removeSource(uint_t sourceId);
+        void addPing(uint_t sourceId, const Sonar::Ping& ping);
+        void run();                                                         // Call regularly to render the queued pings into the image
+        void render(uint32_t* buf, const Palette& palette) const;           // width * height ARGB pixels
+        bool_t save(const std::string& fileName, const Palette& palette) const;
+
+        uint_t width() const { return m_width; }
+        uint_t height() const { return m_height; }
+        const std::vector<uint16_t>& image() const { return m_image; }     // Fused intensity, row 0 is forward
+
+    private:
+        static constexpr uint32_t noCell = 0xffffffff;
+        static constexpr uint32_t noValue = 0xffffffff;
+
+        struct Lut
+        {
+            uint32_t maxRangeMm;
+            std::vector<uint32_t> cell;                 // Polar cell for each output pixel or noCell
+            std::vector<uint32_t> binStart;             // Pixels grouped by angle bin, angleBins + 1 offsets
+            std::vector<uint32_t> binPixels;
+        };
+
+        struct PendingPing
+        {
+            uint32_t maxRangeMm;
+            int_t firstBin;                             // Angle bins first to last - 1, may wrap
+            int_t lastBin;
+            uint16_t row[rangeBins];                    // Resampled to the range bins
+        };
+
+        struct Source
+        {
+            Mount mount;
+            uint32_t maxRangeMm;                        // Written under m_mutex as the worker reads it
+            std::vector<uint16_t> polar;                // angleBins * rangeBins
+            std::vector<bool_t> angleValid;
+            Lut lut;                                    // For maxRangeMm once ready
+            Lut next;                                   // Being built by the worker, guarded by m_mutex with building
+            std::vector<uint32_t> layer;                // This source's value for each output pixel or noValue
+            std::vector<uint32_t> dirty;                // Layer pixels changed since the last merge
+            std::vector<uint8_t> isDirty;
+            std::vector<PendingPing> pending;           // maxPendingPings, queued by addPing() for run()
+            uint_t pendingCount;
+            bool_t ready;
+            bool_t swapped;                             // A new lookup was swapped in, the layer is filled from the polar grid
+            bool_t building;
+            bool_t removed;                             // Slot free for addSource once it's not building
+        };
+
+        uint_t m_width;
+        uint_t m_height;
+        real_t m_metersPerPixel;
+        Blend m_blend;
+        std::vector<std::unique_ptr<Source>> m_sources;
+        std::vector<uint16_t> m_image;
+        std::vector<Source*> m_jobs;                    // Sources waiting for the worker
+        std::vector<Source*> m_built;                   // Sources whose next lookup is ready to swap in
+        bool_t m_stopping;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::thread m_worker;
+        std::vector<Source*> m_renderJobs;              // Sources with pings to render this run
+        uint_t m_renderNext;
+        uint_t m_renderLeft;
+        std::mutex m_renderMutex;
+        std::condition_variable m_renderCv;
+        std::condition_variable m_renderDoneCv;
+        std::vector<std::thread> m_renderers;
+
+        void buildLut(Lut& lut, uint32_t maxRangeMm, const Mount& mount) const;
+        void requestLut(Source& source, uint32_t maxRangeMm);
+        void swapBuilt();
+        void workerTask();
+        void renderTask();
+        void renderNext(std::unique_lock<std::mutex>& lock);
+        void renderSource(Source& source);
+        static void setLayer(Source& source, uint32_t idx, uint32_t value);
+        void updatePixel(uint_t idx);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
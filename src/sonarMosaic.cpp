@@ -0,0 +1,505 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "sonarMosaic.h"
+#include "heapMonitor.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace IslSdk;
+
+static const real_t pi = 3.14159265358979323846;
+static const uint32_t tileMagic = 0x544d5349;                                   // "ISMT"
+
+//--------------------------------------------------------------------------------------------------
+static inline uint64_t tileKey(int32_t x, int32_t y)
+{
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y);
+}
+//--------------------------------------------------------------------------------------------------
+static inline int32_t floorDiv(int64_t a, int64_t b)
+{
+    return static_cast<int32_t>(a >= 0 ? a / b : -((-a + b - 1) / b));
+}
+//--------------------------------------------------------------------------------------------------
+SonarMosaic::SonarMosaic() : m_metersPerPixel(0.1), m_maxResidentTiles(16), m_useCounter(0), m_lastTile(nullptr), m_haveOrigin(false), m_originLatDeg(0), m_originLonDeg(0),
+                             m_metersPerDegLat(0), m_metersPerDegLon(0), m_fixIdx(0), m_fixCount(0), m_headingMountRad(0), m_headingIdx(0), m_headingCount(0)
+{
+}
+//--------------------------------------------------------------------------------------------------
+SonarMosaic::~SonarMosaic()
+{
+}
+//--------------------------------------------------------------------------------------------------
+void SonarMosaic::setup(const std::string& tilePath, real_t metersPerPixel, uint_t maxResidentTiles)
+{
+    m_tilePath = tilePath;
+    m_metersPerPixel = metersPerPixel;
+    m_maxResidentTiles = maxResidentTiles ? maxResidentTiles : 1;
+    m_free.reserve(m_maxResidentTiles);
+
+    if (HeapMonitor::enabled && m_tiles.empty())
+    {
+        // Every tile the mosaic can hold, so pings never allocate one
+        m_tiles.reserve(m_maxResidentTiles);
+        while (m_free.size() < m_maxResidentTiles)
+        {
+            m_free.push_back(m_tiles.extract(m_tiles.emplace(0, std::make_unique<Tile>()).first));
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void SonarMosaic::addPosition(uint64_t hostUs, real_t latitudeDeg, real_t longitudeDeg)
+{
+    if (!m_haveOrigin)
+    {
+        // Local tangent plane about the first fix, adequate over the few kilometres of a survey area
+        const real_t lat = latitudeDeg * pi / 180.0;
+        m_haveOrigin = true;
+        m_originLatDeg = latitudeDeg;
+        m_originLonDeg = longitudeDeg;
+        m_metersPerDegLat = 111132.92 - 559.82 * std::cos(2 * lat) + 1.175 * std::cos(4 * lat);
+        m_metersPerDegLon = 111412.84 * std::cos(lat) - 93.5 * std::cos(3 * lat);
+    }
+
+    Fix& fix = m_fixes[m_fixIdx];
+    fix.hostUs = hostUs;
+    fix.east = (longitudeDeg - m_originLonDeg) * m_metersPerDegLon;
+    fix.north = (latitudeDeg - m_originLatDeg) * m_metersPerDegLat;
+    m_fixIdx = (m_fixIdx + 1) % fixHistory;
+    m_fixCount = m_fixCount < fixHistory ? m_fixCount + 1 : fixHistory;
+}
+//--------------------------------------------------------------------------------------------------
+void SonarMosaic::addHeading(uint64_t hostUs, real_t headingRad)
+{
+    Heading& h = m_headings[m_headingIdx];
+    h.hostUs = hostUs;
+    h.sin = std::sin(headingRad - m_headingMountRad);
+    h.cos = std::cos(headingRad - m_headingMountRad);
+    m_headingIdx = (m_headingIdx + 1) % headingHistory;
+    m_headingCount = m_headingCount < headingHistory ? m_headingCount + 1 : headingHistory;
+}
+//--------------------------------------------------------------------------------------------------
+void SonarMosaic::setHeadingMount(real_t rotationRad)
+{
+    m_headingMountRad = rotationRad;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t SonarMosaic::positionAt(uint64_t hostUs, real_t& east, real_t& north) const
+{
+    if (m_fixCount == 0)
+    {
+        return false;
+    }
+
+    // Walk back from the newest fix to find the pair bracketing the time, pings newer than the last
+    // fix are extrapolated along the last leg
+    const Fix* b = &m_fixes[(m_fixIdx + fixHistory - 1) % fixHistory];
+    const Fix* a = b;
+
+    if (hostUs > b->hostUs + maxExtrapolationMs * static_cast<uint64_t>(1000))
+    {
+        return false;                                                           // The GPS has stopped
+    }
+
+    for (uint_t i = 1; i < m_fixCount; i++)
+    {
+        a = &m_fixes[(m_fixIdx + fixHistory - 1 - i) % fixHistory];
+        if (a->hostUs <= hostUs)
+        {
+            break;
+        }
+        b = a;
+    }
+
+    if (a == b || b->hostUs == a->hostUs)
+    {
+        east = b->east;
+        north = b->north;
+        return true;
+    }
+
+    real_t t = (static_cast<real_t>(hostUs) - a->hostUs) / (static_cast<real_t>(b->hostUs) - a->hostUs);
+    t = t < 0 ? 0 : (t > 2.0 ? 2.0 : t);                                        // Not before the oldest fix or more than one fix interval after the newest
+    east = a->east + (b->east - a->east) * t;
+    north = a->north + (b->north - a->north) * t;
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t SonarMosaic::headingAt(uint64_t hostUs, real_t& headingRad) const
+{
+    if (m_headingCount == 0)
+    {
+        return false;
+    }
+
+    const Heading* b = &m_headings[(m_headingIdx + headingHistory - 1) % headingHistory];
+    const Heading* a = b;
+
+    if (hostUs > b->hostUs + maxExtrapolationMs * static_cast<uint64_t>(1000))
+    {
+        return false;
+    }
+
+    for (uint_t i = 1; i < m_headingCount; i++)
+    {
+        a = &m_headings[(m_headingIdx + headingHistory - 1 - i) % headingHistory];
+        if (a->hostUs <= hostUs)
+        {
+            break;
+        }
+        b = a;
+    }
+
+    if (a == b || b->hostUs <= hostUs || b->hostUs == a->hostUs)
+    {
+        headingRad = std::atan2(b->sin, b->cos);
+        return true;
+    }
+
+    // Interpolating the unit vector avoids the wrap at north
+    real_t t = (static_cast<real_t>(hostUs) - a->hostUs) / (static_cast<real_t>(b->hostUs) - a->hostUs);
+    t = t < 0 ? 0 : t;                                                          // Before the oldest heading
+    headingRad = std::atan2(a->sin + (b->sin - a->sin) * t, a->cos + (b->cos - a->cos) * t);
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t SonarMosaic::addPing(uint64_t hostUs, const Sonar::Ping& ping, real_t mountOffsetRad)
+{
+    real_t east, north, heading;
+    const uint_t count = ping.data.size();
+
+    if (count == 0 || !positionAt(hostUs, east, north) || !headingAt(hostUs, heading))
+    {
+        return false;
+    }
+
+    const real_t bearing = heading + mountOffsetRad + static_cast<real_t>(ping.angle) * 2.0 * pi / Sonar::maxAngle;
+    const real_t minRangeM = ping.minRangeMm * 0.001;
+    const real_t stepM = (static_cast<real_t>(ping.maxRangeMm) - ping.minRangeMm) * 0.001 / count;
+    const real_t dx = std::sin(bearing) / m_metersPerPixel;
+    const real_t dy = std::cos(bearing) / m_metersPerPixel;
+    const real_t px = east / m_metersPerPixel;
+    const real_t py = north / m_metersPerPixel;
+    const int64_t size = tileSize;
+
+    for (uint_t i = 0; i < count; i++)
+    {
+        const real_t range = minRangeM + (i + 0.5) * stepM;
+        const int64_t x = static_cast<int64_t>(std::floor(px + dx * range));
+        const int64_t y = static_cast<int64_t>(std::floor(py + dy * range));
+        const int32_t tx = floorDiv(x, size);
+        const int32_t ty = floorDiv(y, size);
+
+        Tile* tile = m_lastTile;
+        if (tile == nullptr || tile->x != tx || tile->y != ty)
+        {
+            tile = getTile(tx, ty);
+        }
+
+        Pixel& pixel = tile->pixels[(y - ty * size) * size + (x - tx * size)];
+        if (pixel.count < 0xffff)
+        {
+            pixel.count++;
+            pixel.value = static_cast<uint16_t>(pixel.value + (static_cast<int32_t>(ping.data[i]) - pixel.value) / pixel.count);
+        }
+    }
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+SonarMosaic::Tile* SonarMosaic::getTile(int32_t x, int32_t y)
+{
+    const uint64_t key = tileKey(x, y);
+    auto it = m_tiles.find(key);
+
+    if (it != m_tiles.end())
+    {
+        m_lastTile = it->second.get();
+    }
+    else
+    {
+        if (m_tiles.size() >= m_maxResidentTiles)
+        {
+            evict();
+        }
+
+        if (m_free.empty())
+        {
+            m_lastTile = (m_tiles[key] = std::make_unique<Tile>()).get();
+        }
+        else
+        {
+            TileMap::node_type node = std::move(m_free.back());
+            m_free.pop_back();
+            node.key() = key;
+            m_lastTile = node.mapped().get();
+            memset(m_lastTile->pixels, 0, sizeof(m_lastTile->pixels));
+            m_tiles.insert(std::move(node));
+        }
+
+        m_lastTile->x = x;
+        m_lastTile->y = y;
+
+        if (m_onDisk.count(key) && !loadTile(*m_lastTile))
+        {
+            memset(m_lastTile->pixels, 0, sizeof(m_lastTile->pixels));
+        }
+    }
+
+    m_lastTile->lastUsed = ++m_useCounter;
+    return m_lastTile;
+}
+//--------------------------------------------------------------------------------------------------
+void SonarMosaic::evict()
+{
+    auto oldest = m_tiles.begin();
+
+    for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it)
+    {
+        if (it->second->lastUsed < oldest->second->lastUsed)
+        {
+            oldest = it;
+        }
+    }
+
+    if (oldest != m_tiles.end())
+    {
+        if (saveTile(*oldest->second))
+        {
+            m_onDisk.insert(oldest->first);
+        }
+
+        if (m_lastTile == oldest->second.get())
+        {
+            m_lastTile = nullptr;
+        }
+        m_free.push_back(m_tiles.extract(oldest));
+    }
+}
+//--------------------------------------------------------------------------------------------------
+std::string SonarMosaic::tileFileName(int32_t x, int32_t y) const
+{
+    char name[64];
+    snprintf(name, sizeof(name), "mosaic_%d_%d", x, y);
+    return m_tilePath + name;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t SonarMosaic::saveTile(const Tile& tile) const
+{
+    FILE* file = fopen((tileFileName(tile.x, tile.y) + ".tile").c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    // Run length coded, each record is a count of empty pixels followed by a count of literal pixels
+    const uint32_t header[3] = { tileMagic, static_cast<uint32_t>(tile.x), static_cast<uint32_t>(tile.y) };
+    fwrite(header, sizeof(header), 1, file);
+
+    const uint32_t total = tileSize * tileSize;
+    uint32_t i = 0;
+
+    while (i < total)
+    {
+        uint32_t run[2] = { 0, 0 };
+
+        while (i + run[0] < total && tile.pixels[i + run[0]].count == 0)
+        {
+            run[0]++;
+        }
+
+        const uint32_t start = i + run[0];
+        while (start + run[1] < total && tile.pixels[start + run[1]].count != 0)
+        {
+            run[1]++;
+        }
+
+        fwrite(run, sizeof(run), 1, file);
+        if (run[1])
+        {
+            fwrite(&tile.pixels[start], sizeof(Pixel), run[1], file);
+        }
+        i = start + run[1];
+    }
+
+    const bool_t ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t SonarMosaic::loadTile(Tile& tile) const
+{
+    FILE* file = fopen((tileFileName(tile.x, tile.y) + ".tile").c_str(), "rb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    uint32_t header[3];
+    bool_t ok = fread(header, sizeof(header), 1, file) == 1 && header[0] == tileMagic;
+    const uint32_t total = tileSize * tileSize;
+    uint32_t i = 0;
+
+    while (ok && i < total)
+    {
+        uint32_t run[2];
+        ok = fread(run, sizeof(run), 1, file) == 1 && i + run[0] + run[1] <= total;
+
+        if (ok)
+        {
+            memset(&tile.pixels[i], 0, run[0] * sizeof(Pixel));                 // Every pixel is written, the tile may hold another's
+            i += run[0];
+            ok = run[1] == 0 || fread(&tile.pixels[i], sizeof(Pixel), run[1], file) == run[1];
+            i += run[1];
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+//--------------------------------------------------------------------------------------------------
+uint_t SonarMosaic::exportTiles(const std::string& path)
+{
+    uint_t written = 0;
+
+    for (auto& it : m_tiles)
+    {
+        written += writeTiff(path + "mosaic_" + std::to_string(it.second->x) + "_" + std::to_string(it.second->y) + ".tif", *it.second);
+    }
+
+    if (!m_onDisk.empty())
+    {
+        std::unique_ptr<Tile> tile = std::make_unique<Tile>();
+
+        for (uint64_t key : m_onDisk)
+        {
+            if (m_tiles.count(key) == 0)
+            {
+                tile->x = static_cast<int32_t>(key >> 32);
+                tile->y = static_cast<int32_t>(key & 0xffffffff);
+
+                if (loadTile(*tile))
+                {
+                    written += writeTiff(path + "mosaic_" + std::to_string(tile->x) + "_" + std::to_string(tile->y) + ".tif", *tile);
+                }
+            }
+        }
+    }
+    return written;
+}
+//--------------------------------------------------------------------------------------------------
+static void putU16(std::vector<uint8_t>& buf, uint_t offset, uint16_t v)
+{
+    buf[offset] = v & 0xff;
+    buf[offset + 1] = v >> 8;
+}
+//--------------------------------------------------------------------------------------------------
+static void putU32(std::vector<uint8_t>& buf, uint_t offset, uint32_t v)
+{
+    putU16(buf, offset, v & 0xffff);
+    putU16(buf, offset + 2, v >> 16);
+}
+//--------------------------------------------------------------------------------------------------
+static void putF64(std::vector<uint8_t>& buf, uint_t offset, real_t v)
+{
+    double d = static_cast<double>(v);
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    putU32(buf, offset, bits & 0xffffffff);
+    putU32(buf, offset + 4, bits >> 32);
+}
+//--------------------------------------------------------------------------------------------------
+bool_t SonarMosaic::writeTiff(const std::string& fileName, const Tile& tile) const
+{
+    // Baseline little endian TIFF, 16 bit greyscale in one strip, with the GeoTIFF ModelPixelScale and
+    // ModelTiepoint tags placing it in the local east north plane. The origin is in the description.
+    const uint_t tagCount = 14;
+    const uint32_t ifdSize = 2 + tagCount * 12 + 4;
+    const uint32_t scaleOffset = 8 + ifdSize;
+    const uint32_t tieOffset = scaleOffset + 3 * 8;
+    const uint32_t descOffset = tieOffset + 6 * 8;
+
+    char desc[128];
+    const int descLen = snprintf(desc, sizeof(desc), "Sonar mosaic, local ENU meters about lat %.8f lon %.8f", m_originLatDeg, m_originLonDeg) + 1;
+    const uint32_t dataOffset = (descOffset + descLen + 1) & ~1u;
+    const uint32_t dataSize = tileSize * tileSize * 2;
+
+    std::vector<uint8_t> head(dataOffset, 0);
+    head[0] = 'I';
+    head[1] = 'I';
+    putU16(head, 2, 42);
+    putU32(head, 4, 8);
+    putU16(head, 8, tagCount);
+
+    const uint32_t tags[tagCount][4] =
+    {
+        { 256, 4, 1, tileSize },                    // ImageWidth
+        { 257, 4, 1, tileSize },                    // ImageLength
+        { 258, 3, 1, 16 },                          // BitsPerSample
+        { 259, 3, 1, 1 },                           // Compression none
+        { 262, 3, 1, 1 },                           // Photometric black is zero
+        { 270, 2, static_cast<uint32_t>(descLen), descOffset },
+        { 273, 4, 1, dataOffset },                  // StripOffsets
+        { 277, 3, 1, 1 },                           // SamplesPerPixel
+        { 278, 4, 1, tileSize },                    // RowsPerStrip
+        { 279, 4, 1, dataSize },                    // StripByteCounts
+        { 284, 3, 1, 1 },                           // PlanarConfiguration
+        { 339, 3, 1, 1 },                           // SampleFormat unsigned
+        { 33550, 12, 3, scaleOffset },              // ModelPixelScale
+        { 33922, 12, 6, tieOffset },                // ModelTiepoint
+    };
+
+    for (uint_t i = 0; i < tagCount; i++)
+    {
+        const uint_t entry = 10 + i * 12;
+        putU16(head, entry, static_cast<uint16_t>(tags[i][0]));
+        putU16(head, entry + 2, static_cast<uint16_t>(tags[i][1]));
+        putU32(head, entry + 4, tags[i][2]);
+
+        if (tags[i][1] == 3)
+        {
+            putU16(head, entry + 8, static_cast<uint16_t>(tags[i][3]));
+        }
+        else
+        {
+            putU32(head, entry + 8, tags[i][3]);
+        }
+    }
+    putU32(head, 10 + tagCount * 12, 0);
+
+    putF64(head, scaleOffset, m_metersPerPixel);
+    putF64(head, scaleOffset + 8, m_metersPerPixel);
+    putF64(head, scaleOffset + 16, 0);
+
+    // Raster row 0 is the northern edge of the tile
+    putF64(head, tieOffset + 24, static_cast<real_t>(tile.x) * tileSize * m_metersPerPixel);
+    putF64(head, tieOffset + 32, static_cast<real_t>(tile.y + 1) * tileSize * m_metersPerPixel);
+    memcpy(&head[descOffset], desc, descLen);
+
+    FILE* file = fopen(fileName.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    fwrite(&head[0], 1, head.size(), file);
+
+    std::vector<uint8_t> row(tileSize * 2);
+    for (uint_t r = 0; r < tileSize; r++)
+    {
+        const Pixel* src = &tile.pixels[(tileSize - 1 - r) * tileSize];
+        for (uint_t c = 0; c < tileSize; c++)
+        {
+            putU16(row, c * 2, src[c].value);
+        }
+        fwrite(&row[0], 1, row.size(), file);
+    }
+
+    const bool_t ok = ferror(file) == 0;
+    fclose(file);
+    return ok;
+}
+//--------------------------------------------------------------------------------------------------
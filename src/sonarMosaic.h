@@ -0,0 +1,112 @@
+#ifndef SONARMOSAIC_H_
+#define SONARMOSAIC_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "devices/sonar.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Georeferenced sonar mosaic. Position comes from GPS fixes and heading from one AHRS on the
+    // vehicle, turned by its mounting into the vehicle's heading. Both are buffered with their host time
+    // so they can be interpolated at each ping time, and pings more than maxExtrapolationMs after the
+    // newest of either aren't placed. Each ping is turned by its own sonar's mounting. Ping samples are
+    // projected into a local east north plane about the first fix and averaged into a sparse grid of
+    // square tiles. Tiles are allocated when first touched and the least recently used are written to
+    // disk when too many are resident, so a survey of any size builds up in one pass. Evicted tiles are
+    // reused, and static memory builds allocate every resident tile in setup().
+    class SonarMosaic
+    {
+    public:
+        static constexpr uint_t tileSize = 1024;
+        static constexpr uint_t maxExtrapolationMs = 2000;
+
+        SonarMosaic();
+        ~SonarMosaic();
+        void setup(const std::string& tilePath, real_t metersPerPixel, uint_t maxResidentTiles);
+        void addPosition(uint64_t hostUs, real_t latitudeDeg, real_t longitudeDeg);
+        void addHeading(uint64_t hostUs, real_t headingRad);
+        void setHeadingMount(real_t rotationRad);                           // Of the heading source from vehicle forward, clockwise
+        bool_t addPing(uint64_t hostUs, const Sonar::Ping& ping, real_t mountOffsetRad);
+        uint_t exportTiles(const std::string& path);                       // Returns the number of tiles written
+
+        Slot<uint64_t, real_t, real_t> slotPosition{ this, &SonarMosaic::addPosition };
+        Slot<uint64_t, real_t> slotHeading{ this, &SonarMosaic::addHeading };
+
+    private:
+        struct Pixel
+        {
+            uint16_t value;                                 // Running mean of the samples that hit this pixel
+            uint16_t count;
+        };
+
+        struct Tile
+        {
+            int32_t x;
+            int32_t y;
+            uint64_t lastUsed;
+            Pixel pixels[tileSize * tileSize];
+        };
+
+        struct Fix
+        {
+            uint64_t hostUs;
+            real_t east;
+            real_t north;
+        };
+
+        struct Heading
+        {
+            uint64_t hostUs;
+            real_t sin;
+            real_t cos;
+        };
+
+        static constexpr uint_t fixHistory = 16;
+        static constexpr uint_t headingHistory = 256;
+
+        std::string m_tilePath;
+        real_t m_metersPerPixel;
+        uint_t m_maxResidentTiles;
+        uint64_t m_useCounter;
+        typedef std::unordered_map<uint64_t, std::unique_ptr<Tile>> TileMap;
+
+        TileMap m_tiles;
+        std::vector<TileMap::node_type> m_free;                             // Evicted tiles with their map entries, ready to reuse
+        std::unordered_set<uint64_t> m_onDisk;
+        Tile* m_lastTile;
+
+        bool_t m_haveOrigin;
+        real_t m_originLatDeg;
+        real_t m_originLonDeg;
+        real_t m_metersPerDegLat;
+        real_t m_metersPerDegLon;
+
+        Fix m_fixes[fixHistory];
+        uint_t m_fixIdx;
+        uint_t m_fixCount;
+        real_t m_headingMountRad;
+        Heading m_headings[headingHistory];
+        uint_t m_headingIdx;
+        uint_t m_headingCount;
+
+        bool_t positionAt(uint64_t hostUs, real_t& east, real_t& north) const;
+        bool_t headingAt(uint64_t hostUs, real_t& headingRad) const;
+        Tile* getTile(int32_t x, int32_t y);
+        void evict();
+        std::string tileFileName(int32_t x, int32_t y) const;
+        bool_t saveTile(const Tile& tile) const;
+        bool_t loadTile(Tile& tile) const;
+        bool_t writeTiff(const std::string& fileName, const Tile& tile) const;
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,560 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "telemetryServer.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#if defined(OS_UNIX)
+    #include <arpa/inet.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <netinet/in.h>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/uio.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+using namespace IslSdk;
+
+static_assert(sizeof(TelemetryServer::Header) == 32, "Header layout is part of the protocol");
+static_assert(sizeof(TelemetryServer::Ahrs) == 32 && sizeof(TelemetryServer::SonarPing) == 16, "Payload layouts are part of the protocol");
+
+//--------------------------------------------------------------------------------------------------
+TelemetryServer::TelemetryServer() : m_udpSocket(-1), m_unixSocket(-1), m_topicMask(0), m_seq()
+{
+}
+//--------------------------------------------------------------------------------------------------
+TelemetryServer::~TelemetryServer()
+{
+    close();
+}
+//--------------------------------------------------------------------------------------------------
+TelemetryServer& TelemetryServer::global()
+{
+    static TelemetryServer server;
+    return server;
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::updateMask()
+{
+    m_topicMask = 0;
+
+    for (const Subscriber& subscriber : m_subscribers)
+    {
+        m_topicMask |= subscriber.topicMask;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+#ifdef OS_UNIX
+bool_t TelemetryServer::setup(uint16_t udpPort, const std::string& unixPath)
+{
+    const int bufSize = 4 * 1024 * 1024;
+
+    close();
+
+    if (udpPort)
+    {
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(udpPort);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        m_udpSocket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (m_udpSocket >= 0 && bind(m_udpSocket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            Debug::log(Debug::Severity::Warning, "Telemetry", "Can't bind UDP port %u", FMT_U(udpPort));
+            ::close(m_udpSocket);
+            m_udpSocket = -1;
+        }
+    }
+
+    struct sockaddr_un addr = {};
+    if (!unixPath.empty() && unixPath.size() < sizeof(addr.sun_path))
+    {
+        addr.sun_family = AF_UNIX;
+        unixPath.copy(addr.sun_path, unixPath.size());
+        unlink(unixPath.c_str());
+
+        m_unixSocket = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (m_unixSocket >= 0 && bind(m_unixSocket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+        {
+            Debug::log(Debug::Severity::Warning, "Telemetry", "Can't bind %s", unixPath.c_str());
+            ::close(m_unixSocket);
+            m_unixSocket = -1;
+        }
+        m_unixPath = unixPath;
+    }
+
+    for (int s : { m_udpSocket, m_unixSocket })
+    {
+        if (s >= 0)
+        {
+            setsockopt(s, SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+            fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+        }
+    }
+
+    return m_udpSocket >= 0 || m_unixSocket >= 0;
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::close()
+{
+    if (m_udpSocket >= 0)
+    {
+        ::close(m_udpSocket);
+        m_udpSocket = -1;
+    }
+
+    if (m_unixSocket >= 0)
+    {
+        ::close(m_unixSocket);
+        unlink(m_unixPath.c_str());
+        m_unixSocket = -1;
+    }
+
+    m_subscribers.clear();
+    m_topicMask = 0;
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::run()
+{
+    receiveSubscriptions(m_udpSocket);
+    receiveSubscriptions(m_unixSocket);
+
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    for (uint_t i = 0; i < m_subscribers.size();)
+    {
+        Subscriber& subscriber = m_subscribers[i];
+
+        flush(subscriber);
+
+        if (subscriber.dead || nowUs - subscriber.lastSeenUs > subscriberTimeoutMs * static_cast<uint64_t>(1000))
+        {
+            Debug::log(Debug::Severity::Info, "Telemetry", "Subscriber dropped, %llu messages lost to its queue", static_cast<unsigned long long>(subscriber.dropped));
+            m_subscribers.erase(m_subscribers.begin() + i);
+            updateMask();
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::receiveSubscriptions(int socket)
+{
+    Subscribe msg;
+    struct sockaddr_storage from;
+    socklen_t fromLen = sizeof(from);
+    ssize_t size;
+
+    while (socket >= 0 && (size = recvfrom(socket, &msg, sizeof(msg), 0, reinterpret_cast<struct sockaddr*>(&from), &fromLen)) >= 0)
+    {
+        if (size == sizeof(msg) && msg.magic == magic && fromLen <= sizeof(Subscriber::address))
+        {
+            auto it = std::find_if(m_subscribers.begin(), m_subscribers.end(), [&](const Subscriber& s)
+                                   { return s.socket == socket && s.addressLen == fromLen && memcmp(s.address, &from, fromLen) == 0; });
+
+            if (it == m_subscribers.end() && msg.topicMask && m_subscribers.size() < maxSubscribers)
+            {
+                m_subscribers.emplace_back();
+                it = m_subscribers.end() - 1;
+                it->socket = socket;
+                memcpy(it->address, &from, fromLen);
+                it->addressLen = fromLen;
+                it->dropped = 0;
+                it->dead = false;
+                Debug::log(Debug::Severity::Info, "Telemetry", "New subscriber for topics 0x%x", msg.topicMask);
+            }
+
+            if (it != m_subscribers.end())
+            {
+                it->topicMask = msg.topicMask;
+                it->lastSeenUs = Platform::getTimeUs();
+                it->dead = msg.topicMask == 0;
+            }
+            updateMask();
+        }
+        fromLen = sizeof(from);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::publish(Topic topic, uint32_t source, uint64_t timeUs, const void* payload, uint_t payloadSize, const void* data, uint_t dataSize)
+{
+    const uint_t t = static_cast<uint_t>(topic);
+
+    if (!wanted(topic))
+    {
+        return;
+    }
+
+    Header header;
+    header.magic = magic;
+    header.version = version;
+    header.topic = static_cast<uint8_t>(t);
+    header.headerSize = sizeof(Header);
+    header.seq = m_seq[t]++;
+    header.source = source;
+    header.timeUs = timeUs;
+    header.payloadSize = static_cast<uint32_t>(payloadSize + std::min<uint_t>(dataSize, maxMessageSize - sizeof(Header) - payloadSize));
+    header.reserved = 0;
+
+    struct iovec iov[3];
+    iov[0] = { &header, sizeof(header) };
+    iov[1] = { const_cast<void*>(payload), payloadSize };
+    iov[2] = { const_cast<void*>(data), header.payloadSize - payloadSize };
+    const uint_t iovCount = data ? 3 : 2;
+
+    struct mmsghdr msgs[maxSubscribers];
+    Subscriber* targets[maxSubscribers];
+
+    for (int socket : { m_udpSocket, m_unixSocket })
+    {
+        uint_t count = 0;
+
+        for (Subscriber& subscriber : m_subscribers)
+        {
+            if (subscriber.socket != socket || subscriber.dead || !((subscriber.topicMask >> t) & 1))
+            {
+                continue;
+            }
+
+            if (!subscriber.queue.empty())
+            {
+                enqueue(subscriber, iov, iovCount);                             // Behind already, keep the order
+                continue;
+            }
+
+            struct msghdr& hdr = msgs[count].msg_hdr;
+            hdr = {};
+            hdr.msg_name = subscriber.address;
+            hdr.msg_namelen = subscriber.addressLen;
+            hdr.msg_iov = iov;
+            hdr.msg_iovlen = iovCount;
+            targets[count++] = &subscriber;
+        }
+
+        // sendmmsg() stops at the first message that fails, that subscriber is queued and the rest retried
+        for (uint_t i = 0; i < count;)
+        {
+            const int sent = sendmmsg(socket, &msgs[i], count - i, MSG_DONTWAIT | MSG_NOSIGNAL);
+
+            if (sent > 0)
+            {
+                i += sent;
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
+            {
+                enqueue(*targets[i], iov, iovCount);
+            }
+            else
+            {
+                targets[i]->dead = true;                                        // Its socket has gone
+            }
+            i++;
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::enqueue(Subscriber& subscriber, const void* iovs, uint_t iovCount)
+{
+    const struct iovec* iov = static_cast<const struct iovec*>(iovs);
+    std::vector<uint8_t> msg;
+
+    if (subscriber.queue.size() >= queueDepth)
+    {
+        msg.swap(subscriber.queue.front());                                     // Reuse the oldest message's memory
+        subscriber.queue.pop_front();
+        subscriber.dropped++;
+        msg.clear();
+    }
+
+    for (uint_t i = 0; i < iovCount; i++)
+    {
+        const uint8_t* base = static_cast<const uint8_t*>(iov[i].iov_base);
+        msg.insert(msg.end(), base, base + iov[i].iov_len);
+    }
+    subscriber.queue.push_back(std::move(msg));
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::flush(Subscriber& subscriber)
+{
+    while (!subscriber.queue.empty() && !subscriber.dead)
+    {
+        const std::vector<uint8_t>& msg = subscriber.queue.front();
+
+        if (sendto(subscriber.socket, msg.data(), msg.size(), MSG_DONTWAIT | MSG_NOSIGNAL, reinterpret_cast<const struct sockaddr*>(subscriber.address), subscriber.addressLen) < 0)
+        {
+            subscriber.dead = errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS;
+            break;
+        }
+        subscriber.queue.pop_front();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+TelemetryClient::TelemetryClient() : m_socket(-1)
+{
+}
+//--------------------------------------------------------------------------------------------------
+TelemetryClient::~TelemetryClient()
+{
+    close();
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TelemetryClient::open(uint16_t udpPort)
+{
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(udpPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    close();
+    m_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    return m_socket >= 0 && connect(m_socket, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TelemetryClient::open(const std::string& serverPath, const std::string& clientPath)
+{
+    struct sockaddr_un server = {};
+    struct sockaddr_un client = {};
+
+    close();
+
+    if (serverPath.size() >= sizeof(server.sun_path) || clientPath.size() >= sizeof(client.sun_path))
+    {
+        return false;
+    }
+
+    server.sun_family = AF_UNIX;
+    serverPath.copy(server.sun_path, serverPath.size());
+    client.sun_family = AF_UNIX;
+    clientPath.copy(client.sun_path, clientPath.size());
+    unlink(clientPath.c_str());
+
+    // A Unix datagram client needs an address of its own for the server to send to
+    m_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (m_socket >= 0 && bind(m_socket, reinterpret_cast<struct sockaddr*>(&client), sizeof(client)) == 0)
+    {
+        m_path = clientPath;
+        return connect(m_socket, reinterpret_cast<struct sockaddr*>(&server), sizeof(server)) == 0;
+    }
+    return false;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TelemetryClient::subscribe(uint32_t topicMask)
+{
+    const TelemetryServer::Subscribe msg = { TelemetryServer::magic, topicMask };
+    const int bufSize = 4 * 1024 * 1024;
+
+    setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+    return m_socket >= 0 && send(m_socket, &msg, sizeof(msg), 0) == sizeof(msg);
+}
+//--------------------------------------------------------------------------------------------------
+int_t TelemetryClient::receive(uint8_t* buf, uint_t size, uint_t timeoutMs)
+{
+    struct pollfd fd = { m_socket, POLLIN, 0 };
+
+    if (m_socket < 0 || poll(&fd, 1, timeoutMs) <= 0)
+    {
+        return -1;
+    }
+    return recv(m_socket, buf, size, 0);
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryClient::close()
+{
+    if (m_socket >= 0)
+    {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+
+    if (!m_path.empty())
+    {
+        unlink(m_path.c_str());
+        m_path.clear();
+    }
+}
+#else
+//--------------------------------------------------------------------------------------------------
+bool_t TelemetryServer::setup(uint16_t udpPort, const std::string& unixPath)
+{
+    return false;
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::close()
+{
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::run()
+{
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::publish(Topic topic, uint32_t source, uint64_t timeUs, const void* payload, uint_t payloadSize, const void* data, uint_t dataSize)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::receiveSubscriptions(int socket)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::enqueue(Subscriber& subscriber, const void* iov, uint_t iovCount)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::flush(Subscriber& subscriber)
+{
+}
+//--------------------------------------------------------------------------------------------------
+TelemetryClient::TelemetryClient() : m_socket(-1)
+{
+}
+//--------------------------------------------------------------------------------------------------
+TelemetryClient::~TelemetryClient()
+{
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TelemetryClient::open(uint16_t udpPort)
+{
+    return false;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TelemetryClient::open(const std::string& serverPath, const std::string& clientPath)
+{
+    return false;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TelemetryClient::subscribe(uint32_t topicMask)
+{
+    return false;
+}
+//--------------------------------------------------------------------------------------------------
+int_t TelemetryClient::receive(uint8_t* buf, uint_t size, uint_t timeoutMs)
+{
+    return -1;
+}
+//--------------------------------------------------------------------------------------------------
+void TelemetryClient::close()
+{
+}
+#endif
+//--------------------------------------------------------------------------------------------------
+void TelemetryServer::benchmark(uint_t subscribers, uint_t seconds)
+{
+    struct Stats
+    {
+        uint64_t messages = 0;
+        uint64_t bytes = 0;
+        uint64_t lost = 0;
+        Metrics::Histogram latencyNs;
+    };
+
+    const uint16_t port = 33099;
+    const std::string path = "/tmp/islTelemetryBench.sock";
+    TelemetryServer server;
+    std::vector<std::unique_ptr<Stats>> stats;
+    std::vector<std::thread> threads;
+    std::atomic<bool_t> running(true);
+
+    server.setup(port, path);
+
+    // All made before any thread starts so the vector isn't moved under them, and zeroed so a
+    // subscriber that couldn't open reports nothing
+    for (uint_t i = 0; i < subscribers; i++)
+    {
+        stats.push_back(std::make_unique<Stats>());
+    }
+
+    // Half the subscribers on each transport, each counting sequence gaps and the time since publishing
+    for (uint_t i = 0; i < subscribers; i++)
+    {
+        Stats* stat = stats[i].get();
+        threads.emplace_back([&, i, stat]()
+        {
+            Stats& s = *stat;
+            TelemetryClient client;
+            std::vector<uint8_t> buf(maxMessageSize);
+            uint32_t nextSeq = 0;
+
+            if (i & 1 ? !client.open(path, path + "." + std::to_string(i)) : !client.open(port))
+            {
+                return;
+            }
+
+            client.subscribe(1 << static_cast<uint_t>(Topic::SonarPing));
+
+            while (running)
+            {
+                const int_t size = client.receive(buf.data(), buf.size(), 100);
+                if (size >= static_cast<int_t>(sizeof(Header)))
+                {
+                    const Header& header = *reinterpret_cast<const Header*>(buf.data());
+                    s.latencyNs.record((Platform::getTimeUs() - header.timeUs) * 1000);
+                    s.lost += s.messages && header.seq > nextSeq ? header.seq - nextSeq : 0;
+                    nextSeq = header.seq + 1;
+                    s.messages++;
+                    s.bytes += size;
+                }
+            }
+            client.subscribe(0);
+        });
+    }
+
+    // Wait for everyone to subscribe, then publish 1024 sample pings flat out
+    const uint64_t subscribeEndUs = Platform::getTimeUs() + 2000000;
+    while (server.subscriberCount() < subscribers && Platform::getTimeUs() < subscribeEndUs)
+    {
+        server.run();
+        Platform::sleepMs(1);
+    }
+
+    std::vector<uint16_t> samples(1024, 1000);
+    SonarPing ping = { 0, 50000, 0, 16, static_cast<uint32_t>(samples.size()) };
+    const uint64_t startUs = Platform::getTimeUs();
+    const uint64_t endUs = startUs + seconds * static_cast<uint64_t>(1000000);
+    uint64_t published = 0;
+
+    while (Platform::getTimeUs() < endUs)
+    {
+        ping.angle = static_cast<uint16_t>(published * 16);
+        server.publish(Topic::SonarPing, 0, Platform::getTimeUs(), &ping, sizeof(ping), samples.data(), samples.size() * sizeof(uint16_t));
+        published++;
+
+        if ((published & 255) == 0)
+        {
+            server.run();
+        }
+    }
+
+    const real_t elapsedS = (Platform::getTimeUs() - startUs) * 0.000001;
+    Platform::sleepMs(200);
+    server.run();
+    running = false;
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    Debug::log(Debug::Severity::Notice, "Telemetry", "Published %llu pings (%u bytes) in %.1f s, %.0f per second to %u subscribers", static_cast<unsigned long long>(published),
+               FMT_U(sizeof(Header) + sizeof(ping) + samples.size() * 2), elapsedS, published / elapsedS, FMT_U(server.subscriberCount()));
+
+    for (uint_t i = 0; i < subscribers; i++)
+    {
+        const Stats& s = *stats[i];
+        Debug::log(Debug::Severity::Notice, "Telemetry", "%s subscriber %u: %8.0f msg/s %7.1f MB/s, lost %llu, latency us p50:%.1f p99:%.1f p99.9:%.1f", i & 1 ? "Unix" : "UDP ",
+                   FMT_U(i), s.messages / elapsedS, s.bytes / elapsedS * 1e-6, static_cast<unsigned long long>(s.lost),
+                   s.latencyNs.quantile(0.5) * 0.001, s.latencyNs.quantile(0.99) * 0.001, s.latencyNs.quantile(0.999) * 0.001);
+    }
+}
+//--------------------------------------------------------------------------------------------------
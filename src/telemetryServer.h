@@ -0,0 +1,146 @@
+#ifndef TELEMETRYSERVER_H_
+#define TELEMETRYSERVER_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "devices/device.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Publishes depth, altitude, AHRS and sonar pings to other processes on the vehicle. Clients send a
+    // Subscribe datagram with a bit mask of topics to the UDP loopback port or the Unix datagram socket
+    // and repeat it within subscriberTimeoutMs to stay subscribed. Each message is a fixed layout Header
+    // followed by the topic's fixed layout payload, little endian. publish() hands the callback's own
+    // buffers to the kernel with scatter gather and one sendmmsg() per socket for all subscribers, so
+    // nothing is serialised or copied. Only when a Unix subscriber's socket is full is the message
+    // copied to that subscriber's queue, which holds queueDepth messages and drops the oldest. UDP
+    // subscribers that fall behind lose data in their own socket buffer instead.
+    class TelemetryServer
+    {
+    public:
+        static constexpr uint32_t magic = 0x544c5349;                       // "ISLT"
+        static constexpr uint8_t version = 1;
+        static constexpr uint_t maxSubscribers = 32;
+        static constexpr uint_t queueDepth = 256;
+        static constexpr uint_t subscriberTimeoutMs = 10000;
+        static constexpr uint_t maxMessageSize = 65000;
+
+        enum class Topic : uint8_t { Depth, Altitude, Ahrs, SonarPing };   // Bit n of the subscribe mask is topic n
+
+        struct Header
+        {
+            uint32_t magic;
+            uint8_t version;
+            uint8_t topic;
+            uint16_t headerSize;                                            // sizeof(Header), the payload starts here
+            uint32_t seq;                                                   // Per topic, gaps are lost messages
+            uint32_t source;                                                // Part number << 16 | serial number
+            uint64_t timeUs;                                                // Platform::getTimeUs() clock
+            uint32_t payloadSize;
+            uint32_t reserved;
+        };
+
+        struct Subscribe
+        {
+            uint32_t magic;
+            uint32_t topicMask;                                             // 0 to unsubscribe
+        };
+
+        struct Depth
+        {
+            float pressureBar;
+            float depthM;
+        };
+
+        struct Altitude
+        {
+            float altitudeM;
+            float correlation;
+            float signalEnergy;
+            uint32_t totalEchoCount;
+        };
+
+        struct Ahrs
+        {
+            float w;
+            float x;
+            float y;
+            float z;
+            float headingRad;
+            float magHeadingRad;
+            float turns;
+            uint32_t reserved;
+        };
+
+        struct SonarPing
+        {
+            uint32_t minRangeMm;
+            uint32_t maxRangeMm;
+            uint16_t angle;
+            int16_t stepSize;                                               // Negative when scanning anticlockwise
+            uint32_t count;                                                 // Followed by count uint16_t samples
+        };
+
+        TelemetryServer();
+        ~TelemetryServer();
+        static TelemetryServer& global();
+        static uint32_t sourceId(const Device::Info& info) { return (static_cast<uint32_t>(info.pn) << 16) | info.sn; }
+        bool_t setup(uint16_t udpPort, const std::string& unixPath);
+        void close();
+        void run();                                                         // Call regularly to take subscriptions and drain queues
+        bool_t wanted(Topic topic) const { return (m_topicMask >> static_cast<uint_t>(topic)) & 1; }
+        void publish(Topic topic, uint32_t source, uint64_t timeUs, const void* payload, uint_t payloadSize, const void* data = nullptr, uint_t dataSize = 0);
+        uint_t subscriberCount() const { return m_subscribers.size(); }
+        static void benchmark(uint_t subscribers, uint_t seconds);          // Local subscribers measure throughput and latency
+
+    private:
+        struct Subscriber
+        {
+            int socket;
+            uint8_t address[128];
+            uint32_t addressLen;
+            uint32_t topicMask;
+            uint64_t lastSeenUs;
+            uint64_t dropped;
+            bool_t dead;
+            std::deque<std::vector<uint8_t>> queue;
+        };
+
+        int m_udpSocket;
+        int m_unixSocket;
+        std::string m_unixPath;
+        uint32_t m_topicMask;                                               // All subscribers together
+        uint32_t m_seq[4];
+        std::vector<Subscriber> m_subscribers;
+
+        void receiveSubscriptions(int socket);
+        void enqueue(Subscriber& subscriber, const void* iov, uint_t iovCount);
+        void flush(Subscriber& subscriber);
+        void updateMask();
+    };
+
+    // Subscriber side for other processes, over UDP loopback or a Unix datagram socket
+    class TelemetryClient
+    {
+    public:
+        TelemetryClient();
+        ~TelemetryClient();
+        bool_t open(uint16_t udpPort);
+        bool_t open(const std::string& serverPath, const std::string& clientPath);
+        bool_t subscribe(uint32_t topicMask);
+        int_t receive(uint8_t* buf, uint_t size, uint_t timeoutMs);       // Returns the message size, or -1 on timeout
+        void close();
+
+    private:
+        int m_socket;
+        std::string m_path;
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,459 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "timeSeriesStore.h"
+#include "platform/debug.h"
+#include "platform.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace IslSdk;
+
+namespace
+{
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t sampleSize;                                                // sizeof the structs, which differ with real_t
+        uint32_t bucketSize;
+        uint32_t config[5];                                                 // As in TimeSeriesStore::Config
+        uint32_t rawHead;
+        uint32_t rawCount;
+        uint32_t reserved;
+        uint64_t firstUs;
+        uint64_t lastUs;
+    };
+
+    constexpr uint32_t fileMagic = 0x544c5349;                              // "ISLT"
+    constexpr uint32_t fileVersion = 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+TimeSeriesStore::Series::Series(TimeSeriesStore& store, const std::string& name, const std::string& device) : name(name), device(device), m_store(store),
+    m_config(store.m_config), m_raw(m_config.rawSamples), m_rawHead(0), m_rawCount(0), m_buckets(m_config.levels * m_config.buckets), m_widthUs(m_config.levels),
+    m_firstUs(0), m_lastUs(0), m_saved(true)
+{
+    uint64_t widthUs = m_config.bucketMs * static_cast<uint64_t>(1000);
+
+    for (uint_t level = 0; level < m_config.levels; level++)
+    {
+        m_widthUs[level] = widthUs;
+        widthUs *= m_config.factor;
+    }
+
+    if (!m_store.m_pathPrefix.empty())
+    {
+        load();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void TimeSeriesStore::Series::add(uint64_t hostUs, real_t value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Kept in order for the search of the raw ring, the clock sync can step back a little
+    const uint64_t timeUs = std::max(m_store.toUtcUs(hostUs), m_lastUs);
+
+    m_raw[m_rawHead] = { timeUs, value };
+    m_rawHead = (m_rawHead + 1) % m_config.rawSamples;
+    m_firstUs = m_rawCount ? m_firstUs : timeUs;
+    m_rawCount = std::min(m_rawCount + 1, m_config.rawSamples);
+
+    Bucket* level = &m_buckets[0];
+    for (uint_t i = 0; i < m_config.levels; i++, level += m_config.buckets)
+    {
+        const uint64_t index = timeUs / m_widthUs[i];
+        Bucket& b = level[index % m_config.buckets];
+
+        if (b.index != index || b.count == 0)                               // The ring has come round to it again
+        {
+            b = { index, 0, value, value, 0 };
+        }
+
+        b.sum += value;
+        b.min = std::min(b.min, value);
+        b.max = std::max(b.max, value);
+        b.count++;
+    }
+
+    m_lastUs = timeUs;
+    m_saved = false;
+}
+//--------------------------------------------------------------------------------------------------
+void TimeSeriesStore::Series::query(uint64_t fromUs, uint64_t toUs, uint_t points, std::vector<Point>& result) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    result.clear();
+
+    if (m_rawCount == 0 || points == 0 || toUs < fromUs || fromUs > m_lastUs || toUs < m_firstUs)
+    {
+        return;
+    }
+
+    // The raw samples if they go back far enough and there are no more of them than points
+    if (fromUs >= raw(0).timeUs || raw(0).timeUs == m_firstUs)
+    {
+        const uint_t first = rawLowerBound(fromUs);
+        const uint_t end = toUs >= m_lastUs ? m_rawCount : rawLowerBound(toUs + 1);
+
+        if (end - first <= points)
+        {
+            for (uint_t i = first; i < end; i++)
+            {
+                const Sample& s = raw(i);
+                result.push_back({ s.timeUs, s.value, s.value, s.value, 1 });
+            }
+            return;
+        }
+    }
+
+    // Otherwise the finest level with buckets no narrower than a point that holds the start of the range
+    const uint64_t startUs = std::max(fromUs, m_firstUs);
+    const uint64_t pointUs = (toUs - fromUs) / points + 1;
+    uint_t level = 0;
+
+    while (level + 1 < m_config.levels && (m_widthUs[level] < pointUs || m_lastUs / m_widthUs[level] - startUs / m_widthUs[level] >= m_config.buckets))
+    {
+        level++;
+    }
+
+    // Only the top level can have buckets narrower than a point, they're merged in groups to make them
+    // wide enough. The ring bounds the number read
+    const uint64_t widthUs = m_widthUs[level];
+    const uint64_t group = (pointUs + widthUs - 1) / widthUs;
+    const uint64_t newest = m_lastUs / widthUs;
+    const uint64_t oldest = newest >= m_config.buckets ? newest - m_config.buckets + 1 : 0;
+    const uint64_t last = std::min(toUs, m_lastUs) / widthUs;
+    const Bucket* buckets = &m_buckets[level * m_config.buckets];
+
+    for (uint64_t index = std::max(startUs / widthUs, oldest); index <= last; index++)
+    {
+        const Bucket& b = buckets[index % m_config.buckets];
+        const uint64_t timeUs = index / group * group * widthUs;
+
+        if (b.count == 0 || b.index != index)
+        {
+            continue;
+        }
+
+        if (result.empty() || result.back().timeUs != timeUs)
+        {
+            result.push_back({ timeUs, b.min, b.max, static_cast<real_t>(b.sum / b.count), b.count });
+        }
+        else
+        {
+            Point& p = result.back();
+            p.min = std::min(p.min, b.min);
+            p.max = std::max(p.max, b.max);
+            p.mean = static_cast<real_t>((p.mean * p.count + b.sum) / (p.count + b.count));
+            p.count += b.count;
+        }
+    }
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TimeSeriesStore::Series::empty() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rawCount == 0;
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t TimeSeriesStore::Series::firstUs() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_firstUs;
+}
+//--------------------------------------------------------------------------------------------------
+uint64_t TimeSeriesStore::Series::lastUs() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastUs;
+}
+//--------------------------------------------------------------------------------------------------
+uint_t TimeSeriesStore::Series::rawLowerBound(uint64_t timeUs) const
+{
+    uint_t first = 0;
+    uint_t count = m_rawCount;
+
+    while (count)
+    {
+        const uint_t half = count / 2;
+
+        if (raw(first + half).timeUs < timeUs)
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+    return first;
+}
+//--------------------------------------------------------------------------------------------------
+std::string TimeSeriesStore::Series::fileName() const
+{
+    return m_store.m_pathPrefix + name + "_" + device + ".tss";
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TimeSeriesStore::Series::load()
+{
+    const std::string file = fileName();
+    FILE* f = fopen(file.c_str(), "rb");
+    FileHeader header;
+
+    if (f == nullptr)
+    {
+        return false;
+    }
+
+    const bool_t same = fread(&header, sizeof(header), 1, f) == 1 && header.magic == fileMagic && header.version == fileVersion && header.sampleSize == sizeof(Sample) &&
+                        header.bucketSize == sizeof(Bucket) && header.config[0] == m_config.rawSamples && header.config[1] == m_config.bucketMs &&
+                        header.config[2] == m_config.factor && header.config[3] == m_config.levels && header.config[4] == m_config.buckets;
+
+    const bool_t ok = same && fread(&m_raw[0], sizeof(Sample), m_raw.size(), f) == m_raw.size() && fread(&m_buckets[0], sizeof(Bucket), m_buckets.size(), f) == m_buckets.size();
+    fclose(f);
+
+    if (ok)
+    {
+        m_rawHead = header.rawHead % m_config.rawSamples;
+        m_rawCount = std::min<uint_t>(header.rawCount, m_config.rawSamples);
+        m_firstUs = header.firstUs;
+        m_lastUs = header.lastUs;
+        Debug::log(Debug::Severity::Info, "TimeSeries", "%s %s carries on from %.1f hours of data", name.c_str(), device.c_str(), (m_lastUs - m_firstUs) / 3600000000.0);
+    }
+    else
+    {
+        std::fill(m_raw.begin(), m_raw.end(), Sample());
+        std::fill(m_buckets.begin(), m_buckets.end(), Bucket());
+        Debug::log(Debug::Severity::Warning, "TimeSeries", "%s is from another configuration or damaged, starting again", file.c_str());
+    }
+    return ok;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TimeSeriesStore::Series::save(std::vector<uint8_t>& buf)
+{
+    const std::string file = fileName();
+    const std::string tempFile = file + ".tmp";
+    const size_t rawBytes = m_raw.size() * sizeof(Sample);
+    FileHeader header;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_saved)
+        {
+            return true;
+        }
+
+        header = { fileMagic, fileVersion, sizeof(Sample), sizeof(Bucket),
+                   { static_cast<uint32_t>(m_config.rawSamples), static_cast<uint32_t>(m_config.bucketMs), static_cast<uint32_t>(m_config.factor),
+                     static_cast<uint32_t>(m_config.levels), static_cast<uint32_t>(m_config.buckets) },
+                   static_cast<uint32_t>(m_rawHead), static_cast<uint32_t>(m_rawCount), 0, m_firstUs, m_lastUs };
+
+        buf.resize(rawBytes + m_buckets.size() * sizeof(Bucket));
+        memcpy(&buf[0], &m_raw[0], rawBytes);
+        memcpy(&buf[rawBytes], &m_buckets[0], m_buckets.size() * sizeof(Bucket));
+        m_saved = true;                                                         // Cleared by the next add()
+    }
+
+    FILE* f = fopen(tempFile.c_str(), "wb");
+
+    if (f == nullptr)
+    {
+        Debug::log(Debug::Severity::Warning, "TimeSeries", "Can't write %s", tempFile.c_str());
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_saved = false;
+        return false;
+    }
+
+    bool_t ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    ok = ok && fwrite(&buf[0], 1, buf.size(), f) == buf.size();
+    ok = fclose(f) == 0 && ok;
+
+    // Written beside the old file then renamed over it, so a crash while saving leaves the last one whole
+    if (ok && rename(tempFile.c_str(), file.c_str()) != 0)
+    {
+        remove(file.c_str());
+        ok = rename(tempFile.c_str(), file.c_str()) == 0;
+    }
+
+    if (!ok)
+    {
+        Debug::log(Debug::Severity::Warning, "TimeSeries", "Can't write %s", file.c_str());
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_saved = false;
+    }
+    return ok;
+}
+//--------------------------------------------------------------------------------------------------
+TimeSeriesStore::TimeSeriesStore() : m_config(defaultConfig), m_lastSaveUs(0), m_saveDue(false), m_stopping(false)
+{
+    const int64_t epochUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    m_epochOffsetUs = epochUs - static_cast<int64_t>(Platform::getTimeUs());
+}
+//--------------------------------------------------------------------------------------------------
+TimeSeriesStore::~TimeSeriesStore()
+{
+    if (m_writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_cv.notify_one();
+        m_writer.join();
+    }
+    save();
+}
+//--------------------------------------------------------------------------------------------------
+TimeSeriesStore& TimeSeriesStore::global()
+{
+    static TimeSeriesStore timeSeriesStore;
+    return timeSeriesStore;
+}
+//--------------------------------------------------------------------------------------------------
+void TimeSeriesStore::setup(const std::string& pathPrefix, const Config& config)
+{
+    m_pathPrefix = pathPrefix;
+    m_config = config;
+    m_config.rawSamples = std::max<uint_t>(m_config.rawSamples, 1);
+    m_config.bucketMs = std::max<uint_t>(m_config.bucketMs, 1);
+    m_config.factor = std::max<uint_t>(m_config.factor, 2);
+    m_config.levels = std::max<uint_t>(m_config.levels, 1);
+    m_config.buckets = std::max<uint_t>(m_config.buckets, 1);
+    m_lastSaveUs = Platform::getTimeUs();
+
+    uint64_t topUs = m_config.bucketMs * static_cast<uint64_t>(1000);
+    for (uint_t level = 1; level < m_config.levels; level++)
+    {
+        topUs *= m_config.factor;
+    }
+
+    if (!m_pathPrefix.empty() && !m_writer.joinable())
+    {
+        m_writer = std::thread(&TimeSeriesStore::writerTask, this);
+    }
+
+    const real_t mb = (m_config.rawSamples * sizeof(Series::Sample) + m_config.levels * m_config.buckets * sizeof(Series::Bucket)) / 1048576.0;
+    Debug::log(Debug::Severity::Info, "TimeSeries", "%.2f MB a series, %u raw samples and %u levels of %u buckets going back %.1f days", mb, FMT_U(m_config.rawSamples),
+               FMT_U(m_config.levels), FMT_U(m_config.buckets), topUs * m_config.buckets / 86400000000.0);
+}
+//--------------------------------------------------------------------------------------------------
+TimeSeriesStore::Series& TimeSeriesStore::series(const std::string& name, const std::string& device)
+{
+    for (std::unique_ptr<Series>& series : m_series)
+    {
+        if (series->name == name && series->device == device)
+        {
+            return *series;
+        }
+    }
+
+    std::unique_ptr<Series> series = std::make_unique<Series>(*this, name, device);
+    Series& result = *series;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_series.push_back(std::move(series));
+    return result;
+}
+//--------------------------------------------------------------------------------------------------
+void TimeSeriesStore::run()
+{
+    const uint64_t nowUs = Platform::getTimeUs();
+
+    if (m_writer.joinable() && nowUs - m_lastSaveUs >= savePeriodMs * static_cast<uint64_t>(1000))
+    {
+        m_lastSaveUs = nowUs;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_saveDue = true;
+        }
+        m_cv.notify_one();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void TimeSeriesStore::save()
+{
+    if (m_pathPrefix.empty())
+    {
+        return;
+    }
+
+    std::vector<uint8_t> buf;
+    for (std::unique_ptr<Series>& series : m_series)
+    {
+        series->save(buf);
+    }
+}
+//--------------------------------------------------------------------------------------------------
+void TimeSeriesStore::writerTask()
+{
+    Platform::setBackgroundThread();
+
+    std::vector<uint8_t> buf;
+    std::vector<Series*> series;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_cv.wait(lock, [this] { return m_saveDue || m_stopping; });
+
+        if (m_stopping)
+        {
+            break;
+        }
+
+        m_saveDue = false;
+        series.clear();
+        for (std::unique_ptr<Series>& s : m_series)
+        {
+            series.push_back(s.get());
+        }
+        lock.unlock();
+
+        for (Series* s : series)
+        {
+            s->save(buf);
+        }
+
+        lock.lock();
+    }
+}
+//--------------------------------------------------------------------------------------------------
+bool_t TimeSeriesStore::writeCsv(const std::string& fileName, uint_t points)
+{
+    FILE* file = fopen(fileName.c_str(), "w");
+    std::vector<Point> result;
+    uint64_t queryNs = 0;
+    uint_t count = 0;
+
+    if (file == nullptr)
+    {
+        Debug::log(Debug::Severity::Warning, "TimeSeries", "Can't write %s", fileName.c_str());
+        return false;
+    }
+
+    result.reserve(points + 1);
+    fprintf(file, "series,device,timeS,min,max,mean,count\n");
+
+    for (std::unique_ptr<Series>& series : m_series)
+    {
+        const uint64_t startNs = Platform::getTimeNs();
+        series->query(series->firstUs(), series->lastUs(), points, result);
+        queryNs += Platform::getTimeNs() - startNs;
+        count += static_cast<uint_t>(result.size());
+
+        for (const Point& p : result)
+        {
+            fprintf(file, "%s,%s,%.3f,%g,%g,%g,%u\n", series->name.c_str(), series->device.c_str(), p.timeUs * 0.000001, p.min, p.max, p.mean, p.count);
+        }
+    }
+    fclose(file);
+
+    Debug::log(Debug::Severity::Notice, "TimeSeries", "%u points of %u series written to %s, the queries took %.3f ms", FMT_U(count), FMT_U(m_series.size()), fileName.c_str(), queryNs * 0.000001);
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
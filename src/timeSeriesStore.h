@@ -0,0 +1,133 @@
+#ifndef TIMESERIESSTORE_H_
+#define TIMESERIESSTORE_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include <condition_variable>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Keeps a whole mission of depth, altitude, heading and temperature so any time range can be plotted
+    // straight away. Each series, one quantity from one device, holds its newest samples exactly in a raw
+    // ring and everything in a pyramid of levels of min, max, sum and count buckets. Level 0 buckets are
+    // bucketMs wide and each level's are factor times wider than the one below, every level being a ring
+    // of the same number of buckets, so memory is fixed when a series is made and the coarsest level
+    // reaches furthest back. A sample updates one bucket per level. query() picks the finest level whose
+    // buckets are at least as wide as a pixel and that still holds the start of the range, or the raw
+    // samples if there are no more of them than pixels, and reads only the buckets in the range, so it
+    // costs the number of points returned however long the range. Top level buckets narrower than a
+    // pixel are merged. Times are UTC microseconds so the series carry on across restarts, each being
+    // saved every savePeriodMs to pathPrefix + name + "_" + device + ".tss" and loaded when the series
+    // is made. Saving is done by a background thread, which copies a series under its lock and writes
+    // the copy, so adding samples waits for a memory copy rather than the disk. The files are a snapshot
+    // of the memory in native byte order and are ignored if the configuration has changed.
+    class TimeSeriesStore
+    {
+    public:
+        struct Config
+        {
+            uint_t rawSamples;                                              // Newest samples kept exactly
+            uint_t bucketMs;                                                // Level 0 bucket width
+            uint_t factor;                                                  // Buckets of a level to one of the level above
+            uint_t levels;
+            uint_t buckets;                                                 // In each level
+        };
+
+        // Buckets of 100ms up to 27 minutes, 4096 of them reach back 7 minutes at level 0 and 77 days at the top. About 1.5MB a series
+        static constexpr Config defaultConfig = { 16384, 100, 4, 8, 4096 };
+        static constexpr uint_t savePeriodMs = 60000;
+
+        struct Point
+        {
+            uint64_t timeUs;                                                // Start of the bucket, or the sample's time
+            real_t min;
+            real_t max;
+            real_t mean;
+            uint32_t count;                                                 // Samples in the bucket, 1 for a raw sample
+        };
+
+        class Series
+        {
+        public:
+            Series(TimeSeriesStore& store, const std::string& name, const std::string& device);
+            void add(uint64_t hostUs, real_t value);                        // Platform::getTimeUs() clock
+            void query(uint64_t fromUs, uint64_t toUs, uint_t points, std::vector<Point>& result) const;   // UTC, at most points + 1 in time order
+            bool_t empty() const;
+            uint64_t firstUs() const;
+            uint64_t lastUs() const;
+            const std::string name;
+            const std::string device;
+
+        private:
+            friend class TimeSeriesStore;
+
+            struct Sample
+            {
+                uint64_t timeUs;
+                real_t value;
+            };
+
+            struct Bucket
+            {
+                uint64_t index;                                             // Time / width, tells a stale bucket in the ring from a current one
+                double sum;
+                real_t min;
+                real_t max;
+                uint32_t count;
+            };
+
+            TimeSeriesStore& m_store;
+            const Config m_config;
+            std::vector<Sample> m_raw;                                      // Ring buffer in time order
+            uint_t m_rawHead;
+            uint_t m_rawCount;
+            std::vector<Bucket> m_buckets;                                  // Level after level
+            std::vector<uint64_t> m_widthUs;                                // Of each level's buckets
+            uint64_t m_firstUs;
+            uint64_t m_lastUs;
+            bool_t m_saved;
+            mutable std::mutex m_mutex;                                     // query() can be on another thread
+
+            const Sample& raw(uint_t i) const { return m_raw[(m_rawHead + m_raw.size() - m_rawCount + i) % m_raw.size()]; }
+            uint_t rawLowerBound(uint64_t timeUs) const;                    // First raw sample at or after timeUs
+            std::string fileName() const;
+            bool_t load();
+            bool_t save(std::vector<uint8_t>& buf);                         // buf holds the copy, reused between saves
+        };
+
+        TimeSeriesStore();
+        ~TimeSeriesStore();
+        static TimeSeriesStore& global();
+        void setup(const std::string& pathPrefix, const Config& config);   // Before the series are made, an empty pathPrefix keeps them in memory only
+        Series& series(const std::string& name, const std::string& device);
+        void run();                                                         // Call regularly to save the series
+        void save();                                                        // Now, on the calling thread
+        bool_t writeCsv(const std::string& fileName, uint_t points);        // Every series over its whole time at points resolution
+        uint64_t toUtcUs(uint64_t hostUs) const { return hostUs + m_epochOffsetUs; }
+
+    private:
+        std::vector<std::unique_ptr<Series>> m_series;
+        std::string m_pathPrefix;
+        Config m_config;
+        int64_t m_epochOffsetUs;                                            // Added to Platform::getTimeUs() to give UTC
+        uint64_t m_lastSaveUs;
+        bool_t m_saveDue;
+        bool_t m_stopping;
+        std::mutex m_mutex;                                                 // Guards m_series against the writer and the flags
+        std::condition_variable m_cv;
+        std::thread m_writer;
+
+        void writerTask();
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,96 @@
+#ifndef TYPEDAPP_H_
+#define TYPEDAPP_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "app.h"
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Binds the signal member of a device, or of anything, to the member function of the App that
+    // handles it, eg. On<&Isd4000::onPressure, &Isd4000App::callbackPressureData>. The handler must
+    // take exactly the arguments of the signal, a mismatch is a compile error and not a cast. The slot
+    // is bound straight to the handler so an event costs the same as a hand written slot, the SDK's
+    // Slot still calls through its std::function.
+    template<auto signal, auto handler>
+    struct On
+    {
+        static_assert(sizeof(signal) == 0, "On<> needs a Signal<Args...> member and a void handler taking Args...");
+    };
+
+    template<typename T, typename A, typename... Args, Signal<Args...> T::* signal, void (A::* handler)(Args...)>
+    struct On<signal, handler>
+    {
+        class Binding
+        {
+        public:
+            Binding(A* app) : m_slot(app, handler) {}
+            Binding(const Binding&) = delete;                               // The signal holds the slot
+            Binding& operator=(const Binding&) = delete;
+            void connect(T& source) { (source.*signal).connect(m_slot); }
+            void disconnect(T& source) { (source.*signal).disconnect(m_slot); }
+
+        private:
+            Slot<Args...> m_slot;
+        };
+    };
+
+    // The handlers of an App in a single declaration, connected and disconnected together
+    template<typename... Ons>
+    class Handlers : private Ons::Binding...
+    {
+    public:
+        template<typename A> Handlers(A* app) : Ons::Binding(app)... {}
+        template<typename T> void connect(T& source) { (Ons::Binding::connect(source), ...); }
+        template<typename T> void disconnect(T& source) { (Ons::Binding::disconnect(source), ...); }
+    };
+
+    // An App for one type of device. The derived App declares its device handlers as a member,
+    //     Handlers<On<&Isd4000::onPressure, &Isd4000App::callbackPressureData>, ...> m_handlers{ this };
+    // which is connected before connectDevice() and disconnected after disconnectDevice(). Those,
+    // deviceConnected() and sendRates() are the App's hooks taking the device type, found at compile
+    // time so there's no reinterpret_cast and nothing to override. Make TypedApp a friend to keep them private.
+    // watchLink() is the hook that picks the data m_link watches, the AHRS unless the App hides it.
+    template<typename AppT, typename DeviceT>
+    class TypedApp : public App
+    {
+    public:
+        TypedApp(const std::string& name) : App(name) {}
+
+    protected:
+        DeviceT& device() { return static_cast<DeviceT&>(*m_device); }      // Only while m_device is set
+
+        // Defaults for the typed hooks, hidden by those the derived App declares
+        void connectDevice(DeviceT& device) {}                              // Signals connected, set up the rates
+        void disconnectDevice(DeviceT& device) {}
+        void deviceConnected(DeviceT& device) {}                            // The device has connected or reconnected
+        void sendRates(DeviceT& device) {}                                  // Send the intervals in m_rates to the device
+        void watchLink() { m_link.setExpectedIntervalMs(m_rates.intervalMs("ahrs"), true); }
+
+    private:
+        AppT& app() { return static_cast<AppT&>(*this); }
+
+        void connectSignals(Device& device) final
+        {
+            DeviceT& typed = static_cast<DeviceT&>(device);
+            app().m_handlers.connect(typed);
+            app().connectDevice(typed);
+        }
+
+        void disconnectSignals(Device& device) final
+        {
+            DeviceT& typed = static_cast<DeviceT&>(device);
+            app().disconnectDevice(typed);
+            app().m_handlers.disconnect(typed);
+        }
+
+        void connectEvent(Device& device) final { app().deviceConnected(static_cast<DeviceT&>(device)); }
+        void applyRates(Device& device) final { app().sendRates(static_cast<DeviceT&>(device)); }
+        void superviseLink() final { app().watchLink(); }
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,247 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "waterProfile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+WaterProfile::WaterProfile() : m_cast(Cast::None), m_castCount(0), m_queueHead(0), m_queueCount(0), m_haveTemperature(false), m_temperatureC(0), m_temperatureUs(0),
+                               m_havePrevTemperature(false), m_prevTemperatureC(0), m_prevTemperatureUs(0), m_lastPressureUs(0), m_haveDepth(false), m_lastDepthM(0), m_speedMps(0), m_stopTimeS(0)
+{
+    m_current.cast = Cast::None;
+    m_last.cast = Cast::None;
+    m_last.number = 0;
+    setup(Settings());
+}
+//--------------------------------------------------------------------------------------------------
+void WaterProfile::setup(const Settings& settings)
+{
+    m_settings = settings;
+    uint_t binCount = static_cast<uint_t>(std::ceil(settings.maxDepthM / settings.binSizeM)) + 1;
+
+    m_current.bins.assign(binCount, Bin());
+    m_last.bins.assign(binCount, Bin());
+    m_last.cast = Cast::None;
+    m_cast = Cast::None;
+
+    // Every pressure sample of the slowest temperature interval, and one either side
+    const uint32_t pressureMs = settings.pressureIntervalMs ? settings.pressureIntervalMs : 1;
+    m_queue.resize((settings.temperatureIntervalMs + pressureMs - 1) / pressureMs + 2);
+    m_queueHead = 0;
+    m_queueCount = 0;
+    m_haveDepth = false;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t WaterProfile::addPressure(uint64_t timeUs, real_t pressureBar, real_t depthM)
+{
+    bool_t completed = false;
+
+    if (m_haveDepth && timeUs > m_lastPressureUs)
+    {
+        const real_t dt = (timeUs - m_lastPressureUs) * 0.000001;
+        const real_t alpha = dt / (1.0 + dt);                                       // One second time constant
+        m_speedMps += alpha * ((depthM - m_lastDepthM) / dt - m_speedMps);
+
+        if (m_cast == Cast::None)
+        {
+            if (m_speedMps > m_settings.castSpeedMps)
+            {
+                startCast(Cast::Descent, timeUs);
+            }
+            else if (m_speedMps < -m_settings.castSpeedMps)
+            {
+                startCast(Cast::Ascent, timeUs);
+            }
+        }
+        else
+        {
+            const real_t speed = m_cast == Cast::Descent ? m_speedMps : -m_speedMps;
+
+            if (speed < -m_settings.castSpeedMps)
+            {
+                m_stopTimeS = m_settings.stopTimeS;                                 // Direction reversed
+            }
+            else if (speed < m_settings.castSpeedMps * 0.5)
+            {
+                m_stopTimeS += dt;
+            }
+            else
+            {
+                m_stopTimeS = 0;
+            }
+
+            if (m_stopTimeS >= m_settings.stopTimeS)
+            {
+                endCast(timeUs);
+                completed = m_last.cast != Cast::None && m_last.number == m_castCount;
+            }
+        }
+    }
+
+    m_haveDepth = true;
+    m_lastDepthM = depthM;
+    m_lastPressureUs = timeUs;
+
+    const uint_t queueSize = static_cast<uint_t>(m_queue.size());
+
+    if (m_queueCount == queueSize)
+    {
+        // Temperature is slower than configured or has stopped, pair the oldest sample with the trend
+        if (m_haveTemperature && m_cast != Cast::None)
+        {
+            addToBin(m_queue[m_queueHead], trendTemperature(m_queue[m_queueHead].timeUs));
+        }
+        m_queueHead = (m_queueHead + 1) % queueSize;
+        m_queueCount--;
+    }
+
+    PressureSample& sample = m_queue[(m_queueHead + m_queueCount) % queueSize];
+    sample.timeUs = timeUs;
+    sample.pressureBar = pressureBar;
+    sample.depthM = depthM;
+    m_queueCount++;
+
+    return completed;
+}
+//--------------------------------------------------------------------------------------------------
+void WaterProfile::addTemperature(real_t temperatureC)
+{
+    // Temperature carries no timestamp so it's stamped with the most recent pressure sample time
+    flushQueue(temperatureC, m_lastPressureUs);
+    m_havePrevTemperature = m_haveTemperature;
+    m_prevTemperatureC = m_temperatureC;
+    m_prevTemperatureUs = m_temperatureUs;
+    m_haveTemperature = true;
+    m_temperatureC = temperatureC;
+    m_temperatureUs = m_lastPressureUs;
+}
+//--------------------------------------------------------------------------------------------------
+void WaterProfile::startCast(Cast cast, uint64_t timeUs)
+{
+    m_cast = cast;
+    m_stopTimeS = 0;
+    m_current.cast = cast;
+    m_current.number = ++m_castCount;
+    m_current.startTimeUs = timeUs;
+    m_current.endTimeUs = timeUs;
+    m_current.minDepthM = m_lastDepthM;
+    m_current.maxDepthM = m_lastDepthM;
+    std::fill(m_current.bins.begin(), m_current.bins.end(), Bin());
+}
+//--------------------------------------------------------------------------------------------------
+void WaterProfile::endCast(uint64_t timeUs)
+{
+    if (m_haveTemperature)
+    {
+        flushQueue(m_temperatureC, m_temperatureUs);                            // Stopped, so the held temperature is current
+    }
+
+    m_current.endTimeUs = timeUs;
+    if (m_current.maxDepthM - m_current.minDepthM >= m_settings.minCastDepthM)
+    {
+        m_last.cast = m_current.cast;
+        m_last.number = m_current.number;
+        m_last.startTimeUs = m_current.startTimeUs;
+        m_last.endTimeUs = m_current.endTimeUs;
+        m_last.minDepthM = m_current.minDepthM;
+        m_last.maxDepthM = m_current.maxDepthM;
+        m_last.bins = m_current.bins;                                               // Same size so no allocation
+    }
+
+    m_cast = Cast::None;
+    m_current.cast = Cast::None;
+}
+//--------------------------------------------------------------------------------------------------
+void WaterProfile::flushQueue(real_t temperatureC, uint64_t temperatureUs)
+{
+    while (m_queueCount)
+    {
+        const PressureSample& sample = m_queue[m_queueHead];
+        real_t t = temperatureC;
+
+        if (m_haveTemperature && temperatureUs > m_temperatureUs && sample.timeUs > m_temperatureUs)
+        {
+            real_t frac = static_cast<real_t>(sample.timeUs - m_temperatureUs) / (temperatureUs - m_temperatureUs);
+            frac = frac > 1.0 ? 1.0 : frac;
+            t = m_temperatureC + (temperatureC - m_temperatureC) * frac;
+        }
+
+        if (m_cast != Cast::None)
+        {
+            addToBin(sample, t);
+        }
+
+        m_queueHead = (m_queueHead + 1) % m_queue.size();
+        m_queueCount--;
+    }
+}
+//--------------------------------------------------------------------------------------------------
+real_t WaterProfile::trendTemperature(uint64_t timeUs) const
+{
+    // Extends the line through the last two temperatures by at most one more interval
+    if (m_havePrevTemperature && m_temperatureUs > m_prevTemperatureUs && timeUs > m_temperatureUs)
+    {
+        real_t frac = static_cast<real_t>(timeUs - m_prevTemperatureUs) / (m_temperatureUs - m_prevTemperatureUs);
+        frac = frac > 2.0 ? 2.0 : frac;
+        return m_prevTemperatureC + (m_temperatureC - m_prevTemperatureC) * frac;
+    }
+
+    return m_temperatureC;
+}
+//--------------------------------------------------------------------------------------------------
+void WaterProfile::addToBin(const PressureSample& sample, real_t temperatureC)
+{
+    int_t idx = static_cast<int_t>(sample.depthM / m_settings.binSizeM);
+    idx = idx < 0 ? 0 : idx;
+    idx = idx >= static_cast<int_t>(m_current.bins.size()) ? m_current.bins.size() - 1 : idx;
+
+    // Welford's online mean and variance
+    Bin& bin = m_current.bins[idx];
+    bin.count++;
+    real_t delta = temperatureC - bin.temperatureMeanC;
+    bin.temperatureMeanC += delta / bin.count;
+    bin.temperatureM2 += delta * (temperatureC - bin.temperatureMeanC);
+
+    delta = sample.pressureBar - bin.pressureMeanBar;
+    bin.pressureMeanBar += delta / bin.count;
+    bin.pressureM2 += delta * (sample.pressureBar - bin.pressureMeanBar);
+
+    m_current.minDepthM = sample.depthM < m_current.minDepthM ? sample.depthM : m_current.minDepthM;
+    m_current.maxDepthM = sample.depthM > m_current.maxDepthM ? sample.depthM : m_current.maxDepthM;
+}
+//--------------------------------------------------------------------------------------------------
+bool_t WaterProfile::exportCsv(const std::string& fileName) const
+{
+    FILE* file = fopen(fileName.c_str(), "w");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    fprintf(file, "depth_m,count,temperature_c,temperature_var,pressure_bar,pressure_var,sound_speed_mps\n");
+
+    for (size_t i = 0; i < m_last.bins.size(); i++)
+    {
+        const Bin& bin = m_last.bins[i];
+        if (bin.count)
+        {
+            const real_t depthM = (i + 0.5) * m_settings.binSizeM;
+            fprintf(file, "%.2f,%u,%.4f,%.6f,%.5f,%.8f,%.2f\n", depthM, static_cast<unsigned int>(bin.count), bin.temperatureMeanC, bin.temperatureVar(), bin.pressureMeanBar, bin.pressureVar(),
+                    soundSpeed(bin.temperatureMeanC, m_settings.salinityPsu, depthM));
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+//--------------------------------------------------------------------------------------------------
+real_t WaterProfile::soundSpeed(real_t t, real_t s, real_t d)
+{
+    // Mackenzie (1981), valid for 2 to 30C, 25 to 40 PSU and 0 to 8000m
+    return 1448.96 + 4.591 * t - 5.304e-2 * t * t + 2.374e-4 * t * t * t + 1.340 * (s - 35.0) + 1.630e-2 * d + 1.675e-7 * d * d - 1.025e-2 * t * (s - 35.0) - 7.139e-13 * t * d * d * d;
+}
+//--------------------------------------------------------------------------------------------------
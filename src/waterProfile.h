@@ -0,0 +1,110 @@
+#ifndef WATERPROFILE_H_
+#define WATERPROFILE_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include <string>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Builds binned water column profiles from the unsynchronised pressure and temperature streams of a
+    // depth sensor. Pressure samples are held until the next temperature sample arrives and are then
+    // paired with a temperature interpolated between the two bracketing temperature samples. The queue
+    // holds the pressure samples of the slowest temperature interval, if it still fills the oldest is
+    // paired with the trend of the last two temperatures. Casts are detected from the filtered vertical
+    // speed and each paired sample is accumulated into a fixed depth cell, so memory use depends only on
+    // the configured depth range, cell size and stream intervals.
+    class WaterProfile
+    {
+    public:
+        enum class Cast { None, Descent, Ascent };
+
+        struct Settings
+        {
+            real_t binSizeM;                // Depth cell size
+            real_t maxDepthM;               // Deepest cell, samples below this go into the last cell
+            real_t castSpeedMps;            // Vertical speed that starts a cast
+            real_t stopTimeS;               // Time below half the cast speed that ends a cast
+            real_t minCastDepthM;           // Casts covering less depth than this are discarded
+            real_t salinityPsu;             // Used for the sound speed calculation
+            uint32_t pressureIntervalMs;    // Fastest pressure interval
+            uint32_t temperatureIntervalMs; // Slowest temperature interval, the two size the pressure queue
+            Settings() : binSizeM(0.5), maxDepthM(1000), castSpeedMps(0.1), stopTimeS(5), minCastDepthM(2), salinityPsu(35), pressureIntervalMs(100), temperatureIntervalMs(10000) {}
+        };
+
+        struct Bin
+        {
+            uint_t count;
+            real_t temperatureMeanC;
+            real_t temperatureM2;
+            real_t pressureMeanBar;
+            real_t pressureM2;
+            real_t temperatureVar() const { return count > 1 ? temperatureM2 / (count - 1) : 0; }
+            real_t pressureVar() const { return count > 1 ? pressureM2 / (count - 1) : 0; }
+        };
+
+        struct Profile
+        {
+            Cast cast;
+            uint_t number;
+            uint64_t startTimeUs;
+            uint64_t endTimeUs;
+            real_t minDepthM;
+            real_t maxDepthM;
+            std::vector<Bin> bins;
+        };
+
+        WaterProfile();
+        void setup(const Settings& settings);
+        bool_t addPressure(uint64_t timeUs, real_t pressureBar, real_t depthM);     // Returns true when a cast has just completed
+        void addTemperature(real_t temperatureC);
+        Cast cast() const { return m_cast; }
+        const Profile& lastProfile() const { return m_last; }
+        bool_t exportCsv(const std::string& fileName) const;
+        static real_t soundSpeed(real_t temperatureC, real_t salinityPsu, real_t depthM);
+
+    private:
+        struct PressureSample
+        {
+            uint64_t timeUs;
+            real_t pressureBar;
+            real_t depthM;
+        };
+
+        Settings m_settings;
+        Cast m_cast;
+        Profile m_current;
+        Profile m_last;
+        uint_t m_castCount;
+
+        std::vector<PressureSample> m_queue;
+        uint_t m_queueHead;
+        uint_t m_queueCount;
+
+        bool_t m_haveTemperature;
+        real_t m_temperatureC;
+        uint64_t m_temperatureUs;
+        bool_t m_havePrevTemperature;
+        real_t m_prevTemperatureC;
+        uint64_t m_prevTemperatureUs;
+        uint64_t m_lastPressureUs;
+
+        bool_t m_haveDepth;
+        real_t m_lastDepthM;
+        real_t m_speedMps;
+        real_t m_stopTimeS;
+
+        void startCast(Cast cast, uint64_t timeUs);
+        void endCast(uint64_t timeUs);
+        void flushQueue(real_t temperatureC, uint64_t temperatureUs);
+        real_t trendTemperature(uint64_t timeUs) const;
+        void addToBin(const PressureSample& sample, real_t temperatureC);
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif
@@ -0,0 +1,159 @@
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "waveSpectrum.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace IslSdk;
+
+//--------------------------------------------------------------------------------------------------
+WaveSpectrum::WaveSpectrum() : m_sampleRateHz(0), m_df(0), m_size(0), m_hop(0), m_minBin(0), m_maxBin(0), m_reportSamples(0), m_psdScale(0), m_tMean(0), m_tVar(0),
+                               m_ringIdx(0), m_sampleCount(0), m_hopCount(0), m_samplesSinceReport(0), m_segmentCount(0)
+{
+}
+//--------------------------------------------------------------------------------------------------
+void WaveSpectrum::setup(real_t sampleRateHz, uint_t segmentSize, real_t reportIntervalS, real_t minFreqHz, real_t maxFreqHz)
+{
+    const real_t pi = 3.14159265358979323846;
+
+    m_sampleRateHz = sampleRateHz;
+    m_size = segmentSize;
+    m_hop = segmentSize / 2;
+    m_df = sampleRateHz / segmentSize;
+    m_reportSamples = static_cast<uint_t>(reportIntervalS * sampleRateHz);
+
+    m_fft.setup(m_size);
+    m_window.resize(m_size);
+    m_ring.resize(m_size);
+    m_segment.resize(m_size);
+    m_spectrum.resize(m_size / 2 + 1);
+    m_psdSum.resize(m_size / 2 + 1);
+    m_psd.resize(m_size / 2 + 1);
+
+    real_t windowPower = 0;
+    for (uint_t i = 0; i < m_size; i++)
+    {
+        m_window[i] = 0.5 - 0.5 * std::cos(2.0 * pi * i / m_size);
+        windowPower += m_window[i] * m_window[i];
+    }
+    m_psdScale = 1.0 / (sampleRateHz * windowPower);
+
+    // Sample index statistics used by the linear detrend, the vehicle may be changing depth
+    m_tMean = (m_size - 1) * 0.5;
+    m_tVar = 0;
+    for (uint_t i = 0; i < m_size; i++)
+    {
+        m_tVar += (i - m_tMean) * (i - m_tMean);
+    }
+
+    m_minBin = static_cast<uint_t>(std::ceil(minFreqHz / m_df));
+    m_maxBin = static_cast<uint_t>(std::floor(maxFreqHz / m_df));
+    if (m_minBin < 1) m_minBin = 1;
+    if (m_maxBin > m_size / 2) m_maxBin = m_size / 2;
+
+    reset();
+}
+//--------------------------------------------------------------------------------------------------
+void WaveSpectrum::reset()
+{
+    m_ringIdx = 0;
+    m_sampleCount = 0;
+    m_hopCount = 0;
+    m_samplesSinceReport = 0;
+    m_segmentCount = 0;
+    std::fill(m_psdSum.begin(), m_psdSum.end(), 0.0);
+    m_result = Result();
+}
+//--------------------------------------------------------------------------------------------------
+bool_t WaveSpectrum::add(real_t depthM)
+{
+    if (!m_size)
+    {
+        return false;
+    }
+
+    m_ring[m_ringIdx] = depthM;
+    m_ringIdx = (m_ringIdx + 1) % m_size;
+    m_samplesSinceReport++;
+
+    if (m_sampleCount < m_size)
+    {
+        m_sampleCount++;
+    }
+
+    m_hopCount++;
+    if (m_sampleCount == m_size && m_hopCount >= m_hop)
+    {
+        m_hopCount = 0;
+        processSegment();
+    }
+
+    if (m_samplesSinceReport >= m_reportSamples && m_segmentCount)
+    {
+        computeResult();
+        m_samplesSinceReport = 0;
+        return true;
+    }
+    return false;
+}
+//--------------------------------------------------------------------------------------------------
+void WaveSpectrum::processSegment()
+{
+    real_t sum = 0, sumT = 0;
+
+    for (uint_t i = 0; i < m_size; i++)
+    {
+        const real_t v = m_ring[(m_ringIdx + i) % m_size];
+        m_segment[i] = v;
+        sum += v;
+        sumT += (i - m_tMean) * v;
+    }
+
+    const real_t mean = sum / m_size;
+    const real_t slope = sumT / m_tVar;
+
+    for (uint_t i = 0; i < m_size; i++)
+    {
+        m_segment[i] = (m_segment[i] - mean - slope * (i - m_tMean)) * m_window[i];
+    }
+
+    m_fft.transform(&m_segment[0], &m_spectrum[0]);
+
+    for (uint_t k = 0; k <= m_size / 2; k++)
+    {
+        m_psdSum[k] += std::norm(m_spectrum[k]);
+    }
+    m_segmentCount++;
+}
+//--------------------------------------------------------------------------------------------------
+void WaveSpectrum::computeResult()
+{
+    const real_t scale = m_psdScale / m_segmentCount;
+    real_t m0 = 0;
+    real_t peak = 0;
+    uint_t peakBin = 0;
+
+    for (uint_t k = 0; k <= m_size / 2; k++)
+    {
+        const bool_t edge = (k == 0) || (k == m_size / 2);
+        m_psd[k] = m_psdSum[k] * scale * (edge ? 1.0 : 2.0);
+        m_psdSum[k] = 0;
+    }
+
+    for (uint_t k = m_minBin; k <= m_maxBin; k++)
+    {
+        m0 += m_psd[k] * m_df;
+        if (m_psd[k] > peak)
+        {
+            peak = m_psd[k];
+            peakBin = k;
+        }
+    }
+
+    m_result.m0 = m0;
+    m_result.hsM = 4.0 * std::sqrt(m0);
+    m_result.tpS = peakBin ? 1.0 / (peakBin * m_df) : 0.0;
+    m_result.segments = m_segmentCount;
+    m_segmentCount = 0;
+}
+//--------------------------------------------------------------------------------------------------
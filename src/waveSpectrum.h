@@ -0,0 +1,70 @@
+#ifndef WAVESPECTRUM_H_
+#define WAVESPECTRUM_H_
+
+//------------------------------------------ Includes ----------------------------------------------
+
+#include "types/sdkTypes.h"
+#include "realFft.h"
+#include <complex>
+#include <vector>
+
+//--------------------------------------- Class Definition -----------------------------------------
+
+namespace IslSdk
+{
+    // Streaming Welch power spectral density estimator for a depth time series. Samples are collected
+    // into 50% overlapping Hann windowed segments, each segment is transformed when complete and its
+    // periodogram added to a running average. A sea state result is produced every report interval.
+    class WaveSpectrum
+    {
+    public:
+        struct Result
+        {
+            real_t hsM;                 // Significant wave height, 4 * sqrt(m0)
+            real_t tpS;                 // Peak period
+            real_t m0;                  // Zeroth spectral moment over the wave band (m^2)
+            uint_t segments;            // Number of segments averaged
+            Result() : hsM(0), tpS(0), m0(0), segments(0) {}
+        };
+
+        WaveSpectrum();
+        void setup(real_t sampleRateHz, uint_t segmentSize, real_t reportIntervalS, real_t minFreqHz = 0.04, real_t maxFreqHz = 1.0);
+        void reset();
+        bool_t add(real_t depthM);                                  // Returns true when a new result is ready
+        const Result& result() const { return m_result; }
+        const std::vector<real_t>& psd() const { return m_psd; }    // One sided PSD (m^2/Hz) of the last result
+        real_t binWidthHz() const { return m_df; }
+
+    private:
+        RealFft m_fft;
+        real_t m_sampleRateHz;
+        real_t m_df;
+        uint_t m_size;
+        uint_t m_hop;
+        uint_t m_minBin;
+        uint_t m_maxBin;
+        uint_t m_reportSamples;
+        real_t m_psdScale;
+        real_t m_tMean;
+        real_t m_tVar;
+
+        std::vector<real_t> m_window;
+        std::vector<real_t> m_ring;
+        std::vector<real_t> m_segment;
+        std::vector<std::complex<real_t>> m_spectrum;
+        std::vector<real_t> m_psdSum;
+        std::vector<real_t> m_psd;
+        uint_t m_ringIdx;
+        uint_t m_sampleCount;
+        uint_t m_hopCount;
+        uint_t m_samplesSinceReport;
+        uint_t m_segmentCount;
+        Result m_result;
+
+        void processSegment();
+        void computeResult();
+    };
+}
+
+//--------------------------------------------------------------------------------------------------
+#endif